@@ -1,14 +1,33 @@
 #version 450
 
 #extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout( location = 0 ) in vec2 v2fTexCoord;
 layout( location = 1 ) in vec3 v2fNormal;
 layout( location = 2 ) in vec3 v2fPos;
+layout( location = 4 ) flat in uint v2fMaterial;
 
-layout( set = 1, binding = 0 ) uniform sampler2D uTexColor;
-layout( set = 1, binding = 1 ) uniform sampler2D uTexRoughness;
-layout( set = 1, binding = 2 ) uniform sampler2D uTexMetalness;
+// bindless materials, see materials.hpp
+struct Material
+{
+	vec4  baseColorFactor;
+	float metallicFactor;
+	float roughnessFactor;
+	float alphaCutoff;
+	uint  baseColorTexture; // slots in uTextures
+	uint  metalRoughTexture;
+	uint  _pad0;
+	uint  _pad1;
+	uint  _pad2;
+};
+
+layout( scalar, set = 1, binding = 0 ) readonly buffer SMaterials
+{
+	Material materials[];
+};
+
+layout( set = 1, binding = 1 ) uniform sampler2D uTextures[];
 
 layout( scalar, set = 0, binding = 0 ) uniform UScene
 {
@@ -22,17 +41,74 @@ layout( scalar, set = 0, binding = 0 ) uniform UScene
 	uint _pad0;
 	uint _pad1;
 	uint _pad2;
-	mat4 lightVP; // p2_1.5
+	mat4 cascadeVP[4]; // cascaded shadow maps, see shadows.hpp
+	vec4 cascadeSplits; // far view depth of each cascade
+	uint cascadeCount;
+	uint _pad3;
+	uint _pad4;
+	uint _pad5;
+	vec4 pointLightPos;   // w: range (far plane of the cube faces)
+	vec4 pointLightColor; // w: 1 if the cube shadow map is rendered
+	mat4 pointFaceVP[6];  // cube map layer order
+	uint spotLightCount;  // see shadow_atlas.hpp
+	uint _pad6;
+	uint _pad7;
+	uint _pad8;
+	uvec4 clusterGrid;   // xyz: clusters per axis, w: clustered light count
+	vec4  clusterParams; // xy: clusters per pixel, z/w: log view depth to slice scale/bias
 } uScene;
 
+// must match glsl::SpotLightData; the atlas is not sampled here
+struct SpotLight
+{
+	mat4 viewProj;
+	vec4 position;  // w: range
+	vec4 direction; // w: cos of the outer cone angle
+	vec4 color;     // w: cos of the inner cone angle
+	vec4 atlasRect;
+};
+
+layout( std430, set = 0, binding = 4 ) readonly buffer SSpotLights
+{
+	SpotLight spotLights[];
+};
+
+// clustered point lights, binned per froxel by light_cluster.comp; must match glsl::ClusterLightData
+struct ClusterLight
+{
+	vec4 position; // w: range
+	vec4 color;
+};
+
+layout( std430, set = 0, binding = 6 ) readonly buffer SClusterLights
+{
+	ClusterLight clusterLights[];
+};
+
+layout( std430, set = 0, binding = 7 ) readonly buffer SClusterCounts
+{
+	uint clusterCounts[];
+};
+
+layout( std430, set = 0, binding = 8 ) readonly buffer SClusterIndices
+{
+	uint clusterIndices[];
+};
+
+const uint MAX_CLUSTER_LIGHTS = 128; // cfg::kMaxLightsPerCluster
+
 layout( location = 0 ) out vec4 oColor;
 
 const float PI = 3.14159265359;
 
 // simple light source
-vec3 LIGHT_POS = uScene.lightPos.xyz; // world space
+vec4 LIGHT_POS = uScene.lightPos; // world space; w = 0: direction towards the light
 vec3 LIGHT_COLOR = uScene.lightColor.rgb;
 
+// point light, inverse square falloff windowed to its range (unshadowed here,
+// like the directional light)
+const float POINT_INTENSITY = 20.0;
+
 // beckmann distribution function (NDF)
 float D_Beckmann(float alpha, float NdotH)
 {
@@ -63,25 +139,22 @@ float G_CookTorrance(float NdotL, float NdotV, float NdotH, float VdotH)
 	return min(1.0, min(g1, g2));
 }
 
-void main()
+// cluster of the fragment: its screen tile and the depth slice of its view
+// depth, the mapping light_cluster.comp bins with
+uint fragment_cluster()
 {
-	vec4 color = texture( uTexColor, v2fTexCoord );
-	if( color.a < 0.5 )
-		discard;
+	uvec3 grid = uScene.clusterGrid.xyz;
+	uvec2 tile = min(uvec2(gl_FragCoord.xy * uScene.clusterParams.xy), grid.xy - 1);
 
-	// material properties
-	vec3 baseColor = color.rgb;
-	float roughness = texture(uTexRoughness, v2fTexCoord).r;
-	float metalness = texture(uTexMetalness, v2fTexCoord).r;
+	float viewDepth = max(-(uScene.camera * vec4(v2fPos, 1.0)).z, 1e-4);
+	float slice = log(viewDepth) * uScene.clusterParams.z + uScene.clusterParams.w;
 
-	// geometric vectors
-	vec3 N = normalize(v2fNormal);
-	vec3 V = normalize(uScene.cameraPos.xyz - v2fPos); // correct camera pos from uniform
-	
-	// light vector
-	vec3 L_dir = LIGHT_POS - v2fPos;
-	float dist = length(L_dir);
-	vec3 L = normalize(L_dir);
+	return tile.x + grid.x * (tile.y + grid.y * uint(clamp(slice, 0.0, float(grid.z - 1))));
+}
+
+// Cook-Torrance BRDF times NdotL for one light
+vec3 shade( vec3 N, vec3 V, vec3 L, vec3 baseColor, float roughness, float metalness )
+{
 	vec3 H = normalize(L + V);
 
 	// dot products
@@ -89,12 +162,6 @@ void main()
 	float NdotV = max(dot(N, V), 0.0001); // avoid div by zero
 	float NdotH = max(dot(N, H), 0.0);
 	float VdotH = max(dot(V, H), 0.0);
-	float LdotH = max(dot(L, H), 0.0); // same as VdotH
-	const float LIGHT_INTENSITY = 1.2; // no falloff
-
-	// light radiance (no falloff)
-	vec3 Li = LIGHT_COLOR * LIGHT_INTENSITY; 
-	vec3 Lambient = vec3(0.02) * baseColor; // weak ambient
 
 	// PBR
 	// Diffuse (Lambertian)
@@ -122,7 +189,90 @@ void main()
 	
 	vec3 Lspecular = num / max(den, 0.0001);
 	
-	vec3 Lo = (Ldiffuse + Lspecular) * Li * NdotL;
+	return (Ldiffuse + Lspecular) * NdotL;
+}
+
+void main()
+{
+	Material mat = materials[v2fMaterial];
+	vec4 color = texture( uTextures[nonuniformEXT(mat.baseColorTexture)], v2fTexCoord ) * mat.baseColorFactor;
+	if( color.a < mat.alphaCutoff )
+		discard;
+
+	// material properties
+	vec3 baseColor = color.rgb;
+	float roughness = texture(uTextures[nonuniformEXT(mat.metalRoughTexture)], v2fTexCoord).r * mat.roughnessFactor;
+	float metalness = texture(uTextures[nonuniformEXT(mat.metalRoughTexture)], v2fTexCoord).r * mat.metallicFactor;
+
+	// geometric vectors
+	vec3 N = normalize(v2fNormal);
+	vec3 V = normalize(uScene.cameraPos.xyz - v2fPos); // correct camera pos from uniform
+	
+	// light vector
+	vec3 L_dir = LIGHT_POS.w == 0.0 ? LIGHT_POS.xyz : LIGHT_POS.xyz - v2fPos;
+	vec3 L = normalize(L_dir);
+	const float LIGHT_INTENSITY = 1.2; // no falloff
+
+	// light radiance (no falloff)
+	vec3 Li = LIGHT_COLOR * LIGHT_INTENSITY; 
+	vec3 Lambient = vec3(0.02) * baseColor; // weak ambient
+
+	vec3 Lo = shade(N, V, L, baseColor, roughness, metalness) * Li;
+
+	// point light
+	vec3 toPoint = uScene.pointLightPos.xyz - v2fPos;
+	float pointDist = length(toPoint);
+	if( pointDist < uScene.pointLightPos.w )
+	{
+		float window = clamp(1.0 - pow(pointDist / uScene.pointLightPos.w, 4.0), 0.0, 1.0);
+		float falloff = window * window / (pointDist * pointDist + 1.0);
+
+		vec3 Lpoint = uScene.pointLightColor.rgb * POINT_INTENSITY * falloff;
+		Lo += shade(N, V, toPoint / pointDist, baseColor, roughness, metalness) * Lpoint;
+	}
+
+	// spot lights, unshadowed
+	for( uint i = 0; i < uScene.spotLightCount; ++i )
+	{
+		SpotLight spot = spotLights[i];
+
+		vec3 toSpot = spot.position.xyz - v2fPos;
+		float spotDist = length(toSpot);
+		if( spotDist >= spot.position.w )
+			continue;
+
+		vec3 Ls = toSpot / spotDist;
+		float cone = smoothstep(spot.direction.w, spot.color.w, dot(-Ls, spot.direction.xyz));
+		float window = clamp(1.0 - pow(spotDist / spot.position.w, 4.0), 0.0, 1.0);
+		float falloff = window * window / (spotDist * spotDist + 1.0);
+
+		Lo += shade(N, V, Ls, baseColor, roughness, metalness) * spot.color.rgb * (falloff * cone);
+	}
+
+	// clustered point lights, only the ones binned into this fragment's cluster
+	uint clusterCount = 0;
+	if( uScene.clusterGrid.w > 0 )
+	{
+		uint cluster = fragment_cluster();
+		clusterCount = clusterCounts[cluster];
+
+		uint first = cluster * MAX_CLUSTER_LIGHTS;
+		uint last = first + min(clusterCount, MAX_CLUSTER_LIGHTS);
+		for( uint i = first; i < last; ++i )
+		{
+			ClusterLight light = clusterLights[clusterIndices[i]];
+
+			vec3 toLight = light.position.xyz - v2fPos;
+			float dist = length(toLight);
+			if( dist >= light.position.w )
+				continue;
+
+			float window = clamp(1.0 - pow(dist / light.position.w, 4.0), 0.0, 1.0);
+			float falloff = window * window / (dist * dist + 1.0);
+
+			Lo += shade(N, V, toLight / dist, baseColor, roughness, metalness) * light.color.rgb * falloff;
+		}
+	}
 	
 	vec3 finalColor = Lambient + Lo;
 	
@@ -16,10 +16,17 @@ layout( scalar, set = 0, binding = 0 ) uniform UScene
 
 layout( location = 0 ) out vec2 v2fTexCoord;
 layout( location = 1 ) out vec3 v2fNormal; // Just to consume input
+layout( location = 2 ) flat out uint v2fMaterial;
+
+layout( push_constant ) uniform PushConstants {
+	mat4 model; // unused, debug views draw in object space
+	uint materialIndex;
+} uPush;
 
 void main()
 {
 	v2fTexCoord = iTexCoord;
+	v2fMaterial = uPush.materialIndex;
 	v2fNormal = iNormal;
 	gl_Position = uScene.projCam * vec4( iPosition, 1.f );
 }
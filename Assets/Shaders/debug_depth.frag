@@ -4,8 +4,6 @@
 
 layout( location = 0 ) in vec2 v2fTexCoord;
 
-layout( set = 1, binding = 0 ) uniform sampler2D uTexColor;
-
 layout( scalar, set = 0, binding = 0 ) uniform UScene
 {
 	mat4 camera;
@@ -1,10 +1,31 @@
 #version 450
 
 #extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout( location = 0 ) in vec2 v2fTexCoord;
+layout( location = 2 ) flat in uint v2fMaterial;
 
-layout( set = 1, binding = 0 ) uniform sampler2D uTexColor;
+// bindless materials, see materials.hpp
+struct Material
+{
+	vec4  baseColorFactor;
+	float metallicFactor;
+	float roughnessFactor;
+	float alphaCutoff;
+	uint  baseColorTexture; // slots in uTextures
+	uint  metalRoughTexture;
+	uint  _pad0;
+	uint  _pad1;
+	uint  _pad2;
+};
+
+layout( scalar, set = 1, binding = 0 ) readonly buffer SMaterials
+{
+	Material materials[];
+};
+
+layout( set = 1, binding = 1 ) uniform sampler2D uTextures[];
 
 layout( scalar, set = 0, binding = 0 ) uniform UScene
 {
@@ -37,6 +58,7 @@ vec3 mip_color( float lod )
 
 void main()
 {
-	float lod = textureQueryLod( uTexColor, v2fTexCoord ).x;
+	uint tex = materials[v2fMaterial].baseColorTexture;
+	float lod = textureQueryLod( uTextures[nonuniformEXT(tex)], v2fTexCoord ).x;
 	oColor = vec4( mip_color(lod), 1.0 );
 }
@@ -1,15 +1,33 @@
 #version 450
 
 #extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout( location = 0 ) in vec2 v2fTexCoord;
 layout( location = 1 ) in vec3 v2fNormal;
 layout( location = 2 ) in vec3 v2fPos;
-layout( location = 3 ) in vec4 v2fLightProjPos;
+layout( location = 4 ) flat in uint v2fMaterial;
 
-layout( set = 1, binding = 0 ) uniform sampler2D uTexColor;
-layout( set = 1, binding = 1 ) uniform sampler2D uTexRoughness;
-layout( set = 1, binding = 2 ) uniform sampler2D uTexMetalness;
+// bindless materials, see materials.hpp
+struct Material
+{
+	vec4  baseColorFactor;
+	float metallicFactor;
+	float roughnessFactor;
+	float alphaCutoff;
+	uint  baseColorTexture; // slots in uTextures
+	uint  metalRoughTexture;
+	uint  _pad0;
+	uint  _pad1;
+	uint  _pad2;
+};
+
+layout( scalar, set = 1, binding = 0 ) readonly buffer SMaterials
+{
+	Material materials[];
+};
+
+layout( set = 1, binding = 1 ) uniform sampler2D uTextures[];
 
 layout( scalar, set = 0, binding = 0 ) uniform UScene
 {
@@ -23,19 +41,78 @@ layout( scalar, set = 0, binding = 0 ) uniform UScene
 	uint _pad0;
 	uint _pad1;
 	uint _pad2;
-	mat4 lightVP;
+	mat4 cascadeVP[4]; // cascaded shadow maps, see shadows.hpp
+	vec4 cascadeSplits; // far view depth of each cascade
+	uint cascadeCount;
+	uint _pad3;
+	uint _pad4;
+	uint _pad5;
+	vec4 pointLightPos;   // w: range (far plane of the cube faces)
+	vec4 pointLightColor; // w: 1 if the cube shadow map is rendered
+	mat4 pointFaceVP[6];  // cube map layer order
+	uint spotLightCount;  // spot lights with a shadow atlas tile, see shadow_atlas.hpp
+	uint _pad6;
+	uint _pad7;
+	uint _pad8;
+	uvec4 clusterGrid;   // xyz: clusters per axis, w: clustered light count
+	vec4  clusterParams; // xy: clusters per pixel, z/w: log view depth to slice scale/bias
 } uScene;
 
-layout( set = 0, binding = 1 ) uniform sampler2DShadow uShadowMap;
+// must match glsl::SpotLightData
+struct SpotLight
+{
+	mat4 viewProj;
+	vec4 position;  // w: range
+	vec4 direction; // w: cos of the outer cone angle
+	vec4 color;     // w: cos of the inner cone angle
+	vec4 atlasRect; // xy: tile offset, zw: tile size (atlas uv); zw = 0: unshadowed
+};
+
+layout( std430, set = 0, binding = 4 ) readonly buffer SSpotLights
+{
+	SpotLight spotLights[];
+};
+
+// clustered point lights, binned per froxel by light_cluster.comp; must match glsl::ClusterLightData
+struct ClusterLight
+{
+	vec4 position; // w: range
+	vec4 color;
+};
+
+layout( std430, set = 0, binding = 6 ) readonly buffer SClusterLights
+{
+	ClusterLight clusterLights[];
+};
+
+layout( std430, set = 0, binding = 7 ) readonly buffer SClusterCounts
+{
+	uint clusterCounts[];
+};
+
+layout( std430, set = 0, binding = 8 ) readonly buffer SClusterIndices
+{
+	uint clusterIndices[];
+};
+
+const uint MAX_CLUSTER_LIGHTS = 128; // cfg::kMaxLightsPerCluster
+
+layout( set = 0, binding = 1 ) uniform sampler2DArrayShadow uShadowMap; // one layer per cascade
+layout( set = 0, binding = 3 ) uniform samplerCubeShadow uPointShadowMap; // point light
+layout( set = 0, binding = 5 ) uniform sampler2DShadow uShadowAtlas; // spot lights, one tile each
 
 layout( location = 0 ) out vec4 oColor;
 
 const float PI = 3.14159265359;
 
 // simple light source
-vec3 LIGHT_POS = uScene.lightPos.xyz; // world space
+vec4 LIGHT_POS = uScene.lightPos; // world space; w = 0: direction towards the light
 vec3 LIGHT_COLOR = uScene.lightColor.rgb;
 
+// point light, inverse square falloff windowed to its range
+const float POINT_INTENSITY = 20.0;
+const float POINT_SHADOW_NEAR = 0.05; // cfg::kPointShadowNear
+
 // beckmann distribution function (NDF)
 float D_Beckmann(float alpha, float NdotH)
 {
@@ -67,55 +144,113 @@ float G_CookTorrance(float NdotL, float NdotV, float NdotH, float VdotH)
 }
 
 // p2_1.5 PCF
-float calculate_shadow()
+// cascaded shadow maps: the first cascade whose slice contains the fragment; a
+// fragment near the edge of a (stable, hence larger) cascade window may fall
+// outside of it, the next cascade covers it then
+float calculate_shadow( out uint aCascade )
 {
-	vec3 projCoords = v2fLightProjPos.xyz / v2fLightProjPos.w;
-	// projCoords are in [-1, 1], transform to [0, 1]
-	projCoords.xy = projCoords.xy * 0.5 + 0.5;
+	float viewDepth = -(uScene.camera * vec4(v2fPos, 1.0)).z;
 
-	// check bounds
-	if (projCoords.x < 0.0 || projCoords.x > 1.0 || 
-		projCoords.y < 0.0 || projCoords.y > 1.0 || 
-		projCoords.z < 0.0 || projCoords.z > 1.0) 
+	for( aCascade = 0; aCascade < uScene.cascadeCount; ++aCascade )
 	{
-		return 1.0;
+		if( viewDepth > uScene.cascadeSplits[aCascade] )
+			continue;
+
+		vec4 lightProjPos = uScene.cascadeVP[aCascade] * vec4(v2fPos, 1.0);
+		vec3 projCoords = lightProjPos.xyz / lightProjPos.w;
+		// projCoords.xy are in [-1, 1], transform to [0, 1]
+		projCoords.xy = projCoords.xy * 0.5 + 0.5;
+
+		// check bounds
+		if (projCoords.x < 0.0 || projCoords.x > 1.0 || 
+			projCoords.y < 0.0 || projCoords.y > 1.0 || 
+			projCoords.z < 0.0 || projCoords.z > 1.0) 
+		{
+			continue;
+		}
+
+		// PCF
+		float shadow = 0.0;
+		vec2 texelSize = 1.0 / textureSize(uShadowMap, 0).xy;
+		
+		// 3x3 PCF
+		for(int x = -1; x <= 1; ++x)
+		{
+			for(int y = -1; y <= 1; ++y)
+			{
+				// sampler2DArrayShadow automatic comparison, layer = cascade
+				shadow += texture(uShadowMap, vec4(projCoords.xy + vec2(x, y) * texelSize, float(aCascade), projCoords.z)); 
+			}
+		}
+		
+		return shadow / 9.0;
 	}
 
-	// PCF
+	// beyond the shadow distance
+	return 1.0;
+}
+
+// point light cube shadow map; aToFrag is the light to fragment vector. The face
+// that covers it is the one of its major axis, whose view depth is that component,
+// so the reference is that depth through the face projection (perspectiveRH_ZO)
+float calculate_point_shadow( vec3 aToFrag )
+{
+	if( 0.0 == uScene.pointLightColor.w )
+		return 1.0;
+
+	vec3 a = abs(aToFrag);
+	float z = max(a.x, max(a.y, a.z));
+	float n = POINT_SHADOW_NEAR;
+	float f = uScene.pointLightPos.w;
+	float depth = f / (f - n) - (f * n / (f - n)) / z;
+
+	return texture(uPointShadowMap, vec4(aToFrag, depth));
+}
+
+// spot light shadow atlas; the PCF taps are clamped to half a texel inside the
+// light's tile, so they never read a neighbouring one
+float calculate_spot_shadow( SpotLight aLight, vec3 aPos )
+{
+	if( 0.0 == aLight.atlasRect.z )
+		return 1.0;
+
+	vec4 lightProjPos = aLight.viewProj * vec4(aPos, 1.0);
+	vec3 projCoords = lightProjPos.xyz / lightProjPos.w;
+	if( projCoords.z < 0.0 || projCoords.z > 1.0 )
+		return 1.0;
+
+	vec2 uv = aLight.atlasRect.xy + (projCoords.xy * 0.5 + 0.5) * aLight.atlasRect.zw;
+
+	vec2 texelSize = 1.0 / vec2(textureSize(uShadowAtlas, 0));
+	vec2 lo = aLight.atlasRect.xy + 0.5 * texelSize;
+	vec2 hi = aLight.atlasRect.xy + aLight.atlasRect.zw - 0.5 * texelSize;
+
 	float shadow = 0.0;
-	vec2 texelSize = 1.0 / textureSize(uShadowMap, 0);
-	
-	// 3x3 PCF
 	for(int x = -1; x <= 1; ++x)
 	{
 		for(int y = -1; y <= 1; ++y)
-		{
-
-			// sampler2DShadow automatic comparison
-			shadow += texture(uShadowMap, vec3(projCoords.xy + vec2(x, y) * texelSize, projCoords.z)); 
-		}
+			shadow += texture(uShadowAtlas, vec3(clamp(uv + vec2(x, y) * texelSize, lo, hi), projCoords.z));
 	}
-	
-	shadow /= 9.0;
 
-	return shadow;
+	return shadow / 9.0;
 }
 
-void main()
+// cluster of the fragment: its screen tile and the depth slice of its view
+// depth, the mapping light_cluster.comp bins with
+uint fragment_cluster()
 {
-	// material properties
-	vec3 baseColor = texture(uTexColor, v2fTexCoord).rgb;
-	float roughness = texture(uTexRoughness, v2fTexCoord).r;
-	float metalness = texture(uTexMetalness, v2fTexCoord).r;
+	uvec3 grid = uScene.clusterGrid.xyz;
+	uvec2 tile = min(uvec2(gl_FragCoord.xy * uScene.clusterParams.xy), grid.xy - 1);
 
-	// geometric vectors
-	vec3 N = normalize(v2fNormal);
-	vec3 V = normalize(uScene.cameraPos.xyz - v2fPos); 
-	
-	// light vector
-	vec3 L_dir = LIGHT_POS - v2fPos;
-	float dist = length(L_dir);
-	vec3 L = normalize(L_dir);
+	float viewDepth = max(-(uScene.camera * vec4(v2fPos, 1.0)).z, 1e-4);
+	float slice = log(viewDepth) * uScene.clusterParams.z + uScene.clusterParams.w;
+
+	return tile.x + grid.x * (tile.y + grid.y * uint(clamp(slice, 0.0, float(grid.z - 1))));
+}
+
+// Cook-Torrance BRDF times NdotL for one light
+vec3 shade( vec3 N, vec3 V, vec3 L, vec3 baseColor, float roughness, float metalness )
+{
 	vec3 H = normalize(L + V);
 
 	// dot products
@@ -123,14 +258,6 @@ void main()
 	float NdotV = max(dot(N, V), 0.0001); // avoid div by zero
 	float NdotH = max(dot(N, H), 0.0);
 	float VdotH = max(dot(V, H), 0.0);
-	float LdotH = max(dot(L, H), 0.0); // same as VdotH
-	const float LIGHT_INTENSITY = 1.2; // no falloff
-
-	float shadow = calculate_shadow();
-
-	// light radiance (no falloff)
-	vec3 Li = LIGHT_COLOR * LIGHT_INTENSITY * shadow; 
-	vec3 Lambient = vec3(0.02) * baseColor; // weak ambient
 
 	// PBR
 	// Diffuse (Lambertian)
@@ -158,7 +285,96 @@ void main()
 	
 	vec3 Lspecular = num / max(den, 0.0001);
 	
-	vec3 Lo = (Ldiffuse + Lspecular) * Li * NdotL;
+	return (Ldiffuse + Lspecular) * NdotL;
+}
+
+void main()
+{
+	// material properties
+	Material mat = materials[v2fMaterial];
+	vec3 baseColor = texture(uTextures[nonuniformEXT(mat.baseColorTexture)], v2fTexCoord).rgb * mat.baseColorFactor.rgb;
+	float roughness = texture(uTextures[nonuniformEXT(mat.metalRoughTexture)], v2fTexCoord).r * mat.roughnessFactor;
+	float metalness = texture(uTextures[nonuniformEXT(mat.metalRoughTexture)], v2fTexCoord).r * mat.metallicFactor;
+
+	// geometric vectors
+	vec3 N = normalize(v2fNormal);
+	vec3 V = normalize(uScene.cameraPos.xyz - v2fPos); 
+	
+	// light vector
+	vec3 L_dir = LIGHT_POS.w == 0.0 ? LIGHT_POS.xyz : LIGHT_POS.xyz - v2fPos;
+	vec3 L = normalize(L_dir);
+	const float LIGHT_INTENSITY = 1.2; // no falloff
+
+	uint cascade;
+	float shadow = calculate_shadow( cascade );
+
+	// light radiance (no falloff)
+	vec3 Li = LIGHT_COLOR * LIGHT_INTENSITY * shadow; 
+	vec3 Lambient = vec3(0.02) * baseColor; // weak ambient
+
+	vec3 Lo = shade(N, V, L, baseColor, roughness, metalness) * Li;
+
+	// point light; the shadow lookup is offset along the normal against acne
+	vec3 toPoint = uScene.pointLightPos.xyz - v2fPos;
+	float pointDist = length(toPoint);
+	float pointShadow = 1.0;
+	if( pointDist < uScene.pointLightPos.w )
+	{
+		float window = clamp(1.0 - pow(pointDist / uScene.pointLightPos.w, 4.0), 0.0, 1.0);
+		float falloff = window * window / (pointDist * pointDist + 1.0);
+
+		pointShadow = calculate_point_shadow( v2fPos + N * 0.02 - uScene.pointLightPos.xyz );
+
+		vec3 Lpoint = uScene.pointLightColor.rgb * POINT_INTENSITY * falloff * pointShadow;
+		Lo += shade(N, V, toPoint / pointDist, baseColor, roughness, metalness) * Lpoint;
+	}
+
+	// spot lights: cone and the same windowed falloff
+	for( uint i = 0; i < uScene.spotLightCount; ++i )
+	{
+		SpotLight spot = spotLights[i];
+
+		vec3 toSpot = spot.position.xyz - v2fPos;
+		float spotDist = length(toSpot);
+		if( spotDist >= spot.position.w )
+			continue;
+
+		vec3 Ls = toSpot / spotDist;
+		float cone = smoothstep(spot.direction.w, spot.color.w, dot(-Ls, spot.direction.xyz));
+		if( cone <= 0.0 )
+			continue;
+
+		float window = clamp(1.0 - pow(spotDist / spot.position.w, 4.0), 0.0, 1.0);
+		float falloff = window * window / (spotDist * spotDist + 1.0);
+		float spotShadow = calculate_spot_shadow( spot, v2fPos + N * 0.02 );
+
+		Lo += shade(N, V, Ls, baseColor, roughness, metalness) * spot.color.rgb * (falloff * cone * spotShadow);
+	}
+
+	// clustered point lights, only the ones binned into this fragment's cluster
+	uint clusterCount = 0;
+	if( uScene.clusterGrid.w > 0 )
+	{
+		uint cluster = fragment_cluster();
+		clusterCount = clusterCounts[cluster];
+
+		uint first = cluster * MAX_CLUSTER_LIGHTS;
+		uint last = first + min(clusterCount, MAX_CLUSTER_LIGHTS);
+		for( uint i = first; i < last; ++i )
+		{
+			ClusterLight light = clusterLights[clusterIndices[i]];
+
+			vec3 toLight = light.position.xyz - v2fPos;
+			float dist = length(toLight);
+			if( dist >= light.position.w )
+				continue;
+
+			float window = clamp(1.0 - pow(dist / light.position.w, 4.0), 0.0, 1.0);
+			float falloff = window * window / (dist * dist + 1.0);
+
+			Lo += shade(N, V, toLight / dist, baseColor, roughness, metalness) * light.color.rgb * falloff;
+		}
+	}
 	
 	vec3 color = Lambient + Lo;
 
@@ -166,8 +382,25 @@ void main()
 	if( uScene.renderMode == 6 )
 	{
 		// shadow map debug
-		// 1.0 = lit (white), 0.0 = shadow (black)
-		color = vec3(shadow); 
+		// 1.0 = lit (white), 0.0 = shadow (black), tinted by cascade
+		const vec3 CASCADE_TINT[5] = vec3[5](
+			vec3(1.0, 0.6, 0.6), vec3(0.6, 1.0, 0.6), vec3(0.6, 0.6, 1.0), vec3(1.0, 1.0, 0.6),
+			vec3(1.0) // not covered
+		);
+		// darker where the point light is shadowed
+		color = vec3(shadow) * CASCADE_TINT[min(cascade, 4u)] * (0.5 + 0.5 * pointShadow); 
+	}
+	else if( uScene.renderMode == 7 )
+	{
+		// lights per cluster, log scale from blue (none) over green to red
+		// (MAX_CLUSTER_LIGHTS); magenta where lights were dropped
+		float t = log2(float(clusterCount) + 1.0) / log2(float(MAX_CLUSTER_LIGHTS) + 1.0);
+		vec3 heat = clamp(vec3(4.0 * t - 2.0, 2.0 - abs(4.0 * t - 2.0), 2.0 - 4.0 * t), 0.0, 1.0);
+		if( clusterCount > MAX_CLUSTER_LIGHTS )
+			heat = vec3(1.0, 0.0, 1.0);
+
+		// shaded a little so the geometry stays readable
+		color = heat * (0.35 + 0.65 * max(dot(N, V), 0.0));
 	}
 	
 	oColor = vec4(color, 1.0);
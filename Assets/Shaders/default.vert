@@ -18,22 +18,32 @@ layout( scalar, set = 0, binding = 0 ) uniform UScene
 	uint _pad0;
 	uint _pad1;
 	uint _pad2;
-	mat4 lightVP; // p2_1.5
+	mat4 cascadeVP[4]; // cascaded shadow maps, see shadows.hpp
+	vec4 cascadeSplits; // far view depth of each cascade
+	uint cascadeCount;
+	uint _pad3;
+	uint _pad4;
+	uint _pad5;
 } uScene;
 
 layout( location = 0 ) out vec2 v2fTexCoord;
 layout( location = 1 ) out vec3 v2fNormal;
 layout( location = 2 ) out vec3 v2fPos;
-layout( location = 3 ) out vec4 v2fLightProjPos; // p_1.5
+layout( location = 4 ) flat out uint v2fMaterial;
+
+// bit identical to the depth pre-pass (prepass*.vert), which the main pass tests EQUAL against
+invariant gl_Position;
 
 //import modelmatrix in glb
 layout( push_constant ) uniform PushConstants {
 	mat4 model; 
+	uint materialIndex; // bindless material, see glsl::DrawPush
 } uPush;
 
 void main()
 {
 	v2fTexCoord = iTexCoord;
+	v2fMaterial = uPush.materialIndex;
 	
 	v2fNormal = normalize(mat3(uPush.model) * iNormal);
 	// Pass original normal
@@ -43,7 +53,4 @@ void main()
 	v2fPos = worldPos.xyz;
 
 	gl_Position = uScene.projCam * worldPos;
-
-	// p_1.5 position in light space
-	v2fLightProjPos = uScene.lightVP * worldPos;
 }
@@ -0,0 +1,68 @@
+#version 450
+
+#extension GL_EXT_scalar_block_layout : require
+
+layout( location = 0 ) in vec3 iPosition;
+layout( location = 1 ) in vec2 iTexCoord;
+layout( location = 2 ) in vec3 iNormal;
+
+layout( scalar, set = 0, binding = 0 ) uniform UScene
+{
+	mat4 camera;
+	mat4 projection;
+	mat4 projCam;
+	vec4 cameraPos;
+	vec4 lightPos;
+	vec4 lightColor;
+	uint renderMode;
+	uint _pad0;
+	uint _pad1;
+	uint _pad2;
+	mat4 cascadeVP[4]; // cascaded shadow maps, see shadows.hpp
+	vec4 cascadeSplits; // far view depth of each cascade
+	uint cascadeCount;
+	uint _pad3;
+	uint _pad4;
+	uint _pad5;
+} uScene;
+
+layout( location = 0 ) out vec2 v2fTexCoord;
+layout( location = 1 ) out vec3 v2fNormal;
+layout( location = 2 ) out vec3 v2fPos;
+layout( location = 4 ) flat out uint v2fMaterial;
+
+// bit identical to the depth pre-pass (prepass*.vert), which the main pass tests EQUAL against
+invariant gl_Position;
+
+// GPU-driven path: model matrix comes from the instance buffer,
+// firstInstance of each indirect draw is the instance index
+struct Instance
+{
+	mat4 model;
+	uint meshIndex;
+	uint materialIndex;
+	uint bucket;   // (pipeline, dynamic caster), see IndirectDrawBucket
+	uint drawBase; // first command slot of the bucket
+};
+
+layout( scalar, set = 0, binding = 2 ) readonly buffer SInstances
+{
+	Instance instances[];
+};
+
+void main()
+{
+	mat4 model = instances[gl_InstanceIndex].model;
+
+	v2fTexCoord = iTexCoord;
+	v2fMaterial = instances[gl_InstanceIndex].materialIndex;
+	
+	v2fNormal = normalize(mat3(model) * iNormal);
+	// Pass original normal
+	// object space = world space for static
+
+	vec4 worldPos = model * vec4(iPosition, 1.f);
+	v2fPos = worldPos.xyz;
+
+	gl_Position = uScene.projCam * worldPos;
+}
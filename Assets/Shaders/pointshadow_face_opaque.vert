@@ -0,0 +1,48 @@
+#version 450
+
+#extension GL_EXT_scalar_block_layout : require
+
+// point light cube shadow map, one pass per face (point shadow mode 2, see
+// shadows.hpp): faceMask holds only the face of the pass, whose 2D view is the
+// render target; no gl_Layer, so no shaderOutputLayer needed
+
+layout( location = 0 ) in vec3 iPos;
+// position only: opaque casters, drawn without fragment shader (pointshadow.vert draws the alpha tested ones)
+
+layout( scalar, set = 0, binding = 0 ) uniform UScene
+{
+	mat4 camera;
+	mat4 projection;
+	mat4 projCam;
+	vec4 cameraPos;
+	vec4 lightPos;
+	vec4 lightColor;
+	uint renderMode;
+	uint _pad0;
+	uint _pad1;
+	uint _pad2;
+	mat4 cascadeVP[4]; // cascaded shadow maps, see shadows.hpp
+	vec4 cascadeSplits; // far view depth of each cascade
+	uint cascadeCount;
+	uint _pad3;
+	uint _pad4;
+	uint _pad5;
+	vec4 pointLightPos;   // w: range (far plane of the cube faces)
+	vec4 pointLightColor; // w: 1 if the cube shadow map is rendered
+	mat4 pointFaceVP[6];  // cube map layer order
+} uScene;
+
+
+layout( push_constant ) uniform PushConstants {
+	mat4 model; 
+	uint materialIndex; // bindless material, see glsl::DrawPush
+	uint cascade;       // unused
+	uint faceMask;      // the face of the pass
+} uPush;
+
+void main()
+{
+	uint face = uint( findLSB( uPush.faceMask ) );
+
+	gl_Position = uScene.pointFaceVP[face] * uPush.model * vec4(iPos, 1.0);
+}
@@ -0,0 +1,65 @@
+#version 450
+
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_ARB_shader_viewport_layer_array : require
+
+// GPU-driven point light shadow: cull.comp writes one command per (instance,
+// cube face) pair with firstInstance = 6 * instance + face, see shadows.hpp
+
+layout( location = 0 ) in vec3 iPos;
+layout( location = 1 ) in vec2 iTexCoord;
+// no normal input
+
+layout( location = 0 ) out vec2 v2fTexCoord;
+layout( location = 1 ) flat out uint v2fMaterial;
+
+layout( scalar, set = 0, binding = 0 ) uniform UScene
+{
+	mat4 camera;
+	mat4 projection;
+	mat4 projCam;
+	vec4 cameraPos;
+	vec4 lightPos;
+	vec4 lightColor;
+	uint renderMode;
+	uint _pad0;
+	uint _pad1;
+	uint _pad2;
+	mat4 cascadeVP[4]; // cascaded shadow maps, see shadows.hpp
+	vec4 cascadeSplits; // far view depth of each cascade
+	uint cascadeCount;
+	uint _pad3;
+	uint _pad4;
+	uint _pad5;
+	vec4 pointLightPos;   // w: range (far plane of the cube faces)
+	vec4 pointLightColor; // w: 1 if the cube shadow map is rendered
+	mat4 pointFaceVP[6];  // cube map layer order
+} uScene;
+
+
+struct Instance
+{
+	mat4 model;
+	uint meshIndex;
+	uint materialIndex;
+	uint bucket;   // (pipeline, dynamic caster), see IndirectDrawBucket
+	uint drawBase; // first command slot of the bucket
+};
+
+// GPU-driven path: model matrix from the instance buffer (see default_indirect.vert)
+layout( scalar, set = 0, binding = 2 ) readonly buffer SInstances
+{
+	Instance instances[];
+};
+
+void main()
+{
+	uint id = uint(gl_InstanceIndex) / 6;
+	uint face = uint(gl_InstanceIndex) % 6;
+
+	v2fTexCoord = iTexCoord;
+	v2fMaterial = instances[id].materialIndex;
+	
+	gl_Layer = int(face);
+	gl_Position = uScene.pointFaceVP[face] * instances[id].model * vec4(iPos, 1.0);
+}
@@ -0,0 +1,58 @@
+#version 450
+
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_ARB_shader_viewport_layer_array : require
+
+// point light cube shadow map, all faces in one layered pass (see shadows.hpp)
+// the draw has one instance per cube face the caster overlaps; instance n goes
+// to the n-th face set in faceMask
+
+layout( location = 0 ) in vec3 iPos;
+// position only: opaque casters, drawn without fragment shader (pointshadow.vert draws the alpha tested ones)
+
+layout( scalar, set = 0, binding = 0 ) uniform UScene
+{
+	mat4 camera;
+	mat4 projection;
+	mat4 projCam;
+	vec4 cameraPos;
+	vec4 lightPos;
+	vec4 lightColor;
+	uint renderMode;
+	uint _pad0;
+	uint _pad1;
+	uint _pad2;
+	mat4 cascadeVP[4]; // cascaded shadow maps, see shadows.hpp
+	vec4 cascadeSplits; // far view depth of each cascade
+	uint cascadeCount;
+	uint _pad3;
+	uint _pad4;
+	uint _pad5;
+	vec4 pointLightPos;   // w: range (far plane of the cube faces)
+	vec4 pointLightColor; // w: 1 if the cube shadow map is rendered
+	mat4 pointFaceVP[6];  // cube map layer order
+} uScene;
+
+
+layout( push_constant ) uniform PushConstants {
+	mat4 model; 
+	uint materialIndex; // bindless material, see glsl::DrawPush
+	uint cascade;       // unused
+	uint faceMask;      // cube faces the caster overlaps
+} uPush;
+
+// index of the n-th set bit of aMask
+uint nth_face( uint aMask, uint aN )
+{
+	for( uint i = 0; i < aN; ++i )
+		aMask &= aMask - 1; // clear the lowest set bit
+	return uint( findLSB( aMask ) );
+}
+
+void main()
+{
+	uint face = nth_face( uPush.faceMask, uint(gl_InstanceIndex) );
+
+	gl_Layer = int(face);
+	gl_Position = uScene.pointFaceVP[face] * uPush.model * vec4(iPos, 1.0);
+}
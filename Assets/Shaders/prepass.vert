@@ -0,0 +1,27 @@
+#version 450
+
+#extension GL_EXT_scalar_block_layout : require
+
+layout( location = 0 ) in vec3 iPosition;
+// position only
+
+layout( scalar, set = 0, binding = 0 ) uniform UScene
+{
+	mat4 camera;
+	mat4 projection;
+	mat4 projCam;
+} uScene;
+
+// same transform as default.vert, see there
+invariant gl_Position;
+
+layout( push_constant ) uniform PushConstants {
+	mat4 model; 
+	uint materialIndex; // bindless material, see glsl::DrawPush
+} uPush;
+
+void main()
+{
+	vec4 worldPos = uPush.model * vec4(iPosition, 1.f);
+	gl_Position = uScene.projCam * worldPos;
+}
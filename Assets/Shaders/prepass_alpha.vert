@@ -0,0 +1,34 @@
+#version 450
+
+#extension GL_EXT_scalar_block_layout : require
+
+layout( location = 0 ) in vec3 iPosition;
+layout( location = 1 ) in vec2 iTexCoord;
+
+layout( scalar, set = 0, binding = 0 ) uniform UScene
+{
+	mat4 camera;
+	mat4 projection;
+	mat4 projCam;
+} uScene;
+
+// alpha test in shadowmap.frag
+layout( location = 0 ) out vec2 v2fTexCoord;
+layout( location = 1 ) flat out uint v2fMaterial;
+
+// same transform as default.vert, see there
+invariant gl_Position;
+
+layout( push_constant ) uniform PushConstants {
+	mat4 model; 
+	uint materialIndex; // bindless material, see glsl::DrawPush
+} uPush;
+
+void main()
+{
+	v2fTexCoord = iTexCoord;
+	v2fMaterial = uPush.materialIndex;
+
+	vec4 worldPos = uPush.model * vec4(iPosition, 1.f);
+	gl_Position = uScene.projCam * worldPos;
+}
@@ -0,0 +1,39 @@
+#version 450
+
+#extension GL_EXT_scalar_block_layout : require
+
+layout( location = 0 ) in vec3 iPosition;
+// position only
+
+layout( scalar, set = 0, binding = 0 ) uniform UScene
+{
+	mat4 camera;
+	mat4 projection;
+	mat4 projCam;
+} uScene;
+
+// same transform as default_indirect.vert, see there
+invariant gl_Position;
+
+// GPU-driven path: model matrix from the instance buffer (see default_indirect.vert)
+struct Instance
+{
+	mat4 model;
+	uint meshIndex;
+	uint materialIndex;
+	uint bucket;   // (pipeline, dynamic caster), see IndirectDrawBucket
+	uint drawBase; // first command slot of the bucket
+};
+
+layout( scalar, set = 0, binding = 2 ) readonly buffer SInstances
+{
+	Instance instances[];
+};
+
+void main()
+{
+	mat4 model = instances[gl_InstanceIndex].model;
+
+	vec4 worldPos = model * vec4(iPosition, 1.f);
+	gl_Position = uScene.projCam * worldPos;
+}
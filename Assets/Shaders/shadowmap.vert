@@ -7,6 +7,7 @@ layout( location = 1 ) in vec2 iTexCoord;
 // no normal input
 
 layout( location = 0 ) out vec2 v2fTexCoord;
+layout( location = 1 ) flat out uint v2fMaterial;
 
 layout( scalar, set = 0, binding = 0 ) uniform UScene
 {
@@ -20,13 +21,25 @@ layout( scalar, set = 0, binding = 0 ) uniform UScene
 	uint _pad0;
 	uint _pad1;
 	uint _pad2;
-	mat4 lightVP; // p2_1.5 add light matrix
+	mat4 cascadeVP[4]; // cascaded shadow maps, see shadows.hpp
+	vec4 cascadeSplits; // far view depth of each cascade
+	uint cascadeCount;
+	uint _pad3;
+	uint _pad4;
+	uint _pad5;
 } uScene;
 
 
+layout( push_constant ) uniform PushConstants {
+	mat4 model; 
+	uint materialIndex; // bindless material, see glsl::DrawPush
+	uint cascade;       // layer of the shadow map, index into cascadeVP
+} uPush;
+
 void main()
 {
 	v2fTexCoord = iTexCoord;
+	v2fMaterial = uPush.materialIndex;
 	
-	gl_Position = uScene.lightVP * vec4(iPos, 1.0);
+	gl_Position = uScene.cascadeVP[uPush.cascade] * uPush.model * vec4(iPos, 1.0);
 }
@@ -0,0 +1,52 @@
+#version 450
+
+#extension GL_EXT_scalar_block_layout : require
+
+layout( location = 0 ) in vec3 iPos;
+// position only: opaque casters, drawn without fragment shader (shadowmap_indirect.vert draws the alpha tested ones)
+
+layout( scalar, set = 0, binding = 0 ) uniform UScene
+{
+	mat4 camera;
+	mat4 projection;
+	mat4 projCam;
+	vec4 cameraPos;
+	vec4 lightPos;
+	vec4 lightColor;
+	uint renderMode;
+	uint _pad0;
+	uint _pad1;
+	uint _pad2;
+	mat4 cascadeVP[4]; // cascaded shadow maps, see shadows.hpp
+	vec4 cascadeSplits; // far view depth of each cascade
+	uint cascadeCount;
+	uint _pad3;
+	uint _pad4;
+	uint _pad5;
+} uScene;
+
+
+struct Instance
+{
+	mat4 model;
+	uint meshIndex;
+	uint materialIndex;
+	uint bucket;   // (pipeline, dynamic caster), see IndirectDrawBucket
+	uint drawBase; // first command slot of the bucket
+};
+
+// GPU-driven path: model matrix from the instance buffer (see default_indirect.vert)
+layout( scalar, set = 0, binding = 2 ) readonly buffer SInstances
+{
+	Instance instances[];
+};
+
+// only the cascade of glsl::DrawPush is pushed on this path
+layout( push_constant ) uniform PushConstants {
+	layout( offset = 68 ) uint cascade;
+} uPush;
+
+void main()
+{
+	gl_Position = uScene.cascadeVP[uPush.cascade] * instances[gl_InstanceIndex].model * vec4(iPos, 1.0);
+}
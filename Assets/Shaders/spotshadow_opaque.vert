@@ -0,0 +1,35 @@
+#version 450
+
+#extension GL_EXT_scalar_block_layout : require
+
+// spot light shadow atlas (see shadow_atlas.hpp); the viewport selects the
+// light's tile, the push constant cascade the light
+
+layout( location = 0 ) in vec3 iPos;
+// position only: opaque casters, drawn without fragment shader (spotshadow.vert draws the alpha tested ones)
+
+struct SpotLight
+{
+	mat4 viewProj;
+	vec4 position;  // w: range
+	vec4 direction; // w: cos of the outer cone angle
+	vec4 color;     // w: cos of the inner cone angle
+	vec4 atlasRect; // xy: tile offset, zw: tile size (atlas uv); zw = 0: unshadowed
+};
+
+layout( std430, set = 0, binding = 4 ) readonly buffer SSpotLights
+{
+	SpotLight spotLights[];
+};
+
+
+layout( push_constant ) uniform PushConstants {
+	mat4 model; 
+	uint materialIndex; // bindless material, see glsl::DrawPush
+	uint cascade;       // spot light index
+} uPush;
+
+void main()
+{
+	gl_Position = spotLights[uPush.cascade].viewProj * uPush.model * vec4(iPos, 1.0);
+}
@@ -0,0 +1,15 @@
+#version 450
+
+// Visibility buffer
+// no shading here: the instance and the triangle of the closest surface are all
+// that is stored, visbuffer_resolve.frag shades every pixel once afterwards.
+// gl_PrimitiveID counts the triangles from the draw's firstIndex.
+
+layout( location = 2 ) flat in uint v2fInstance;
+
+layout( location = 0 ) out uvec2 oVisibility;
+
+void main()
+{
+	oVisibility = uvec2(v2fInstance, uint(gl_PrimitiveID));
+}
@@ -0,0 +1,35 @@
+#version 450
+
+#extension GL_EXT_scalar_block_layout : require
+
+layout( location = 0 ) in vec3 iPosition;
+// position only
+
+layout( scalar, set = 0, binding = 0 ) uniform UScene
+{
+	mat4 camera;
+	mat4 projection;
+	mat4 projCam;
+} uScene;
+
+// visibility buffer: the instance is written out with the triangle, see visbuffer.frag
+layout( location = 2 ) flat out uint v2fInstance;
+
+// same transform as default.vert; the resolve rebuilds the triangle with it
+invariant gl_Position;
+
+layout( push_constant ) uniform PushConstants {
+	mat4 model; 
+	uint materialIndex; // bindless material, see glsl::DrawPush
+	uint cascade;
+	uint faceMask;
+	uint instance;      // index into the instance buffer
+} uPush;
+
+void main()
+{
+	v2fInstance = uPush.instance;
+
+	vec4 worldPos = uPush.model * vec4(iPosition, 1.f);
+	gl_Position = uScene.projCam * worldPos;
+}
@@ -0,0 +1,44 @@
+#version 450
+
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout( location = 0 ) in vec2 v2fTexCoord;
+layout( location = 1 ) flat in uint v2fMaterial;
+layout( location = 2 ) flat in uint v2fInstance;
+
+// Visibility buffer, alpha tested surfaces: the alpha test of alpha.frag, then
+// the same output as visbuffer.frag
+
+// bindless materials, see materials.hpp
+struct Material
+{
+	vec4  baseColorFactor;
+	float metallicFactor;
+	float roughnessFactor;
+	float alphaCutoff;
+	uint  baseColorTexture; // slots in uTextures
+	uint  metalRoughTexture;
+	uint  _pad0;
+	uint  _pad1;
+	uint  _pad2;
+};
+
+layout( scalar, set = 1, binding = 0 ) readonly buffer SMaterials
+{
+	Material materials[];
+};
+
+layout( set = 1, binding = 1 ) uniform sampler2D uTextures[];
+
+layout( location = 0 ) out uvec2 oVisibility;
+
+void main()
+{
+	Material mat = materials[v2fMaterial];
+	float alpha = texture(uTextures[nonuniformEXT(mat.baseColorTexture)], v2fTexCoord).a * mat.baseColorFactor.a;
+	if( alpha < mat.alphaCutoff )
+		discard;
+
+	oVisibility = uvec2(v2fInstance, uint(gl_PrimitiveID));
+}
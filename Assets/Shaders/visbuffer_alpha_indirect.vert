@@ -0,0 +1,48 @@
+#version 450
+
+#extension GL_EXT_scalar_block_layout : require
+
+layout( location = 0 ) in vec3 iPosition;
+layout( location = 1 ) in vec2 iTexCoord;
+
+layout( scalar, set = 0, binding = 0 ) uniform UScene
+{
+	mat4 camera;
+	mat4 projection;
+	mat4 projCam;
+} uScene;
+
+// alpha test in visbuffer_alpha.frag
+layout( location = 0 ) out vec2 v2fTexCoord;
+layout( location = 1 ) flat out uint v2fMaterial;
+layout( location = 2 ) flat out uint v2fInstance;
+
+// same transform as default_indirect.vert; the resolve rebuilds the triangle with it
+invariant gl_Position;
+
+// GPU-driven path: model matrix from the instance buffer (see default_indirect.vert)
+struct Instance
+{
+	mat4 model;
+	uint meshIndex;
+	uint materialIndex;
+	uint bucket;   // (pipeline, dynamic caster), see IndirectDrawBucket
+	uint drawBase; // first command slot of the bucket
+};
+
+layout( scalar, set = 0, binding = 2 ) readonly buffer SInstances
+{
+	Instance instances[];
+};
+
+void main()
+{
+	mat4 model = instances[gl_InstanceIndex].model;
+
+	v2fTexCoord = iTexCoord;
+	v2fMaterial = instances[gl_InstanceIndex].materialIndex;
+	v2fInstance = gl_InstanceIndex;
+
+	vec4 worldPos = model * vec4(iPosition, 1.f);
+	gl_Position = uScene.projCam * worldPos;
+}
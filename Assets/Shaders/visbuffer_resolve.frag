@@ -0,0 +1,526 @@
+#version 450
+
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Visibility buffer resolve
+// one full-screen pass over the visibility buffer: every covered pixel rebuilds
+// its triangle from the instance and triangle ids (indices and vertex streams as
+// storage buffers), interpolates the attributes with perspective correct
+// barycentrics and runs the lighting of default.frag once. Texture gradients
+// come from the barycentrics of the neighbouring pixels on the same triangle's
+// plane, as there are no helper lanes across triangles here.
+
+// bindless materials, see materials.hpp
+struct Material
+{
+	vec4  baseColorFactor;
+	float metallicFactor;
+	float roughnessFactor;
+	float alphaCutoff;
+	uint  baseColorTexture; // slots in uTextures
+	uint  metalRoughTexture;
+	uint  _pad0;
+	uint  _pad1;
+	uint  _pad2;
+};
+
+layout( scalar, set = 1, binding = 0 ) readonly buffer SMaterials
+{
+	Material materials[];
+};
+
+layout( set = 1, binding = 1 ) uniform sampler2D uTextures[];
+
+layout( scalar, set = 0, binding = 0 ) uniform UScene
+{
+	mat4 camera;
+	mat4 projection;
+	mat4 projCam;
+	vec4 cameraPos;
+	vec4 lightPos;
+	vec4 lightColor;
+	uint renderMode;
+	uint _pad0;
+	uint _pad1;
+	uint _pad2;
+	mat4 cascadeVP[4]; // cascaded shadow maps, see shadows.hpp
+	vec4 cascadeSplits; // far view depth of each cascade
+	uint cascadeCount;
+	uint _pad3;
+	uint _pad4;
+	uint _pad5;
+	vec4 pointLightPos;   // w: range (far plane of the cube faces)
+	vec4 pointLightColor; // w: 1 if the cube shadow map is rendered
+	mat4 pointFaceVP[6];  // cube map layer order
+	uint spotLightCount;  // spot lights with a shadow atlas tile, see shadow_atlas.hpp
+	uint _pad6;
+	uint _pad7;
+	uint _pad8;
+	uvec4 clusterGrid;   // xyz: clusters per axis, w: clustered light count
+	vec4  clusterParams; // xy: clusters per pixel, z/w: log view depth to slice scale/bias
+	vec4  renderSize;    // xy: pixels covered by the scene, zw: their inverse
+} uScene;
+
+// must match glsl::SpotLightData
+struct SpotLight
+{
+	mat4 viewProj;
+	vec4 position;  // w: range
+	vec4 direction; // w: cos of the outer cone angle
+	vec4 color;     // w: cos of the inner cone angle
+	vec4 atlasRect; // xy: tile offset, zw: tile size (atlas uv); zw = 0: unshadowed
+};
+
+layout( std430, set = 0, binding = 4 ) readonly buffer SSpotLights
+{
+	SpotLight spotLights[];
+};
+
+// clustered point lights, binned per froxel by light_cluster.comp; must match glsl::ClusterLightData
+struct ClusterLight
+{
+	vec4 position; // w: range
+	vec4 color;
+};
+
+layout( std430, set = 0, binding = 6 ) readonly buffer SClusterLights
+{
+	ClusterLight clusterLights[];
+};
+
+layout( std430, set = 0, binding = 7 ) readonly buffer SClusterCounts
+{
+	uint clusterCounts[];
+};
+
+layout( std430, set = 0, binding = 8 ) readonly buffer SClusterIndices
+{
+	uint clusterIndices[];
+};
+
+const uint MAX_CLUSTER_LIGHTS = 128; // cfg::kMaxLightsPerCluster
+
+// instance and mesh buffers of the GPU-driven path (see gpu_driven.hpp); the
+// visibility buffer holds instance buffer indices on both paths
+struct Instance
+{
+	mat4 model;
+	uint meshIndex;
+	uint materialIndex;
+	uint bucket;
+	uint drawBase;
+};
+
+layout( scalar, set = 0, binding = 2 ) readonly buffer SInstances
+{
+	Instance instances[];
+};
+
+struct Mesh
+{
+	vec3 boundsMin;
+	uint firstIndex;
+	vec3 boundsMax;
+	uint indexCount;
+	int  vertexOffset;
+	uint _pad0;
+	uint _pad1;
+	uint _pad2;
+};
+
+// set 2, see create_visbuffer_descriptor_layout(); the merged vertex streams and
+// index buffer of MeshDrawRange
+layout( set = 2, binding = 0, rg32ui ) uniform readonly uimage2D uVisibility;
+
+layout( scalar, set = 2, binding = 1 ) readonly buffer SMeshes
+{
+	Mesh meshes[];
+};
+
+layout( scalar, set = 2, binding = 2 ) readonly buffer SIndices
+{
+	uint indices[];
+};
+
+layout( scalar, set = 2, binding = 3 ) readonly buffer SPositions
+{
+	vec3 positions[];
+};
+
+layout( scalar, set = 2, binding = 4 ) readonly buffer STexCoords
+{
+	vec2 texcoords[];
+};
+
+layout( scalar, set = 2, binding = 5 ) readonly buffer SNormals
+{
+	vec3 normals[];
+};
+
+const uint NO_INSTANCE = 0xffffffffu; // clear value, no surface
+
+layout( set = 0, binding = 1 ) uniform sampler2DArrayShadow uShadowMap; // one layer per cascade
+layout( set = 0, binding = 3 ) uniform samplerCubeShadow uPointShadowMap; // point light
+layout( set = 0, binding = 5 ) uniform sampler2DShadow uShadowAtlas; // spot lights, one tile each
+
+layout( location = 0 ) out vec4 oColor;
+
+const float PI = 3.14159265359;
+
+// simple light source
+vec4 LIGHT_POS = uScene.lightPos; // world space; w = 0: direction towards the light
+vec3 LIGHT_COLOR = uScene.lightColor.rgb;
+
+// point light, inverse square falloff windowed to its range
+const float POINT_INTENSITY = 20.0;
+const float POINT_SHADOW_NEAR = 0.05; // cfg::kPointShadowNear
+
+// beckmann distribution function (NDF)
+float D_Beckmann(float alpha, float NdotH)
+{
+	if( NdotH <= 0.0 ) return 0.0;
+
+	float alpha2 = alpha * alpha;
+	float NdotH2 = NdotH * NdotH;
+	
+	// equation from pdf
+	float num = exp( (NdotH2 - 1.0) / (alpha2 * NdotH2) );
+	float den = PI * alpha2 * NdotH2 * NdotH2;
+	
+	return num / den;
+}
+
+// simple helper for cook-torrance masking
+float G1(float NdotV, float NdotH, float VdotH)
+{
+	if( VdotH <= 0.0 ) return 0.0;
+	return (2.0 * NdotH * NdotV) / VdotH;
+}
+
+// cook-torrance geometric shadowing/masking
+float G_CookTorrance(float NdotL, float NdotV, float NdotH, float VdotH)
+{
+	float g1 = G1(NdotV, NdotH, VdotH);
+	float g2 = G1(NdotL, NdotH, VdotH); // using L instead of V for second term assumption logic symmetric
+	return min(1.0, min(g1, g2));
+}
+
+// p2_1.5 PCF
+// cascaded shadow maps: the first cascade whose slice contains the fragment; a
+// fragment near the edge of a (stable, hence larger) cascade window may fall
+// outside of it, the next cascade covers it then
+float calculate_shadow( vec3 aPos, out uint aCascade )
+{
+	float viewDepth = -(uScene.camera * vec4(aPos, 1.0)).z;
+
+	for( aCascade = 0; aCascade < uScene.cascadeCount; ++aCascade )
+	{
+		if( viewDepth > uScene.cascadeSplits[aCascade] )
+			continue;
+
+		vec4 lightProjPos = uScene.cascadeVP[aCascade] * vec4(aPos, 1.0);
+		vec3 projCoords = lightProjPos.xyz / lightProjPos.w;
+		// projCoords.xy are in [-1, 1], transform to [0, 1]
+		projCoords.xy = projCoords.xy * 0.5 + 0.5;
+
+		// check bounds
+		if (projCoords.x < 0.0 || projCoords.x > 1.0 || 
+			projCoords.y < 0.0 || projCoords.y > 1.0 || 
+			projCoords.z < 0.0 || projCoords.z > 1.0) 
+		{
+			continue;
+		}
+
+		// PCF
+		float shadow = 0.0;
+		vec2 texelSize = 1.0 / textureSize(uShadowMap, 0).xy;
+		
+		// 3x3 PCF
+		for(int x = -1; x <= 1; ++x)
+		{
+			for(int y = -1; y <= 1; ++y)
+			{
+				// sampler2DArrayShadow automatic comparison, layer = cascade
+				shadow += texture(uShadowMap, vec4(projCoords.xy + vec2(x, y) * texelSize, float(aCascade), projCoords.z)); 
+			}
+		}
+		
+		return shadow / 9.0;
+	}
+
+	// beyond the shadow distance
+	return 1.0;
+}
+
+// point light cube shadow map; aToFrag is the light to fragment vector. The face
+// that covers it is the one of its major axis, whose view depth is that component,
+// so the reference is that depth through the face projection (perspectiveRH_ZO)
+float calculate_point_shadow( vec3 aToFrag )
+{
+	if( 0.0 == uScene.pointLightColor.w )
+		return 1.0;
+
+	vec3 a = abs(aToFrag);
+	float z = max(a.x, max(a.y, a.z));
+	float n = POINT_SHADOW_NEAR;
+	float f = uScene.pointLightPos.w;
+	float depth = f / (f - n) - (f * n / (f - n)) / z;
+
+	return texture(uPointShadowMap, vec4(aToFrag, depth));
+}
+
+// spot light shadow atlas; the PCF taps are clamped to half a texel inside the
+// light's tile, so they never read a neighbouring one
+float calculate_spot_shadow( SpotLight aLight, vec3 aPos )
+{
+	if( 0.0 == aLight.atlasRect.z )
+		return 1.0;
+
+	vec4 lightProjPos = aLight.viewProj * vec4(aPos, 1.0);
+	vec3 projCoords = lightProjPos.xyz / lightProjPos.w;
+	if( projCoords.z < 0.0 || projCoords.z > 1.0 )
+		return 1.0;
+
+	vec2 uv = aLight.atlasRect.xy + (projCoords.xy * 0.5 + 0.5) * aLight.atlasRect.zw;
+
+	vec2 texelSize = 1.0 / vec2(textureSize(uShadowAtlas, 0));
+	vec2 lo = aLight.atlasRect.xy + 0.5 * texelSize;
+	vec2 hi = aLight.atlasRect.xy + aLight.atlasRect.zw - 0.5 * texelSize;
+
+	float shadow = 0.0;
+	for(int x = -1; x <= 1; ++x)
+	{
+		for(int y = -1; y <= 1; ++y)
+			shadow += texture(uShadowAtlas, vec3(clamp(uv + vec2(x, y) * texelSize, lo, hi), projCoords.z));
+	}
+
+	return shadow / 9.0;
+}
+
+// cluster of the fragment: its screen tile and the depth slice of its view
+// depth, the mapping light_cluster.comp bins with
+uint fragment_cluster( vec3 aPos )
+{
+	uvec3 grid = uScene.clusterGrid.xyz;
+	uvec2 tile = min(uvec2(gl_FragCoord.xy * uScene.clusterParams.xy), grid.xy - 1);
+
+	float viewDepth = max(-(uScene.camera * vec4(aPos, 1.0)).z, 1e-4);
+	float slice = log(viewDepth) * uScene.clusterParams.z + uScene.clusterParams.w;
+
+	return tile.x + grid.x * (tile.y + grid.y * uint(clamp(slice, 0.0, float(grid.z - 1))));
+}
+
+// perspective correct barycentrics of the point aNdc in the triangle with clip
+// space corners aClip: screen space barycentrics weighted by 1/w
+vec3 barycentrics( vec4 aClip[3], vec2 aNdc )
+{
+	vec2 p0 = aClip[0].xy / aClip[0].w;
+	vec2 e1 = aClip[1].xy / aClip[1].w - p0;
+	vec2 e2 = aClip[2].xy / aClip[2].w - p0;
+	vec2 d = aNdc - p0;
+
+	float den = e1.x * e2.y - e2.x * e1.y;
+	float l1 = (d.x * e2.y - e2.x * d.y) / den;
+	float l2 = (e1.x * d.y - d.x * e1.y) / den;
+
+	vec3 w = vec3(1.0 - l1 - l2, l1, l2) / vec3(aClip[0].w, aClip[1].w, aClip[2].w);
+	return w / (w.x + w.y + w.z);
+}
+
+// Cook-Torrance BRDF times NdotL for one light
+vec3 shade( vec3 N, vec3 V, vec3 L, vec3 baseColor, float roughness, float metalness )
+{
+	vec3 H = normalize(L + V);
+
+	// dot products
+	float NdotL = max(dot(N, L), 0.0);
+	float NdotV = max(dot(N, V), 0.0001); // avoid div by zero
+	float NdotH = max(dot(N, H), 0.0);
+	float VdotH = max(dot(V, H), 0.0);
+
+	// PBR
+	// Diffuse (Lambertian)
+	// Dielectrics have diffuse, metals do not (multiplied by 1-M)
+	
+	// Fresnel (Schlick)
+	// F0 = mix(0.04, baseColor, metalness)
+	vec3 F0 = mix(vec3(0.04), baseColor, metalness);
+	vec3 F = F0 + (1.0 - F0) * pow(1.0 - VdotH, 5.0);
+	
+	vec3 Ldiffuse = (baseColor / PI) * (vec3(1.0) - F) * (1.0 - metalness);
+
+	// Specular (Cook-Torrance)
+	// Lspecular = (D * G * F) / (4 * NdotL * NdotV)
+	
+	// Alpha from roughness
+	float alpha = roughness * roughness;
+	if( alpha < 0.001 ) alpha = 0.001; 
+	
+	float D = D_Beckmann(alpha, NdotH);
+	float G = G_CookTorrance(NdotL, NdotV, NdotH, VdotH);
+	
+	vec3 num = D * G * F;
+	float den = 4.0 * NdotL * NdotV;
+	
+	vec3 Lspecular = num / max(den, 0.0001);
+	
+	return (Ldiffuse + Lspecular) * NdotL;
+}
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	uvec2 visibility = imageLoad(uVisibility, pixel).xy;
+	if( visibility.x == NO_INSTANCE )
+		discard; // background, the clear color stays
+
+	Instance instance = instances[visibility.x];
+	Mesh mesh = meshes[instance.meshIndex];
+
+	// the triangle, as default.vert / default_indirect.vert transformed it
+	uint corner[3];
+	vec4 clip[3];
+	vec3 world[3];
+	for( uint i = 0; i < 3; ++i )
+	{
+		corner[i] = uint(int(indices[mesh.firstIndex + 3 * visibility.y + i]) + mesh.vertexOffset);
+		world[i] = (instance.model * vec4(positions[corner[i]], 1.0)).xyz;
+		clip[i] = uScene.projCam * vec4(world[i], 1.0);
+	}
+
+	// barycentrics of the pixel center and of its right and lower neighbours
+	// (the scene may cover only part of the image, see dynamic_resolution.hpp)
+	vec2 pixelSize = 2.0 * uScene.renderSize.zw;
+	vec2 ndc = (vec2(pixel) + 0.5) * pixelSize - 1.0;
+	vec3 b = barycentrics( clip, ndc );
+	vec3 bx = barycentrics( clip, ndc + vec2(pixelSize.x, 0.0) );
+	vec3 by = barycentrics( clip, ndc + vec2(0.0, pixelSize.y) );
+
+	vec3 position = b.x * world[0] + b.y * world[1] + b.z * world[2];
+
+	mat3x2 uv = mat3x2(texcoords[corner[0]], texcoords[corner[1]], texcoords[corner[2]]);
+	vec2 texCoord = uv * b;
+	vec2 dUVdx = uv * bx - texCoord;
+	vec2 dUVdy = uv * by - texCoord;
+
+	mat3 normalMatrix = mat3(instance.model);
+	vec3 normal = b.x * normalize(normalMatrix * normals[corner[0]])
+		+ b.y * normalize(normalMatrix * normals[corner[1]])
+		+ b.z * normalize(normalMatrix * normals[corner[2]]);
+
+	// material properties
+	Material mat = materials[instance.materialIndex];
+	vec3 baseColor = textureGrad(uTextures[nonuniformEXT(mat.baseColorTexture)], texCoord, dUVdx, dUVdy).rgb * mat.baseColorFactor.rgb;
+	float roughness = textureGrad(uTextures[nonuniformEXT(mat.metalRoughTexture)], texCoord, dUVdx, dUVdy).r * mat.roughnessFactor;
+	float metalness = textureGrad(uTextures[nonuniformEXT(mat.metalRoughTexture)], texCoord, dUVdx, dUVdy).r * mat.metallicFactor;
+
+	// geometric vectors
+	vec3 N = normalize(normal);
+	vec3 V = normalize(uScene.cameraPos.xyz - position); 
+	
+	// light vector
+	vec3 L_dir = LIGHT_POS.w == 0.0 ? LIGHT_POS.xyz : LIGHT_POS.xyz - position;
+	vec3 L = normalize(L_dir);
+	const float LIGHT_INTENSITY = 1.2; // no falloff
+
+	uint cascade;
+	float shadow = calculate_shadow( position, cascade );
+
+	// light radiance (no falloff)
+	vec3 Li = LIGHT_COLOR * LIGHT_INTENSITY * shadow; 
+	vec3 Lambient = vec3(0.02) * baseColor; // weak ambient
+
+	vec3 Lo = shade(N, V, L, baseColor, roughness, metalness) * Li;
+
+	// point light; the shadow lookup is offset along the normal against acne
+	vec3 toPoint = uScene.pointLightPos.xyz - position;
+	float pointDist = length(toPoint);
+	float pointShadow = 1.0;
+	if( pointDist < uScene.pointLightPos.w )
+	{
+		float window = clamp(1.0 - pow(pointDist / uScene.pointLightPos.w, 4.0), 0.0, 1.0);
+		float falloff = window * window / (pointDist * pointDist + 1.0);
+
+		pointShadow = calculate_point_shadow( position + N * 0.02 - uScene.pointLightPos.xyz );
+
+		vec3 Lpoint = uScene.pointLightColor.rgb * POINT_INTENSITY * falloff * pointShadow;
+		Lo += shade(N, V, toPoint / pointDist, baseColor, roughness, metalness) * Lpoint;
+	}
+
+	// spot lights: cone and the same windowed falloff
+	for( uint i = 0; i < uScene.spotLightCount; ++i )
+	{
+		SpotLight spot = spotLights[i];
+
+		vec3 toSpot = spot.position.xyz - position;
+		float spotDist = length(toSpot);
+		if( spotDist >= spot.position.w )
+			continue;
+
+		vec3 Ls = toSpot / spotDist;
+		float cone = smoothstep(spot.direction.w, spot.color.w, dot(-Ls, spot.direction.xyz));
+		if( cone <= 0.0 )
+			continue;
+
+		float window = clamp(1.0 - pow(spotDist / spot.position.w, 4.0), 0.0, 1.0);
+		float falloff = window * window / (spotDist * spotDist + 1.0);
+		float spotShadow = calculate_spot_shadow( spot, position + N * 0.02 );
+
+		Lo += shade(N, V, Ls, baseColor, roughness, metalness) * spot.color.rgb * (falloff * cone * spotShadow);
+	}
+
+	// clustered point lights, only the ones binned into this fragment's cluster
+	uint clusterCount = 0;
+	if( uScene.clusterGrid.w > 0 )
+	{
+		uint cluster = fragment_cluster( position );
+		clusterCount = clusterCounts[cluster];
+
+		uint first = cluster * MAX_CLUSTER_LIGHTS;
+		uint last = first + min(clusterCount, MAX_CLUSTER_LIGHTS);
+		for( uint i = first; i < last; ++i )
+		{
+			ClusterLight light = clusterLights[clusterIndices[i]];
+
+			vec3 toLight = light.position.xyz - position;
+			float dist = length(toLight);
+			if( dist >= light.position.w )
+				continue;
+
+			float window = clamp(1.0 - pow(dist / light.position.w, 4.0), 0.0, 1.0);
+			float falloff = window * window / (dist * dist + 1.0);
+
+			Lo += shade(N, V, toLight / dist, baseColor, roughness, metalness) * light.color.rgb * falloff;
+		}
+	}
+	
+	vec3 color = Lambient + Lo;
+
+	// debug modes
+	if( uScene.renderMode == 6 )
+	{
+		// shadow map debug
+		// 1.0 = lit (white), 0.0 = shadow (black), tinted by cascade
+		const vec3 CASCADE_TINT[5] = vec3[5](
+			vec3(1.0, 0.6, 0.6), vec3(0.6, 1.0, 0.6), vec3(0.6, 0.6, 1.0), vec3(1.0, 1.0, 0.6),
+			vec3(1.0) // not covered
+		);
+		// darker where the point light is shadowed
+		color = vec3(shadow) * CASCADE_TINT[min(cascade, 4u)] * (0.5 + 0.5 * pointShadow); 
+	}
+	else if( uScene.renderMode == 7 )
+	{
+		// lights per cluster, log scale from blue (none) over green to red
+		// (MAX_CLUSTER_LIGHTS); magenta where lights were dropped
+		float t = log2(float(clusterCount) + 1.0) / log2(float(MAX_CLUSTER_LIGHTS) + 1.0);
+		vec3 heat = clamp(vec3(4.0 * t - 2.0, 2.0 - abs(4.0 * t - 2.0), 2.0 - 4.0 * t), 0.0, 1.0);
+		if( clusterCount > MAX_CLUSTER_LIGHTS )
+			heat = vec3(1.0, 0.0, 1.0);
+
+		// shaded a little so the geometry stays readable
+		color = heat * (0.35 + 0.65 * max(dot(N, V), 0.0));
+	}
+	
+	oColor = vec4(color, 1.0);
+}
@@ -14,13 +14,17 @@
 
 #include <print>
 #include <chrono>
+#include <cmath>
 #include <limits>
 #include <vector>
+#include <string>
+#include <format>
 #include <stdexcept>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <algorithm>
 
 #define GLFW_INCLUDE_NONE
 
@@ -37,6 +41,8 @@ using namespace labut2::literals;
 #include "../Rhi/load.hpp"
 #include "../Rhi/error.hpp"
 #include "../Rhi/synch.hpp"
+#include "../Rhi/upload.hpp"
+#include "../Rhi/gpu_profiler.hpp"
 #include "../Rhi/vkimage.hpp"
 #include "../Rhi/commands.hpp"
 #include "../Rhi/textures.hpp"
@@ -51,6 +57,14 @@ namespace lut = labut2;
 #include "RenderUtilities/camera.hpp"
 #include "RenderUtilities/setup.hpp"
 #include "RenderUtilities/rendering.hpp"
+#include "RenderUtilities/culling.hpp"
+#include "RenderUtilities/materials.hpp"
+#include "RenderUtilities/software_occlusion.hpp"
+#include "RenderUtilities/shadows.hpp"
+#include "RenderUtilities/shadow_atlas.hpp"
+#include "RenderUtilities/frame_ring.hpp"
+#include "RenderUtilities/clustered_lights.hpp"
+#include "RenderUtilities/dynamic_resolution.hpp"
 
 namespace glsl {
     struct MosaicUniform {
@@ -80,6 +94,15 @@ namespace engine {
             glfwSetMouseButtonCallback(mWindow.window, &glfw_callback_button);
             glfwSetCursorPosCallback(mWindow.window, &glfw_callback_motion);
 
+            // software occlusion culling is the default on devices where the GPU
+            // is likely the bottleneck (lavapipe, integrated GPUs)
+            {
+                VkPhysicalDeviceProperties props{};
+                vkGetPhysicalDeviceProperties(mWindow.physicalDevice, &props);
+                mState.softwareOcclusion = VK_PHYSICAL_DEVICE_TYPE_CPU == props.deviceType
+                    || VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU == props.deviceType;
+            }
+
             // Create VMA allocator
             mAllocator = lut::create_allocator(mWindow);
 
@@ -87,12 +110,65 @@ namespace engine {
             mSceneLayout = create_scene_descriptor_layout(mWindow);
             mObjectLayout = create_object_descriptor_layout(mWindow);
             mPostLayout = create_post_proc_descriptor_layout(mWindow);
+            mCullLayout = create_cull_descriptor_layout(mWindow);
 
             mPipeLayout = create_triangle_pipeline_layout(mWindow, mSceneLayout.handle, mObjectLayout.handle);
             mPostPipeLayout = create_post_proc_pipeline_layout(mWindow, mPostLayout.handle);
+            mCullPipeLayout = create_cull_pipeline_layout(mWindow, mSceneLayout.handle, mCullLayout.handle);
 
             mPipe = create_triangle_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT);
 
+            // GPU-driven path (key G); needs multiDrawIndirect, drawIndirectFirstInstance
+            // and drawIndirectCount, without them the toggle has no effect
+            {
+                VkPhysicalDeviceVulkan12Features vk12{};
+                vk12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+                VkPhysicalDeviceFeatures2 features{};
+                features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+                features.pNext = &vk12;
+                vkGetPhysicalDeviceFeatures2(mWindow.physicalDevice, &features);
+                mIndirectSupported = VK_TRUE == features.features.multiDrawIndirect
+                    && VK_TRUE == features.features.drawIndirectFirstInstance
+                    && VK_TRUE == vk12.drawIndirectCount;
+            }
+            mCullPipe = create_cull_pipeline(mWindow, mCullPipeLayout.handle);
+
+            // Hi-Z occlusion culling (key H)
+            mReduceLayout = create_depth_reduce_descriptor_layout(mWindow);
+            mReducePipeLayout = create_depth_reduce_pipeline_layout(mWindow, mReduceLayout.handle);
+            mReducePipe = create_depth_reduce_pipeline(mWindow, mReducePipeLayout.handle);
+
+            // clustered lighting (key N, heatmap key 9)
+            mClusterPipeLayout = create_light_cluster_pipeline_layout(mWindow, mSceneLayout.handle);
+            mClusterPipe = create_light_cluster_pipeline(mWindow, mClusterPipeLayout.handle);
+
+            // compute post-processing (key R), used where the swapchain is a blit destination
+            mComputePostSupported = compute_post_supported(mWindow);
+            mComputePostLayout = create_compute_post_descriptor_layout(mWindow);
+            mComputePostPipeLayout = create_compute_post_pipeline_layout(mWindow, mComputePostLayout.handle);
+            mComputePostPipe = create_compute_post_pipeline(mWindow, mComputePostPipeLayout.handle);
+            mPyramidSampler = create_depth_pyramid_sampler(mWindow);
+            mIndirectPipe = create_triangle_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT, cfg::kIndirectVertShaderPath);
+            mIndirectAlphaPipe = create_alpha_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT, cfg::kIndirectVertShaderPath);
+            mIndirectShadowPipe = create_shadow_pipeline(mWindow, mPipeLayout.handle, cfg::kShadowIndirectVertShaderPath);
+            mIndirectShadowOpaquePipe = create_shadow_pipeline(mWindow, mPipeLayout.handle, cfg::kShadowOpaqueIndirectVertShaderPath, false);
+
+            // layered point shadows write gl_Layer from the vertex shader, which
+            // needs shaderOutputLayer; without it, mode 2 (one pass per face) is used
+            {
+                VkPhysicalDeviceVulkan12Features vk12{};
+                vk12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+                VkPhysicalDeviceFeatures2 features{};
+                features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+                features.pNext = &vk12;
+                vkGetPhysicalDeviceFeatures2(mWindow.physicalDevice, &features);
+                mLayeredPointShadows = VK_TRUE == vk12.shaderOutputLayer;
+            }
+            if (mLayeredPointShadows)
+                mIndirectPointShadowPipe = create_shadow_pipeline(mWindow, mPipeLayout.handle, cfg::kPointShadowIndirectVertShaderPath);
+
             // Create multiple debug pipelines
             mMipPipe = create_debug_pipeline(mWindow, mPipeLayout.handle, cfg::kDebugVertShaderPath, cfg::kDebugMipFragShaderPath, VK_FORMAT_R16G16B16A16_SFLOAT);
             mDepthPipe = create_debug_pipeline(mWindow, mPipeLayout.handle, cfg::kDebugVertShaderPath, cfg::kDebugDepthFragShaderPath, VK_FORMAT_R16G16B16A16_SFLOAT);
@@ -109,37 +185,150 @@ namespace engine {
                 VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
                 VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 
-            for (std::size_t i = 0; i < mWindow.swapImages.size(); ++i) {
+            // every graphics queue submission signals the next value; a frame slot
+            // is free once the value of its last submit is reached
+            mGraphicsTimeline = lut::create_timeline(mWindow.device, mWindow.graphicsQueue);
+            mUploads = lut::UploadManager(mWindow, mAllocator, mGraphicsTimeline);
+
+            // frames in flight, independent of the swapchain; the present wait
+            // semaphore belongs to the swapchain image (see CreateRenderFinished())
+            for (std::size_t i = 0; i < cfg::kFramesInFlight; ++i) {
                 mCmdBuffers.emplace_back(lut::alloc_command_buffer(mWindow, mCmdPool.handle));
-                mFrameDone.emplace_back(lut::create_fence(mWindow.device, VK_FENCE_CREATE_SIGNALED_BIT));
                 mImageAvailable.emplace_back(lut::create_semaphore(mWindow.device));
-                mRenderFinished.emplace_back(lut::create_semaphore(mWindow.device));
+            }
+            mFrameValues.assign(mCmdBuffers.size(), 0);
+            CreateRenderFinished();
+
+            // per pass GPU times and debug labels of every frame (see record_commands());
+            // its "frame" scope drives the dynamic resolution
+            {
+                VkPhysicalDeviceProperties props{};
+                vkGetPhysicalDeviceProperties(mWindow.physicalDevice, &props);
+                if (props.limits.timestampComputeAndGraphics) {
+                    mProfiler = lut::GpuProfiler(mWindow, std::uint32_t(mCmdBuffers.size()));
+                    mProfiling = true;
+                }
+                mFrameScale.assign(mCmdBuffers.size(), 0.f);
+            }
+
+            // fragment shader invocations of the depth pre-pass and the main pass,
+            // two queries per frame in flight; no pool without pipelineStatisticsQuery
+            {
+                VkPhysicalDeviceFeatures features{};
+                vkGetPhysicalDeviceFeatures(mWindow.physicalDevice, &features);
+                if (features.pipelineStatisticsQuery) {
+                    mPassStatistics = create_statistics_pool(mWindow, std::uint32_t(mCmdBuffers.size() * 2),
+                        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT);
+                }
+                mStatisticsPending.assign(mCmdBuffers.size(), 0);
+            }
+
+            // CPU path parallel recording: one pool per frame and worker thread, as a
+            // pool must not be used from two threads at once; reset once the frame's timeline value is reached
+            for (std::size_t i = 0; i < cfg::kFramesInFlight; ++i) {
+                for (std::size_t t = 0; t < cfg::kMaxRecordThreads; ++t) {
+                    auto const& pool = mRecordPools.emplace_back(lut::create_command_pool(mWindow, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT));
+                    for (std::uint32_t c = 0; c < cfg::kMaxShadowCascades; ++c)
+                        mShadowSecondaries.emplace_back(lut::alloc_command_buffer(mWindow, pool.handle, VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+                    mMainSecondaries.emplace_back(lut::alloc_command_buffer(mWindow, pool.handle, VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+                }
+
+                // cached draws are re-recorded individually, hence RESET_COMMAND_BUFFER
+                auto& cache = mDrawCaches.emplace_back();
+                for (std::size_t r = 0; r < cfg::kCachedDrawRegions; ++r) {
+                    auto const& pool = cache.pools.emplace_back(lut::create_command_pool(mWindow, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT));
+                    for (std::uint32_t c = 0; c < cfg::kMaxShadowCascades; ++c)
+                        cache.shadow.emplace_back(lut::alloc_command_buffer(mWindow, pool.handle, VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+                    cache.main.emplace_back(lut::alloc_command_buffer(mWindow, pool.handle, VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+                }
             }
 
             // Load data
             mModel = load_engine_model_glb("Assets/Models/TScene.glb");
-
-            // textures
-            for (auto const& tex : mModel.textures) {
+            if (cfg::kStressInstanceCount > mModel.scenes.size())
+                ReplicateScene(cfg::kStressInstanceCount);
+
+            // textures, written by the host with cfg::kHostImageCopy where the device
+            // supports host image copies for the format, else batched through the
+            // staging ring; timed up to the GPU being done with them
+            // (cfg::kUploadWaitPerTexture for the old behaviour). Host copy support
+            // and layout are queried once, here.
+            bool const hostCopySrgb = lut::host_image_copy_supported(mWindow.physicalDevice, VK_FORMAT_R8G8B8A8_SRGB);
+            bool const hostCopyUnorm = lut::host_image_copy_supported(mWindow.physicalDevice, VK_FORMAT_R8G8B8A8_UNORM);
+            VkImageLayout const hostCopyLayout = hostCopySrgb || hostCopyUnorm
+                ? lut::host_image_copy_layout(mWindow.physicalDevice)
+                : VK_IMAGE_LAYOUT_GENERAL;
+            auto const hostCopyable = [&](VkFormat aFormat) {
+                return VK_FORMAT_R8G8B8A8_SRGB == aFormat ? hostCopySrgb : hostCopyUnorm;
+            };
+
+            auto const texturesStart = std::chrono::steady_clock::now();
+            lut::UploadStats const uploadsBefore = mUploads.stats();
+            std::size_t textureBytes = 0, hostCopies = 0;
+
+            std::size_t const textureCount = mModel.textures.empty() ? 0 : std::max(mModel.textures.size(), cfg::kStressTextureCount);
+            for (std::size_t i = 0; i < textureCount; ++i) {
                 glfwPollEvents();
 
+                auto const& tex = mModel.textures[i % mModel.textures.size()];
                 VkFormat fmt = (tex.space == ETextureSpace::srgb)
                     ? VK_FORMAT_R8G8B8A8_SRGB
                     : VK_FORMAT_R8G8B8A8_UNORM;
 
                 // upload texture data to gpu memory
-                mModelTextures.emplace_back(
-                    lut::load_image_texture2d_from_memory(
+                textureBytes += tex.pixels.size();
+                lut::Image image;
+                VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                if (cfg::kHostImageCopy && hostCopyable(fmt)) {
+                    auto const mips = lut::build_mips_rgba8(tex.pixels.data(),
+                        static_cast<uint32_t>(tex.width), static_cast<uint32_t>(tex.height),
+                        VK_FORMAT_R8G8B8A8_SRGB == fmt);
+                    image = lut::load_image_texture2d_host(
                         tex.pixels.data(),
                         static_cast<uint32_t>(tex.width),
                         static_cast<uint32_t>(tex.height),
-                        mWindow, mCmdPool.handle, mAllocator, fmt));
+                        mips, mWindow, mAllocator, fmt, hostCopyLayout);
+                    layout = hostCopyLayout;
+                    ++hostCopies;
+                }
+                else {
+                    image = lut::load_image_texture2d_from_memory(
+                        tex.pixels.data(),
+                        static_cast<uint32_t>(tex.width),
+                        static_cast<uint32_t>(tex.height),
+                        mUploads, mAllocator, fmt);
+
+                    if (cfg::kUploadWaitPerTexture)
+                        mUploads.finish();
+                }
+
+                // copies beyond the model's textures only count for the measurement
+                if (i >= mModel.textures.size()) {
+                    mStressTextures.emplace_back(std::move(image));
+                    continue;
+                }
 
                 // Create an imageview so the shader samplers can interpret the image data
+                mModelTextures.emplace_back(std::move(image));
                 mModelTextureViews.emplace_back(
                     lut::create_image_view_texture2d(mWindow, mModelTextures.back().image, fmt));
+                mModelTextureLayouts.emplace_back(layout);
+            }
+
+            if (textureCount) {
+                mUploads.finish();
+
+                auto const& stats = mUploads.stats();
+                double const ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - texturesStart).count();
+                std::print(stderr, "[stats] textures: {} ({:.1f} MiB) loaded in {:.1f} ms ({:.3f} ms/texture), {} host image copies, {} staged ({}) in {} batches, {} host waits\n",
+                    textureCount, double(textureBytes) / (1024.0 * 1024.0), ms, ms / double(textureCount),
+                    hostCopies, textureCount - hostCopies, cfg::kUploadWaitPerTexture ? "wait per texture" : "staging ring",
+                    stats.batches - uploadsBefore.batches, stats.stalls - uploadsBefore.stalls);
             }
 
+            if (cfg::kCompareTextureUploads && (hostCopySrgb || hostCopyUnorm))
+                CompareTextureUploads(hostCopySrgb, hostCopyUnorm, hostCopyLayout);
+
             {
                 // just for objects without texture to set a default texture
                 // RGBA: 128, 128, 128, 255 (grey)
@@ -148,7 +337,7 @@ namespace engine {
                 // uploda 1x1 pixel to GPU
                 mDefaultGrayTex = lut::load_image_texture2d_from_memory(
                     grey, 1, 1,
-                    mWindow, mCmdPool.handle, mAllocator,
+                    mUploads, mAllocator,
                     VK_FORMAT_R8G8B8A8_UNORM);
 
                 // create grey imageview
@@ -161,56 +350,196 @@ namespace engine {
             mDebugSampler = create_debug_sampler(mWindow);
             mDescPool = lut::create_descriptor_pool(mWindow);
 
-            // material descriptors
-            BuildMaterialDescriptors(mDefaultSampler.handle, mMaterialDescriptors);
-            BuildMaterialDescriptors(mDebugSampler.handle, mDebugMaterialDescriptors);
-
-            // meshes
+            // meshes (and the material buffer)
             UploadMeshes();
 
-            mSceneUBO = lut::create_buffer(mAllocator,
-                sizeof(glsl::SceneUniform),
-                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            // bindless material descriptors, one set per sampler
+            mBindlessPool = lut::create_descriptor_pool(mWindow, 2 * cfg::kMaxBindlessTextures, 2,
+                VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
+            mMaterialDescriptors = BuildMaterialDescriptors(mDefaultSampler.handle);
+            mDebugMaterialDescriptors = BuildMaterialDescriptors(mDebugSampler.handle);
+            mInstanceBounds = compute_instance_bounds(mModel);
+            mSceneBounds = compute_scene_bounds(mInstanceBounds);
+
+            // cached draws record whole instance ranges and cull them by region
+            mRegionBounds = compute_range_bounds(mInstanceBounds, cfg::kCachedDrawRegions);
+            mAllInstances.assign(mModel.scenes.size(), 1);
+            mStaticCasters.resize(mModel.scenes.size());
+            for (std::size_t i = 0; i < mModel.scenes.size(); ++i)
+                mStaticCasters[i] = mModel.scenes[i].dynamic ? 0 : 1;
+
+            // spot lights with shadow atlas tiles (key J)
+            static_assert(cfg::kSpotLightCount <= cfg::kMaxSpotLights);
+            mSpotLights = build_spot_lights(mSceneBounds, cfg::kSpotLightCount);
+            mSpotAnimated = mSpotLights;
+            mSpotSlots.assign(mSpotLights.size(), SpotShadowSlot{});
+            mSpotTileSizes.assign(mSpotLights.size(), 0);
+            mSpotVisible.assign(mSpotLights.size(), {});
+            mSpotData.assign(mSpotLights.size(), glsl::SpotLightData{});
+            mShadowAtlas = create_shadow_atlas(cfg::kShadowAtlasSize, cfg::kMinShadowTile);
+
+            // clustered point lights; mState.clusterLights of them are animated and binned per frame
+            mClusterLights = build_cluster_lights(mSceneBounds, cfg::kMaxClusteredLights);
+            mClusterData.resize(mClusterLights.size());
+            mOccluders = build_occluders(mModel);
+            std::print(stderr, "Software occlusion: {} occluder instances, {} triangles\n",
+                mOccluders.instanceCount, mOccluders.indices.size() / 3);
+
+            mCullDescriptors = lut::alloc_desc_set(mWindow, mDescPool.handle, mCullLayout.handle);
+            {
+                // binding 6 (depth pyramid) is written by UpdatePyramidDescriptors()
+                VkDescriptorBufferInfo bi[7]{
+                    { mMeshDataBuffer.buffer, 0, VK_WHOLE_SIZE },
+                    { mMainDrawBuffer.buffer, 0, VK_WHOLE_SIZE },
+                    { mShadowDrawBuffer.buffer, 0, VK_WHOLE_SIZE },
+                    { mDrawCountBuffer.buffer, 0, VK_WHOLE_SIZE },
+                    { mLateDrawBuffer.buffer, 0, VK_WHOLE_SIZE },
+                    { mVisibilityBuffer.buffer, 0, VK_WHOLE_SIZE },
+                    { mPointDrawBuffer.buffer, 0, VK_WHOLE_SIZE }
+                };
+
+                VkWriteDescriptorSet w[7]{};
+                for (std::uint32_t j = 0; j < 7; ++j) {
+                    w[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                    w[j].dstSet = mCullDescriptors; w[j].dstBinding = j < 6 ? j : j + 1;
+                    w[j].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                    w[j].descriptorCount = 1; w[j].pBufferInfo = &bi[j];
+                }
+                vkUpdateDescriptorSets(mWindow.device, 7, w, 0, nullptr);
+            }
+
+            // per-frame data written by the host every frame: one region per frame
+            // in flight, bound with dynamic offsets
+            mFrameRing = FrameRing(mWindow.physicalDevice);
+            mFrameScene = mFrameRing.reserve(sizeof(glsl::SceneUniform));
+            mFrameSpots = mFrameRing.reserve(cfg::kMaxSpotLights * sizeof(glsl::SpotLightData));
+            mFrameClusterLights = mFrameRing.reserve(cfg::kMaxClusteredLights * sizeof(glsl::ClusterLightData));
+            mFrameMosaic = mFrameRing.reserve(sizeof(glsl::MosaicUniform));
+            mFrameRing.create(mAllocator, cfg::kFramesInFlight);
+            mClusterCountBuffer = lut::create_buffer(mAllocator,
+                cfg::kClusterCount * sizeof(std::uint32_t),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                0,
+                VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+            mClusterIndexBuffer = lut::create_buffer(mAllocator,
+                cfg::kClusterCount * cfg::kMaxLightsPerCluster * sizeof(std::uint32_t),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
                 0,
                 VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
 
             mSceneDescriptors = lut::alloc_desc_set(mWindow, mDescPool.handle, mSceneLayout.handle);
             {
-                VkDescriptorBufferInfo bi{ mSceneUBO.buffer, 0, VK_WHOLE_SIZE };
+                VkDescriptorBufferInfo bi{ mFrameRing.buffer(), mFrameScene, sizeof(glsl::SceneUniform) };
                 VkWriteDescriptorSet w{};
                 w.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
                 w.dstSet = mSceneDescriptors; w.dstBinding = 0;
-                w.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                w.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
                 w.descriptorCount = 1; w.pBufferInfo = &bi;
                 vkUpdateDescriptorSets(mWindow.device, 1, &w, 0, nullptr);
             }
 
             mAlphaPipe = create_alpha_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT);
 
+            // depth pre-pass (key Z): depth only pipelines, main pass pipelines with depth EQUAL
+            mPrepassPipe = create_prepass_pipeline(mWindow, mPipeLayout.handle, cfg::kPrepassVertShaderPath, false);
+            mPrepassAlphaPipe = create_prepass_pipeline(mWindow, mPipeLayout.handle, cfg::kPrepassAlphaVertShaderPath, true);
+            mIndirectPrepassPipe = create_prepass_pipeline(mWindow, mPipeLayout.handle, cfg::kPrepassIndirectVertShaderPath, false);
+            mIndirectPrepassAlphaPipe = create_prepass_pipeline(mWindow, mPipeLayout.handle, cfg::kPrepassAlphaIndirectVertShaderPath, true);
+            mEqualPipe = create_triangle_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT, cfg::kVertShaderPath, true);
+            mEqualAlphaPipe = create_alpha_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT, cfg::kAlphaVertShaderPath, true);
+            mIndirectEqualPipe = create_triangle_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT, cfg::kIndirectVertShaderPath, true);
+            mIndirectEqualAlphaPipe = create_alpha_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT, cfg::kIndirectVertShaderPath, true);
+            mEqualOvershadingPipe = create_overshading_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R8G8B8A8_UNORM, true);
+
+            // visibility buffer (key X): id raster pipelines and the full-screen resolve;
+            // gl_PrimitiveID in the fragment shader needs the geometryShader feature
+            {
+                VkPhysicalDeviceFeatures features{};
+                vkGetPhysicalDeviceFeatures(mWindow.physicalDevice, &features);
+                mVisbufferSupported = VK_TRUE == features.geometryShader;
+            }
+            if (mVisbufferSupported) {
+                mVisbufferLayout = create_visbuffer_descriptor_layout(mWindow);
+                mVisbufferPipeLayout = create_visbuffer_resolve_pipeline_layout(mWindow, mSceneLayout.handle, mObjectLayout.handle, mVisbufferLayout.handle);
+                mVisbufferPipe = create_visbuffer_pipeline(mWindow, mPipeLayout.handle, cfg::kVisbufferVertShaderPath, false);
+                mVisbufferAlphaPipe = create_visbuffer_pipeline(mWindow, mPipeLayout.handle, cfg::kVisbufferAlphaVertShaderPath, true);
+                mIndirectVisbufferPipe = create_visbuffer_pipeline(mWindow, mPipeLayout.handle, cfg::kVisbufferIndirectVertShaderPath, false);
+                mIndirectVisbufferAlphaPipe = create_visbuffer_pipeline(mWindow, mPipeLayout.handle, cfg::kVisbufferAlphaIndirectVertShaderPath, true);
+                mVisbufferResolvePipe = create_visbuffer_resolve_pipeline(mWindow, mVisbufferPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT);
+            }
+
             // p2_1.5 Shadow Resources
-            mShadowMap = create_shadow_map(mWindow, mAllocator);
+            mHasDynamicCasters = std::any_of(mModel.scenes.begin(), mModel.scenes.end(),
+                [](EngineInstance const& inst) { return inst.dynamic; });
+            CreateShadowMaps();
             mShadowSampler = create_shadow_sampler(mWindow);
             mShadowPipe = create_shadow_pipeline(mWindow, mPipeLayout.handle);
+            // opaque casters: position stream only, no fragment shader
+            mShadowOpaquePipe = create_shadow_pipeline(mWindow, mPipeLayout.handle, cfg::kShadowOpaqueVertShaderPath, false);
+
+            // point light cube shadow map (key U)
+            mPointShadowMap = create_point_shadow_map(mWindow, mAllocator, cfg::kPointShadowResolution);
+            if (mLayeredPointShadows) {
+                mPointShadowPipe = create_shadow_pipeline(mWindow, mPipeLayout.handle, cfg::kPointShadowVertShaderPath);
+                mPointShadowOpaquePipe = create_shadow_pipeline(mWindow, mPipeLayout.handle, cfg::kPointShadowOpaqueVertShaderPath, false);
+            }
+            mPointFaceShadowPipe = create_shadow_pipeline(mWindow, mPipeLayout.handle, cfg::kPointShadowFaceVertShaderPath);
+            mPointFaceShadowOpaquePipe = create_shadow_pipeline(mWindow, mPipeLayout.handle, cfg::kPointShadowFaceOpaqueVertShaderPath, false);
+
+            // spot light shadow atlas (key J)
+            mShadowAtlasImage = create_shadow_atlas_image(mWindow, mAllocator, cfg::kShadowAtlasSize);
+            mAtlasShadowPipe = create_shadow_pipeline(mWindow, mPipeLayout.handle, cfg::kSpotShadowVertShaderPath);
+            mAtlasShadowOpaquePipe = create_shadow_pipeline(mWindow, mPipeLayout.handle, cfg::kSpotShadowOpaqueVertShaderPath, false);
 
             mDepthBuffer = create_depth_buffer(mWindow, mAllocator);
+            mDepthPyramid = create_depth_pyramid(mWindow, mAllocator);
+            for (std::uint32_t i = 0; i < cfg::kMaxDepthPyramidLevels; ++i)
+                mReduceDescriptors.emplace_back(lut::alloc_desc_set(mWindow, mDescPool.handle, mReduceLayout.handle));
+            UpdatePyramidDescriptors();
+
             mPostProcPipe = create_post_proc_pipeline(mWindow, mPostPipeLayout.handle, mPostLayout.handle);
-            mOffscreenImage = create_offscreen_buffer(mWindow, mAllocator);
-            mVisImage = create_vis_image(mWindow, mAllocator); // p2_1.1
+            // offscreen, p2_1.1 vis image and visibility buffer ids, aliased where possible
+            mTransients = create_transient_attachments(mWindow, mAllocator, mVisbufferSupported);
             mPostSampler = create_post_proc_sampler(mWindow);
 
+            if (mVisbufferSupported) {
+                mVisbufferDescriptors = lut::alloc_desc_set(mWindow, mDescPool.handle, mVisbufferLayout.handle);
+                UpdateVisbufferDescriptors();
+            }
+
             // main scene descriptors need shadow map
             // update scene descriptors
             {
-                VkDescriptorBufferInfo bi{ mSceneUBO.buffer, 0, VK_WHOLE_SIZE };
+                VkDescriptorBufferInfo bi{ mFrameRing.buffer(), mFrameScene, sizeof(glsl::SceneUniform) };
                 VkDescriptorImageInfo  si{};
                 si.imageLayout = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
-                si.imageView = mShadowMap.view;
+                si.imageView = mShadowMap.image.view; // all cascades
                 si.sampler = mShadowSampler.handle;
 
-                VkWriteDescriptorSet w[2]{};
+                VkDescriptorBufferInfo ii{ mInstanceBuffer.buffer, 0, VK_WHOLE_SIZE };
+
+                VkDescriptorImageInfo  pi{};
+                pi.imageLayout = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+                pi.imageView = mPointShadowMap.image.view; // cube
+                pi.sampler = mShadowSampler.handle;
+
+                VkDescriptorBufferInfo li{ mFrameRing.buffer(), mFrameSpots, cfg::kMaxSpotLights * sizeof(glsl::SpotLightData) };
+
+                VkDescriptorImageInfo  ai{};
+                ai.imageLayout = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+                ai.imageView = mShadowAtlasImage.view;
+                ai.sampler = mShadowSampler.handle;
+
+                VkDescriptorBufferInfo ci[3]{
+                    { mFrameRing.buffer(), mFrameClusterLights, cfg::kMaxClusteredLights * sizeof(glsl::ClusterLightData) },
+                    { mClusterCountBuffer.buffer, 0, VK_WHOLE_SIZE },
+                    { mClusterIndexBuffer.buffer, 0, VK_WHOLE_SIZE }
+                };
+
+                VkWriteDescriptorSet w[9]{};
                 w[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
                 w[0].dstSet = mSceneDescriptors; w[0].dstBinding = 0;
-                w[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+                w[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
                 w[0].descriptorCount = 1; w[0].pBufferInfo = &bi;
 
                 w[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -218,24 +547,55 @@ namespace engine {
                 w[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
                 w[1].descriptorCount = 1; w[1].pImageInfo = &si;
 
-                vkUpdateDescriptorSets(mWindow.device, 2, w, 0, nullptr);
+                w[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                w[2].dstSet = mSceneDescriptors; w[2].dstBinding = 2; // instance buffer
+                w[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                w[2].descriptorCount = 1; w[2].pBufferInfo = &ii;
+
+                w[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                w[3].dstSet = mSceneDescriptors; w[3].dstBinding = 3; // point shadow map
+                w[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                w[3].descriptorCount = 1; w[3].pImageInfo = &pi;
+
+                w[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                w[4].dstSet = mSceneDescriptors; w[4].dstBinding = 4; // spot lights
+                w[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+                w[4].descriptorCount = 1; w[4].pBufferInfo = &li;
+
+                w[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                w[5].dstSet = mSceneDescriptors; w[5].dstBinding = 5; // shadow atlas
+                w[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                w[5].descriptorCount = 1; w[5].pImageInfo = &ai;
+
+                // clustered lights, cluster light counts and indices
+                for (std::uint32_t j = 0; j < 3; ++j) {
+                    w[6 + j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                    w[6 + j].dstSet = mSceneDescriptors; w[6 + j].dstBinding = 6 + j;
+                    w[6 + j].descriptorType = 0 == j ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                    w[6 + j].descriptorCount = 1; w[6 + j].pBufferInfo = &ci[j];
+                }
+
+                vkUpdateDescriptorSets(mWindow.device, 9, w, 0, nullptr);
             }
 
-            // mosaic UBOs
+            // occlusion statistics, one readback buffer per frame in flight
             for (std::size_t i = 0; i < mCmdBuffers.size(); ++i) {
-                mMosaicUBOs.emplace_back(lut::create_buffer(mAllocator,
-                    sizeof(glsl::MosaicUniform),
-                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                    VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT));
+                mCullStatsReadback.emplace_back(lut::create_buffer(mAllocator,
+                    2 * sizeof(std::uint32_t),
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT));
+            }
+            mCullStatsPending.assign(mCmdBuffers.size(), 0);
 
-                mPostDescriptors.emplace_back(
-                    BuildPostDesc(mOffscreenImage.view, mMosaicUBOs.back().buffer));
+            // post descriptors; the mosaic uniform is in the frame's ring region
+            mPostDescriptors = BuildPostDesc(mTransients.offscreen.view);
 
-                // p2 1.1: vis descriptors
-                // reuse postProcLayout (2 bindings) but passthrough shader only uses binding 0
-                mVisDescriptors.emplace_back(
-                    BuildPostDesc(mVisImage.view, mMosaicUBOs[i].buffer));
-            }
+            // p2 1.1: vis descriptors
+            // reuse postProcLayout (2 bindings) but passthrough shader only uses binding 0
+            mVisDescriptors = BuildPostDesc(mTransients.vis.view);
+
+            mComputePostDescriptors = lut::alloc_desc_set(mWindow, mDescPool.handle, mComputePostLayout.handle);
+            UpdateComputePostDescriptors();
         }
 
         void Update(float dt) override
@@ -261,10 +621,14 @@ namespace engine {
 
                 // Recreate them
                 auto const changes = lut::recreate_swapchain(mWindow);
+                if (mRenderFinished.size() != mWindow.swapImages.size())
+                    CreateRenderFinished();
 
                 if (changes.changedFormat) {
                     mPipe = create_triangle_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT);
                     mAlphaPipe = create_alpha_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT);
+                    mIndirectPipe = create_triangle_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT, cfg::kIndirectVertShaderPath);
+                    mIndirectAlphaPipe = create_alpha_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT, cfg::kIndirectVertShaderPath);
                     mMipPipe = create_debug_pipeline(mWindow, mPipeLayout.handle, cfg::kDebugVertShaderPath, cfg::kDebugMipFragShaderPath, VK_FORMAT_R16G16B16A16_SFLOAT);
                     mDepthPipe = create_debug_pipeline(mWindow, mPipeLayout.handle, cfg::kDebugVertShaderPath, cfg::kDebugDepthFragShaderPath, VK_FORMAT_R16G16B16A16_SFLOAT);
                     mDerivPipe = create_debug_pipeline(mWindow, mPipeLayout.handle, cfg::kDebugVertShaderPath, cfg::kDebugDerivFragShaderPath, VK_FORMAT_R16G16B16A16_SFLOAT);
@@ -273,33 +637,120 @@ namespace engine {
                     // Recreate (p2_1.1)
                     mOverdrawPipe = create_overdraw_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R8G8B8A8_UNORM);
                     mOvershadingPipe = create_overshading_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R8G8B8A8_UNORM);
+
+                    mEqualPipe = create_triangle_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT, cfg::kVertShaderPath, true);
+                    mEqualAlphaPipe = create_alpha_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT, cfg::kAlphaVertShaderPath, true);
+                    mIndirectEqualPipe = create_triangle_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT, cfg::kIndirectVertShaderPath, true);
+                    mIndirectEqualAlphaPipe = create_alpha_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT, cfg::kIndirectVertShaderPath, true);
+                    mEqualOvershadingPipe = create_overshading_pipeline(mWindow, mPipeLayout.handle, VK_FORMAT_R8G8B8A8_UNORM, true);
                     mVisResolvePipe = create_vis_resolve_pipeline(mWindow, mPostPipeLayout.handle, mPostLayout.handle);
+                    mComputePostSupported = compute_post_supported(mWindow);
+                    if (mVisbufferSupported)
+                        mVisbufferResolvePipe = create_visbuffer_resolve_pipeline(mWindow, mVisbufferPipeLayout.handle, VK_FORMAT_R16G16B16A16_SFLOAT);
                 }
 
                 if (changes.changedSize) {
                     mDepthBuffer = create_depth_buffer(mWindow, mAllocator);
-                    mOffscreenImage = create_offscreen_buffer(mWindow, mAllocator);
-                    mVisImage = create_vis_image(mWindow, mAllocator);
+                    mDepthPyramid = create_depth_pyramid(mWindow, mAllocator);
+                    UpdatePyramidDescriptors();
+                    mTransients = create_transient_attachments(mWindow, mAllocator, mVisbufferSupported);
 
                     // Update descriptor set
-                    UpdatePostDescImage(mPostDescriptors, mOffscreenImage.view);
+                    UpdatePostDescImage(mPostDescriptors, mTransients.offscreen.view);
 
                     // p2 1.1: update vis descriptors
-                    UpdatePostDescImage(mVisDescriptors, mVisImage.view);
+                    UpdatePostDescImage(mVisDescriptors, mTransients.vis.view);
+                    UpdateComputePostDescriptors();
+
+                    if (mVisbufferSupported)
+                        UpdateVisbufferDescriptors();
                 }
 
+                // cached draws reference the recreated pipelines and bake the viewport
+                ++mDrawCacheGeneration;
+
                 mRecreateSwapchain = false;
                 return;
             }
 
+            // shadow map resolution changed (key B); the old maps may still be in use
+            if (mState.shadowResolution != mShadowMap.resolution) {
+                vkDeviceWaitIdle(mWindow.device);
+
+                CreateShadowMaps();
+                UpdateShadowDescriptor();
+
+                // cached shadow draws bake the viewport
+                ++mDrawCacheGeneration;
+            }
+
             // Advance to next frame
             mFrameIndex = (mFrameIndex + 1) % mCmdBuffers.size();
 
             // Make sure that the frame resources are no longer in use
-            if (auto res = vkWaitForFences(mWindow.device, 1,
-                &mFrameDone[mFrameIndex].handle, VK_TRUE,
-                std::numeric_limits<std::uint64_t>::max()); VK_SUCCESS != res)
-                throw lut::Error("vkWaitForFences: {}", lut::to_string(res));
+            mGraphicsTimeline.wait(mFrameValues[mFrameIndex]);
+
+            // submits uploads left open for too long, recycles staging ring space
+            mUploads.update();
+
+            // per pass GPU times of this slot's last frame, available after the wait
+            if (mProfiling)
+                mProfiler.begin_frame(std::uint32_t(mFrameIndex));
+
+            // GPU time of that frame, at the scale it was rendered with; feeds the
+            // dynamic resolution controller while that is on
+            if (mFrameScale[mFrameIndex] > 0.f) {
+                if (auto const gpuMs = mProfiler.read_back_ms("frame")) {
+                    mStats.renderScale += mFrameScale[mFrameIndex];
+                    ++mStats.scaleFrames;
+
+                    if (mDynamicResolution)
+                        update_resolution_scale(mResolution, *gpuMs, mFrameScale[mFrameIndex]);
+                }
+                mFrameScale[mFrameIndex] = 0.f;
+            }
+
+            // CPU frame time: everything between the timeline wait and the submit
+            auto const frameStart = std::chrono::steady_clock::now();
+
+            for (std::size_t t = 0; t < cfg::kMaxRecordThreads; ++t)
+                vkResetCommandPool(mWindow.device, mRecordPools[mFrameIndex * cfg::kMaxRecordThreads + t].handle, 0);
+
+            // occlusion statistics of the last submission of this frame slot
+            if (mCullStatsPending[mFrameIndex]) {
+                auto const& readback = mCullStatsReadback[mFrameIndex];
+                vmaInvalidateAllocation(mAllocator.allocator, readback.allocation, 0, VK_WHOLE_SIZE);
+
+                void* ptr;
+                vmaMapMemory(mAllocator.allocator, readback.allocation, &ptr);
+                std::uint32_t counts[2];
+                std::memcpy(counts, ptr, sizeof(counts));
+                vmaUnmapMemory(mAllocator.allocator, readback.allocation);
+
+                mStats.hizTested += counts[0];
+                mStats.hizOccluded += counts[1];
+                ++mStats.hizFrames;
+                mCullStatsPending[mFrameIndex] = 0;
+            }
+
+            // fragment shader invocations of the last submission of this frame slot;
+            // the pre-pass query is unavailable in frames without pre-pass
+            if (mStatisticsPending[mFrameIndex]) {
+                std::uint64_t invocations[2][2]{}; // value, availability
+                auto const res = vkGetQueryPoolResults(mWindow.device, mPassStatistics.handle,
+                    std::uint32_t(mFrameIndex * 2), 2,
+                    sizeof(invocations), invocations, sizeof(invocations[0]),
+                    VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+                if (VK_SUCCESS != res && VK_NOT_READY != res)
+                    throw lut::Error("vkGetQueryPoolResults: {}", lut::to_string(res));
+
+                if (invocations[1][1]) {
+                    mStats.prepassFragments += invocations[0][1] ? invocations[0][0] : 0;
+                    mStats.mainFragments += invocations[1][0];
+                    ++mStats.fragmentFrames;
+                }
+                mStatisticsPending[mFrameIndex] = 0;
+            }
 
             // Acquire next swap chain image
             std::uint32_t imageIndex = 0;
@@ -317,24 +768,161 @@ namespace engine {
             if (acquireRes != VK_SUCCESS)
                 throw lut::Error("vkAcquireNextImageKHR: {}", lut::to_string(acquireRes));
 
-            // Reset fence
-            if (auto res = vkResetFences(mWindow.device, 1,
-                &mFrameDone[mFrameIndex].handle); VK_SUCCESS != res)
-                throw lut::Error("vkResetFences: {}", lut::to_string(res));
+            // this frame slot's ring region is free again (timeline wait above)
+            SceneDescriptors const scene{ mSceneDescriptors, mFrameRing.begin_frame(std::uint32_t(mFrameIndex)) };
 
             // Update state
             update_user_state(mState, dt);
 
+            // dynamic resolution (key I): the scene is rendered at the controller's
+            // scale and upscaled by the compute post pass, hence only where that runs;
+            // elsewhere (and when off) at full resolution
+            bool const dynamicResolution = mState.dynamicResolution && mProfiling
+                && mComputePostSupported && mState.computePost
+                && mState.renderMode != 4 && mState.renderMode != 5;
+            if (dynamicResolution != mDynamicResolution) {
+                reset_resolution_scale(mResolution);
+                mDynamicResolution = dynamicResolution;
+            }
+
+            VkExtent2D const renderExtent = scaled_extent(mWindow.swapchainExtent, mResolution.scale);
+            if (renderExtent.width != mRenderExtent.width || renderExtent.height != mRenderExtent.height) {
+                // cached draws bake the viewport
+                mRenderExtent = renderExtent;
+                ++mDrawCacheGeneration;
+            }
+
+            if (mState.dumpGpuProfile) {
+                bool const ok = mProfiling && mProfiler.write_csv(cfg::kGpuProfilePath);
+                std::print(stderr, "{} {}\n", ok ? "Wrote" : "Unable to write", cfg::kGpuProfilePath);
+                mState.dumpGpuProfile = false;
+            }
+
+            if (mState.dumpResolutionHistory) {
+                bool const ok = write_resolution_history(mResolution, cfg::kResolutionHistoryPath);
+                std::print(stderr, "{} {}\n", ok ? "Wrote" : "Unable to write", cfg::kResolutionHistoryPath);
+                mState.dumpResolutionHistory = false;
+            }
+
             // Prepare data for this frame
             glsl::SceneUniform sceneUniforms{};
             update_scene_uniforms(sceneUniforms,
                 mWindow.swapchainExtent.width,
                 mWindow.swapchainExtent.height,
                 mState);
+            sceneUniforms.renderSize = glm::vec4(float(renderExtent.width), float(renderExtent.height),
+                1.f / float(renderExtent.width), 1.f / float(renderExtent.height));
+
+            // cascaded shadow maps (keys V, B): the near cascades follow the camera
+            // every frame, the far ones every cfg::kFarCascadeInterval frames and keep
+            // the matrix they were rendered with in between, see shadows.hpp; key F
+            // fits them to the receivers in view and the casters in front of them
+            ShadowCascades const cascades = compute_shadow_cascades(mState.camera2world,
+                float(mWindow.swapchainExtent.width) / float(mWindow.swapchainExtent.height),
+                glm::vec3(sceneUniforms.lightPos), mSceneBounds.min, mSceneBounds.max,
+                mState.shadowCascades, mShadowMap.resolution,
+                mState.shadowFit ? &mInstanceBounds : nullptr, &mShadowFitScratch);
+
+            // a new shadow map or a new split updates every cascade at once
+            bool const resetCascades = mShadowReset || cascades.count != mCascades.count;
+
+            std::uint32_t updateMask = 0;
+            for (std::uint32_t c = 0; c < cascades.count; ++c) {
+                if (resetCascades || is_cascade_due(c, mShadowFrame)) {
+                    mCascades.viewProj[c] = cascades.viewProj[c];
+                    updateMask |= 1u << c;
+                    ++mStats.cascadeUpdates[c];
+                    mStats.cascadeFitScale[c] += cascades.fitScale[c];
+                }
+                mCascades.splitFar[c] = cascades.splitFar[c];
+            }
+            mCascades.count = cascades.count;
+            ++mShadowFrame;
+
+            for (std::uint32_t c = 0; c < mCascades.count; ++c) {
+                sceneUniforms.cascadeVP[c] = mCascades.viewProj[c];
+                sceneUniforms.cascadeSplits[c] = mCascades.splitFar[c];
+            }
+            sceneUniforms.cascadeCount = mCascades.count;
+
+            // point light cube shadow (key U), all six faces every frame
+            std::uint32_t const pointShadows = PointShadowMode();
+            if (pointShadows)
+                compute_point_shadow_faces(glm::vec3(sceneUniforms.pointLightPos), sceneUniforms.pointLightPos.w, sceneUniforms.pointFaceVP);
+
+            // spot light shadow atlas (key J): tiles sized by the screen coverage of
+            // each light, re-rendered within cfg::kShadowAtlasBudget texels per frame;
+            // a light keeps the matrix its tile was rendered with, see shadow_atlas.hpp
+            mSpotTime += dt;
+            ShadowSchedule atlasSchedule;
+            if (mState.spotLights) {
+                Frustum const cameraFrustum = extract_frustum(sceneUniforms.projCam);
+                float const tanHalfFov = std::tan(0.5f * lut::Radians(cfg::kCameraFov).value());
+                for (std::size_t i = 0; i < mSpotLights.size(); ++i) {
+                    mSpotAnimated[i] = animate_spot_light(mSpotLights[i], mSpotTime);
+                    mSpotTileSizes[i] = spot_shadow_tile_size(mSpotAnimated[i], cameraFrustum, glm::vec3(sceneUniforms.cameraPos), tanHalfFov);
+                }
+
+                atlasSchedule = schedule_shadow_atlas(mShadowAtlas, mSpotSlots, mSpotTileSizes, mSpotAnimated, mShadowFrame, cfg::kShadowAtlasBudget);
+
+                // casters of the re-rendered tiles; CPU culled on both paths
+                for (auto const& update : atlasSchedule.updates)
+                    cull_instances(extract_frustum(mSpotSlots[update.light].viewProj), mInstanceBounds, mSpotVisible[update.light]);
+
+                float const atlasScale = 1.f / float(mShadowAtlas.size);
+                for (std::size_t i = 0; i < mSpotLights.size(); ++i) {
+                    auto const& light = mSpotAnimated[i];
+                    auto const& slot = mSpotSlots[i];
+                    auto& data = mSpotData[i];
+                    data.viewProj = slot.viewProj;
+                    data.position = glm::vec4(light.position, light.range);
+                    data.direction = glm::vec4(light.direction, std::cos(light.outerAngle));
+                    data.color = glm::vec4(light.color, std::cos(light.innerAngle));
+                    data.atlasRect = slot.rendered
+                        ? glm::vec4(float(slot.tile.x), float(slot.tile.y), float(slot.tile.size), float(slot.tile.size)) * atlasScale
+                        : glm::vec4(0.f);
+                }
+                sceneUniforms.spotLightCount = std::uint32_t(mSpotLights.size());
+
+                mStats.atlasTexels += atlasSchedule.texels;
+                mStats.atlasTiles += atlasSchedule.updates.size();
+                mStats.atlasUnshadowed += atlasSchedule.unshadowed;
+            }
+
+            // clustered point lights (key N): animated here, binned into the froxel
+            // grid by light_cluster.comp before the lighting reads them
+            mClusterTime += dt;
+            std::uint32_t const clusterLights = std::min(mState.clusterLights, cfg::kMaxClusteredLights);
+            for (std::uint32_t i = 0; i < clusterLights; ++i)
+                mClusterData[i] = animate_cluster_light(mClusterLights[i], mClusterTime);
+
+            sceneUniforms.clusterGrid = glm::uvec4(cfg::kClusterTilesX, cfg::kClusterTilesY, cfg::kClusterSlices, clusterLights);
+            sceneUniforms.clusterParams = compute_cluster_params(renderExtent.width, renderExtent.height,
+                cfg::kCameraNear, cfg::kCameraFar);
+
+            // static shadow cache, per cascade: re-render the static casters only when
+            // the cascade matrix, the static geometry or the shadow map resolution changed
+            std::uint32_t refreshMask = 0;
+            for (std::uint32_t c = 0; c < mCascades.count; ++c) {
+                if (0 == (updateMask & (1u << c)))
+                    continue;
+
+                ShadowCacheKey const key{ mCascades.viewProj[c], mShadowMap.resolution, mStaticGeometryGeneration };
+                if (!mState.shadowCache || resetCascades || key != mShadowCacheKeys[c]) {
+                    mShadowCacheKeys[c] = key;
+                    refreshMask |= 1u << c;
+                    ++mStats.cascadeRefreshes[c];
+                }
+            }
+            if (refreshMask)
+                ++mStats.shadowRefreshes;
+
+            // cascades that draw casters this frame
+            std::uint32_t const drawMask = refreshMask | (mHasDynamicCasters ? updateMask : 0);
 
             VkPipeline  currentOpaque = mPipe.handle;
             VkPipeline  currentAlpha = mAlphaPipe.handle;
-            auto const* currentDescs = &mMaterialDescriptors;
+            VkDescriptorSet currentMaterials = mMaterialDescriptors;
 
             // Task 1.4
             // Debug Visualization Pipeline Switching
@@ -346,87 +934,440 @@ namespace engine {
             case 1: // Mode 1: Mipmap Visualization
                 // Visualizes texture LOD levels (colored).
                 currentOpaque = currentAlpha = mMipPipe.handle;
-                currentDescs = &mDebugMaterialDescriptors;
+                currentMaterials = mDebugMaterialDescriptors;
                 break;
             case 2: // Mode 2: Depth Visualization
                 // Visualizes fragment depth (non-linear grayscale)
                 currentOpaque = currentAlpha = mDepthPipe.handle;
-                currentDescs = &mDebugMaterialDescriptors;
+                currentMaterials = mDebugMaterialDescriptors;
                 break;
             case 3: // Mode 3: Derivatives Visualization
                 // Visualizes partial derivatives of depth (dFdx, dFdy)
                 currentOpaque = currentAlpha = mDerivPipe.handle;
-                currentDescs = &mDebugMaterialDescriptors;
+                currentMaterials = mDebugMaterialDescriptors;
                 break;
             case 4: // Mode 4: Overdraw
                 currentOpaque = currentAlpha = mOverdrawPipe.handle;
-                currentDescs = &mDebugMaterialDescriptors;
+                currentMaterials = mDebugMaterialDescriptors;
                 // rendering.cpp binds descriptors (i think)
                 break;
             case 5: // Mode 5: Overshading
                 currentOpaque = currentAlpha = mOvershadingPipe.handle;
-                currentDescs = &mDebugMaterialDescriptors;
+                currentMaterials = mDebugMaterialDescriptors;
                 break;
             default:
                 break;
             }
 
+            // visibility buffer (key X), shading modes only: the debug views are
+            // forward shaders; it replaces the depth pre-pass, the raster is cheap already
+            bool const visibilityBuffer = mState.visibilityBuffer && mVisbufferSupported
+                && (mState.renderMode == 0 || mState.renderMode == 6 || mState.renderMode == 7);
+            if (visibilityBuffer) {
+                currentOpaque = mVisbufferPipe.handle;
+                currentAlpha = mVisbufferAlphaPipe.handle;
+            }
+
+            // depth pre-pass (key Z), shading and overshading modes only; the
+            // other debug views show the depth complexity the pre-pass would hide
+            bool const depthPrepass = mState.depthPrepass && !visibilityBuffer
+                && (mState.renderMode == 0 || mState.renderMode == 5 || mState.renderMode == 6 || mState.renderMode == 7);
+            if (depthPrepass) {
+                if (mState.renderMode == 5) {
+                    currentOpaque = currentAlpha = mEqualOvershadingPipe.handle;
+                }
+                else {
+                    currentOpaque = mEqualPipe.handle;
+                    currentAlpha = mEqualAlphaPipe.handle;
+                }
+            }
+
             ImageAndView    offscreenTarget;
             VkPipeline      resolvePipeline = mPostProcPipe.handle;
-            VkDescriptorSet resolveDescs = mPostDescriptors[mFrameIndex];
+            VkDescriptorSet resolveDescs = mPostDescriptors;
             VkPipelineLayout resolveLayout = mPostPipeLayout.handle;
             VkClearColorValue clearColor = { 0.1f, 0.1f, 0.1f, 1.f };
 
             if (mState.renderMode == 4 || mState.renderMode == 5) {
                 // Visualization Mode
-                offscreenTarget = { mVisImage.image, mVisImage.view };
+                offscreenTarget = { mTransients.vis.image, mTransients.vis.view };
                 resolvePipeline = mVisResolvePipe.handle;
-                resolveDescs = mVisDescriptors[mFrameIndex]; // same layout (postProcPipelineLayout)
+                resolveDescs = mVisDescriptors; // same layout (postProcPipelineLayout)
                 clearColor = { 0.f, 0.1f, 0.f, 1.f }; // dark green
             }
             else {
                 // Normal Mode
-                offscreenTarget = { mOffscreenImage.image, mOffscreenImage.view };
+                offscreenTarget = { mTransients.offscreen.image, mTransients.offscreen.view };
             }
 
-            // update mosaic ubo
-            {
-                glsl::MosaicUniform mu{ mState.mosaicEnabled ? 1 : 0, {} };
-                void* ptr;
-                vmaMapMemory(mAllocator.allocator, mMosaicUBOs[mFrameIndex].allocation, &ptr);
-                std::memcpy(ptr, &mu, sizeof(mu));
-                vmaUnmapMemory(mAllocator.allocator, mMosaicUBOs[mFrameIndex].allocation);
-            }
+            // update mosaic uniform
+            mFrameRing.write(mFrameMosaic, glsl::MosaicUniform{ mState.mosaicEnabled ? 1 : 0, {} });
 
             ImageAndView colorTarget = { mWindow.swapImages[imageIndex], mWindow.swapViews[imageIndex] };
             ImageAndView depthTarget = { mDepthBuffer.image, mDepthBuffer.view };
-            ImageAndView shadowTarget = { mShadowMap.image,   mShadowMap.view };
+
+            // GPU-driven path
+            // only the shading modes have indirect pipelines (model matrix from the
+            // instance buffer); the debug visualizations stay on the CPU path
+            IndirectDrawInfo indirect{};
+            bool const useIndirect = mState.gpuDriven && mIndirectSupported && (mState.renderMode == 0 || mState.renderMode == 6 || mState.renderMode == 7);
+            if (useIndirect) {
+                indirect.cullPipe = mCullPipe.handle;
+                indirect.cullLayout = mCullPipeLayout.handle;
+                indirect.cullDescriptors = mCullDescriptors;
+                indirect.mainDraws = mMainDrawBuffer.buffer;
+                indirect.shadowDraws = mShadowDrawBuffer.buffer;
+                indirect.drawCounts = mDrawCountBuffer.buffer;
+                indirect.instanceCount = std::uint32_t(mModel.scenes.size());
+                indirect.buckets = mDrawBuckets;
+                indirect.cascadeMask = drawMask;
+                indirect.pointShadow = 0 != pointShadows && mLayeredPointShadows;
+                indirect.pointDraws = mPointDrawBuffer.buffer;
+                indirect.opaquePipe = visibilityBuffer ? mIndirectVisbufferPipe.handle
+                    : depthPrepass ? mIndirectEqualPipe.handle : mIndirectPipe.handle;
+                indirect.alphaPipe = visibilityBuffer ? mIndirectVisbufferAlphaPipe.handle
+                    : depthPrepass ? mIndirectEqualAlphaPipe.handle : mIndirectAlphaPipe.handle;
+                indirect.shadowPipe = mIndirectShadowPipe.handle;
+                indirect.shadowOpaquePipe = mIndirectShadowOpaquePipe.handle;
+                indirect.pointShadowPipe = mIndirectPointShadowPipe.handle;
+
+                indirect.occlusion = mState.occlusionCulling;
+                indirect.lateDraws = mLateDrawBuffer.buffer;
+                indirect.visibility = mVisibilityBuffer.buffer;
+                indirect.statsReadback = mCullStatsReadback[mFrameIndex].buffer;
+                indirect.pyramidImage = mDepthPyramid.image.image;
+                indirect.pyramidWidth = mDepthPyramid.width;
+                indirect.pyramidHeight = mDepthPyramid.height;
+                indirect.pyramidLevels = mDepthPyramid.levels;
+                indirect.reducePipe = mReducePipe.handle;
+                indirect.reduceLayout = mReducePipeLayout.handle;
+                indirect.reduceDescriptors = mReduceDescriptors;
+
+                mCullStatsPending[mFrameIndex] = mState.occlusionCulling ? 1 : 0;
+            }
+
+            // CPU frustum culling, the GPU-driven path culls in cull.comp instead.
+            // Cached draws (see below) cull whole regions: bit 0 the main pass,
+            // bit 1 + c cascade c; the depth pre-pass then draws the instances of
+            // the regions in view, and per instance culling and software
+            // occlusion are skipped.
+            bool const cachedDraws = !useIndirect && mState.cachedDraws;
+            std::uint8_t executed[cfg::kCachedDrawRegions] = {};
+            if (!useIndirect) {
+                auto const cullStart = std::chrono::steady_clock::now();
+
+                Frustum const mainFrustum = extract_frustum(sceneUniforms.projCam);
+                if (cachedDraws) {
+                    Frustum cascadeFrusta[cfg::kMaxShadowCascades];
+                    for (std::uint32_t c = 0; c < mCascades.count; ++c)
+                        cascadeFrusta[c] = extract_frustum(mCascades.viewProj[c]);
+
+                    std::size_t const count = mModel.scenes.size();
+                    mMainVisible.resize(count);
+                    for (std::size_t r = 0; r < cfg::kCachedDrawRegions; ++r) {
+                        std::size_t const begin = r * count / cfg::kCachedDrawRegions;
+                        std::size_t const end = (r + 1) * count / cfg::kCachedDrawRegions;
+
+                        executed[r] = box_visible(mainFrustum, mRegionBounds[r]) ? 1 : 0;
+                        for (std::uint32_t c = 0; c < mCascades.count; ++c)
+                            executed[r] |= box_visible(cascadeFrusta[c], mRegionBounds[r]) ? std::uint8_t(2u << c) : 0;
+
+                        std::fill(mMainVisible.begin() + begin, mMainVisible.begin() + end, executed[r] & 1);
+                        mStats.regionsExecuted += executed[r] & 1;
+                    }
+                }
+                else {
+                    CullStats const mainCull = cull_instances(mainFrustum, mInstanceBounds, mMainVisible);
+                    mStats.mainVisible += mainCull.visible;
+                }
+
+                // casters per cascade, only for the cascades drawn this frame; the
+                // others keep the result they were last rendered with (unless the
+                // GPU-driven path was active then)
+                for (std::uint32_t c = 0; c < mCascades.count; ++c) {
+                    auto& visible = mShadowVisible[c];
+                    if (0 == (drawMask & (1u << c)) && visible.size() == mInstanceBounds.count)
+                        continue;
+
+                    CullStats const shadowCull = cull_instances(extract_frustum(mCascades.viewProj[c]), mInstanceBounds, visible);
+                    mStats.shadowVisible += shadowCull.visible;
+
+                    // mShadowVisible keeps the static casters (cached), dynamic ones are drawn per update
+                    if (mHasDynamicCasters) {
+                        auto& dynamicVisible = mDynamicShadowVisible[c];
+                        dynamicVisible.resize(visible.size());
+                        for (std::size_t i = 0; i < visible.size(); ++i) {
+                            bool const dynamic = mModel.scenes[i].dynamic;
+                            dynamicVisible[i] = dynamic ? visible[i] : 0;
+                            if (dynamic)
+                                visible[i] = 0;
+                        }
+                    }
+                }
+
+                mStats.cullMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+
+                // software occlusion culling of the main pass
+                if (!cachedDraws && mState.softwareOcclusion && !mOccluders.indices.empty()) {
+                    auto const rasterStart = std::chrono::steady_clock::now();
+                    rasterize_occluders(mOccluders, sceneUniforms.projCam, mOcclusionBuffer);
+
+                    auto const testStart = std::chrono::steady_clock::now();
+                    std::uint32_t const occluded = test_occlusion(mOcclusionBuffer, sceneUniforms.projCam, mInstanceBounds, mMainVisible);
+                    auto const testEnd = std::chrono::steady_clock::now();
+
+                    mStats.rasterMs += std::chrono::duration<float, std::milli>(testStart - rasterStart).count();
+                    mStats.testMs += std::chrono::duration<float, std::milli>(testEnd - testStart).count();
+                    mStats.swOccluded += occluded;
+                    ++mStats.swFrames;
+
+                    if (mState.dumpOcclusionBuffer) {
+                        bool const ok = write_occlusion_buffer(mOcclusionBuffer, cfg::kOcclusionDumpPath);
+                        std::print(stderr, "{} {}\n", ok ? "Wrote" : "Unable to write", cfg::kOcclusionDumpPath);
+                    }
+                }
+
+                mState.dumpOcclusionBuffer = false;
+            }
+
+            // point light casters per cube face; on the GPU-driven path only when
+            // it cannot render the layered pass (see PointShadowMode())
+            if (pointShadows && (!useIndirect || !mLayeredPointShadows)) {
+                auto const cullStart = std::chrono::steady_clock::now();
+
+                mStats.pointFaces += compute_point_face_masks(sceneUniforms.pointFaceVP, mInstanceBounds, mPointFaceMasks, mPointCullScratch);
+                mStats.pointCasters += std::size_t(std::count_if(mPointFaceMasks.begin(), mPointFaceMasks.end(),
+                    [](std::uint8_t m) { return 0 != m; }));
+
+                mStats.cullMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+            }
+
+            ShadowMap const& staticMap = mHasDynamicCasters ? mStaticShadowMap : mShadowMap;
+            VkImageView shadowLayers[cfg::kMaxShadowCascades]{}, staticLayers[cfg::kMaxShadowCascades]{};
+
+            ShadowPass shadowPass{};
+            shadowPass.cascadeCount = mCascades.count;
+            shadowPass.resolution = mShadowMap.resolution;
+            shadowPass.updateMask = updateMask;
+            shadowPass.refreshMask = refreshMask;
+            shadowPass.dynamic = mHasDynamicCasters;
+            shadowPass.discard = mShadowReset;
+            shadowPass.shadowImage = mShadowMap.image.image;
+            shadowPass.staticImage = staticMap.image.image;
+            for (std::uint32_t c = 0; c < cfg::kMaxShadowCascades; ++c) {
+                shadowLayers[c] = mShadowMap.layerViews[c].handle;
+                staticLayers[c] = staticMap.layerViews[c].handle;
+                shadowPass.staticVisible[c] = mShadowVisible[c];
+                shadowPass.dynamicVisible[c] = mDynamicShadowVisible[c];
+            }
+            shadowPass.shadowLayers = shadowLayers;
+            shadowPass.staticLayers = staticLayers;
+            shadowPass.opaquePipe = mShadowOpaquePipe.handle;
+            shadowPass.pointOpaquePipe = mPointShadowOpaquePipe.handle;
+            shadowPass.atlasOpaquePipe = mAtlasShadowOpaquePipe.handle;
+
+            shadowPass.pointFaces = pointShadows;
+            shadowPass.pointDiscard = mPointShadowReset;
+            shadowPass.pointResolution = mPointShadowMap.resolution;
+            shadowPass.pointImage = mPointShadowMap.image.image;
+            shadowPass.pointTarget = mPointShadowMap.faces.handle;
+            shadowPass.pointPipe = mPointShadowPipe.handle;
+            VkImageView const pointFaceTargets[6] = {
+                mPointShadowMap.face[0].handle, mPointShadowMap.face[1].handle, mPointShadowMap.face[2].handle,
+                mPointShadowMap.face[3].handle, mPointShadowMap.face[4].handle, mPointShadowMap.face[5].handle
+            };
+            shadowPass.pointFaceTargets = pointFaceTargets;
+            shadowPass.pointFacePipe = mPointFaceShadowPipe.handle;
+            shadowPass.pointFaceOpaquePipe = mPointFaceShadowOpaquePipe.handle;
+            shadowPass.pointFaceMasks = mPointFaceMasks;
+
+            shadowPass.atlasUpdates = atlasSchedule.updates;
+            shadowPass.spotVisible = mSpotVisible;
+            shadowPass.atlasDiscard = mShadowAtlasReset;
+            shadowPass.atlasSize = mShadowAtlas.size;
+            shadowPass.atlasImage = mShadowAtlasImage.image;
+            shadowPass.atlasView = mShadowAtlasImage.view;
+            shadowPass.atlasPipe = mAtlasShadowPipe.handle;
+
+            mShadowReset = false;
+            mPointShadowReset = false;
+            mShadowAtlasReset = false;
+
+            DepthPrepass prepass{};
+            prepass.enabled = depthPrepass;
+            prepass.opaquePipe = mPrepassPipe.handle;
+            prepass.alphaPipe = mPrepassAlphaPipe.handle;
+            prepass.indirectOpaquePipe = mIndirectPrepassPipe.handle;
+            prepass.indirectAlphaPipe = mIndirectPrepassAlphaPipe.handle;
+            if (mPassStatistics.handle) {
+                prepass.statistics = mPassStatistics.handle;
+                prepass.firstQuery = std::uint32_t(mFrameIndex * 2);
+                mStatisticsPending[mFrameIndex] = 1;
+            }
+
+            LightClusters clusters{};
+            clusters.lightCount = clusterLights;
+            clusters.clusterCounts = mClusterCountBuffer.buffer;
+            clusters.clusterIndices = mClusterIndexBuffer.buffer;
+            clusters.binPipe = mClusterPipe.handle;
+            clusters.binLayout = mClusterPipeLayout.handle;
+            mStats.clusterLights += clusterLights;
+
+            VisBufferPass visbuffer{};
+            visbuffer.enabled = visibilityBuffer;
+            visbuffer.image = mTransients.visbuffer.image;
+            visbuffer.view = mTransients.visbuffer.view;
+            visbuffer.resolvePipe = mVisbufferResolvePipe.handle;
+            visbuffer.resolveLayout = mVisbufferPipeLayout.handle;
+            visbuffer.resolveDescriptors = mVisbufferDescriptors;
+
+            // compute post-processing, not for the overdraw/overshading visualizations
+            ComputePostPass computePost{};
+            computePost.enabled = mState.computePost && mComputePostSupported
+                && mState.renderMode != 4 && mState.renderMode != 5;
+            computePost.image = mTransients.post.image;
+            computePost.pipe = mComputePostPipe.handle;
+            computePost.layout = mComputePostPipeLayout.handle;
+            computePost.descriptors = mComputePostDescriptors;
+            computePost.push.size = glm::uvec2(mWindow.swapchainExtent.width, mWindow.swapchainExtent.height);
+            computePost.push.renderSize = glm::uvec2(renderExtent.width, renderExtent.height);
+            computePost.push.exposure = mState.exposure;
+            computePost.push.sharpen = cfg::kPostSharpen;
+            computePost.push.mosaic = mState.mosaicEnabled ? 1 : 0;
+            computePost.push.filter = mState.postFilter;
+
+            // the rest of the frame's data; plain writes, visible to the GPU at submit
+            mFrameRing.write(mFrameScene, sceneUniforms);
+            if (mState.spotLights)
+                mFrameRing.write(mFrameSpots, mSpotData.data(), mSpotData.size() * sizeof(glsl::SpotLightData));
+            mFrameRing.write(mFrameClusterLights, mClusterData.data(), clusterLights * sizeof(glsl::ClusterLightData));
+            mFrameRing.flush();
 
             // Record and submit commands for this frame
+            auto const recordStart = std::chrono::steady_clock::now();
+
+            // CPU path: draws of both passes are recorded by worker threads into
+            // secondaries; record_commands() then only executes them. Cached draws
+            // keep the secondaries of this frame slot: every instance of a region
+            // is recorded (static casters for the shadows), so the camera does not
+            // invalidate them; the regions culled above are not executed.
+            std::size_t const recordThreads = useIndirect ? 0
+                : cachedDraws ? cfg::kCachedDrawRegions
+                : std::min<std::size_t>(mState.recordThreads, cfg::kMaxRecordThreads);
+
+            SecondaryDrawLists secondary{};
+            if (mPassStatistics.handle)
+                secondary.statistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+            std::uint8_t dirty[cfg::kCachedDrawRegions] = {};
+            std::size_t dirtyCount = recordThreads;
+            ShadowPass recordShadow = shadowPass;
+
+            if (cachedDraws) {
+                auto& cache = mDrawCaches[mFrameIndex];
+                bool const stale = cache.generation != mDrawCacheGeneration
+                    || cache.renderMode != mState.renderMode
+                    || cache.depthPrepass != depthPrepass
+                    || cache.visibilityBuffer != visibilityBuffer
+                    || cache.cascadeCount != mCascades.count;
+
+                dirtyCount = 0;
+                for (std::size_t r = 0; r < cfg::kCachedDrawRegions; ++r) {
+                    dirty[r] = stale ? 1 : 0;
+                    dirtyCount += dirty[r];
+                }
+
+                for (std::uint32_t c = 0; c < mCascades.count; ++c)
+                    recordShadow.staticVisible[c] = mStaticCasters;
+
+                // every cascade is kept recorded, only the refreshed ones are executed
+                secondary.shadow = cache.shadow;
+                secondary.shadowMask = (1u << mCascades.count) - 1;
+                secondary.main = cache.main;
+                secondary.dirty = dirty;
+                secondary.executed = executed;
+                secondary.reusable = true;
+
+                if (dirtyCount > 0) {
+                    cache.generation = mDrawCacheGeneration;
+                    cache.renderMode = mState.renderMode;
+                    cache.depthPrepass = depthPrepass;
+                    cache.visibilityBuffer = visibilityBuffer;
+                    cache.cascadeCount = mCascades.count;
+                }
+
+                mStats.regionsRecorded += dirtyCount;
+            }
+            else if (recordThreads > 0) {
+                std::size_t const first = mFrameIndex * cfg::kMaxRecordThreads;
+                secondary.shadow = std::span<VkCommandBuffer const>(mShadowSecondaries).subspan(first * cfg::kMaxShadowCascades, recordThreads * cfg::kMaxShadowCascades);
+                secondary.shadowMask = refreshMask;
+                secondary.main = std::span<VkCommandBuffer const>(mMainSecondaries).subspan(first, recordThreads);
+            }
+
+            if (dirtyCount > 0) {
+                VkFormat const colorFormat = visibilityBuffer ? cfg::kVisbufferFormat
+                    : (mState.renderMode == 4 || mState.renderMode == 5) ? VK_FORMAT_R8G8B8A8_UNORM
+                    : VK_FORMAT_R16G16B16A16_SFLOAT;
+
+                record_secondary_draws(secondary, colorFormat, renderExtent,
+                    currentOpaque, currentAlpha, mShadowPipe.handle,
+                    mPipeLayout.handle, scene,
+                    mVertexPositions.buffer, mVertexTexCoords.buffer, mVertexNormals.buffer, mIndexBuffer.buffer,
+                    mMeshRanges,
+                    mModel.meshes, mModel.materials,
+                    currentMaterials,
+                    mModel.scenes,
+                    cachedDraws ? mAllInstances : mMainVisible,
+                    recordShadow);
+            }
+
+            // read back with the profiler's "frame" scope, see above
+            if (mProfiling)
+                mFrameScale[mFrameIndex] = mResolution.scale;
+
+            RenderGraphStats graphStats{};
             record_commands(
                 mCmdBuffers[mFrameIndex],
                 currentOpaque, currentAlpha,
                 colorTarget, depthTarget,
-                mWindow.swapchainExtent,
-                mSceneUBO.buffer, sceneUniforms,
-                mPipeLayout.handle, mSceneDescriptors,
-                mMeshPositions, mMeshTexCoords, mMeshNormals, mMeshIndices,
+                mWindow.swapchainExtent, renderExtent,
+                mPipeLayout.handle, scene,
+                mVertexPositions.buffer, mVertexTexCoords.buffer, mVertexNormals.buffer, mIndexBuffer.buffer,
+                mMeshRanges,
                 mModel.meshes, mModel.materials,
-                *currentDescs,
+                currentMaterials,
                 mModel.scenes,
                 resolvePipeline, resolveDescs, resolveLayout,
                 offscreenTarget, clearColor,
-                mShadowPipe.handle, shadowTarget
+                mShadowPipe.handle,
+                useIndirect ? std::span<std::uint8_t const>{} : mMainVisible,
+                shadowPass,
+                useIndirect ? &indirect : nullptr,
+                recordThreads > 0 ? &secondary : nullptr,
+                &prepass,
+                &clusters,
+                &visbuffer,
+                &computePost,
+                mProfiling ? &mProfiler : nullptr,
+                &graphStats
             );
+            mStats.graphPasses += graphStats.passes;
+            mStats.graphCulled += graphStats.culled;
+            mStats.graphBarriers += graphStats.barriers;
+            mStats.graphBatches += graphStats.batches;
+
+            mStats.recordMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
 
-            submit_commands(mWindow,
+            mFrameValues[mFrameIndex] = submit_commands(mGraphicsTimeline,
                 mCmdBuffers[mFrameIndex],
-                mFrameDone[mFrameIndex].handle,
                 mImageAvailable[mFrameIndex].handle,
-                mRenderFinished[mFrameIndex].handle);
+                mRenderFinished[imageIndex].handle);
+
+            mStats.cpuFrameMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+            ReportStats(dt, useIndirect, cachedDraws, recordThreads);
 
             present_results(mWindow.presentQueue, mWindow.swapchain,
-                imageIndex, mRenderFinished[mFrameIndex].handle,
+                imageIndex, mRenderFinished[imageIndex].handle,
                 mRecreateSwapchain);
         }
 
@@ -438,132 +1379,215 @@ namespace engine {
         }
 
     private:
-        void BuildMaterialDescriptors(VkSampler sampler,
-            std::vector<VkDescriptorSet>& out)
+        // bindless set 1: the material buffer plus every texture; slot 0 holds
+        // the default gray texture, see texture_slot()
+        VkDescriptorSet BuildMaterialDescriptors(VkSampler sampler)
         {
-            for (auto const& mat : mModel.materials) {
-                VkDescriptorSet ds = lut::alloc_desc_set(
-                    mWindow, mDescPool.handle, mObjectLayout.handle);
-
-                // Base Color
-                VkImageView baseView = mDefaultGrayView.handle;
-                if (mat.baseColorTexture >= 0)
-                    baseView = mModelTextureViews[mat.baseColorTexture].handle;
-
-                // 2. Roughness / Metalness
-                // if roughness/metallic textures are missing, using gray (0.5 roughness/metal)
-                VkImageView mrView = mDefaultGrayView.handle;
-                if (mat.metalRoughTexture >= 0)
-                    mrView = mModelTextureViews[mat.metalRoughTexture].handle;
-
-                VkDescriptorImageInfo imgs[3]{};
-                imgs[0] = { sampler, baseView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
-                imgs[1] = { sampler, mrView,   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
-                imgs[2] = { sampler, mrView,   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
-
-                VkWriteDescriptorSet w[3]{};
-                for (int j = 0; j < 3; ++j) {
-                    w[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-                    w[j].dstSet = ds; w[j].dstBinding = (uint32_t)j;
-                    w[j].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-                    w[j].descriptorCount = 1; w[j].pImageInfo = &imgs[j];
-                }
-                vkUpdateDescriptorSets(mWindow.device, 3, w, 0, nullptr);
-                out.emplace_back(ds);
+            std::uint32_t const textureCount = std::uint32_t(mModelTextureViews.size()) + 1;
+            if (textureCount > cfg::kMaxBindlessTextures)
+                throw lut::Error("Scene has {} textures, at most {} are supported",
+                    mModelTextureViews.size(), cfg::kMaxBindlessTextures - 1);
+
+            VkDescriptorSet ds = lut::alloc_desc_set(
+                mWindow, mBindlessPool.handle, mObjectLayout.handle, textureCount);
+
+            std::vector<VkDescriptorImageInfo> imgs;
+            imgs.reserve(textureCount);
+            imgs.push_back({ sampler, mDefaultGrayView.handle, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+            for (std::size_t i = 0; i < mModelTextureViews.size(); ++i)
+                imgs.push_back({ sampler, mModelTextureViews[i].handle, mModelTextureLayouts[i] });
+
+            VkDescriptorBufferInfo materials{ mMaterialBuffer.buffer, 0, VK_WHOLE_SIZE };
+
+            VkWriteDescriptorSet w[2]{};
+            w[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            w[0].dstSet = ds; w[0].dstBinding = 0;
+            w[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            w[0].descriptorCount = 1; w[0].pBufferInfo = &materials;
+
+            w[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            w[1].dstSet = ds; w[1].dstBinding = 1;
+            w[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            w[1].descriptorCount = textureCount; w[1].pImageInfo = imgs.data();
+
+            vkUpdateDescriptorSets(mWindow.device, 2, w, 0, nullptr);
+            return ds;
+        }
+
+        // the model's host-copyable textures through both upload paths, into
+        // images that are dropped again: CPU mips, host copies and staged uploads
+        // (copy and GPU mips, up to the GPU being done) each timed on their own
+        void CompareTextureUploads(bool aHostCopySrgb, bool aHostCopyUnorm, VkImageLayout aHostCopyLayout)
+        {
+            using Clock = std::chrono::steady_clock;
+            auto const msSince = [](Clock::time_point aStart) {
+                return std::chrono::duration<double, std::milli>(Clock::now() - aStart).count();
+            };
+
+            double mipMs = 0.0, hostMs = 0.0, stagedMs = 0.0;
+            std::size_t count = 0, bytes = 0;
+            std::vector<lut::Image> images;
+
+            for (auto const& tex : mModel.textures) {
+                VkFormat const fmt = (tex.space == ETextureSpace::srgb) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+                if (!(VK_FORMAT_R8G8B8A8_SRGB == fmt ? aHostCopySrgb : aHostCopyUnorm))
+                    continue;
+
+                auto const mipStart = Clock::now();
+                auto const mips = lut::build_mips_rgba8(tex.pixels.data(),
+                    static_cast<uint32_t>(tex.width), static_cast<uint32_t>(tex.height),
+                    VK_FORMAT_R8G8B8A8_SRGB == fmt);
+                mipMs += msSince(mipStart);
+
+                auto const hostStart = Clock::now();
+                images.emplace_back(lut::load_image_texture2d_host(tex.pixels.data(),
+                    static_cast<uint32_t>(tex.width), static_cast<uint32_t>(tex.height),
+                    mips, mWindow, mAllocator, fmt, aHostCopyLayout));
+                hostMs += msSince(hostStart);
+
+                ++count;
+                bytes += tex.pixels.size();
             }
+            images.clear();
+
+            lut::UploadStats const uploadsBefore = mUploads.stats();
+            auto const stagedStart = Clock::now();
+            for (auto const& tex : mModel.textures) {
+                VkFormat const fmt = (tex.space == ETextureSpace::srgb) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+                if (!(VK_FORMAT_R8G8B8A8_SRGB == fmt ? aHostCopySrgb : aHostCopyUnorm))
+                    continue;
+
+                images.emplace_back(lut::load_image_texture2d_from_memory(tex.pixels.data(),
+                    static_cast<uint32_t>(tex.width), static_cast<uint32_t>(tex.height),
+                    mUploads, mAllocator, fmt));
+                if (cfg::kUploadWaitPerTexture)
+                    mUploads.finish();
+            }
+            mUploads.finish();
+            stagedMs = msSince(stagedStart);
+            images.clear(); // the GPU is done with them after finish()
+
+            if (!count)
+                return;
+
+            auto const& stats = mUploads.stats();
+            double const n = double(count);
+            std::print(stderr, "[stats] texture uploads, same {} textures ({:.1f} MiB), ms/texture: host image copy {:.3f} + CPU mips {:.3f} = {:.3f}; staged with GPU mips {:.3f} ({} batches, {} host waits)\n",
+                count, double(bytes) / (1024.0 * 1024.0),
+                hostMs / n, mipMs / n, (hostMs + mipMs) / n,
+                stagedMs / n,
+                stats.batches - uploadsBefore.batches, stats.stalls - uploadsBefore.stalls);
         }
 
         void UploadMeshes()
         {
-            // Mesh upload: use a single command buffer for all uploads to avoid
-            // stalling the pipeline with hundreds of submissions.
-            VkCommandBuffer uploadCmd = lut::alloc_command_buffer(mWindow, mCmdPool.handle);
-            VkCommandBufferBeginInfo bi{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
-            bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-            vkBeginCommandBuffer(uploadCmd, &bi);
+            // Merge all meshes into one set of vertex streams and one index buffer;
+            // every mesh is addressed with firstIndex/vertexOffset (MeshDrawRange).
+            // This lets the CPU path bind the buffers once per pass and is required
+            // by the GPU-driven path, where one indirect draw covers many meshes.
+            std::vector<glm::vec3>     positions, normals;
+            std::vector<glm::vec2>     texcoords;
+            std::vector<std::uint32_t> indices;
+
+            mMeshRanges.clear();
+            for (auto const& mesh : mModel.meshes) {
+                mMeshRanges.emplace_back(MeshDrawRange{
+                    std::uint32_t(indices.size()),
+                    std::uint32_t(mesh.indices.size()),
+                    std::int32_t(positions.size())
+                });
+
+                positions.insert(positions.end(), mesh.positions.begin(), mesh.positions.end());
+                texcoords.insert(texcoords.end(), mesh.texcoords.begin(), mesh.texcoords.end());
+                normals.insert(normals.end(), mesh.normals.begin(), mesh.normals.end());
+                indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+            }
 
-            // Keep staging buffers alive until submit is complete
-            std::vector<lut::Buffer> staging;
+            // storage buffers for the GPU-driven path
+            GpuDrawData drawData = build_gpu_draw_data(mModel, mMeshRanges);
+            mDrawBuckets = std::move(drawData.buckets);
 
-            for (auto const& mesh : mModel.meshes) {
-                // Poll events to keep window responsive
-                glfwPollEvents();
+            // new static geometry invalidates the cached shadow depth
+            ++mStaticGeometryGeneration;
 
-                VkDeviceSize posSz = mesh.positions.size() * sizeof(glm::vec3);
-                VkDeviceSize texSz = mesh.texcoords.size() * sizeof(glm::vec2);
-                VkDeviceSize normSz = mesh.normals.size() * sizeof(glm::vec3);
-                VkDeviceSize idxSz = mesh.indices.size() * sizeof(std::uint32_t);
+            // Mesh upload: all buffers go into the upload batch after the textures,
+            // copied out of the staging ring on the transfer queue
+            auto upload = [&](void const* src, std::size_t count, std::size_t elemSize,
+                VkBufferUsageFlags usage, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess) {
+                    // zero sized buffers are invalid, keep at least one element
+                    VkDeviceSize const sz = VkDeviceSize(std::max<std::size_t>(count, 1) * elemSize);
 
-                auto mkGpu = [&](VkDeviceSize sz, VkBufferUsageFlags usage) {
-                    return lut::create_buffer(mAllocator, sz,
+                    lut::Buffer gpu = lut::create_buffer(mAllocator, sz,
                         usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
-                    };
-                mMeshPositions.emplace_back(mkGpu(posSz, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT));
-                mMeshTexCoords.emplace_back(mkGpu(texSz, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT));
-                mMeshNormals.emplace_back(mkGpu(normSz, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT));
-                mMeshIndices.emplace_back(mkGpu(idxSz, VK_BUFFER_USAGE_INDEX_BUFFER_BIT));
-
-                // upload data (using staging buffers)
-                auto mkStg = [&](VkDeviceSize sz) {
-                    return lut::create_buffer(mAllocator, sz,
-                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
-                    };
-                lut::Buffer ps = mkStg(posSz), ts = mkStg(texSz),
-                    ns = mkStg(normSz), is = mkStg(idxSz);
-
-                auto up = [&](lut::Buffer& b, const void* src, VkDeviceSize sz) {
-                    void* ptr;
-                    vmaMapMemory(mAllocator.allocator, b.allocation, &ptr);
-                    std::memcpy(ptr, src, static_cast<std::size_t>(sz));
-                    vmaUnmapMemory(mAllocator.allocator, b.allocation);
-                    };
-                up(ps, mesh.positions.data(), posSz);
-                up(ts, mesh.texcoords.data(), texSz);
-                up(ns, mesh.normals.data(), normSz);
-                up(is, mesh.indices.data(), idxSz);
-
-                auto cpy = [&](lut::Buffer& src, lut::Buffer& dst, VkDeviceSize sz) {
-                    VkBufferCopy c{ 0, 0, sz };
-                    vkCmdCopyBuffer(uploadCmd, src.buffer, dst.buffer, 1, &c);
-                    };
-                cpy(ps, mMeshPositions.back(), posSz);
-                cpy(ts, mMeshTexCoords.back(), texSz);
-                cpy(ns, mMeshNormals.back(), normSz);
-                cpy(is, mMeshIndices.back(), idxSz);
-
-                // Add buffer barriers for vertex attributes
-                lut::buffer_barrier(uploadCmd, mMeshPositions.back().buffer,
-                    VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
-                    VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT);
-                lut::buffer_barrier(uploadCmd, mMeshTexCoords.back().buffer,
-                    VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
-                    VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT);
-                lut::buffer_barrier(uploadCmd, mMeshNormals.back().buffer,
-                    VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
-                    VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT);
-                lut::buffer_barrier(uploadCmd, mMeshIndices.back().buffer,
-                    VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
-                    VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT);
-
-                staging.emplace_back(std::move(ps)); staging.emplace_back(std::move(ts));
-                staging.emplace_back(std::move(ns)); staging.emplace_back(std::move(is));
-            }
-
-            vkEndCommandBuffer(uploadCmd);
-
-            VkCommandBufferSubmitInfo ci{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO };
-            ci.commandBuffer = uploadCmd;
-            VkSubmitInfo2 si{ VK_STRUCTURE_TYPE_SUBMIT_INFO_2 };
-            si.commandBufferInfoCount = 1; si.pCommandBufferInfos = &ci;
-            vkQueueSubmit2(mWindow.graphicsQueue, 1, &si, VK_NULL_HANDLE);
-
-            // Wait for uploads to finish before destroying staging buffers
-            vkQueueWaitIdle(mWindow.graphicsQueue);
+                        0, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+                    // an empty buffer is never read
+                    if (count)
+                        mUploads.upload(gpu.buffer, src, VkDeviceSize(count * elemSize), dstStage, dstAccess);
+
+                    return gpu;
+                };
+
+            // the streams are also storage buffers: the visibility buffer resolve
+            // fetches the triangles of its ids from them
+            VkBufferUsageFlags const fetch = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+            VkPipelineStageFlags2 const fetchStage = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+            VkAccessFlags2 const fetchAccess = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+
+            mVertexPositions = upload(positions.data(), positions.size(), sizeof(glm::vec3), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | fetch,
+                VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT | fetchStage, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT | fetchAccess);
+            mVertexTexCoords = upload(texcoords.data(), texcoords.size(), sizeof(glm::vec2), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | fetch,
+                VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT | fetchStage, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT | fetchAccess);
+            mVertexNormals = upload(normals.data(), normals.size(), sizeof(glm::vec3), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | fetch,
+                VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT | fetchStage, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT | fetchAccess);
+            mIndexBuffer = upload(indices.data(), indices.size(), sizeof(std::uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | fetch,
+                VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT | fetchStage, VK_ACCESS_2_INDEX_READ_BIT | fetchAccess);
+
+            mInstanceBuffer = upload(drawData.instances.data(), drawData.instances.size(), sizeof(glsl::InstanceData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | fetchStage, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+            mMeshDataBuffer = upload(drawData.meshes.data(), drawData.meshes.size(), sizeof(glsl::MeshData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | fetchStage, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+
+            // bindless material parameters (set 1, binding 0)
+            std::vector<glsl::MaterialData> const materials = build_material_data(mModel);
+            mMaterialBuffer = upload(materials.data(), materials.size(), sizeof(glsl::MaterialData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+
+            // everything counts as visible in the first frame of the occlusion test
+            std::vector<std::uint32_t> const visibility(drawData.instances.size(), 1);
+            mVisibilityBuffer = upload(visibility.data(), visibility.size(), sizeof(std::uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+            // no wait: the acquires are ahead of the first frame on the graphics queue
+            mUploads.flush();
+
+            // Draw command buffers: one slot per instance, written by cull.comp
+            VkDeviceSize const drawSz = std::max<std::size_t>(mModel.scenes.size(), 1) * sizeof(VkDrawIndexedIndirectCommand);
+            mMainDrawBuffer = lut::create_buffer(mAllocator, drawSz,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                0, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+            mShadowDrawBuffer = lut::create_buffer(mAllocator, cfg::kMaxShadowCascades * drawSz,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                0, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+            // point light shadow: one slot per instance and cube face
+            mPointDrawBuffer = lut::create_buffer(mAllocator, 6 * drawSz,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                0, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+            mLateDrawBuffer = lut::create_buffer(mAllocator, drawSz,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                0, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+            // counters per bucket and pass plus the occlusion statistics; cleared with
+            // vkCmdFillBuffer every frame, the statistics are copied out for the host
+            mDrawCountBuffer = lut::create_buffer(mAllocator,
+                draw_count_buffer_size(mDrawBuckets.size()),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                0, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
         }
 
-        VkDescriptorSet BuildPostDesc(VkImageView imageView, VkBuffer mosaicBuf)
+        VkDescriptorSet BuildPostDesc(VkImageView imageView)
         {
             VkDescriptorSet ds = lut::alloc_desc_set(
                 mWindow, mDescPool.handle, mPostLayout.handle);
@@ -573,7 +1597,7 @@ namespace engine {
             ii.imageView = imageView;
             ii.sampler = mPostSampler.handle;
 
-            VkDescriptorBufferInfo bi{ mosaicBuf, 0, VK_WHOLE_SIZE };
+            VkDescriptorBufferInfo bi{ mFrameRing.buffer(), mFrameMosaic, sizeof(glsl::MosaicUniform) };
 
             VkWriteDescriptorSet w[2]{};
             w[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -584,28 +1608,367 @@ namespace engine {
             // Mosaic UBO Binding
             w[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
             w[1].dstSet = ds; w[1].dstBinding = 1;
-            w[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            w[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
             w[1].descriptorCount = 1; w[1].pBufferInfo = &bi;
 
             vkUpdateDescriptorSets(mWindow.device, 2, w, 0, nullptr);
             return ds;
         }
 
-        void UpdatePostDescImage(std::vector<VkDescriptorSet>& sets, VkImageView newView)
+        void UpdatePostDescImage(VkDescriptorSet ds, VkImageView newView)
         {
             VkDescriptorImageInfo ii{};
             ii.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
             ii.imageView = newView;
             ii.sampler = mPostSampler.handle;
 
-            for (auto ds : sets) {
-                VkWriteDescriptorSet w{};
-                w.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-                w.dstSet = ds; w.dstBinding = 0;
-                w.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-                w.descriptorCount = 1; w.pImageInfo = &ii;
-                vkUpdateDescriptorSets(mWindow.device, 1, &w, 0, nullptr);
+            VkWriteDescriptorSet w{};
+            w.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            w.dstSet = ds; w.dstBinding = 0;
+            w.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            w.descriptorCount = 1; w.pImageInfo = &ii;
+            vkUpdateDescriptorSets(mWindow.device, 1, &w, 0, nullptr);
+        }
+
+        // offscreen image in, TransientAttachments::post out; again after a resize
+        void UpdateComputePostDescriptors()
+        {
+            VkDescriptorImageInfo src{ mPostSampler.handle, mTransients.offscreen.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+            VkDescriptorImageInfo dst{ VK_NULL_HANDLE, mTransients.post.view, VK_IMAGE_LAYOUT_GENERAL };
+
+            VkWriteDescriptorSet w[2]{};
+            w[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            w[0].dstSet = mComputePostDescriptors; w[0].dstBinding = 0;
+            w[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            w[0].descriptorCount = 1; w[0].pImageInfo = &src;
+
+            w[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            w[1].dstSet = mComputePostDescriptors; w[1].dstBinding = 1;
+            w[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            w[1].descriptorCount = 1; w[1].pImageInfo = &dst;
+
+            vkUpdateDescriptorSets(mWindow.device, 2, w, 0, nullptr);
+        }
+
+        // one present wait semaphore per swapchain image: the image's previous
+        // present is done with it once the image is acquired again, which a
+        // frame slot's timeline value does not guarantee
+        void CreateRenderFinished()
+        {
+            mRenderFinished.clear();
+            for (std::size_t i = 0; i < mWindow.swapImages.size(); ++i)
+                mRenderFinished.emplace_back(lut::create_semaphore(mWindow.device));
+        }
+
+        // reduce sets: level 0 reads the depth buffer, level i reads level i-1;
+        // the cull set samples the whole pyramid. Called again after a resize.
+        void UpdatePyramidDescriptors()
+        {
+            std::vector<VkDescriptorImageInfo> src(mDepthPyramid.levels), dst(mDepthPyramid.levels);
+            std::vector<VkWriteDescriptorSet> w;
+
+            for (std::uint32_t i = 0; i < mDepthPyramid.levels; ++i) {
+                src[i].sampler = mPyramidSampler.handle;
+                src[i].imageView = 0 == i ? mDepthBuffer.view : mDepthPyramid.levelViews[i - 1].handle;
+                src[i].imageLayout = 0 == i ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+                dst[i].imageView = mDepthPyramid.levelViews[i].handle;
+                dst[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+                VkWriteDescriptorSet ws{};
+                ws.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                ws.dstSet = mReduceDescriptors[i]; ws.dstBinding = 0;
+                ws.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                ws.descriptorCount = 1; ws.pImageInfo = &src[i];
+                w.emplace_back(ws);
+
+                ws.dstBinding = 1;
+                ws.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+                ws.pImageInfo = &dst[i];
+                w.emplace_back(ws);
+            }
+
+            VkDescriptorImageInfo pyramid{ mPyramidSampler.handle, mDepthPyramid.image.view, VK_IMAGE_LAYOUT_GENERAL };
+
+            VkWriteDescriptorSet wc{};
+            wc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            wc.dstSet = mCullDescriptors; wc.dstBinding = 6;
+            wc.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            wc.descriptorCount = 1; wc.pImageInfo = &pyramid;
+            w.emplace_back(wc);
+
+            vkUpdateDescriptorSets(mWindow.device, std::uint32_t(w.size()), w.data(), 0, nullptr);
+        }
+
+        // visibility buffer resolve, set 2: the id image (new on resize) and the mesh
+        // buffers it rebuilds the triangles from (new after UploadMeshes())
+        void UpdateVisbufferDescriptors()
+        {
+            VkDescriptorImageInfo ids{ VK_NULL_HANDLE, mTransients.visbuffer.view, VK_IMAGE_LAYOUT_GENERAL };
+
+            VkDescriptorBufferInfo bi[5]{
+                { mMeshDataBuffer.buffer, 0, VK_WHOLE_SIZE },
+                { mIndexBuffer.buffer, 0, VK_WHOLE_SIZE },
+                { mVertexPositions.buffer, 0, VK_WHOLE_SIZE },
+                { mVertexTexCoords.buffer, 0, VK_WHOLE_SIZE },
+                { mVertexNormals.buffer, 0, VK_WHOLE_SIZE }
+            };
+
+            VkWriteDescriptorSet w[6]{};
+            w[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            w[0].dstSet = mVisbufferDescriptors; w[0].dstBinding = 0;
+            w[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            w[0].descriptorCount = 1; w[0].pImageInfo = &ids;
+
+            for (std::uint32_t j = 0; j < 5; ++j) {
+                w[1 + j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                w[1 + j].dstSet = mVisbufferDescriptors; w[1 + j].dstBinding = 1 + j;
+                w[1 + j].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                w[1 + j].descriptorCount = 1; w[1 + j].pBufferInfo = &bi[j];
+            }
+
+            vkUpdateDescriptorSets(mWindow.device, 6, w, 0, nullptr);
+        }
+
+        // stress scene: grid copies of the loaded instances, offset by the scene size
+        void ReplicateScene(std::size_t aCount)
+        {
+            InstanceBounds const bounds = compute_instance_bounds(mModel);
+            if (0 == bounds.count)
+                return;
+
+            auto const [lo, hi] = compute_scene_bounds(bounds);
+
+            std::vector<EngineInstance> const base = std::move(mModel.scenes);
+            std::size_t const copies = (aCount + base.size() - 1) / base.size();
+            std::size_t const side = std::size_t(std::ceil(std::sqrt(double(copies))));
+            glm::vec3 const step = 1.1f * (hi - lo);
+
+            mModel.scenes.clear();
+            mModel.scenes.reserve(aCount);
+            for (std::size_t c = 0; mModel.scenes.size() < aCount; ++c) {
+                glm::mat4 const shift = glm::translate(glm::vec3(step.x * float(c % side), 0.f, step.z * float(c / side)));
+                for (auto const& inst : base) {
+                    if (mModel.scenes.size() == aCount)
+                        break;
+                    mModel.scenes.emplace_back(EngineInstance{ inst.meshIndex, shift * inst.transform, inst.dynamic });
+                }
             }
+
+            std::print(stderr, "Stress scene: {} instances ({} copies of {})\n", mModel.scenes.size(), copies, base.size());
+        }
+
+        // cascaded shadow maps at mState.shadowResolution; the static shadow cache
+        // gets its own image only when dynamic casters are composited over a copy
+        // of it, see ShadowPass
+        void CreateShadowMaps()
+        {
+            std::uint32_t const resolution = mState.shadowResolution;
+            if (mHasDynamicCasters) {
+                mShadowMap = create_shadow_map(mWindow, mAllocator, resolution, VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+                mStaticShadowMap = create_shadow_map(mWindow, mAllocator, resolution, VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+            }
+            else {
+                mShadowMap = create_shadow_map(mWindow, mAllocator, resolution);
+            }
+
+            // contents are undefined, every cascade is rendered in the next frame
+            mShadowReset = true;
+        }
+
+        // mState.pointShadows, mode 1 falls back to 2 without shaderOutputLayer
+        std::uint32_t PointShadowMode() const
+        {
+            return (1 == mState.pointShadows && !mLayeredPointShadows) ? 2 : mState.pointShadows;
+        }
+
+        void UpdateShadowDescriptor()
+        {
+            VkDescriptorImageInfo si{};
+            si.imageLayout = VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL;
+            si.imageView = mShadowMap.image.view;
+            si.sampler = mShadowSampler.handle;
+
+            VkWriteDescriptorSet w{};
+            w.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            w.dstSet = mSceneDescriptors; w.dstBinding = 1; // shadow map binding
+            w.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            w.descriptorCount = 1; w.pImageInfo = &si;
+            vkUpdateDescriptorSets(mWindow.device, 1, &w, 0, nullptr);
+        }
+
+        // periodic CPU-side summary on stderr; recordThreads == 0 is inline recording
+        void ReportStats(float dt, bool indirect, bool cached, std::size_t recordThreads)
+        {
+            mStats.elapsed += dt;
+            ++mStats.frames;
+
+            if (mStats.elapsed < cfg::kStatsInterval)
+                return;
+
+            float const frames = float(mStats.frames);
+            std::string const recording = cached ? std::string("cached")
+                : recordThreads > 0 ? std::format("{} threads", recordThreads)
+                : std::string("inline");
+            std::print(stderr, "[stats] {} path: {:.1f} fps, cpu frame {:.3f} ms, record {:.3f} ms/frame ({}), {} instances\n",
+                indirect ? "gpu-driven" : mIndirectSupported ? "cpu" : "cpu (gpu-driven unsupported)",
+                frames / mStats.elapsed,
+                mStats.cpuFrameMs / frames,
+                mStats.recordMs / frames,
+                recording,
+                mModel.scenes.size());
+
+            if (!indirect && mState.cachedDraws) {
+                std::print(stderr, "[stats] cached draws: {:.2f} of {} regions re-recorded per frame\n",
+                    float(mStats.regionsRecorded) / frames,
+                    cfg::kCachedDrawRegions);
+            }
+
+            std::print(stderr, "[stats] shadow cache: static casters rendered in {} of {} frames ({})\n",
+                mStats.shadowRefreshes, mStats.frames,
+                mHasDynamicCasters ? "dynamic casters drawn over a copy" : "no dynamic casters");
+
+            // per cascade: updates (staggered) and static caster renders; the GPU
+            // times are the profiler's "cascade N" scopes
+            std::string cascades;
+            for (std::uint32_t c = 0; c < mCascades.count; ++c)
+                cascades += std::format(" [{}] {}/{}", c, mStats.cascadeUpdates[c], mStats.cascadeRefreshes[c]);
+            std::print(stderr, "[stats] shadow cascades {} x {}, updates/static renders:{}\n",
+                mCascades.count, mShadowMap.resolution, cascades);
+
+            // receiver-aware fitting: texel density gained over the stable windows
+            if (mState.shadowFit) {
+                std::string density;
+                for (std::uint32_t c = 0; c < mCascades.count; ++c) {
+                    float const scale = mStats.cascadeUpdates[c] ? mStats.cascadeFitScale[c] / float(mStats.cascadeUpdates[c]) : 1.f;
+                    density += std::format(" [{}] x{:.2f}", c, 1.f / (scale * scale));
+                }
+                std::print(stderr, "[stats] shadow fit (receivers + casters): texels per area vs stable window:{}\n", density);
+            }
+
+            // point light: draws of the layered pass and the faces they cover; six
+            // separate passes would issue one draw per face covered instead (the GPU
+            // time is the profiler's "point shadow" scope)
+            if (PointShadowMode() && (!indirect || !mLayeredPointShadows)) {
+                static char const* const kModes[] = { "", "layered pass", "one pass per face" };
+                std::print(stderr, "[stats] point shadow ({}{}): {} casters covering {} faces/frame ({:.2f} faces per caster)\n",
+                    kModes[PointShadowMode()],
+                    mLayeredPointShadows ? "" : ", no shaderOutputLayer",
+                    mStats.pointCasters / mStats.frames, mStats.pointFaces / mStats.frames,
+                    mStats.pointCasters ? float(mStats.pointFaces) / float(mStats.pointCasters) : 0.f);
+            }
+
+            // shadow atlas: allocated share, tiles and texels rendered per frame
+            // against the budget, visible lights left without a tile this frame
+            if (mState.spotLights) {
+                std::uint64_t const atlasTexels = std::uint64_t(mShadowAtlas.size) * mShadowAtlas.size;
+                std::print(stderr, "[stats] shadow atlas {0}x{0}: {1:.1f}% allocated ({2} tiles), {3:.2f} tiles and {4:.3f} of {5:.3f} Mtexels budget rendered/frame, {6:.2f} lights unshadowed/frame\n",
+                    mShadowAtlas.size,
+                    100.f * float(mShadowAtlas.allocatedTexels) / float(atlasTexels),
+                    mShadowAtlas.tileCount,
+                    float(mStats.atlasTiles) / frames,
+                    float(mStats.atlasTexels) / frames * 1e-6f,
+                    float(cfg::kShadowAtlasBudget) * 1e-6f,
+                    float(mStats.atlasUnshadowed) / frames);
+            }
+
+            // clustered lighting: lights binned per frame
+            if (mStats.clusterLights) {
+                std::print(stderr, "[stats] clustered lighting: {:.0f} lights in {}x{}x{} clusters (max {} per cluster)\n",
+                    float(mStats.clusterLights) / frames,
+                    cfg::kClusterTilesX, cfg::kClusterTilesY, cfg::kClusterSlices,
+                    cfg::kMaxLightsPerCluster);
+            }
+
+            // post-processing path (key R); the GPU times are the profiler's
+            // "post-process" scope against "compute post-process" plus "post blit"
+            {
+                static char const* const kFilters[] = { "none", "fxaa", "sharpen" };
+                std::print(stderr, "[stats] post-process {}x{}: {} (filter {}, mosaic {}, exposure {:g}){}\n",
+                    mWindow.swapchainExtent.width, mWindow.swapchainExtent.height,
+                    mState.computePost && mComputePostSupported ? "compute" : "raster",
+                    kFilters[mState.postFilter], mState.mosaicEnabled ? "on" : "off", mState.exposure,
+                    mComputePostSupported ? "" : ", compute unsupported (no swapchain blit)");
+            }
+
+            // dynamic resolution (key I): the average scale against the budget for the
+            // profiler's "frame" scope, and the scale the controller settled on
+            if (mStats.scaleFrames) {
+                std::print(stderr, "[stats] dynamic resolution {}: average scale {:.2f}, {}x{} of {}x{}, budget {:.1f} ms, {} scale changes\n",
+                    mDynamicResolution ? "on" : mState.dynamicResolution ? "unavailable" : "off",
+                    mStats.renderScale / float(mStats.scaleFrames),
+                    mRenderExtent.width, mRenderExtent.height,
+                    mWindow.swapchainExtent.width, mWindow.swapchainExtent.height,
+                    mResolution.budgetMs,
+                    mResolution.changes);
+            }
+
+            // per pass GPU times over the profiler's window, nested scopes indented
+            if (mProfiling) {
+                for (auto const& pass : mProfiler.timings()) {
+                    if (!pass.samples)
+                        continue;
+                    std::print(stderr, "[stats] gpu {:{}}{}: avg {:.3f} ms, p95 {:.3f} ms, p99 {:.3f} ms, max {:.3f} ms ({} frames)\n",
+                        "", 2 * pass.depth, pass.name,
+                        pass.averageMs, pass.p95Ms, pass.p99Ms, pass.maxMs, pass.samples);
+                }
+                if (mProfiler.dropped())
+                    std::print(stderr, "[stats] gpu profiler: {} scopes dropped\n", mProfiler.dropped());
+            }
+
+            // frame graph: passes and barriers recorded per frame, and what aliasing
+            // saves on the transient attachments
+            std::print(stderr, "[stats] render graph: {:.1f} passes ({:.1f} culled), {:.1f} barriers in {:.1f} batches/frame; transient attachments {:.1f} MiB in {} allocations ({:.1f} MiB saved by aliasing)\n",
+                float(mStats.graphPasses) / frames,
+                float(mStats.graphCulled) / frames,
+                float(mStats.graphBarriers) / frames,
+                float(mStats.graphBatches) / frames,
+                float(mTransients.allocatedBytes) / (1024.f * 1024.f),
+                mTransients.memory.size(),
+                float(mTransients.unaliasedBytes - mTransients.allocatedBytes) / (1024.f * 1024.f));
+
+            // fragment shader invocations per frame and per pixel of the main pass
+            // (the lighting cost the pre-pass is meant to cut), pre-pass ones apart
+            if (mStats.fragmentFrames) {
+                float const fragmentFrames = float(mStats.fragmentFrames);
+                float const pixels = float(mWindow.swapchainExtent.width) * float(mWindow.swapchainExtent.height);
+                std::print(stderr, "[stats] depth pre-pass {}: main pass {:.0f} fragment invocations/frame ({:.2f} per pixel), pre-pass {:.0f}\n",
+                    mState.depthPrepass ? "on" : "off",
+                    float(mStats.mainFragments) / fragmentFrames,
+                    float(mStats.mainFragments) / (fragmentFrames * pixels),
+                    float(mStats.prepassFragments) / fragmentFrames);
+            }
+
+            if (indirect && mStats.hizFrames) {
+                std::size_t const tested = mStats.hizTested / mStats.hizFrames;
+                std::size_t const occluded = mStats.hizOccluded / mStats.hizFrames;
+                std::print(stderr, "[stats] hi-z occlusion: {} of {} frustum visible instances culled ({:.1f}%)\n",
+                    occluded, tested,
+                    tested ? 100.f * float(occluded) / float(tested) : 0.f);
+            }
+
+            if (!indirect && mStats.swFrames) {
+                float const swFrames = float(mStats.swFrames);
+                std::print(stderr, "[stats] software occlusion: raster {:.3f} ms, test {:.3f} ms, {} instances occluded\n",
+                    mStats.rasterMs / swFrames,
+                    mStats.testMs / swFrames,
+                    mStats.swOccluded / mStats.swFrames);
+            }
+
+            if (!indirect) {
+                std::size_t const n = mModel.scenes.size();
+                std::size_t const mainVisible = mStats.mainVisible / mStats.frames;
+                std::size_t const shadowVisible = mStats.shadowVisible / mStats.frames;
+                std::string const main = mState.cachedDraws
+                    ? std::format("main {:.2f} of {} regions visible", float(mStats.regionsExecuted) / frames, cfg::kCachedDrawRegions)
+                    : std::format("main {} visible / {} culled", mainVisible, n - mainVisible);
+                std::print(stderr, "[stats] cpu culling {:.3f} ms/frame, {}, shadow {} casters/frame (all cascades)\n",
+                    mStats.cullMs / frames,
+                    main,
+                    shadowVisible);
+            }
+
+            mStats = {};
         }
 
         bool& mAppRunning;
@@ -617,26 +1980,100 @@ namespace engine {
         bool       mRecreateSwapchain = false;
         std::size_t mFrameIndex = 0;
 
+        lut::Timeline       mGraphicsTimeline;
+        lut::UploadManager  mUploads;
         lut::CommandPool    mCmdPool;
         lut::DescriptorPool mDescPool;
+        lut::DescriptorPool mBindlessPool; // update-after-bind, material sets only
 
         std::vector<VkCommandBuffer>  mCmdBuffers;
-        std::vector<lut::Fence>       mFrameDone;
+        std::vector<std::uint64_t>    mFrameValues; // mGraphicsTimeline, last submit per frame slot
         std::vector<lut::Semaphore>   mImageAvailable;
         std::vector<lut::Semaphore>   mRenderFinished;
 
+        // CPU path secondaries, [frame * cfg::kMaxRecordThreads + thread]
+        // (shadow: times cfg::kMaxShadowCascades, plus the cascade)
+        std::vector<lut::CommandPool> mRecordPools;
+        std::vector<VkCommandBuffer>  mShadowSecondaries, mMainSecondaries;
+
+        // cached CPU path draws, per frame slot; all regions are re-recorded when
+        // the cache went stale (bump mDrawCacheGeneration when pipelines, targets,
+        // instances or materials change), the camera only selects the executed ones
+        struct DrawCache {
+            std::vector<lut::CommandPool> pools;          // one per region
+            std::vector<VkCommandBuffer>  shadow, main;   // one per region (shadow: and cascade)
+            std::uint64_t                 generation = 0;
+            int                           renderMode = -1;
+            bool                          depthPrepass = false;
+            bool                          visibilityBuffer = false;
+            std::uint32_t                 cascadeCount = 0;
+        };
+        std::vector<DrawCache> mDrawCaches;
+        std::uint64_t          mDrawCacheGeneration = 1;
+
         lut::DescriptorSetLayout mSceneLayout, mObjectLayout, mPostLayout;
+        lut::DescriptorSetLayout mCullLayout;
         lut::PipelineLayout      mPipeLayout, mPostPipeLayout;
+        lut::PipelineLayout      mCullPipeLayout;
 
         lut::Pipeline mPipe, mAlphaPipe;
         lut::Pipeline mMipPipe, mDepthPipe, mDerivPipe;
         lut::Pipeline mOverdrawPipe, mOvershadingPipe;
         lut::Pipeline mPostProcPipe, mVisResolvePipe;
-        lut::Pipeline mShadowPipe;
+        lut::Pipeline mShadowPipe, mShadowOpaquePipe;
+        lut::Pipeline mCullPipe;
+        lut::Pipeline mIndirectPipe, mIndirectAlphaPipe, mIndirectShadowPipe, mIndirectShadowOpaquePipe;
+        lut::Pipeline mPointShadowPipe, mPointShadowOpaquePipe, mIndirectPointShadowPipe; // layered, mLayeredPointShadows only
+        lut::Pipeline mPointFaceShadowPipe, mPointFaceShadowOpaquePipe;                  // one pass per face
+        lut::Pipeline mAtlasShadowPipe, mAtlasShadowOpaquePipe;
+        lut::Pipeline mPrepassPipe, mPrepassAlphaPipe, mIndirectPrepassPipe, mIndirectPrepassAlphaPipe;
+        lut::Pipeline mEqualPipe, mEqualAlphaPipe, mIndirectEqualPipe, mIndirectEqualAlphaPipe;
+        lut::Pipeline mEqualOvershadingPipe;
+
+        // multiDrawIndirect, drawIndirectFirstInstance, drawIndirectCount: GPU-driven path (key G)
+        bool                     mIndirectSupported = false;
+
+        // shaderOutputLayer: point shadows in one layered pass, see PointShadowMode()
+        bool                     mLayeredPointShadows = false;
+
+        // visibility buffer, see VisBufferPass; nothing is created without geometryShader
+        bool                     mVisbufferSupported = false;
+        lut::DescriptorSetLayout mVisbufferLayout;
+        lut::PipelineLayout      mVisbufferPipeLayout;
+        lut::Pipeline            mVisbufferPipe, mVisbufferAlphaPipe, mIndirectVisbufferPipe, mIndirectVisbufferAlphaPipe;
+        lut::Pipeline            mVisbufferResolvePipe;
+        VkDescriptorSet          mVisbufferDescriptors = VK_NULL_HANDLE;
+
+        // compute post-processing, see ComputePostPass
+        bool                     mComputePostSupported = false;
+        lut::DescriptorSetLayout mComputePostLayout;
+        lut::PipelineLayout      mComputePostPipeLayout;
+        lut::Pipeline            mComputePostPipe;
+        VkDescriptorSet          mComputePostDescriptors = VK_NULL_HANDLE;
+
+        // Hi-Z occlusion culling
+        lut::DescriptorSetLayout     mReduceLayout;
+        lut::PipelineLayout          mReducePipeLayout;
+        lut::Pipeline                mReducePipe;
+        lut::Sampler                 mPyramidSampler;
+        DepthPyramid                 mDepthPyramid;
+        std::vector<VkDescriptorSet> mReduceDescriptors;
+        std::vector<lut::Buffer>     mCullStatsReadback;
+        std::vector<std::uint8_t>    mCullStatsPending;
+
+        // clustered lighting, see clustered_lights.hpp
+        lut::PipelineLayout                 mClusterPipeLayout;
+        lut::Pipeline                       mClusterPipe;
+        lut::Buffer                         mClusterCountBuffer, mClusterIndexBuffer;
+        std::vector<ClusterLight>           mClusterLights;
+        std::vector<glsl::ClusterLightData> mClusterData; // this frame, the first mState.clusterLights
+        float                               mClusterTime = 0.f;
 
         EngineModel                    mModel;
         std::vector<lut::Image>        mModelTextures;
         std::vector<lut::ImageView>    mModelTextureViews;
+        std::vector<VkImageLayout>     mModelTextureLayouts; // host copies may stay GENERAL, see host_image_copy_layout()
+        std::vector<lut::Image>        mStressTextures; // cfg::kStressTextureCount
 
         lut::Image     mDefaultGrayTex;
         lut::ImageView mDefaultGrayView;
@@ -645,28 +2082,139 @@ namespace engine {
         lut::Sampler mDefaultSampler, mDebugSampler;
         lut::Sampler mPostSampler, mShadowSampler;
 
-        // Mesh GPU buffers
-        std::vector<lut::Buffer> mMeshPositions;
-        std::vector<lut::Buffer> mMeshTexCoords;
-        std::vector<lut::Buffer> mMeshNormals;
-        std::vector<lut::Buffer> mMeshIndices;
+        // Mesh GPU buffers (merged, see UploadMeshes)
+        lut::Buffer                mVertexPositions;
+        lut::Buffer                mVertexTexCoords;
+        lut::Buffer                mVertexNormals;
+        lut::Buffer                mIndexBuffer;
+        std::vector<MeshDrawRange> mMeshRanges;
+
+
+        // GPU-driven path
+        lut::Buffer mInstanceBuffer, mMeshDataBuffer;
+        lut::Buffer mMaterialBuffer;
+        lut::Buffer mMainDrawBuffer, mShadowDrawBuffer, mDrawCountBuffer;
+        lut::Buffer mPointDrawBuffer;
+        lut::Buffer mLateDrawBuffer, mVisibilityBuffer;
+        std::vector<IndirectDrawBucket> mDrawBuckets;
+
+        // CPU culling
+        InstanceBounds            mInstanceBounds;
+        SceneBounds               mSceneBounds{};
+        std::vector<std::uint8_t> mMainVisible;
+        std::vector<std::uint8_t> mShadowVisible[cfg::kMaxShadowCascades];        // static casters
+        std::vector<std::uint8_t> mDynamicShadowVisible[cfg::kMaxShadowCascades]; // empty without dynamic casters
+        std::vector<SceneBounds>  mRegionBounds;     // of the cached draw regions
+        std::vector<std::uint8_t> mAllInstances;     // 1 per instance, cached main draws
+        std::vector<std::uint8_t> mStaticCasters;    // 1 per static instance, cached shadow draws
+        std::vector<std::uint8_t> mPointFaceMasks;   // cube faces per instance
+        std::vector<std::uint8_t> mPointCullScratch;
+        ShadowFitScratch          mShadowFitScratch;
+        Occluders                 mOccluders;
+        OcclusionBuffer           mOcclusionBuffer;
 
         // UBOs
-        lut::Buffer              mSceneUBO;
-        std::vector<lut::Buffer> mMosaicUBOs;
+        FrameRing                mFrameRing;
+        VkDeviceSize             mFrameScene = 0, mFrameSpots = 0, mFrameClusterLights = 0, mFrameMosaic = 0; // offsets in each region
 
         // Descriptor sets
         VkDescriptorSet                mSceneDescriptors = VK_NULL_HANDLE;
-        std::vector<VkDescriptorSet>   mMaterialDescriptors;
-        std::vector<VkDescriptorSet>   mDebugMaterialDescriptors;
-        std::vector<VkDescriptorSet>   mPostDescriptors;
-        std::vector<VkDescriptorSet>   mVisDescriptors;
+        VkDescriptorSet                mCullDescriptors = VK_NULL_HANDLE;
+        VkDescriptorSet                mMaterialDescriptors = VK_NULL_HANDLE;      // bindless, default sampler
+        VkDescriptorSet                mDebugMaterialDescriptors = VK_NULL_HANDLE; // bindless, no anisotropy
+        VkDescriptorSet                mPostDescriptors = VK_NULL_HANDLE;
+        VkDescriptorSet                mVisDescriptors = VK_NULL_HANDLE;
 
         // Render targets
         lut::ImageWithView mDepthBuffer;
-        lut::ImageWithView mOffscreenImage;
-        lut::ImageWithView mVisImage;
-        lut::ImageWithView mShadowMap;
+        TransientAttachments mTransients;
+        ShadowMap          mShadowMap;
+        ShadowMap          mStaticShadowMap; // only with dynamic casters
+        PointShadowMap     mPointShadowMap;
+        bool               mPointShadowReset = true; // not rendered yet
+        lut::ImageWithView mShadowAtlasImage;
+        bool               mShadowAtlasReset = true; // no tile rendered yet
+
+        // spot lights and their atlas tiles, see shadow_atlas.hpp
+        std::vector<SpotLight>                 mSpotLights;
+        std::vector<SpotLight>                 mSpotAnimated; // this frame
+        std::vector<SpotShadowSlot>            mSpotSlots;
+        std::vector<std::uint32_t>             mSpotTileSizes;
+        std::vector<std::vector<std::uint8_t>> mSpotVisible; // casters, culled when the tile is rendered
+        std::vector<glsl::SpotLightData>       mSpotData;
+        ShadowAtlas                            mShadowAtlas;
+        float                                  mSpotTime = 0.f;
+
+        // cascaded shadow maps: the matrices the cascades were last rendered with
+        ShadowCascades mCascades{};
+        std::uint64_t  mShadowFrame = 0;  // staggered updates, see is_cascade_due()
+        bool           mShadowReset = true; // render every cascade in the next frame
+
+        // static shadow cache, see ShadowPass; a cascade is refreshed when its key changes
+        struct ShadowCacheKey {
+            glm::mat4     viewProj{ 0.f };
+            std::uint32_t resolution = 0;
+            std::uint64_t geometry = 0;
+
+            bool operator==(ShadowCacheKey const&) const = default;
+        } mShadowCacheKeys[cfg::kMaxShadowCascades];
+        bool          mHasDynamicCasters = false;
+        std::uint64_t mStaticGeometryGeneration = 0; // bumped by UploadMeshes()
+
+        // dynamic resolution, see dynamic_resolution.hpp; mRenderExtent is the scene's
+        // part of the swapchain sized attachments
+        ResolutionController      mResolution;
+        bool                      mDynamicResolution = false;
+        VkExtent2D                mRenderExtent{};
+
+        // per pass GPU times, see lut::GpuProfiler; nothing without timestamps.
+        // mFrameScale: the resolution scale of the pending submission per frame
+        // slot, 0 if none
+        lut::GpuProfiler          mProfiler;
+        bool                      mProfiling = false;
+        std::vector<float>        mFrameScale;
+
+        // depth pre-pass and main pass fragment shader invocations, see DepthPrepass
+        lut::QueryPool            mPassStatistics;
+        std::vector<std::uint8_t> mStatisticsPending;
+
+        struct FrameStats {
+            float       elapsed = 0.f;
+            float       recordMs = 0.f;
+            float       cpuFrameMs = 0.f;
+            std::size_t regionsRecorded = 0; // summed over frames
+            std::size_t regionsExecuted = 0; // main pass, summed over frames
+            std::size_t shadowRefreshes = 0; // frames that rendered the static casters
+            std::size_t cascadeUpdates[cfg::kMaxShadowCascades] = {};
+            std::size_t cascadeRefreshes[cfg::kMaxShadowCascades] = {};
+            float       cascadeFitScale[cfg::kMaxShadowCascades] = {}; // summed over updates
+            std::size_t pointCasters = 0;  // summed over frames (CPU path)
+            std::size_t pointFaces = 0;
+            std::size_t atlasTexels = 0;  // summed over frames
+            std::size_t atlasTiles = 0;
+            std::size_t atlasUnshadowed = 0;
+            std::uint64_t prepassFragments = 0; // summed over frames with readback
+            std::uint64_t mainFragments = 0;
+            std::size_t   fragmentFrames = 0;
+            std::size_t clusterLights = 0;  // summed over frames
+            float       renderScale = 0.f; // summed over frames with readback
+            std::size_t scaleFrames = 0;
+            std::size_t graphPasses = 0;   // summed over frames
+            std::size_t graphCulled = 0;
+            std::size_t graphBarriers = 0;
+            std::size_t graphBatches = 0;
+            float       cullMs = 0.f;
+            std::size_t mainVisible = 0;   // summed over frames
+            std::size_t shadowVisible = 0;
+            std::size_t hizTested = 0;     // summed over frames with readback
+            std::size_t hizOccluded = 0;
+            std::size_t hizFrames = 0;
+            float       rasterMs = 0.f;    // software occlusion
+            float       testMs = 0.f;
+            std::size_t swOccluded = 0;
+            std::size_t swFrames = 0;
+            std::size_t frames = 0;
+        } mStats;
     };
 
 } // namespace engine
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <cstdio>
+#include <algorithm>
 
 namespace lut = labut2;
 
@@ -48,7 +49,138 @@ void glfw_callback_key_press( GLFWwindow* aWindow, int aKey, int, int aAction, i
 		if( GLFW_KEY_6 == aKey ) state->renderMode = 4; // Overdraw
 		if( GLFW_KEY_7 == aKey ) state->renderMode = 5; // Overshading
 		if( GLFW_KEY_8 == aKey ) state->renderMode = 6; // Shadow Debug (Task p2_1.5)
+		if( GLFW_KEY_9 == aKey ) state->renderMode = 7; // Lights per cluster heatmap
 		
+		if( GLFW_KEY_G == aKey )
+		{
+			state->gpuDriven = !state->gpuDriven;
+			std::printf("GPU-driven rendering: %s\n", state->gpuDriven ? "on" : "off");
+		}
+
+		if( GLFW_KEY_H == aKey )
+		{
+			state->occlusionCulling = !state->occlusionCulling;
+			std::printf("Hi-Z occlusion culling: %s\n", state->occlusionCulling ? "on" : "off");
+		}
+
+		if( GLFW_KEY_O == aKey )
+		{
+			state->softwareOcclusion = !state->softwareOcclusion;
+			std::printf("Software occlusion culling: %s\n", state->softwareOcclusion ? "on" : "off");
+		}
+
+		if( GLFW_KEY_K == aKey )
+			state->dumpOcclusionBuffer = true;
+
+		if( GLFW_KEY_C == aKey )
+		{
+			state->cachedDraws = !state->cachedDraws;
+			std::printf("Cached draw command buffers: %s\n", state->cachedDraws ? "on" : "off");
+		}
+
+		if( GLFW_KEY_L == aKey )
+		{
+			state->shadowCache = !state->shadowCache;
+			std::printf("Static shadow cache: %s\n", state->shadowCache ? "on" : "off");
+		}
+
+		if( GLFW_KEY_V == aKey )
+		{
+			state->shadowCascades = state->shadowCascades % cfg::kMaxShadowCascades + 1;
+			std::printf("Shadow cascades: %u\n", state->shadowCascades);
+		}
+
+		if( GLFW_KEY_B == aKey )
+		{
+			// 512 -> 1024 -> 2048 -> 4096 -> 512
+			state->shadowResolution = state->shadowResolution >= 4096 ? 512 : state->shadowResolution * 2;
+			std::printf("Shadow map resolution: %u\n", state->shadowResolution);
+		}
+
+		if( GLFW_KEY_F == aKey )
+		{
+			state->shadowFit = !state->shadowFit;
+			std::printf("Receiver-aware shadow fitting: %s\n", state->shadowFit ? "on" : "off");
+		}
+
+		if( GLFW_KEY_U == aKey )
+		{
+			static char const* const kModes[] = { "off (unshadowed)", "one layered pass", "one pass per face" };
+			state->pointShadows = (state->pointShadows + 1) % 3;
+			std::printf("Point light shadows: %s\n", kModes[state->pointShadows]);
+		}
+
+		if( GLFW_KEY_J == aKey )
+		{
+			state->spotLights = !state->spotLights;
+			std::printf("Spot lights (shadow atlas): %s\n", state->spotLights ? "on" : "off");
+		}
+
+		if( GLFW_KEY_N == aKey )
+		{
+			// 0 -> 64 -> 256 -> 1024 -> 4096 -> 0 (cfg::kMaxClusteredLights)
+			state->clusterLights = 0 == state->clusterLights ? 64 : state->clusterLights * 4;
+			if( state->clusterLights > 4096 )
+				state->clusterLights = 0;
+			std::printf("Clustered point lights: %u\n", state->clusterLights);
+		}
+
+		if( GLFW_KEY_Z == aKey )
+		{
+			state->depthPrepass = !state->depthPrepass;
+			std::printf("Depth pre-pass (main pass depth EQUAL): %s\n", state->depthPrepass ? "on" : "off");
+		}
+
+		if( GLFW_KEY_X == aKey )
+		{
+			state->visibilityBuffer = !state->visibilityBuffer;
+			std::printf("Visibility buffer (deferred resolve of the main pass): %s\n", state->visibilityBuffer ? "on" : "off");
+		}
+
+		if( GLFW_KEY_T == aKey )
+		{
+			// 0 -> 1 -> 2 -> 4 -> 8 -> 0 (cfg::kMaxRecordThreads)
+			state->recordThreads = 0 == state->recordThreads ? 1 : state->recordThreads * 2;
+			if( state->recordThreads > 8 )
+				state->recordThreads = 0;
+
+			if( 0 == state->recordThreads )
+				std::printf("Draw recording: inline\n");
+			else
+				std::printf("Draw recording: %u secondary command buffer thread(s)\n", state->recordThreads);
+		}
+
+		if( GLFW_KEY_R == aKey )
+		{
+			state->computePost = !state->computePost;
+			std::printf("Compute post-processing: %s\n", state->computePost ? "on" : "off (raster)");
+		}
+
+		if( GLFW_KEY_Y == aKey )
+		{
+			static char const* const kFilters[] = { "none", "FXAA", "sharpen" };
+			state->postFilter = (state->postFilter + 1) % 3;
+			std::printf("Post filter: %s\n", kFilters[state->postFilter]);
+		}
+
+		if( GLFW_KEY_MINUS == aKey || GLFW_KEY_EQUAL == aKey )
+		{
+			state->exposure = std::clamp( GLFW_KEY_EQUAL == aKey ? state->exposure * 2.f : state->exposure * 0.5f, 1.f / 64.f, 64.f );
+			std::printf("Exposure: %g\n", state->exposure);
+		}
+
+		if( GLFW_KEY_I == aKey )
+		{
+			state->dynamicResolution = !state->dynamicResolution;
+			std::printf("Dynamic resolution: %s\n", state->dynamicResolution ? "on" : "off");
+		}
+
+		if( GLFW_KEY_M == aKey )
+			state->dumpResolutionHistory = true;
+
+		if( GLFW_KEY_0 == aKey )
+			state->dumpGpuProfile = true;
+
 		if( GLFW_KEY_P == aKey )
 		{												// Print camera position
 			auto const pos = state->camera2world[3];
@@ -153,24 +285,15 @@ void update_scene_uniforms( glsl::SceneUniform& aSceneUniforms, std::uint32_t aF
 	
 	aSceneUniforms.cameraPos = glm::vec4( aState.camera2world[3][0], aState.camera2world[3][1], aState.camera2world[3][2], 1.0f );
 	
-	// light source position and color
-	// aSceneUniforms.lightPos = glm::vec4( -0.2972f, 7.3100f, -11.9532f, 1.0f ); // og pos
-	aSceneUniforms.lightPos = glm::vec4( 1.4418f, 6.4484f, 0.8148f, 1.0f ); // new pos for shadows
+	// directional light (w = 0), pointing towards the light; casts the cascaded shadows
+	// aSceneUniforms.lightPos = glm::vec4( 1.4418f, 6.4484f, 0.8148f, 1.0f ); // old point light
+	aSceneUniforms.lightPos = glm::vec4( glm::normalize( glm::vec3( 0.3f, 1.f, 0.45f ) ), 0.f );
 	aSceneUniforms.lightColor = glm::vec4( 1.0f, 1.0f, 1.0f, 1.0f );
 
-	aSceneUniforms.renderMode = std::uint32_t(aState.renderMode);
-
-	// p2_1.5 shadow map matrix
-	// tuned for the statues: statue level, slightly offset, looking at center; i think
-	glm::vec3 lightPos = glm::vec3(aSceneUniforms.lightPos);
-	// glm::vec3 lightPos = glm::vec3(2.f, 25.f, 0.f);
-	// glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3(0.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
-	glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3( 0.2157f, 0.9278f, -47.9831f ), glm::vec3(0.f, 1.f, 0.f));
+	// the old point light, now a second light with a cube shadow map; the face
+	// matrices are filled by RenderSystem (compute_point_shadow_faces())
+	aSceneUniforms.pointLightPos = glm::vec4( 1.4418f, 6.4484f, 0.8148f, cfg::kPointLightRange );
+	aSceneUniforms.pointLightColor = glm::vec4( 1.0f, 0.8f, 0.6f, aState.pointShadows ? 1.f : 0.f );
 
-	
-	// wide frustum
-	glm::mat4 lightProj = glm::perspectiveRH_ZO( glm::radians(90.0f), 1.0f, 1.0f, 200.0f); 
-	lightProj[1][1] *= -1.f; // flip Y for Vulkan
-	
-	aSceneUniforms.lightVP = lightProj * lightView;
+	aSceneUniforms.renderMode = std::uint32_t(aState.renderMode);
 }
@@ -21,6 +21,14 @@ namespace cfg
 	constexpr float kCameraFastMult = 5.f;
 	constexpr float kCameraSlowMult = 0.05f;
 	constexpr float kCameraMouseSensitivity = 0.01f;
+
+	// cascaded shadow maps, see shadows.hpp; sizes the UScene arrays of the shaders
+	constexpr std::uint32_t kMaxShadowCascades = 4;
+
+	// point light cube shadow map, see shadows.hpp; the near plane is hardcoded
+	// in the shaders comparing against it (POINT_SHADOW_NEAR)
+	constexpr float kPointLightRange = 20.f;
+	constexpr float kPointShadowNear = 0.05f;
 }
 
 namespace glsl
@@ -32,11 +40,32 @@ namespace glsl
 		glm::mat4 projection;
 		glm::mat4 projCam;
 		glm::vec4 cameraPos;
-		glm::vec4 lightPos;
+		glm::vec4 lightPos;   // w = 0: direction towards the (directional) light
 		glm::vec4 lightColor;
 		std::uint32_t renderMode;
 		std::uint32_t _padding[3];
-		glm::mat4 lightVP; // p2_1.5
+
+		// cascaded shadow maps (p2_1.5), filled by RenderSystem, see shadows.hpp
+		glm::mat4 cascadeVP[cfg::kMaxShadowCascades];
+		glm::vec4 cascadeSplits; // far view depth of each cascade
+		std::uint32_t cascadeCount;
+		std::uint32_t _padding2[3];
+
+		// point light with an omnidirectional (cube) shadow map, see shadows.hpp
+		glm::vec4 pointLightPos;   // w: range, also the far plane of the cube faces
+		glm::vec4 pointLightColor; // w: 1 if the cube shadow map is rendered
+		glm::mat4 pointFaceVP[6];  // +X, -X, +Y, -Y, +Z, -Z (cube map layer order)
+
+		// spot lights (glsl::SpotLightData buffer), shadowed from an atlas, see shadow_atlas.hpp
+		std::uint32_t spotLightCount;
+		std::uint32_t _padding3[3];
+
+		// clustered point lights (glsl::ClusterLightData buffer), see clustered_lights.hpp
+		glm::uvec4 clusterGrid;   // xyz: clusters per axis, w: light count
+		glm::vec4  clusterParams; // see compute_cluster_params()
+
+		// the part of the attachments the scene covers, see dynamic_resolution.hpp
+		glm::vec4 renderSize; // xy: pixels, zw: their inverse
 	};
 }
 
@@ -71,6 +100,28 @@ struct UserState
 	int renderMode = 0; // 0=Default, 1=Mip, 2=Depth, 3=Deriv
 	
 	bool mosaicEnabled = false; // key 5 toggle
+
+	bool gpuDriven = false; // key G toggle: compute culling + indirect draws instead of CPU recorded draws
+	bool occlusionCulling = true; // key H toggle: Hi-Z occlusion culling (GPU-driven path only)
+	bool softwareOcclusion = false; // key O toggle: CPU rasterized occlusion culling (CPU path only)
+	bool dumpOcclusionBuffer = false; // key K: write the software occlusion buffer to a PNG
+	bool cachedDraws = true; // key C toggle: keep CPU path secondaries across frames, culled per region instead of per instance
+	bool shadowCache = true; // key L toggle: keep the static caster shadow depth until the light or the scene changes
+	std::uint32_t shadowCascades = 4;       // key V cycles 1 .. cfg::kMaxShadowCascades
+	std::uint32_t shadowResolution = 2048;  // key B cycles 512 .. 4096, per cascade
+	bool shadowFit = true; // key F toggle: fit the cascades to the visible receivers and their casters (see shadows.hpp)
+	std::uint32_t pointShadows = 1; // key U cycles 0 (unshadowed) / 1 (one layered pass) / 2 (one pass per cube face, for comparison; used for 1 without shaderOutputLayer)
+	bool spotLights = true; // key J toggle: spot lights with the shadow atlas
+	std::uint32_t clusterLights = 256; // key N cycles 0 / 64 / 256 / 1024 / cfg::kMaxClusteredLights: clustered point lights
+	bool depthPrepass = false; // key Z toggle: depth only pre-pass, main pass shades with depth EQUAL (render modes of keys 1, 7, 8, 9)
+	bool visibilityBuffer = false; // key X toggle: main pass writes instance/triangle ids, one full-screen resolve shades them (render modes of keys 1, 8, 9)
+	std::uint32_t recordThreads = 4; // key T cycles 0 (inline) / 1 / 2 / 4 / 8: CPU path secondary command buffer recording (cached draws off)
+	bool computePost = true; // key R toggle: fused compute post-processing (post.comp + blit) instead of the full-screen raster pass (render modes of keys 1-4, 8, 9)
+	std::uint32_t postFilter = 0; // key Y cycles PostFilter none / fxaa / sharpen (compute post only)
+	float exposure = 1.f; // keys - and = halve/double it (compute post only)
+	bool dynamicResolution = false; // key I toggle: scale the scene resolution to the GPU frame time budget (compute post only, not in render modes 4, 5)
+	bool dumpResolutionHistory = false; // key M: write the dynamic resolution history to a CSV file
+	bool dumpGpuProfile = false; // key 0: write the per pass GPU timestamps (lut::GpuProfiler) to a CSV file
 };
 
 // GLFW callbacks
@@ -0,0 +1,68 @@
+#include "clustered_lights.hpp"
+
+#include <cmath>
+#include <random>
+#include <algorithm>
+
+std::vector<ClusterLight> build_cluster_lights( SceneBounds const& aScene, std::uint32_t aCount )
+{
+	std::vector<ClusterLight> ret;
+	ret.reserve( aCount );
+
+	std::minstd_rand rng( 1234 );
+	std::uniform_real_distribution<float> unit( 0.f, 1.f );
+
+	glm::vec3 const extent = aScene.max - aScene.min;
+
+	// small lights, so that a cluster sees a bounded share of them however many there are
+	float const range = std::clamp( 0.06f * std::max( extent.x, extent.z ), 1.f, 4.f );
+
+	for( std::uint32_t i = 0; i < aCount; ++i )
+	{
+		ClusterLight light{};
+		light.position = aScene.min + extent * glm::vec3( unit( rng ), 0.05f + 0.45f * unit( rng ), unit( rng ) );
+
+		// saturated hues, scaled like the spot lights
+		float const hue = unit( rng ) * 6.f;
+		glm::vec3 const rgb = glm::clamp( glm::vec3(
+			std::abs( hue - 3.f ) - 1.f,
+			2.f - std::abs( hue - 2.f ),
+			2.f - std::abs( hue - 4.f )
+		), 0.f, 1.f );
+		light.color = rgb * 3.f;
+
+		light.range = range * (0.75f + 0.5f * unit( rng ));
+		light.orbitRadius = 0.5f * light.range * unit( rng );
+		light.orbitSpeed = 0.3f + 0.9f * unit( rng );
+		light.phase = 6.2831853f * unit( rng );
+
+		ret.emplace_back( light );
+	}
+
+	return ret;
+}
+
+glsl::ClusterLightData animate_cluster_light( ClusterLight const& aLight, float aTime )
+{
+	float const a = aLight.phase + aTime * aLight.orbitSpeed;
+	glm::vec3 const offset = aLight.orbitRadius * glm::vec3( std::cos( a ), 0.25f * std::sin( 2.f * a ), std::sin( a ) );
+
+	return glsl::ClusterLightData{
+		glm::vec4( aLight.position + offset, aLight.range ),
+		glm::vec4( aLight.color, 0.f )
+	};
+}
+
+glm::vec4 compute_cluster_params( std::uint32_t aWidth, std::uint32_t aHeight, float aNear, float aFar )
+{
+	// slice = log(depth / near) / log(far / near) * slices
+	float const scale = float(cfg::kClusterSlices) / std::log( aFar / aNear );
+	float const bias = -std::log( aNear ) * scale;
+
+	return glm::vec4(
+		float(cfg::kClusterTilesX) / float(aWidth),
+		float(cfg::kClusterTilesY) / float(aHeight),
+		scale,
+		bias
+	);
+}
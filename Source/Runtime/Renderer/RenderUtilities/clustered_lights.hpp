@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "culling.hpp"
+
+// Clustered forward lighting for many unshadowed point lights
+// the view frustum is split into a froxel grid: screen tiles times depth slices
+// that are exponentially spaced between the camera near and far planes, so the
+// clusters are roughly cube shaped at every depth. light_cluster.comp bins the
+// lights into the clusters every frame (sphere against the cluster's view space
+// bounding box); the lighting then loops only over the lights of the fragment's
+// cluster, at most cfg::kMaxLightsPerCluster of them, whatever the light count.
+
+namespace cfg
+{
+	constexpr std::uint32_t kClusterTilesX = 16;
+	constexpr std::uint32_t kClusterTilesY = 9;
+	constexpr std::uint32_t kClusterSlices = 24;
+	constexpr std::uint32_t kClusterCount = kClusterTilesX * kClusterTilesY * kClusterSlices;
+
+	// light index slots per cluster (MAX_CLUSTER_LIGHTS in the shaders); lights
+	// beyond it are dropped from that cluster, the heatmap shows where
+	constexpr std::uint32_t kMaxLightsPerCluster = 128;
+
+	// sizes the light buffer; key N cycles the count up to it
+	constexpr std::uint32_t kMaxClusteredLights = 4096;
+
+	// local_size_x of light_cluster.comp: clusters per workgroup, and lights
+	// staged in shared memory per batch
+	constexpr std::uint32_t kClusterGroupSize = 128;
+}
+
+namespace glsl
+{
+	// must match ClusterLight in default.frag, alpha.frag and light_cluster.comp
+	struct ClusterLightData
+	{
+		glm::vec4 position; // world space, w: range
+		glm::vec4 color;    // radiance scale included
+	};
+}
+
+struct ClusterLight
+{
+	glm::vec3 position;
+	glm::vec3 color;
+	float     range;
+
+	// every light drifts on a small ellipse around position
+	float orbitRadius;
+	float orbitSpeed; // radians per second
+	float phase;
+};
+
+// aCount lights scattered through the lower part of the scene bounds
+// (deterministic, the same lights every run)
+std::vector<ClusterLight> build_cluster_lights( SceneBounds const&, std::uint32_t aCount );
+
+// light state at aTime (seconds)
+glsl::ClusterLightData animate_cluster_light( ClusterLight const&, float aTime );
+
+// SceneUniform::clusterParams for a framebuffer: xy clusters per pixel, z/w
+// scale and bias that map log(view depth) to the depth slice
+glm::vec4 compute_cluster_params( std::uint32_t aWidth, std::uint32_t aHeight, float aNear, float aFar );
@@ -0,0 +1,224 @@
+#include "culling.hpp"
+
+#include <bit>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <thread>
+#include <algorithm>
+
+// MSVC implies FMA with /arch:AVX2 but does not define __FMA__
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#	define CULL_AVX2_ 1
+#	include <immintrin.h>
+#endif
+
+namespace
+{
+	constexpr std::size_t kLanes = 8;
+
+	// culls [aBegin, aEnd), aBegin is a multiple of kLanes
+	std::uint32_t cull_range( Frustum const& aFrustum, InstanceBounds const& aBounds, std::uint8_t* aVisible, std::size_t aBegin, std::size_t aEnd )
+	{
+		std::uint32_t visible = 0;
+		std::size_t i = aBegin;
+
+#		if defined(CULL_AVX2_)
+		__m256 const zero = _mm256_setzero_ps();
+		__m256 const absMask = _mm256_castsi256_ps( _mm256_set1_epi32( 0x7fffffff ) );
+
+		for( ; i + kLanes <= aEnd; i += kLanes )
+		{
+			__m256 const cx = _mm256_loadu_ps( aBounds.cx.data() + i );
+			__m256 const cy = _mm256_loadu_ps( aBounds.cy.data() + i );
+			__m256 const cz = _mm256_loadu_ps( aBounds.cz.data() + i );
+			__m256 const ex = _mm256_loadu_ps( aBounds.ex.data() + i );
+			__m256 const ey = _mm256_loadu_ps( aBounds.ey.data() + i );
+			__m256 const ez = _mm256_loadu_ps( aBounds.ez.data() + i );
+
+			__m256 outside = zero;
+			for( auto const& p : aFrustum.planes )
+			{
+				__m256 const nx = _mm256_set1_ps( p.x );
+				__m256 const ny = _mm256_set1_ps( p.y );
+				__m256 const nz = _mm256_set1_ps( p.z );
+
+				// signed distance of the center plus the projected radius of the box
+				__m256 dist = _mm256_set1_ps( p.w );
+				dist = _mm256_fmadd_ps( nx, cx, dist );
+				dist = _mm256_fmadd_ps( ny, cy, dist );
+				dist = _mm256_fmadd_ps( nz, cz, dist );
+
+				__m256 radius = _mm256_mul_ps( _mm256_and_ps( nx, absMask ), ex );
+				radius = _mm256_fmadd_ps( _mm256_and_ps( ny, absMask ), ey, radius );
+				radius = _mm256_fmadd_ps( _mm256_and_ps( nz, absMask ), ez, radius );
+
+				outside = _mm256_or_ps( outside, _mm256_cmp_ps( _mm256_add_ps( dist, radius ), zero, _CMP_LT_OQ ) );
+			}
+
+			int const culled = _mm256_movemask_ps( outside );
+			for( std::size_t k = 0; k < kLanes; ++k )
+				aVisible[i + k] = std::uint8_t( ((culled >> k) & 1) ^ 1 );
+
+			visible += kLanes - std::uint32_t(std::popcount( unsigned(culled) ));
+		}
+#		endif
+
+		// scalar loop; tail of the AVX2 path
+		for( ; i < aEnd; ++i )
+		{
+			bool inside = true;
+			for( auto const& p : aFrustum.planes )
+			{
+				float const dist = p.x * aBounds.cx[i] + p.y * aBounds.cy[i] + p.z * aBounds.cz[i] + p.w;
+				float const radius = std::abs( p.x ) * aBounds.ex[i] + std::abs( p.y ) * aBounds.ey[i] + std::abs( p.z ) * aBounds.ez[i];
+				if( dist + radius < 0.f )
+				{
+					inside = false;
+					break;
+				}
+			}
+
+			aVisible[i] = inside ? 1 : 0;
+			visible += inside ? 1 : 0;
+		}
+
+		return visible;
+	}
+}
+
+InstanceBounds compute_instance_bounds( EngineModel const& aModel )
+{
+	InstanceBounds ret;
+	ret.count = aModel.scenes.size();
+
+	std::size_t const padded = (ret.count + kLanes - 1) / kLanes * kLanes;
+	for( auto* v : { &ret.cx, &ret.cy, &ret.cz, &ret.ex, &ret.ey, &ret.ez } )
+		v->assign( padded, 0.f );
+
+	for( std::size_t i = 0; i < ret.count; ++i )
+	{
+		auto const& inst = aModel.scenes[i];
+		auto const& mesh = aModel.meshes[inst.meshIndex];
+
+		glm::vec3 const c = 0.5f * (mesh.boundsMin + mesh.boundsMax);
+		glm::vec3 const e = 0.5f * (mesh.boundsMax - mesh.boundsMin);
+
+		// transform the box (Arvo): the new extent is |M| * e
+		glm::vec3 const wc = glm::vec3( inst.transform * glm::vec4( c, 1.f ) );
+		glm::mat3 const m = glm::mat3( inst.transform );
+		glm::vec3 const we = glm::abs( m[0] ) * e.x + glm::abs( m[1] ) * e.y + glm::abs( m[2] ) * e.z;
+
+		ret.cx[i] = wc.x; ret.cy[i] = wc.y; ret.cz[i] = wc.z;
+		ret.ex[i] = we.x; ret.ey[i] = we.y; ret.ez[i] = we.z;
+	}
+
+	return ret;
+}
+
+SceneBounds compute_scene_bounds( InstanceBounds const& aBounds )
+{
+	SceneBounds ret{ glm::vec3( std::numeric_limits<float>::max() ), glm::vec3( -std::numeric_limits<float>::max() ) };
+
+	for( std::size_t i = 0; i < aBounds.count; ++i )
+	{
+		glm::vec3 const c( aBounds.cx[i], aBounds.cy[i], aBounds.cz[i] );
+		glm::vec3 const e( aBounds.ex[i], aBounds.ey[i], aBounds.ez[i] );
+		ret.min = glm::min( ret.min, c - e );
+		ret.max = glm::max( ret.max, c + e );
+	}
+
+	return ret;
+}
+
+std::vector<SceneBounds> compute_range_bounds( InstanceBounds const& aBounds, std::size_t aRanges )
+{
+	std::vector<SceneBounds> ret( aRanges, SceneBounds{ glm::vec3( std::numeric_limits<float>::max() ), glm::vec3( -std::numeric_limits<float>::max() ) } );
+
+	for( std::size_t r = 0; r < aRanges; ++r )
+	{
+		std::size_t const begin = r * aBounds.count / aRanges;
+		std::size_t const end = (r + 1) * aBounds.count / aRanges;
+		for( std::size_t i = begin; i < end; ++i )
+		{
+			glm::vec3 const c( aBounds.cx[i], aBounds.cy[i], aBounds.cz[i] );
+			glm::vec3 const e( aBounds.ex[i], aBounds.ey[i], aBounds.ez[i] );
+			ret[r].min = glm::min( ret[r].min, c - e );
+			ret[r].max = glm::max( ret[r].max, c + e );
+		}
+	}
+
+	return ret;
+}
+
+Frustum extract_frustum( glm::mat4 const& aViewProj )
+{
+	// glm is column major, row r is (m[0][r], m[1][r], m[2][r], m[3][r])
+	auto const row = [&] (int r) {
+		return glm::vec4( aViewProj[0][r], aViewProj[1][r], aViewProj[2][r], aViewProj[3][r] );
+	};
+
+	glm::vec4 const r0 = row( 0 ), r1 = row( 1 ), r2 = row( 2 ), r3 = row( 3 );
+
+	Frustum ret;
+	ret.planes[0] = r3 + r0; // left
+	ret.planes[1] = r3 - r0; // right
+	ret.planes[2] = r3 + r1; // bottom
+	ret.planes[3] = r3 - r1; // top
+	ret.planes[4] = r2;      // near (z >= 0)
+	ret.planes[5] = r3 - r2; // far
+	return ret;
+}
+
+bool box_visible( Frustum const& aFrustum, SceneBounds const& aBox )
+{
+	if( glm::any( glm::greaterThan( aBox.min, aBox.max ) ) )
+		return false;
+
+	// same test as cull_range()
+	glm::vec3 const c = 0.5f * (aBox.min + aBox.max);
+	glm::vec3 const e = 0.5f * (aBox.max - aBox.min);
+	for( auto const& p : aFrustum.planes )
+	{
+		float const dist = p.x * c.x + p.y * c.y + p.z * c.z + p.w;
+		float const radius = std::abs( p.x ) * e.x + std::abs( p.y ) * e.y + std::abs( p.z ) * e.z;
+		if( dist + radius < 0.f )
+			return false;
+	}
+
+	return true;
+}
+
+CullStats cull_instances( Frustum const& aFrustum, InstanceBounds const& aBounds, std::vector<std::uint8_t>& aVisible )
+{
+	aVisible.resize( aBounds.count );
+
+	std::uint32_t visible = 0;
+
+	if( aBounds.count < cfg::kCullParallelThreshold )
+	{
+		visible = cull_range( aFrustum, aBounds, aVisible.data(), 0, aBounds.count );
+	}
+	else
+	{
+		// chunks are multiples of the SIMD width so no two workers share a batch
+		std::size_t const workers = std::max( 1u, std::thread::hardware_concurrency() );
+		std::size_t chunk = (aBounds.count + workers - 1) / workers;
+		chunk = (chunk + kLanes - 1) / kLanes * kLanes;
+
+		std::vector<std::future<std::uint32_t>> jobs;
+		for( std::size_t begin = chunk; begin < aBounds.count; begin += chunk )
+		{
+			std::size_t const end = std::min( begin + chunk, aBounds.count );
+			jobs.emplace_back( std::async( std::launch::async, cull_range,
+				std::cref( aFrustum ), std::cref( aBounds ), aVisible.data(), begin, end ) );
+		}
+
+		// first chunk on this thread
+		visible = cull_range( aFrustum, aBounds, aVisible.data(), 0, std::min( chunk, aBounds.count ) );
+		for( auto& job : jobs )
+			visible += job.get();
+	}
+
+	return CullStats{ visible, std::uint32_t(aBounds.count) - visible };
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "engine_model.hpp"
+
+// CPU frustum culling
+// world space AABBs of all instances are kept in SoA form (center + half extent)
+// so the kernel can test 8 boxes against a plane per iteration (AVX2).
+// Builds without AVX2 (e.g. MSVC without /arch:AVX2) use the scalar loop.
+
+namespace cfg
+{
+	// below this instance count culling runs on the calling thread
+	constexpr std::size_t kCullParallelThreshold = 4096;
+}
+
+struct InstanceBounds
+{
+	// padded to a multiple of 8; the padding is never reported visible
+	std::vector<float> cx, cy, cz;
+	std::vector<float> ex, ey, ez;
+	std::size_t count = 0;
+};
+
+// planes are (n, d) with n.p + d >= 0 inside, not normalized
+struct Frustum
+{
+	glm::vec4 planes[6];
+};
+
+struct SceneBounds
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+struct CullStats
+{
+	std::uint32_t visible = 0;
+	std::uint32_t culled = 0;
+};
+
+// world bounds from EngineMesh::boundsMin/boundsMax and EngineInstance::transform
+InstanceBounds compute_instance_bounds( EngineModel const& );
+
+// union of all instance boxes
+SceneBounds compute_scene_bounds( InstanceBounds const& );
+
+// union of the boxes of each of aRanges instance ranges
+// [r * count / aRanges, (r + 1) * count / aRanges), the partitions of
+// record_secondary_draws(); an empty range gets min > max
+std::vector<SceneBounds> compute_range_bounds( InstanceBounds const&, std::size_t aRanges );
+
+// Gribb-Hartmann extraction, expects a [0,1] clip depth range
+Frustum extract_frustum( glm::mat4 const& aViewProj );
+
+// false if the box is outside a plane of the frustum, or empty
+bool box_visible( Frustum const&, SceneBounds const& );
+
+// writes 1 (visible) or 0 (culled) per instance into aVisible, resized to aBounds.count
+CullStats cull_instances(
+	Frustum const&,
+	InstanceBounds const&,
+	std::vector<std::uint8_t>& aVisible
+);
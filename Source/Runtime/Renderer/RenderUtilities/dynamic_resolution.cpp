@@ -0,0 +1,120 @@
+#include "dynamic_resolution.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+
+namespace
+{
+	float quantize_scale( ResolutionController const& aController, float aScale )
+	{
+		float const steps = std::floor( aScale / cfg::kDynamicResolutionStep + 1e-3f );
+		return std::clamp( steps * cfg::kDynamicResolutionStep, aController.minScale, 1.f );
+	}
+}
+
+float update_resolution_scale( ResolutionController& aController, float aGpuMs, float aScale )
+{
+	auto& c = aController;
+
+	// the frame may predate the last change; its time is brought to the current
+	// scale so the filter does not step twice for the same overshoot
+	float const ratio = (c.scale * c.scale) / (aScale * aScale);
+	float const normalized = aGpuMs * ratio;
+
+	c.filteredMs = c.filteredMs > 0.f
+		? c.filteredMs + cfg::kDynamicResolutionSmoothing * (normalized - c.filteredMs)
+		: normalized;
+
+	ResolutionSample const sample{ aGpuMs, aScale, c.filteredMs };
+	if( c.history.size() < cfg::kDynamicResolutionHistory )
+		c.history.emplace_back( sample );
+	else
+	{
+		c.history[c.head] = sample;
+		c.head = (c.head + 1) % c.history.size();
+	}
+
+	if( c.settle > 0 )
+	{
+		--c.settle;
+		return c.scale;
+	}
+
+	float next = c.scale;
+	if( c.filteredMs > c.budgetMs )
+	{
+		// straight to the predicted scale, at least one step down
+		c.underBudget = 0;
+		float const target = c.scale * std::sqrt( c.budgetMs / c.filteredMs );
+		next = std::min( quantize_scale( c, target ), c.scale - cfg::kDynamicResolutionStep );
+	}
+	else if( c.filteredMs < cfg::kDynamicResolutionHeadroom * c.budgetMs && c.scale < 1.f )
+	{
+		// one step at a time, and only after a run of cheap frames
+		if( ++c.underBudget >= cfg::kDynamicResolutionUpFrames )
+		{
+			c.underBudget = 0;
+			next = c.scale + cfg::kDynamicResolutionStep;
+		}
+	}
+	else
+	{
+		c.underBudget = 0;
+	}
+
+	next = std::clamp( next, c.minScale, 1.f );
+	if( next != c.scale )
+	{
+		// keep the filter in step with the new scale
+		c.filteredMs *= (next * next) / (c.scale * c.scale);
+		c.scale = next;
+		c.settle = cfg::kDynamicResolutionSettleFrames;
+		++c.changes;
+	}
+
+	return c.scale;
+}
+
+void reset_resolution_scale( ResolutionController& aController )
+{
+	aController.scale = 1.f;
+	aController.filteredMs = 0.f;
+	aController.settle = 0;
+	aController.underBudget = 0;
+}
+
+std::vector<ResolutionSample> resolution_history( ResolutionController const& aController )
+{
+	std::vector<ResolutionSample> ret;
+	ret.reserve( aController.history.size() );
+	ret.insert( ret.end(), aController.history.begin() + std::ptrdiff_t(aController.head), aController.history.end() );
+	ret.insert( ret.end(), aController.history.begin(), aController.history.begin() + std::ptrdiff_t(aController.head) );
+	return ret;
+}
+
+bool write_resolution_history( ResolutionController const& aController, char const* aPath )
+{
+	std::FILE* file = std::fopen( aPath, "w" );
+	if( !file )
+		return false;
+
+	std::fprintf( file, "frame,gpu_ms,filtered_ms,scale,budget_ms\n" );
+
+	auto const samples = resolution_history( aController );
+	for( std::size_t i = 0; i < samples.size(); ++i )
+	{
+		auto const& s = samples[i];
+		std::fprintf( file, "%zu,%.4f,%.4f,%.4f,%.2f\n", i, s.gpuMs, s.filtered, s.scale, aController.budgetMs );
+	}
+
+	return 0 == std::fclose( file );
+}
+
+VkExtent2D scaled_extent( VkExtent2D aExtent, float aScale )
+{
+	return VkExtent2D{
+		std::max( 1u, std::uint32_t(std::lround( float(aExtent.width) * aScale )) ),
+		std::max( 1u, std::uint32_t(std::lround( float(aExtent.height) * aScale )) )
+	};
+}
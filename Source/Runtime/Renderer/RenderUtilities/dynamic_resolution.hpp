@@ -0,0 +1,83 @@
+#pragma once
+
+#include <volk/volk.h>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Dynamic resolution
+// the scene (main pass, its depth pre-pass and resolve) is rendered into the
+// top-left part of the swapchain sized attachments, scale times the swapchain
+// extent per axis; the compute post pass upscales it to the swapchain (post.comp).
+// Nothing is reallocated when the scale changes. The controller follows the GPU
+// time of whole frames (the profiler's "frame" scope, see lut::GpuProfiler,
+// read back cfg::kFramesInFlight frames late):
+// GPU time is taken as proportional to the pixel count, so the scale that meets
+// the budget is scale * sqrt(budget / time). It steps down as soon as the
+// smoothed time is over budget, and up only after a run of frames with enough
+// headroom, so it does not oscillate around the budget. Scales are quantized to
+// cfg::kDynamicResolutionStep (cached draws bake the viewport and are re-recorded
+// on every change).
+
+namespace cfg
+{
+	constexpr float kDynamicResolutionBudgetMs = 16.6f; // GPU time per frame
+	constexpr float kDynamicResolutionMinScale = 0.5f;
+	constexpr float kDynamicResolutionStep = 1.f / 16.f;
+
+	// step up only below this share of the budget, for this many frames
+	constexpr float         kDynamicResolutionHeadroom = 0.85f;
+	constexpr std::uint32_t kDynamicResolutionUpFrames = 30;
+
+	// frames after a change before the next one; the measurements lag behind
+	constexpr std::uint32_t kDynamicResolutionSettleFrames = 4;
+
+	// smoothing of the measured GPU time, weight of the newest frame
+	constexpr float kDynamicResolutionSmoothing = 0.2f;
+
+	// frames kept in ResolutionController::history
+	constexpr std::size_t kDynamicResolutionHistory = 600;
+
+	// written by key M
+	constexpr char const* kResolutionHistoryPath = "dynamic_resolution.csv";
+}
+
+struct ResolutionSample
+{
+	float gpuMs;    // measured, whole frame
+	float scale;    // the frame was rendered at
+	float filtered; // smoothed GPU time after this sample
+};
+
+struct ResolutionController
+{
+	float budgetMs = cfg::kDynamicResolutionBudgetMs;
+	float minScale = cfg::kDynamicResolutionMinScale;
+	float scale = 1.f;
+
+	float         filteredMs = 0.f; // 0: no sample yet
+	std::uint32_t settle = 0;       // frames until the scale may change again
+	std::uint32_t underBudget = 0;  // consecutive frames with headroom
+
+	// ring of the last cfg::kDynamicResolutionHistory samples, oldest at head
+	// once full; see resolution_history()
+	std::vector<ResolutionSample> history;
+	std::size_t                   head = 0;
+	std::size_t                   changes = 0; // scale changes so far
+};
+
+// feeds the GPU time of a frame rendered at aScale; returns the scale of the
+// next frame (also in aController.scale)
+float update_resolution_scale( ResolutionController&, float aGpuMs, float aScale );
+
+// back to full resolution, the history is kept
+void reset_resolution_scale( ResolutionController& );
+
+// the samples in order, oldest first
+std::vector<ResolutionSample> resolution_history( ResolutionController const& );
+
+// writes resolution_history() as CSV (frame, gpu ms, filtered ms, scale, budget); false on failure
+bool write_resolution_history( ResolutionController const&, char const* aPath );
+
+// aExtent scaled per axis, at least one pixel
+VkExtent2D scaled_extent( VkExtent2D aExtent, float aScale );
@@ -10,6 +10,7 @@
 #include "engine_model.hpp"
 #include <stdexcept>
 #include <cstring>
+#include <limits>
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -181,6 +182,16 @@ static std::vector<EngineMesh> loadMeshes(
                 mesh.positions.resize(acc.count);
                 for (size_t k = 0; k < acc.count; ++k)
                     mesh.positions[k] = *reinterpret_cast<const glm::vec3*>(data + k * stride);
+
+                // local AABB
+                mesh.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+                mesh.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+                for (auto const& p : mesh.positions) {
+                    mesh.boundsMin = glm::min(mesh.boundsMin, p);
+                    mesh.boundsMax = glm::max(mesh.boundsMax, p);
+                }
+                if (mesh.positions.empty())
+                    mesh.boundsMin = mesh.boundsMax = glm::vec3(0.f);
             }
 
             // NORMAL 
@@ -272,6 +283,8 @@ static void processNode(
     int nodeIdx,
     const glm::mat4& parentMatrix,
     const std::vector<std::vector<uint32_t>>& meshMap,
+    const std::vector<uint8_t>& animatedNodes,
+    bool parentAnimated,
     std::vector<EngineInstance>& outInstances)
 {
     if (nodeIdx < 0 || nodeIdx >= gltf.nodes.size()) return;
@@ -282,6 +295,9 @@ static void processNode(
     glm::mat4 localMatrix = getNodeTransform(node);
     glm::mat4 globalMatrix = parentMatrix * localMatrix;
 
+    // animated nodes move their whole subtree
+    const bool animated = parentAnimated || animatedNodes[nodeIdx];
+
     // 2. Create Instances if the node has a mesh
     if (node.mesh >= 0 && node.mesh < meshMap.size()) {
         const auto& engineMeshIndices = meshMap[node.mesh];
@@ -290,13 +306,14 @@ static void processNode(
             EngineInstance instance;
             instance.meshIndex = meshIndex; // Reference to geometry
             instance.transform = globalMatrix;  // World position
+            instance.dynamic = animated;
             outInstances.push_back(instance);
         }
     }
 
     // 3. Process children recursively
     for (int childIdx : node.children) {
-        processNode(gltf, childIdx, globalMatrix, meshMap, outInstances);
+        processNode(gltf, childIdx, globalMatrix, meshMap, animatedNodes, animated, outInstances);
     }
 }
 
@@ -325,12 +342,21 @@ EngineModel load_engine_model_glb(const char* path)
 
     // 2. Build Scene Graph (Nodes -> Instances)
     if (gltf.scenes.size() > 0) {
+        // nodes targeted by an animation channel (dynamic shadow casters)
+        std::vector<uint8_t> animatedNodes(gltf.nodes.size(), 0);
+        for (const auto& anim : gltf.animations) {
+            for (const auto& channel : anim.channels) {
+                if (channel.target_node >= 0 && channel.target_node < int(gltf.nodes.size()))
+                    animatedNodes[channel.target_node] = 1;
+            }
+        }
+
         int sceneIdx = gltf.defaultScene > -1 ? gltf.defaultScene : 0;
         const tinygltf::Scene& scene = gltf.scenes[sceneIdx];
 
         for (int nodeIdx : scene.nodes) {
             // Process all root nodes
-            processNode(gltf, nodeIdx, glm::mat4(1.0f), meshMap, model.scenes);
+            processNode(gltf, nodeIdx, glm::mat4(1.0f), meshMap, animatedNodes, false, model.scenes);
         }
     }
     else {
@@ -45,11 +45,16 @@ struct EngineMesh {
     std::vector<glm::vec2>  texcoords;
     std::vector<uint32_t>   indices;
 	// lightmapUVs may be added in the future
+
+    // object space bounding box, computed from positions at import (used for culling)
+    glm::vec3               boundsMin{ 0.f };
+    glm::vec3               boundsMax{ 0.f };
 };
 
 struct EngineInstance {
     uint32_t  meshIndex; 
 	glm::mat4 transform; // world transform matrix for this instance, calculated from gltf node hierarchy
+	bool      dynamic = false; // transform may change at run time; drawn over the cached static shadow depth
 };
 
 struct EngineModel {
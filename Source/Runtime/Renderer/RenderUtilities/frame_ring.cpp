@@ -0,0 +1,78 @@
+#include "frame_ring.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+#include "../../Rhi/error.hpp"
+#include "../../Rhi/to_string.hpp"
+
+namespace
+{
+	VkDeviceSize align_up( VkDeviceSize aValue, VkDeviceSize aAlignment )
+	{
+		return (aValue + aAlignment - 1) / aAlignment * aAlignment;
+	}
+}
+
+FrameRing::FrameRing( VkPhysicalDevice aPhysicalDev )
+{
+	VkPhysicalDeviceProperties props{};
+	vkGetPhysicalDeviceProperties( aPhysicalDev, &props );
+
+	// both are powers of two
+	mAlignment = std::max( props.limits.minUniformBufferOffsetAlignment, props.limits.minStorageBufferOffsetAlignment );
+}
+
+VkDeviceSize FrameRing::reserve( VkDeviceSize aSize )
+{
+	assert( VK_NULL_HANDLE == mBuffer.buffer );
+
+	VkDeviceSize const offset = mRegionSize;
+	mRegionSize = align_up( offset + aSize, mAlignment );
+	return offset;
+}
+
+void FrameRing::create( lut::Allocator const& aAllocator, std::uint32_t aFrames )
+{
+	assert( mRegionSize > 0 && aFrames > 0 );
+
+	// device local and host visible where available (resizable BAR), else host memory
+	mBuffer = lut::create_buffer( aAllocator,
+		mRegionSize * aFrames,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+		VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE
+	);
+	mAllocator = aAllocator.allocator;
+
+	VmaAllocationInfo info{};
+	vmaGetAllocationInfo( mAllocator, mBuffer.allocation, &info );
+	if( !info.pMappedData )
+		throw lut::Error( "Unable to map the per-frame ring buffer" );
+
+	mMapped = static_cast<std::byte*>( info.pMappedData );
+	mBase = 0;
+}
+
+std::uint32_t FrameRing::begin_frame( std::uint32_t aFrame )
+{
+	mBase = mRegionSize * aFrame;
+	return std::uint32_t(mBase);
+}
+
+void FrameRing::write( VkDeviceSize aOffset, void const* aData, std::size_t aSize )
+{
+	assert( mMapped && aOffset + aSize <= mRegionSize );
+	std::memcpy( mMapped + mBase + aOffset, aData, aSize );
+}
+
+void FrameRing::flush()
+{
+	if( auto const res = vmaFlushAllocation( mAllocator, mBuffer.allocation, mBase, mRegionSize ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to flush the per-frame ring buffer\n"
+			"vmaFlushAllocation() returned {}", lut::to_string(res)
+		);
+	}
+}
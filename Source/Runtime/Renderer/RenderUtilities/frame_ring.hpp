@@ -0,0 +1,57 @@
+#pragma once
+
+#include <volk/volk.h>
+#include <cstddef>
+#include <cstdint>
+
+#include "../../Rhi/vkbuffer.hpp"
+#include "../../Rhi/allocator.hpp"
+
+namespace lut = labut2;
+
+// Per-frame uniform and storage data
+// One persistently mapped, host visible buffer with a region per frame in
+// flight, used round robin. Every region has the same layout, fixed by
+// reserve() before create(): descriptors are written once against region 0 as
+// *_DYNAMIC and bound with the frame's begin_frame() offset. The frame's timeline
+// value tells when its region is free again and the submit makes the host writes
+// visible, so an upload is a memcpy, without transfer commands or barriers.
+class FrameRing
+{
+	public:
+		FrameRing() noexcept = default;
+
+		// aligned for both uniform and storage buffer bindings
+		explicit FrameRing( VkPhysicalDevice );
+
+		// offset of aSize bytes in every region; only before create()
+		VkDeviceSize reserve( VkDeviceSize aSize );
+
+		void create( lut::Allocator const&, std::uint32_t aFrames );
+
+		// selects the region of frame slot aFrame; returns its dynamic offset
+		std::uint32_t begin_frame( std::uint32_t aFrame );
+
+		// into the current region, at an offset from reserve()
+		void write( VkDeviceSize aOffset, void const* aData, std::size_t aSize );
+
+		template< typename T >
+		void write( VkDeviceSize aOffset, T const& aValue )
+		{
+			write( aOffset, &aValue, sizeof(T) );
+		}
+
+		// makes the current region's writes available (non-coherent memory only)
+		void flush();
+
+		VkBuffer buffer() const noexcept { return mBuffer.buffer; }
+		VkDeviceSize region_size() const noexcept { return mRegionSize; }
+
+	private:
+		lut::Buffer   mBuffer;
+		VmaAllocator  mAllocator = VK_NULL_HANDLE;
+		std::byte*    mMapped = nullptr;
+		VkDeviceSize  mAlignment = 1;
+		VkDeviceSize  mRegionSize = 0;
+		VkDeviceSize  mBase = 0;
+};
@@ -0,0 +1,71 @@
+#include "gpu_driven.hpp"
+
+#include <cassert>
+
+GpuDrawData build_gpu_draw_data( EngineModel const& aModel, std::vector<MeshDrawRange> const& aMeshRanges )
+{
+	assert( aModel.meshes.size() == aMeshRanges.size() );
+
+	GpuDrawData ret;
+
+	auto const material_of = [&] (EngineMesh const& aMesh) -> std::uint32_t {
+		return aMesh.materialIndex < aModel.materials.size() ? aMesh.materialIndex : 0;
+	};
+
+	// the pipeline (task 1.6) is the only state that still splits draws; dynamic
+	// casters are kept apart for the shadow cache
+	auto const key_of = [&] (EngineInstance const& aInst) -> std::uint32_t {
+		auto const mat = aModel.meshes[aInst.meshIndex].materialIndex;
+		std::uint32_t const alphaMask = mat < aModel.materials.size() && aModel.materials[mat].alphaMaskTexture >= 0 ? 1 : 0;
+		return alphaMask + (aInst.dynamic ? 2 : 0);
+	};
+
+	// count instances per key to size the buckets
+	std::uint32_t perKey[4] = {};
+	for( auto const& inst : aModel.scenes )
+		++perKey[key_of( inst )];
+
+	// prefix sum -> first slot of each bucket
+	// empty buckets are skipped so the recorder does not issue useless draws
+	std::uint32_t bucketOfKey[4] = {};
+	std::uint32_t base = 0;
+	for( std::uint32_t k = 0; k < 4; ++k )
+	{
+		if( 0 == perKey[k] )
+			continue;
+
+		bucketOfKey[k] = std::uint32_t(ret.buckets.size());
+		ret.buckets.emplace_back( IndirectDrawBucket{ k & 1, k >> 1, base, perKey[k] } );
+		base += perKey[k];
+	}
+
+	ret.meshes.reserve( aModel.meshes.size() );
+	for( std::size_t i = 0; i < aModel.meshes.size(); ++i )
+	{
+		auto const& mesh = aModel.meshes[i];
+
+		glsl::MeshData md{};
+		md.boundsMin = mesh.boundsMin;
+		md.boundsMax = mesh.boundsMax;
+		md.firstIndex = aMeshRanges[i].firstIndex;
+		md.indexCount = aMeshRanges[i].indexCount;
+		md.vertexOffset = aMeshRanges[i].vertexOffset;
+		ret.meshes.emplace_back( md );
+	}
+
+	ret.instances.reserve( aModel.scenes.size() );
+	for( auto const& inst : aModel.scenes )
+	{
+		std::uint32_t const bucket = bucketOfKey[key_of( inst )];
+
+		glsl::InstanceData id{};
+		id.model = inst.transform;
+		id.meshIndex = inst.meshIndex;
+		id.materialIndex = material_of( aModel.meshes[inst.meshIndex] );
+		id.bucket = bucket;
+		id.drawBase = ret.buckets[bucket].drawBase;
+		ret.instances.emplace_back( id );
+	}
+
+	return ret;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <volk/volk.h>
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "engine_model.hpp"
+#include "camera.hpp"
+
+// GPU-driven rendering
+// instances and meshes live in storage buffers, a compute pass (cull.comp)
+// frustum culls every instance and writes compacted VkDrawIndexedIndirectCommands
+// plus one draw count per pipeline bucket for the main pass and each shadow cascade,
+// and one command per (instance, cube face) for the point light shadow.
+// Materials are bindless (see materials.hpp), so a bucket spans many materials.
+
+namespace glsl
+{
+	// must match Instance in cull.comp and the *_indirect.vert shaders
+	struct InstanceData
+	{
+		glm::mat4     model;
+		std::uint32_t meshIndex;
+		std::uint32_t materialIndex; // into the material buffer
+		std::uint32_t bucket;        // see IndirectDrawBucket
+		std::uint32_t drawBase;      // first command slot of the bucket
+	};
+
+	// must match Mesh in cull.comp
+	struct MeshData
+	{
+		glm::vec3     boundsMin;
+		std::uint32_t firstIndex;
+		glm::vec3     boundsMax;
+		std::uint32_t indexCount;
+		std::int32_t  vertexOffset;
+		std::uint32_t _pad[3];
+	};
+
+	// push constants of cull.comp
+	struct CullPush
+	{
+		std::uint32_t instanceCount;
+		std::uint32_t bucketCount;
+		std::uint32_t phase;     // 0: shadow + previously visible, 1: occlusion test
+		std::uint32_t occlusion; // 0 disables the visibility test of phase 0
+		glm::vec2     pyramidSize;
+		float         pyramidLevels;
+		std::uint32_t cascadeMask; // shadow cascades that need draws this frame
+		std::uint32_t pointShadow; // 1: per cube face draws of the point light shadow
+	};
+
+	// push constants of depth_reduce.comp
+	struct DepthReducePush
+	{
+		glm::uvec2 srcSize;
+		glm::uvec2 dstSize;
+	};
+}
+
+// where a mesh lives inside the merged vertex/index buffers
+struct MeshDrawRange
+{
+	std::uint32_t firstIndex;
+	std::uint32_t indexCount;
+	std::int32_t  vertexOffset;
+};
+
+// one bucket per pipeline (opaque, alpha masked) and caster kind; draws of a
+// bucket are merged into one indirect draw, the material is looked up per instance.
+// Dynamic casters get buckets of their own so the shadow pass can draw them on
+// top of the cached static shadow depth (see ShadowPass).
+struct IndirectDrawBucket
+{
+	std::uint32_t alphaMask; // draws use the alpha tested pipeline
+	std::uint32_t dynamic;   // instances flagged EngineInstance::dynamic
+	std::uint32_t drawBase;  // first command in the draw buffers
+	std::uint32_t maxDraws;  // number of instances in this bucket
+};
+
+struct GpuDrawData
+{
+	std::vector<glsl::InstanceData> instances;
+	std::vector<glsl::MeshData>     meshes;
+	std::vector<IndirectDrawBucket> buckets;
+};
+
+// build the storage buffer contents; the command slots of each bucket are laid
+// out back to back so the draw buffers need exactly one slot per instance
+GpuDrawData build_gpu_draw_data(
+	EngineModel const&,
+	std::vector<MeshDrawRange> const&
+);
+
+// non-owning handles needed to record the GPU-driven path
+struct IndirectDrawInfo
+{
+	VkPipeline       cullPipe;
+	VkPipelineLayout cullLayout;
+	VkDescriptorSet  cullDescriptors;
+
+	VkBuffer mainDraws;
+	VkBuffer shadowDraws; // cfg::kMaxShadowCascades times the slots of mainDraws
+	VkBuffer pointDraws;  // six slots per instance, firstInstance = 6 * instance + face
+	VkBuffer drawCounts;  // see draw_count_buffer_size()
+
+	std::uint32_t instanceCount;
+	std::span<IndirectDrawBucket const> buckets;
+	std::uint32_t cascadeMask; // shadow cascades culled by cull.comp
+	bool          pointShadow; // point light shadow draws culled by cull.comp
+
+	// pipelines reading the model matrix from the instance buffer
+	VkPipeline opaquePipe;
+	VkPipeline alphaPipe;
+	VkPipeline shadowPipe;       // alpha tested casters
+	VkPipeline shadowOpaquePipe; // position only, the other buckets
+	VkPipeline pointShadowPipe;  // every caster, the point draws are not split by bucket
+
+	// Hi-Z occlusion culling; the main pass is split into two phases when set
+	bool occlusion;
+	VkBuffer lateDraws;      // phase 1 commands, same layout as mainDraws
+	VkBuffer visibility;     // one uint per instance, written by phase 1
+	VkBuffer statsReadback;  // host visible, receives frustum visible + occluded counts
+
+	VkImage       pyramidImage;
+	std::uint32_t pyramidWidth;
+	std::uint32_t pyramidHeight;
+	std::uint32_t pyramidLevels;
+
+	VkPipeline       reducePipe;
+	VkPipelineLayout reduceLayout;
+	std::span<VkDescriptorSet const> reduceDescriptors; // one per pyramid level
+};
+
+// counters written by cull.comp: main (phase 0), main (phase 1) and one set per
+// shadow cascade, each with one counter per bucket; one counter for the point light
+// shadow (a single pipeline, buckets do not matter); then the two occlusion statistics
+inline std::uint32_t shadow_count_base( std::size_t aBucketCount, std::uint32_t aCascade )
+{
+	return std::uint32_t((2 + aCascade) * aBucketCount);
+}
+
+inline std::uint32_t point_shadow_count_index( std::size_t aBucketCount )
+{
+	return std::uint32_t((2 + cfg::kMaxShadowCascades) * aBucketCount);
+}
+
+inline std::uint32_t draw_count_stats_offset( std::size_t aBucketCount )
+{
+	return std::uint32_t((point_shadow_count_index( aBucketCount ) + 1) * sizeof(std::uint32_t));
+}
+
+inline VkDeviceSize draw_count_buffer_size( std::size_t aBucketCount )
+{
+	return draw_count_stats_offset( aBucketCount ) + 2 * sizeof(std::uint32_t);
+}
@@ -0,0 +1,34 @@
+#include "materials.hpp"
+
+std::vector<glsl::MaterialData> build_material_data( EngineModel const& aModel )
+{
+	std::vector<glsl::MaterialData> ret;
+	ret.reserve( aModel.materials.size() );
+
+	for( auto const& mat : aModel.materials )
+	{
+		glsl::MaterialData md{};
+		md.baseColorFactor = mat.baseColorFactor;
+		md.metallicFactor = mat.metallicFactor;
+		md.roughnessFactor = mat.roughnessFactor;
+		md.alphaCutoff = mat.alphaCutoff;
+		md.baseColorTexture = texture_slot( mat.baseColorTexture );
+		md.metalRoughTexture = texture_slot( mat.metalRoughTexture );
+		ret.emplace_back( md );
+	}
+
+	// meshes without a valid material index use entry 0
+	if( ret.empty() )
+	{
+		glsl::MaterialData md{};
+		md.baseColorFactor = glm::vec4( 1.f );
+		md.metallicFactor = 1.f;
+		md.roughnessFactor = 1.f;
+		md.alphaCutoff = 0.5f;
+		md.baseColorTexture = cfg::kDefaultTextureSlot;
+		md.metalRoughTexture = cfg::kDefaultTextureSlot;
+		ret.emplace_back( md );
+	}
+
+	return ret;
+}
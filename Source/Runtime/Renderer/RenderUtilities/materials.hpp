@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "engine_model.hpp"
+
+// Bindless materials
+// all textures live in one partially bound sampler2D[] (set 1, binding 1) and the
+// material parameters in a storage buffer (set 1, binding 0); draws select their
+// material with an index (push constant on the CPU path, instance buffer on the
+// GPU-driven path), so set 1 is bound once per pass instead of once per draw.
+
+namespace cfg
+{
+	// upper bound of the texture array (variable count binding)
+	constexpr std::uint32_t kMaxBindlessTextures = 4096;
+
+	// slot 0 of the texture array holds the default gray texture
+	constexpr std::uint32_t kDefaultTextureSlot = 0;
+}
+
+namespace glsl
+{
+	// must match Material in the shaders reading set 1
+	struct MaterialData
+	{
+		glm::vec4     baseColorFactor;
+		float         metallicFactor;
+		float         roughnessFactor;
+		float         alphaCutoff;
+		std::uint32_t baseColorTexture;  // slots in the texture array
+		std::uint32_t metalRoughTexture;
+		std::uint32_t _pad[3];
+	};
+
+	// push constants of the CPU path vertex shaders; the shadow pass
+	// shaders (both paths) also read cascade, pointshadow.vert faceMask,
+	// the visibility buffer shaders instance
+	struct DrawPush
+	{
+		glm::mat4     model;
+		std::uint32_t materialIndex;
+		std::uint32_t cascade;  // index into SceneUniform::cascadeVP
+		std::uint32_t faceMask; // cube faces the instance is drawn into, one instance each
+		std::uint32_t instance; // index into the instance buffer (EngineModel::scenes)
+	};
+}
+
+// slot of EngineModel::textures[aTexture] in the texture array, -1 maps to the default
+inline std::uint32_t texture_slot( int aTexture )
+{
+	return aTexture >= 0 ? std::uint32_t(aTexture) + 1 : cfg::kDefaultTextureSlot;
+}
+
+// one entry per EngineModel::materials (at least one, a default material)
+std::vector<glsl::MaterialData> build_material_data( EngineModel const& );
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Compute post-processing
+// post.comp fuses the whole post stack into one dispatch: exposure, the 5x3
+// mosaic and Reinhard tonemapping of fullscreen.frag, then an optional edge
+// filter (FXAA style luma edge blend, or a sharpen). Each workgroup tonemaps
+// its tile plus a one pixel apron into shared memory once, the filter reads
+// the neighbours from there. The linear result is in TransientAttachments::post;
+// a blit into the swapchain does the sRGB encode that the raster path gets from
+// its attachment. Adding an effect means another step in post.comp, not another
+// full-screen pass and barrier. When the scene was rendered below the output
+// size, the tonemap step upscales it first.
+
+namespace cfg
+{
+	// local_size_x/y of post.comp (TILE), the shared tile is two texels wider
+	constexpr std::uint32_t kPostTileSize = 16;
+
+	// sharpen strength of PostFilter::sharpen (0: none, 1: strong)
+	constexpr float kPostSharpen = 0.5f;
+}
+
+enum class PostFilter : std::uint32_t
+{
+	none    = 0,
+	fxaa    = 1,
+	sharpen = 2
+};
+
+namespace glsl
+{
+	// push constants of post.comp
+	struct PostPush
+	{
+		glm::uvec2    size;
+		glm::uvec2    renderSize; // of the scene in the input, see dynamic_resolution.hpp
+		float         exposure;  // scales the linear color before tonemapping
+		float         sharpen;   // PostFilter::sharpen only
+		std::uint32_t mosaic;    // 1: 5x3 blocks
+		std::uint32_t filter;    // PostFilter
+	};
+}
@@ -0,0 +1,349 @@
+#include "render_graph.hpp"
+
+#include "../../Rhi/gpu_profiler.hpp"
+
+#include <numeric>
+#include <cassert>
+#include <algorithm>
+
+namespace
+{
+	constexpr VkAccessFlags2 kWriteAccess = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT
+		| VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		| VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+		| VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+	struct UseState
+	{
+		VkPipelineStageFlags2 stages;
+		VkAccessFlags2        access;
+		VkImageLayout         layout;
+	};
+
+	UseState use_state( RgUse aUse )
+	{
+		constexpr VkPipelineStageFlags2 kDepthStages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+
+		switch( aUse )
+		{
+			case RgUse::colorWrite:
+				return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+			case RgUse::depthWrite:
+				return { kDepthStages, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+			case RgUse::sampled:
+				return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			case RgUse::storageRead:
+				return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL };
+			case RgUse::present:
+				return { VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+			case RgUse::computeSampled:
+				return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+			case RgUse::storageWrite:
+				return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL };
+			case RgUse::transferSrc:
+				return { VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL };
+			case RgUse::transferDst:
+				return { VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL };
+		}
+
+		assert( false );
+		return {};
+	}
+
+	bool writes( RgUse aUse )
+	{
+		return RgUse::colorWrite == aUse || RgUse::depthWrite == aUse
+			|| RgUse::storageWrite == aUse || RgUse::transferDst == aUse;
+	}
+
+	// see render_graph.hpp
+	bool framebuffer_local( VkImageMemoryBarrier2 const& aBarrier )
+	{
+		constexpr VkPipelineStageFlags2 kFramebufferStages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT
+			| VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT
+			| VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+		constexpr VkAccessFlags2 kAttachmentAccess = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT
+			| VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT
+			| VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+			| VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		return 0 == (aBarrier.srcStageMask & ~kFramebufferStages)
+			&& 0 == (aBarrier.dstStageMask & ~kFramebufferStages)
+			&& 0 == (aBarrier.dstAccessMask & ~kAttachmentAccess);
+	}
+}
+
+RgImage RenderGraph::import_image( VkImage aImage, VkImageAspectFlags aAspect )
+{
+	Image img{ aImage, aAspect, {} };
+
+	// every stage and write an attachment sees in a frame: the first barrier
+	// waits for the previous frame (or the other owner of aliased memory) and
+	// chains with the swapchain acquire wait at COLOR_ATTACHMENT_OUTPUT
+	img.state.stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT
+		| VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT
+		| VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT
+		| VK_PIPELINE_STAGE_2_BLIT_BIT;
+	img.state.access = kWriteAccess;
+
+	mImages.emplace_back( img );
+	return RgImage(mImages.size() - 1);
+}
+
+void RenderGraph::set_output( RgImage aImage, RgUse aUse )
+{
+	assert( aImage < mImages.size() );
+	mImages[aImage].output = true;
+	mImages[aImage].outputUse = aUse;
+}
+
+void RenderGraph::add_pass( char const* aName, std::initializer_list<RgAccess> aAccesses, std::function<void()> aRecord )
+{
+	mPasses.emplace_back( Pass{ aName, aAccesses, std::move(aRecord) } );
+}
+
+void RenderGraph::transition( Image& aImage, RgUse aUse, std::vector<VkImageMemoryBarrier2>& aBarriers )
+{
+	UseState const next = use_state( aUse );
+	State& cur = aImage.state;
+
+	bool const prevWrite = 0 != (cur.access & kWriteAccess);
+	bool const nextWrite = 0 != (next.access & kWriteAccess);
+
+	// reads after reads in the same layout need nothing; remember the readers
+	// for the next write
+	if( cur.layout == next.layout && !prevWrite && !nextWrite )
+	{
+		cur.stages |= next.stages;
+		cur.access |= next.access;
+		return;
+	}
+
+	VkImageMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = cur.stages;
+	barrier.srcAccessMask = cur.access & kWriteAccess; // only writes need to be made available
+	barrier.dstStageMask = next.stages;
+	barrier.dstAccessMask = next.access;
+	barrier.oldLayout = cur.layout;
+	barrier.newLayout = next.layout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = aImage.image;
+	barrier.subresourceRange = VkImageSubresourceRange{ aImage.aspect, 0, 1, 0, 1 };
+	aBarriers.emplace_back( barrier );
+
+	cur = State{ next.stages, next.access, next.layout };
+}
+
+std::vector<std::uint8_t> RenderGraph::live_passes() const
+{
+	// backwards: a pass lives if it writes an image that is an output or read
+	// by a later live pass (earlier writers of such an image stay live too)
+	std::vector<std::uint8_t> needed( mImages.size(), 0 );
+	for( std::size_t i = 0; i < mImages.size(); ++i )
+		needed[i] = mImages[i].output ? 1 : 0;
+
+	std::vector<std::uint8_t> live( mPasses.size(), 0 );
+	for( std::size_t p = mPasses.size(); p-- > 0; )
+	{
+		for( auto const& access : mPasses[p].accesses )
+		{
+			if( writes( access.use ) && needed[access.image] )
+				live[p] = 1;
+		}
+
+		if( !live[p] )
+			continue;
+
+		for( auto const& access : mPasses[p].accesses )
+		{
+			if( !writes( access.use ) )
+				needed[access.image] = 1;
+		}
+	}
+
+	return live;
+}
+
+std::vector<RgLifetime> RenderGraph::lifetimes() const
+{
+	std::vector<RgLifetime> ret( mImages.size() );
+
+	std::vector<std::uint8_t> const live = live_passes();
+	std::uint32_t order = 0;
+	for( std::size_t p = 0; p < mPasses.size(); ++p )
+	{
+		if( !live[p] )
+			continue;
+
+		for( auto const& access : mPasses[p].accesses )
+		{
+			auto& lifetime = ret[access.image];
+			lifetime.first = std::min( lifetime.first, order );
+			lifetime.last = std::max( lifetime.last, order );
+		}
+		++order;
+	}
+
+	for( std::size_t i = 0; i < mImages.size(); ++i )
+	{
+		if( mImages[i].output )
+		{
+			ret[i].first = std::min( ret[i].first, order );
+			ret[i].last = order;
+		}
+	}
+
+	return ret;
+}
+
+RenderGraphStats RenderGraph::execute( VkCommandBuffer aCmdBuff, labut2::GpuProfiler* aProfiler )
+{
+	RenderGraphStats stats{};
+	stats.passes = std::uint32_t(mPasses.size());
+
+	std::vector<std::uint8_t> const live = live_passes();
+	for( std::uint8_t const l : live )
+		stats.culled += l ? 0 : 1;
+
+	std::vector<VkImageMemoryBarrier2> barriers;
+	auto const flush = [&] {
+		if( barriers.empty() )
+			return;
+
+		VkDependencyInfo deps{};
+		deps.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		if( std::all_of( barriers.begin(), barriers.end(), framebuffer_local ) )
+			deps.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+		deps.imageMemoryBarrierCount = std::uint32_t(barriers.size());
+		deps.pImageMemoryBarriers = barriers.data();
+		vkCmdPipelineBarrier2( aCmdBuff, &deps );
+
+		stats.barriers += std::uint32_t(barriers.size());
+		++stats.batches;
+		barriers.clear();
+	};
+
+	for( std::size_t p = 0; p < mPasses.size(); ++p )
+	{
+		if( !live[p] )
+			continue;
+
+		labut2::GpuProfiler::Scope const scope( aProfiler, aCmdBuff, mPasses[p].name );
+
+		for( auto const& access : mPasses[p].accesses )
+			transition( mImages[access.image], access.use, barriers );
+
+		flush();
+		mPasses[p].record();
+	}
+
+	for( auto& image : mImages )
+	{
+		if( image.output )
+			transition( image, image.outputUse, barriers );
+	}
+	flush();
+
+	return stats;
+}
+
+void declare_frame_graph( RenderGraph& aGraph, FrameGraphConfig const& aConfig, FrameGraphTargets const& aTargets, FrameGraphRecorders aRecorders )
+{
+	RgImage const depth = aGraph.import_image( aTargets.depth, VK_IMAGE_ASPECT_DEPTH_BIT );
+	RgImage const offscreen = aGraph.import_image( aTargets.offscreen, VK_IMAGE_ASPECT_COLOR_BIT );
+	RgImage const ids = aConfig.visbuffer ? aGraph.import_image( aTargets.ids, VK_IMAGE_ASPECT_COLOR_BIT ) : offscreen;
+	RgImage const swapchain = aGraph.import_image( aTargets.swapchain, VK_IMAGE_ASPECT_COLOR_BIT );
+	aGraph.set_output( swapchain, RgUse::present );
+
+	RgImage const post = aConfig.computePost ? aGraph.import_image( aTargets.post, VK_IMAGE_ASPECT_COLOR_BIT ) : swapchain;
+
+	if( aConfig.prepass )
+		aGraph.add_pass( "depth pre-pass", { { depth, RgUse::depthWrite } }, std::move(aRecorders.prepass) );
+
+	aGraph.add_pass( "main", { { ids, RgUse::colorWrite }, { depth, RgUse::depthWrite } }, std::move(aRecorders.main) );
+
+	if( aConfig.visbuffer )
+		aGraph.add_pass( "visibility buffer resolve", { { ids, RgUse::storageRead }, { offscreen, RgUse::colorWrite } }, std::move(aRecorders.resolve) );
+
+	if( aConfig.computePost )
+	{
+		aGraph.add_pass( "compute post-process", { { offscreen, RgUse::computeSampled }, { post, RgUse::storageWrite } }, std::move(aRecorders.computePost) );
+		aGraph.add_pass( "post blit", { { post, RgUse::transferSrc }, { swapchain, RgUse::transferDst } }, std::move(aRecorders.postBlit) );
+	}
+	else
+	{
+		aGraph.add_pass( "post-process", { { offscreen, RgUse::sampled }, { swapchain, RgUse::colorWrite } }, std::move(aRecorders.post) );
+	}
+}
+
+FrameGraphLifetimes frame_graph_lifetimes( FrameGraphConfig const& aConfig )
+{
+	RenderGraph graph;
+	declare_frame_graph( graph, aConfig, FrameGraphTargets{}, FrameGraphRecorders{} );
+
+	// imported in order: depth, offscreen, ids (visbuffer), swapchain, post (computePost)
+	auto const lifetimes = graph.lifetimes();
+
+	FrameGraphLifetimes ret;
+	ret.offscreen = lifetimes[1];
+	if( aConfig.visbuffer )
+		ret.ids = lifetimes[2];
+	if( aConfig.computePost )
+		ret.post = lifetimes.back();
+	return ret;
+}
+
+std::vector<std::uint32_t> plan_transient_aliasing( std::span<VkMemoryRequirements const> aRequirements, std::span<RgLifetime const> aLifetimes )
+{
+	std::size_t const count = aRequirements.size();
+	assert( count > 0 && 0 == aLifetimes.size() % count );
+	std::size_t const configurations = aLifetimes.size() / count;
+
+	auto const conflict = [&] (std::size_t a, std::size_t b) {
+		for( std::size_t c = 0; c < configurations; ++c )
+		{
+			if( aLifetimes[c * count + a].overlaps( aLifetimes[c * count + b] ) )
+				return true;
+		}
+		return false;
+	};
+
+	std::vector<std::size_t> order( count );
+	std::iota( order.begin(), order.end(), std::size_t(0) );
+	std::stable_sort( order.begin(), order.end(), [&] (std::size_t a, std::size_t b) {
+		return aRequirements[a].size > aRequirements[b].size;
+	} );
+
+	struct Slot
+	{
+		std::vector<std::size_t> members;
+		std::uint32_t            memoryTypeBits;
+	};
+	std::vector<Slot> slots;
+
+	std::vector<std::uint32_t> ret( count, 0 );
+	for( std::size_t const i : order )
+	{
+		auto const& req = aRequirements[i];
+
+		std::uint32_t s = 0;
+		for( ; s < slots.size(); ++s )
+		{
+			if( 0 == (slots[s].memoryTypeBits & req.memoryTypeBits) )
+				continue;
+			if( std::none_of( slots[s].members.begin(), slots[s].members.end(), [&] (std::size_t m) { return conflict( m, i ); } ) )
+				break;
+		}
+
+		if( s == slots.size() )
+			slots.emplace_back( Slot{ {}, ~0u } );
+
+		slots[s].members.emplace_back( i );
+		slots[s].memoryTypeBits &= req.memoryTypeBits;
+		ret[i] = s;
+	}
+
+	return ret;
+}
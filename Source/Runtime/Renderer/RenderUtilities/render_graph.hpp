@@ -0,0 +1,174 @@
+#pragma once
+
+#include <volk/volk.h>
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+
+namespace labut2
+{
+	class GpuProfiler;
+}
+
+// Frame graph of the main frame's attachments
+// record_commands() declares its passes from the depth pre-pass to the post
+// process, each with the images it reads and writes and how (RgUse). execute()
+// drops the passes whose writes reach neither an output nor a later live pass,
+// then records the others in order, each one after a single batched
+// vkCmdPipelineBarrier2 with the layout transitions and hazards it needs; the
+// outputs get one last batch. Shadow maps, culling and light binning come
+// before the graph and keep their own barriers. With a profiler, every live
+// pass is a profiler scope (and debug label) of its name, barriers included.
+//
+// Attachment contents never outlive the frame: the first use of an image
+// always starts from VK_IMAGE_LAYOUT_UNDEFINED, which is also what lets the
+// transient attachments share memory (see plan_transient_aliasing()). A batch
+// is BY_REGION only when it is framebuffer-local: every barrier waits on and
+// blocks framebuffer-space stages only, and the later pass uses the image as
+// an attachment (a sampled or storage read may fetch other pixels).
+
+enum class RgUse : std::uint8_t
+{
+	colorWrite,  // color attachment
+	depthWrite,  // depth attachment (also after a pre-pass: storeOp STORE writes)
+	sampled,     // fragment shader, sampled
+	storageRead, // fragment shader, imageLoad()
+	present,     // swapchain image, as an output
+
+	// compute post-processing and its blit into the swapchain
+	computeSampled, // compute shader, sampled
+	storageWrite,   // compute shader, imageStore()
+	transferSrc,    // blit source
+	transferDst     // blit destination
+};
+
+using RgImage = std::uint32_t;
+
+struct RgAccess
+{
+	RgImage image;
+	RgUse   use;
+};
+
+// live passes that use an image, in execution order: first..last (inclusive),
+// outputs up to the final transitions (the live pass count); first > last if
+// the image is not used
+struct RgLifetime
+{
+	std::uint32_t first = ~0u;
+	std::uint32_t last = 0;
+
+	bool used() const noexcept { return first <= last; }
+	bool overlaps( RgLifetime const& aOther ) const noexcept
+	{
+		return used() && aOther.used() && first <= aOther.last && aOther.first <= last;
+	}
+};
+
+// per execute(), see ReportStats()
+struct RenderGraphStats
+{
+	std::uint32_t passes = 0;   // declared
+	std::uint32_t culled = 0;
+	std::uint32_t barriers = 0; // image memory barriers
+	std::uint32_t batches = 0;  // vkCmdPipelineBarrier2 calls
+};
+
+class RenderGraph
+{
+	public:
+		RgImage import_image( VkImage, VkImageAspectFlags );
+
+		// left in aUse's state by execute(); its writers are never culled
+		void set_output( RgImage, RgUse );
+
+		// aRecord records into the command buffer given to execute()
+		void add_pass( char const* aName, std::initializer_list<RgAccess>, std::function<void()> aRecord );
+
+		RenderGraphStats execute( VkCommandBuffer, labut2::GpuProfiler* = nullptr );
+
+		// per imported image, after culling; records nothing
+		std::vector<RgLifetime> lifetimes() const;
+
+	private:
+		struct State
+		{
+			VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+			VkAccessFlags2        access = VK_ACCESS_2_NONE;
+			VkImageLayout         layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		};
+
+		struct Image
+		{
+			VkImage            image;
+			VkImageAspectFlags aspect;
+			State              state;
+			bool               output = false;
+			RgUse              outputUse = RgUse::present;
+		};
+
+		struct Pass
+		{
+			char const*           name;
+			std::vector<RgAccess> accesses;
+			std::function<void()> record;
+		};
+
+		// 1 per pass that writes an output or an image read by a later live pass
+		std::vector<std::uint8_t> live_passes() const;
+
+		// appends the barrier that takes aImage to aUse, if any
+		static void transition( Image&, RgUse, std::vector<VkImageMemoryBarrier2>& );
+
+		std::vector<Image> mImages;
+		std::vector<Pass>  mPasses;
+};
+
+// The main frame graph: record_commands() declares it with its recorders, the
+// transient attachment planning without (frame_graph_lifetimes()), so both see
+// the same passes. Passes: depth pre-pass (prepass), main (into the ids when
+// visbuffer), visibility buffer resolve (visbuffer), then either compute
+// post-process and post blit (computePost) or the raster post-process.
+struct FrameGraphConfig
+{
+	bool prepass = false;
+	bool visbuffer = false;
+	bool computePost = false;
+};
+
+struct FrameGraphTargets
+{
+	VkImage depth = VK_NULL_HANDLE;
+	VkImage offscreen = VK_NULL_HANDLE;
+	VkImage ids = VK_NULL_HANDLE;  // visbuffer only
+	VkImage post = VK_NULL_HANDLE; // computePost only
+	VkImage swapchain = VK_NULL_HANDLE;
+};
+
+// only those of the configured passes are called
+struct FrameGraphRecorders
+{
+	std::function<void()> prepass, main, resolve, computePost, postBlit, post;
+};
+
+void declare_frame_graph( RenderGraph&, FrameGraphConfig const&, FrameGraphTargets const&, FrameGraphRecorders );
+
+// of the transient attachments' roles in the graph of aConfig
+struct FrameGraphLifetimes
+{
+	RgLifetime offscreen, ids, post;
+};
+
+FrameGraphLifetimes frame_graph_lifetimes( FrameGraphConfig const& );
+
+// Transient attachment memory
+// aLifetimes: per frame configuration, the lifetime of every attachment
+// (aLifetimes[configuration * attachments + attachment], see
+// frame_graph_lifetimes()). Two attachments may share memory when their
+// lifetimes are disjoint in every configuration: the later one's first barrier
+// (from UNDEFINED, see RenderGraph) waits for all uses of the earlier one.
+// They are packed greedily, largest first. Returns the memory slot of each
+// attachment, slots numbered from 0.
+std::vector<std::uint32_t> plan_transient_aliasing( std::span<VkMemoryRequirements const>, std::span<RgLifetime const> aLifetimes );
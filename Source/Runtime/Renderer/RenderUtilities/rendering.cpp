@@ -6,320 +6,1191 @@
 #include "../../Rhi/to_string.hpp"
 #include "setup.hpp"	
 
+#include <bit>
+#include <span>
+#include <array>
+#include <future>
+#include <iterator>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-// multi-pass rendering
-// render scene to offscreen image
-// apply post processing and render to swapchain
-// function definition
-//Now change shadow map resolution in setup.hpp 
-
-void record_commands( VkCommandBuffer aCmdBuff, VkPipeline aGraphicsPipe, VkPipeline aAlphaPipe, ImageAndView const& aColorAttach, ImageAndView const& aDepthAttach, VkExtent2D const& aImageExtent, VkBuffer aSceneUBO, glsl::SceneUniform const& aSceneUniform, VkPipelineLayout aGraphicsLayout, VkDescriptorSet aSceneDescriptors, std::vector<lut::Buffer> const& aMeshPositions, std::vector<lut::Buffer> const& aMeshTexCoords, std::vector<lut::Buffer> const& aMeshNormals, std::vector<lut::Buffer> const& aMeshIndices, std::vector<EngineMesh> const& aMeshInfos, std::vector<EngineMaterial> const& aMaterials, std::vector<VkDescriptorSet> const& aMaterialDescriptors, std::vector<EngineInstance> const& aInstances,VkPipeline aPostProcPipe, VkDescriptorSet aPostProcDescriptors, VkPipelineLayout aPostProcLayout, ImageAndView const& aOffscreenColor, VkClearColorValue aClearColor, VkPipeline aShadowPipe, ImageAndView const& aShadowMap )
+namespace
 {
+	// set 0 (scene) and aSets after it; the scene set's dynamic bindings all sit
+	// in this frame's FrameRing region
+	void bind_scene_sets( VkCommandBuffer aCmdBuff, VkPipelineBindPoint aBindPoint, VkPipelineLayout aLayout, SceneDescriptors const& aScene, std::initializer_list<VkDescriptorSet> aSets )
+	{
+		VkDescriptorSet sets[4]{ aScene.set };
+		assert( aSets.size() < 4 );
+		std::copy( aSets.begin(), aSets.end(), sets + 1 );
 
-	// begin recording commands
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-	beginInfo.pInheritanceInfo = nullptr;
+		std::uint32_t const offsets[3] = { aScene.frameOffset, aScene.frameOffset, aScene.frameOffset }; // bindings 0, 4, 6
+		vkCmdBindDescriptorSets( aCmdBuff, aBindPoint, aLayout, 0, std::uint32_t(1 + aSets.size()), sets, 3, offsets );
+	}
 
-	if( auto const res = vkBeginCommandBuffer( aCmdBuff, &beginInfo ); VK_SUCCESS != res )
+	// GPU-driven path
+	// phase 0: reset the draw counters, run cull.comp over all instances and make
+	//          the compacted commands visible to the indirect draws of the shadow
+	//          pass and the first half of the main pass
+	// phase 1: occlusion test against the depth pyramid, commands for the
+	//          second half of the main pass (see cull.comp)
+	void record_gpu_cull( VkCommandBuffer aCmdBuff, SceneDescriptors const& aSceneDescriptors, IndirectDrawInfo const& aIndirect, std::uint32_t aPhase )
 	{
-		throw lut::Error( "Unable to begin recording command buffer\n"
-			"vkBeginCommandBuffer() returned {}", lut::to_string(res)
-		);
-	}
+		if( 0 == aPhase )
+		{
+			// previous frame's indirect draws may still read the counters/commands
+			lut::buffer_barrier( aCmdBuff, aIndirect.drawCounts,
+				VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT,
+				VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT
+			);
+
+			vkCmdFillBuffer( aCmdBuff, aIndirect.drawCounts, 0, VK_WHOLE_SIZE, 0 );
+
+			lut::buffer_barrier( aCmdBuff, aIndirect.drawCounts,
+				VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+			);
+
+			for( VkBuffer draws : { aIndirect.mainDraws, aIndirect.shadowDraws, aIndirect.pointDraws } )
+			{
+				lut::buffer_barrier( aCmdBuff, draws,
+					VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+					VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+				);
+			}
+
+			// written by phase 1 of the previous frame
+			lut::buffer_barrier( aCmdBuff, aIndirect.visibility,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+			);
+		}
+		else
+		{
+			lut::buffer_barrier( aCmdBuff, aIndirect.drawCounts,
+				VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+			);
+			lut::buffer_barrier( aCmdBuff, aIndirect.lateDraws,
+				VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+			);
+		}
+
+		vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aIndirect.cullPipe );
+
+		bind_scene_sets( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aIndirect.cullLayout, aSceneDescriptors, { aIndirect.cullDescriptors } );
+
+		glsl::CullPush push{};
+		push.instanceCount = aIndirect.instanceCount;
+		push.bucketCount = std::uint32_t(aIndirect.buckets.size());
+		push.phase = aPhase;
+		push.occlusion = aIndirect.occlusion ? 1 : 0;
+		push.pyramidSize = glm::vec2( float(aIndirect.pyramidWidth), float(aIndirect.pyramidHeight) );
+		push.pyramidLevels = float(aIndirect.pyramidLevels);
+		push.cascadeMask = aIndirect.cascadeMask;
+		push.pointShadow = aIndirect.pointShadow ? 1 : 0;
+		vkCmdPushConstants( aCmdBuff, aIndirect.cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push );
+
+		vkCmdDispatch( aCmdBuff, (aIndirect.instanceCount + 63) / 64, 1, 1 ); // local_size_x = 64
+
+		std::array<VkBuffer, 4> const earlyWritten{ aIndirect.mainDraws, aIndirect.shadowDraws, aIndirect.pointDraws, aIndirect.drawCounts };
+		std::array<VkBuffer, 2> const lateWritten{ aIndirect.lateDraws, aIndirect.drawCounts };
+		std::span<VkBuffer const> const written = 0 == aPhase
+			? std::span<VkBuffer const>( earlyWritten )
+			: std::span<VkBuffer const>( lateWritten );
+
+		for( VkBuffer buf : written )
+		{
+			lut::buffer_barrier( aCmdBuff, buf,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT
+			);
+		}
+
+		// occlusion statistics, read on the host once this frame slot's timeline value is reached
+		if( 1 == aPhase )
+		{
+			VkBufferCopy copy{ draw_count_stats_offset( aIndirect.buckets.size() ), 0, 2 * sizeof(std::uint32_t) };
+			vkCmdCopyBuffer( aCmdBuff, aIndirect.drawCounts, aIndirect.statsReadback, 1, &copy );
 
-	// Upload scene uniforms
-	lut::buffer_barrier( aCmdBuff, aSceneUBO, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT );
+			lut::buffer_barrier( aCmdBuff, aIndirect.statsReadback,
+				VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT
+			);
+		}
+	}
 
-	vkCmdUpdateBuffer( aCmdBuff, aSceneUBO, 0, sizeof(glsl::SceneUniform), &aSceneUniform );
+	// clustered lighting: light_cluster.comp rebuilds every cluster's list from
+	// this frame's lights (already in its FrameRing region); the previous frame's
+	// lighting may still read the lists
+	void record_light_binning( VkCommandBuffer aCmdBuff, SceneDescriptors const& aSceneDescriptors, LightClusters const& aClusters )
+	{
+		for( VkBuffer buf : { aClusters.clusterCounts, aClusters.clusterIndices } )
+		{
+			lut::buffer_barrier( aCmdBuff, buf,
+				VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT
+			);
+		}
 
-	lut::buffer_barrier( aCmdBuff, aSceneUBO, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT );
+		vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aClusters.binPipe );
+		bind_scene_sets( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aClusters.binLayout, aSceneDescriptors, {} );
+		vkCmdDispatch( aCmdBuff, (cfg::kClusterCount + cfg::kClusterGroupSize - 1) / cfg::kClusterGroupSize, 1, 1 );
 
+		for( VkBuffer buf : { aClusters.clusterCounts, aClusters.clusterIndices } )
+		{
+			lut::buffer_barrier( aCmdBuff, buf,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT
+			);
+		}
+	}
 
-	// p2_1.5 shadow pass
+	// Hi-Z: reduce the depth of the first main pass phase into the pyramid
+	void record_depth_pyramid( VkCommandBuffer aCmdBuff, VkImage aDepthImage, VkExtent2D const& aDepthExtent, IndirectDrawInfo const& aIndirect )
 	{
-		// transition shadow map to depth attachment
-		lut::image_barrier( aCmdBuff, aShadowMap.image,
-			VK_PIPELINE_STAGE_2_NONE,
-			VK_ACCESS_2_NONE,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT,
+		lut::image_barrier( aCmdBuff, aDepthImage,
+			VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
 			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-			VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
 			VkImageSubresourceRange{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 }
 		);
 
+		// contents are rebuilt every frame; previous reads by cull.comp must finish first
+		lut::image_barrier( aCmdBuff, aIndirect.pyramidImage,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, aIndirect.pyramidLevels, 0, 1 }
+		);
 
-		VkRenderingAttachmentInfo shadowDepthInfo{};
-		shadowDepthInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-		shadowDepthInfo.imageView = aShadowMap.view;
-		shadowDepthInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
-		shadowDepthInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		shadowDepthInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		shadowDepthInfo.clearValue.depthStencil = { 1.f, 0 };
+		vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aIndirect.reducePipe );
 
-		VkRenderingInfo shadowRenderInfo{};
-		shadowRenderInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
-		shadowRenderInfo.renderArea.offset = { 0, 0 };
-		shadowRenderInfo.renderArea.extent = { kShadowMapResolution, kShadowMapResolution }; // shadow map resolution
-		shadowRenderInfo.layerCount = 1;
-		shadowRenderInfo.colorAttachmentCount = 0;
-		shadowRenderInfo.pDepthAttachment = &shadowDepthInfo;
+		glm::uvec2 srcSize( aDepthExtent.width, aDepthExtent.height );
+		for( std::uint32_t level = 0; level < aIndirect.pyramidLevels; ++level )
+		{
+			glm::uvec2 const dstSize(
+				std::max( aIndirect.pyramidWidth >> level, 1u ),
+				std::max( aIndirect.pyramidHeight >> level, 1u )
+			);
 
-		vkCmdBeginRendering( aCmdBuff, &shadowRenderInfo );
+			vkCmdBindDescriptorSets( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aIndirect.reduceLayout, 0, 1, &aIndirect.reduceDescriptors[level], 0, nullptr );
+
+			glsl::DepthReducePush push{ srcSize, dstSize };
+			vkCmdPushConstants( aCmdBuff, aIndirect.reduceLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push );
+
+			vkCmdDispatch( aCmdBuff, (dstSize.x + 7) / 8, (dstSize.y + 7) / 8, 1 ); // local_size 8x8
+
+			// the next level reads this one; after the last level cull.comp samples all of them
+			lut::image_barrier( aCmdBuff, aIndirect.pyramidImage,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+				VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+				VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 }
+			);
+
+			srcSize = dstSize;
+		}
+
+		lut::image_barrier( aCmdBuff, aDepthImage,
+			VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VkImageSubresourceRange{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 }
+		);
+	}
+
+	// one indirect draw per pipeline bucket (task 1.6); materials are bindless
+	void record_indirect_draws( VkCommandBuffer aCmdBuff, IndirectDrawInfo const& aIndirect, VkBuffer aDraws, std::uint32_t aCountBase, VkPipeline& aCurrentPipeline )
+	{
+		for( std::uint32_t b = 0; b < std::uint32_t(aIndirect.buckets.size()); ++b )
+		{
+			auto const& bucket = aIndirect.buckets[b];
+
+			VkPipeline const targetPipeline = bucket.alphaMask ? aIndirect.alphaPipe : aIndirect.opaquePipe;
 
+			if( targetPipeline != aCurrentPipeline )
+			{
+				vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, targetPipeline );
+				aCurrentPipeline = targetPipeline;
+			}
+
+			vkCmdDrawIndexedIndirectCount( aCmdBuff,
+				aDraws, bucket.drawBase * sizeof(VkDrawIndexedIndirectCommand),
+				aIndirect.drawCounts, (aCountBase + b) * sizeof(std::uint32_t),
+				bucket.maxDraws, sizeof(VkDrawIndexedIndirectCommand)
+			);
+		}
+	}
+
+	// dynamic state and bindings of the shadow pass; every secondary command buffer
+	// starts without state, so the workers record this again
+	void bind_shadow_state( VkCommandBuffer aCmdBuff, VkPipeline aShadowPipe, std::uint32_t aResolution, VkPipelineLayout aGraphicsLayout, SceneDescriptors const& aSceneDescriptors, VkDescriptorSet aMaterialDescriptors, VkBuffer aPositions, VkBuffer aTexCoords, VkBuffer aIndices )
+	{
 		vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aShadowPipe );
 		
 		VkViewport viewport{};
-		viewport.width = float(kShadowMapResolution);
-		viewport.height = float(kShadowMapResolution);
+		viewport.width = float(aResolution);
+		viewport.height = float(aResolution);
 		viewport.minDepth = 0.f;
 		viewport.maxDepth = 1.f;
 		vkCmdSetViewport( aCmdBuff, 0, 1, &viewport );
 
 		VkRect2D scissor{};
-		scissor.extent = { kShadowMapResolution, kShadowMapResolution };
+		scissor.extent = { aResolution, aResolution };
 		vkCmdSetScissor( aCmdBuff, 0, 1, &scissor );
 
 		vkCmdSetDepthBias( aCmdBuff, 1.25f, 0.f, 1.75f ); // bias
 
-		// bind uniforms (set 0); light matrix
-		vkCmdBindDescriptorSets( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsLayout, 0, 1, &aSceneDescriptors, 0, nullptr );
+		// bind uniforms (set 0); cascade matrices
+		// bindless materials (set 1) for alpha masking
+		bind_scene_sets( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsLayout, aSceneDescriptors, { aMaterialDescriptors } );
+
+		// bind vertex and index buffers (merged, shared by all meshes)
+		// shadow pipeline only has bindings 0 (pos) and 1 (uv), the opaque one only 0
+		VkBuffer const vertexBuffers[2] = { aPositions, aTexCoords };
+		VkDeviceSize const vertexOffsets[2] = { 0, 0 };
+		vkCmdBindVertexBuffers( aCmdBuff, 0, 2, vertexBuffers, vertexOffsets );
+		vkCmdBindIndexBuffer( aCmdBuff, aIndices, 0, VK_INDEX_TYPE_UINT32 );
+	}
+
+	// as above, for the main pass; starts with the opaque pipeline bound
+	void bind_scene_state( VkCommandBuffer aCmdBuff, VkPipeline aGraphicsPipe, VkPipelineLayout aGraphicsLayout, SceneDescriptors const& aSceneDescriptors, VkDescriptorSet aMaterialDescriptors, VkExtent2D const& aImageExtent, VkBuffer aPositions, VkBuffer aTexCoords, VkBuffer aNormals, VkBuffer aIndices )
+	{
+		vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipe );
+
+		bind_scene_sets( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsLayout, aSceneDescriptors, { aMaterialDescriptors } );
+
+		VkViewport viewport{};
+		viewport.x = 0.f;
+		viewport.y = 0.f;
+		viewport.width = float(aImageExtent.width);
+		viewport.height = float(aImageExtent.height);
+		viewport.minDepth = 0.f;
+		viewport.maxDepth = 1.f;
+		vkCmdSetViewport( aCmdBuff, 0, 1, &viewport );
+
+		VkRect2D scissor{};
+		scissor.offset = { 0, 0 };
+		scissor.extent = aImageExtent;
+		vkCmdSetScissor( aCmdBuff, 0, 1, &scissor );
+
+		VkBuffer const vertexBuffers[3] = { aPositions, aTexCoords, aNormals };
+		VkDeviceSize const vertexOffsets[3] = { 0, 0, 0 };
+		vkCmdBindVertexBuffers( aCmdBuff, 0, 3, vertexBuffers, vertexOffsets );
+		vkCmdBindIndexBuffer( aCmdBuff, aIndices, 0, VK_INDEX_TYPE_UINT32 );
+	}
 
-		VkDeviceSize kZeroOffset = 0;
+	// depth passes: position only pipeline unless the material is alpha masked
+	void select_depth_pipeline( VkCommandBuffer aCmdBuff, std::vector<EngineMaterial> const& aMaterials, std::uint32_t aMaterialIndex, VkPipeline aOpaquePipe, VkPipeline aAlphaPipe, VkPipeline& aCurrentPipeline )
+	{
+		VkPipeline const target = aMaterialIndex < aMaterials.size() && aMaterials[aMaterialIndex].alphaMaskTexture >= 0 ? aAlphaPipe : aOpaquePipe;
+		if( target != aCurrentPipeline )
+		{
+			vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, target );
+			aCurrentPipeline = target;
+		}
+	}
 
-		for (const auto& instance : aInstances)
+	// CPU path: shadow pass draws of instances [aBegin, aEnd) into cascade aCascade
+	void record_shadow_instances( VkCommandBuffer aCmdBuff, VkPipelineLayout aGraphicsLayout, VkPipeline aOpaquePipe, VkPipeline aAlphaPipe, VkPipeline& aCurrentPipeline, std::uint32_t aCascade, std::vector<MeshDrawRange> const& aMeshRanges, std::vector<EngineMesh> const& aMeshInfos, std::vector<EngineMaterial> const& aMaterials, std::vector<EngineInstance> const& aInstances, std::span<std::uint8_t const> aVisible, std::size_t aBegin, std::size_t aEnd )
+	{
+		for (std::size_t i = aBegin; i < aEnd; ++i)
 		{
+			if (!aVisible.empty() && !aVisible[i])
+				continue;
+
+			auto const& instance = aInstances[i];
 			uint32_t meshIdx = instance.meshIndex;
 
-			// push the model matrix and bind vertex/index buffers
+			// push the model matrix, the material index (bindless set 1) and the cascade
+			uint32_t matIdx = aMeshInfos[meshIdx].materialIndex;
+			select_depth_pipeline( aCmdBuff, aMaterials, matIdx, aOpaquePipe, aAlphaPipe, aCurrentPipeline );
+			glsl::DrawPush const push{ instance.transform, matIdx < aMaterials.size() ? matIdx : 0, aCascade };
 			vkCmdPushConstants(
 				aCmdBuff,
 				aGraphicsLayout,
 				VK_SHADER_STAGE_VERTEX_BIT,
 				0,
-				sizeof(glm::mat4),
-				&instance.transform 
+				sizeof(push),
+				&push 
 			);
 
-			// bind material descriptor set (set 1), which contains the texture index for this mesh
-			uint32_t matIdx = aMeshInfos[meshIdx].materialIndex;
-			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsLayout, 1, 1, &aMaterialDescriptors[matIdx], 0, nullptr);
+			auto const& range = aMeshRanges[meshIdx];
+			vkCmdDrawIndexed(aCmdBuff, range.indexCount, 1, range.firstIndex, range.vertexOffset, 0);
+		}
+	}
+
+	// CPU path: point light shadow draws, one instance per cube face in
+	// aFaceMasks[i] & aFaceFilter (pointshadow.vert maps instances to faces)
+	void record_point_shadow_instances( VkCommandBuffer aCmdBuff, VkPipelineLayout aGraphicsLayout, VkPipeline aOpaquePipe, VkPipeline aAlphaPipe, VkPipeline& aCurrentPipeline, std::uint32_t aFaceFilter, std::vector<MeshDrawRange> const& aMeshRanges, std::vector<EngineMesh> const& aMeshInfos, std::vector<EngineMaterial> const& aMaterials, std::vector<EngineInstance> const& aInstances, std::span<std::uint8_t const> aFaceMasks )
+	{
+		for( std::size_t i = 0; i < aInstances.size(); ++i )
+		{
+			std::uint32_t const faces = aFaceMasks[i] & aFaceFilter;
+			if( 0 == faces )
+				continue;
+
+			auto const& instance = aInstances[i];
+			std::uint32_t const meshIdx = instance.meshIndex;
+			std::uint32_t const matIdx = aMeshInfos[meshIdx].materialIndex;
+			select_depth_pipeline( aCmdBuff, aMaterials, matIdx, aOpaquePipe, aAlphaPipe, aCurrentPipeline );
+
+			glsl::DrawPush const push{ instance.transform, matIdx < aMaterials.size() ? matIdx : 0, 0, faces };
+			vkCmdPushConstants( aCmdBuff, aGraphicsLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(push), &push );
+
+			auto const& range = aMeshRanges[meshIdx];
+			vkCmdDrawIndexed( aCmdBuff, range.indexCount, std::uint32_t(std::popcount( faces )), range.firstIndex, range.vertexOffset, 0 );
+		}
+	}
+
+	// CPU path: main pass draws of instances [aBegin, aEnd)
+	void record_scene_instances( VkCommandBuffer aCmdBuff, VkPipelineLayout aGraphicsLayout, VkPipeline aGraphicsPipe, VkPipeline aAlphaPipe, VkPipeline& aCurrentPipeline, std::vector<MeshDrawRange> const& aMeshRanges, std::vector<EngineMesh> const& aMeshInfos, std::vector<EngineMaterial> const& aMaterials, std::vector<EngineInstance> const& aInstances, std::span<std::uint8_t const> aVisible, std::size_t aBegin, std::size_t aEnd )
+	{
+		for (std::size_t i = aBegin; i < aEnd; ++i)
+		{
+			if (!aVisible.empty() && !aVisible[i])
+				continue;
+
+			auto const& instance = aInstances[i];
+			uint32_t meshIdx = instance.meshIndex;
+			auto const& meshInfo = aMeshInfos[meshIdx];
+
+			glsl::DrawPush const push{ instance.transform, meshInfo.materialIndex < aMaterials.size() ? meshInfo.materialIndex : 0, 0, 0, std::uint32_t(i) };
+			vkCmdPushConstants(
+				aCmdBuff,
+				aGraphicsLayout,
+				VK_SHADER_STAGE_VERTEX_BIT,
+				0,
+				sizeof(push),
+				&push
+			);
+
+
+			// task 1.6: select pipeline based on material
+			VkPipeline targetPipeline = aGraphicsPipe;
+			if (meshInfo.materialIndex < aMaterials.size() && aMaterials[meshInfo.materialIndex].alphaMaskTexture >= 0)
+			{
+				targetPipeline = aAlphaPipe;
+			}
+
+			if( targetPipeline != aCurrentPipeline )
+			{
+				vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, targetPipeline );
+				aCurrentPipeline = targetPipeline;
+			}
+
+			auto const& range = aMeshRanges[meshIdx];
+			vkCmdDrawIndexed( aCmdBuff, range.indexCount, 1, range.firstIndex, range.vertexOffset, 0 );
+		}
+	}
+
+	// depth-only render pass instance on one layer of a shadow map, or on aLayers
+	// layers for layered rendering (gl_Layer)
+	void begin_shadow_pass( VkCommandBuffer aCmdBuff, VkImageView aTarget, std::uint32_t aResolution, VkAttachmentLoadOp aLoadOp, bool aSecondaries, std::uint32_t aLayers = 1 )
+	{
+		VkRenderingAttachmentInfo shadowDepthInfo{};
+		shadowDepthInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		shadowDepthInfo.imageView = aTarget;
+		shadowDepthInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+		shadowDepthInfo.loadOp = aLoadOp;
+		shadowDepthInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		shadowDepthInfo.clearValue.depthStencil = { 1.f, 0 };
+
+		VkRenderingInfo shadowRenderInfo{};
+		shadowRenderInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		shadowRenderInfo.renderArea.offset = { 0, 0 };
+		shadowRenderInfo.renderArea.extent = { aResolution, aResolution }; // shadow map resolution
+		shadowRenderInfo.layerCount = aLayers;
+		shadowRenderInfo.colorAttachmentCount = 0;
+		shadowRenderInfo.pDepthAttachment = &shadowDepthInfo;
+
+		// draws come from the workers' secondaries when the CPU path records in parallel
+		if( aSecondaries )
+			shadowRenderInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+
+		vkCmdBeginRendering( aCmdBuff, &shadowRenderInfo );
+	}
+
+	// GPU-driven shadow draws of the static or the dynamic caster buckets of one
+	// cascade; commands and counters per cascade, see cull.comp
+	void record_indirect_shadow_draws( VkCommandBuffer aCmdBuff, IndirectDrawInfo const& aIndirect, VkPipelineLayout aGraphicsLayout, std::uint32_t aCascade, bool aDynamic, VkPipeline& aCurrentPipeline )
+	{
+		// the model matrix and the material come from the instance buffer
+		vkCmdPushConstants( aCmdBuff, aGraphicsLayout, VK_SHADER_STAGE_VERTEX_BIT,
+			offsetof(glsl::DrawPush, cascade), sizeof(std::uint32_t), &aCascade );
+
+		auto const bucketCount = std::uint32_t(aIndirect.buckets.size());
+		std::uint32_t const countBase = shadow_count_base( bucketCount, aCascade );
+		for( std::uint32_t b = 0; b < bucketCount; ++b )
+		{
+			auto const& bucket = aIndirect.buckets[b];
+			if( (0 != bucket.dynamic) != aDynamic )
+				continue;
+
+			VkPipeline const targetPipeline = bucket.alphaMask ? aIndirect.shadowPipe : aIndirect.shadowOpaquePipe;
+			if( targetPipeline != aCurrentPipeline )
+			{
+				vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, targetPipeline );
+				aCurrentPipeline = targetPipeline;
+			}
+
+			VkDeviceSize const first = VkDeviceSize(aCascade) * aIndirect.instanceCount + bucket.drawBase;
+			vkCmdDrawIndexedIndirectCount( aCmdBuff,
+				aIndirect.shadowDraws, first * sizeof(VkDrawIndexedIndirectCommand),
+				aIndirect.drawCounts, (countBase + b) * sizeof(std::uint32_t),
+				bucket.maxDraws, sizeof(VkDrawIndexedIndirectCommand)
+			);
+		}
+	}
 
-			// bind vertex and index buffersw
-			vkCmdBindVertexBuffers(aCmdBuff, 0, 1, &aMeshPositions[meshIdx].buffer, &kZeroOffset);
-			vkCmdBindVertexBuffers(aCmdBuff, 1, 1, &aMeshTexCoords[meshIdx].buffer, &kZeroOffset);
-			vkCmdBindVertexBuffers(aCmdBuff, 2, 1, &aMeshNormals[meshIdx].buffer, &kZeroOffset);
+	// secondaries continue a render pass instance begun by the primary;
+	// aStatistics: counters of the pipeline statistics query active in it
+	void begin_secondary( VkCommandBuffer aCmdBuff, VkCommandBufferInheritanceRenderingInfo const& aRendering, bool aReusable, VkQueryPipelineStatisticFlags aStatistics = 0 )
+	{
+		VkCommandBufferInheritanceInfo inheritance{};
+		inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance.pNext = &aRendering;
+		inheritance.pipelineStatistics = aStatistics;
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		if( !aReusable )
+			beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = &inheritance;
+
+		if( auto const res = vkBeginCommandBuffer( aCmdBuff, &beginInfo ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to begin recording secondary command buffer\n"
+				"vkBeginCommandBuffer() returned {}", lut::to_string(res)
+			);
+		}
+	}
+
+	void end_secondary( VkCommandBuffer aCmdBuff )
+	{
+		if( auto const res = vkEndCommandBuffer( aCmdBuff ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to end recording secondary command buffer\n"
+				"vkEndCommandBuffer() returned {}", lut::to_string(res)
+			);
+		}
+	}
+}
+
+// multi-pass rendering
+// render scene to offscreen image
+// apply post processing and render to swapchain
+// function definition
+//Now change shadow map resolution in setup.hpp 
+
+void record_commands( VkCommandBuffer aCmdBuff, VkPipeline aGraphicsPipe, VkPipeline aAlphaPipe, ImageAndView const& aColorAttach, ImageAndView const& aDepthAttach, VkExtent2D const& aImageExtent, VkExtent2D const& aRenderExtent, VkPipelineLayout aGraphicsLayout, SceneDescriptors const& aSceneDescriptors, VkBuffer aPositions, VkBuffer aTexCoords, VkBuffer aNormals, VkBuffer aIndices, std::vector<MeshDrawRange> const& aMeshRanges, std::vector<EngineMesh> const& aMeshInfos, std::vector<EngineMaterial> const& aMaterials, VkDescriptorSet aMaterialDescriptors, std::vector<EngineInstance> const& aInstances,VkPipeline aPostProcPipe, VkDescriptorSet aPostProcDescriptors, VkPipelineLayout aPostProcLayout, ImageAndView const& aOffscreenColor, VkClearColorValue aClearColor, VkPipeline aShadowPipe, std::span<std::uint8_t const> aMainVisible, ShadowPass const& aShadow, IndirectDrawInfo const* aIndirect, SecondaryDrawLists const* aSecondary, DepthPrepass const* aPrepass, LightClusters const* aClusters, VisBufferPass const* aVisBuffer, ComputePostPass const* aComputePost, lut::GpuProfiler* aProfiler, RenderGraphStats* aGraphStats )
+{
+
+	// begin recording commands
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = nullptr;
+
+	if( auto const res = vkBeginCommandBuffer( aCmdBuff, &beginInfo ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to begin recording command buffer\n"
+			"vkBeginCommandBuffer() returned {}", lut::to_string(res)
+		);
+	}
+
+	if( aProfiler )
+	{
+		aProfiler->reset( aCmdBuff );
+		aProfiler->begin( aCmdBuff, "frame" );
+	}
+
+	// scene uniforms, spot and clustered lights are already in the frame's
+	// FrameRing region (aSceneDescriptors.frameOffset), nothing to upload
+
+	// clustered lighting: light lists of this frame, read by the main pass
+	if( aClusters && aClusters->lightCount > 0 )
+	{
+		lut::GpuProfiler::Scope const scope( aProfiler, aCmdBuff, "light binning" );
+		record_light_binning( aCmdBuff, aSceneDescriptors, *aClusters );
+	}
+
+	bool const prepass = aPrepass && aPrepass->enabled;
+	VkQueryPool const statistics = aPrepass ? aPrepass->statistics : VK_NULL_HANDLE;
+	if( statistics )
+		vkCmdResetQueryPool( aCmdBuff, statistics, aPrepass->firstQuery, 2 );
+
+	// GPU-driven path: cull instances and build the draw lists for both passes
+	if( aIndirect )
+	{
+		lut::GpuProfiler::Scope const scope( aProfiler, aCmdBuff, "gpu cull" );
+		record_gpu_cull( aCmdBuff, aSceneDescriptors, *aIndirect, 0 );
+	}
+
+	// p2_1.5 shadow pass, one render pass instance (or two) per cascade
+	// static casters go to the cache only when it is refreshed; dynamic casters
+	// are drawn over a copy of it whenever the cascade updates (see ShadowPass)
+	if( aProfiler )
+		aProfiler->begin( aCmdBuff, "shadows" );
+
+	// the sampled view covers every layer, unused ones must be in its layout too
+	if( aShadow.discard && aShadow.cascadeCount < cfg::kMaxShadowCascades )
+	{
+		lut::image_barrier( aCmdBuff, aShadow.shadowImage,
+			VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
+			VK_ACCESS_2_NONE,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+			VkImageSubresourceRange{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, aShadow.cascadeCount, cfg::kMaxShadowCascades - aShadow.cascadeCount }
+		);
+	}
+
+	// secondaries of one cascade, in worker order
+	std::vector<VkCommandBuffer> cascadeSecondaries;
+	auto const executed = [&] (std::size_t aWorker, std::uint32_t aBit) {
+		return aSecondary->executed.empty() || 0 != (aSecondary->executed[aWorker] & aBit);
+	};
+
+	for( std::uint32_t c = 0; c < aShadow.cascadeCount; ++c )
+	{
+		bool const refresh = 0 != (aShadow.refreshMask & (1u << c));
+		bool const dynamic = aShadow.dynamic && 0 != (aShadow.updateMask & (1u << c));
+		if( !refresh && !dynamic )
+			continue;
+
+		static char const* const kCascadeScopes[] = { "cascade 0", "cascade 1", "cascade 2", "cascade 3" };
+		static_assert( std::size(kCascadeScopes) == cfg::kMaxShadowCascades );
+		lut::GpuProfiler::Scope const scope( aProfiler, aCmdBuff, kCascadeScopes[c] );
+
+		VkImageSubresourceRange const layer{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, c, 1 };
+
+		if( refresh )
+		{
+			// discard the old contents; previous frames may still sample or copy them
+			lut::image_barrier( aCmdBuff, aShadow.staticImage,
+				VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT,
+				VK_ACCESS_2_NONE,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+				layer
+			);
+
+			begin_shadow_pass( aCmdBuff, aShadow.staticLayers[c], aShadow.resolution, VK_ATTACHMENT_LOAD_OP_CLEAR, nullptr != aSecondary );
+
+			if( aSecondary )
+			{
+				assert( 0 != (aSecondary->shadowMask & (1u << c)) );
+
+				cascadeSecondaries.clear();
+				for( std::size_t t = 0; t < aSecondary->main.size(); ++t )
+				{
+					if( executed( t, 2u << c ) )
+						cascadeSecondaries.emplace_back( aSecondary->shadow[t * cfg::kMaxShadowCascades + c] );
+				}
+
+				if( !cascadeSecondaries.empty() )
+					vkCmdExecuteCommands( aCmdBuff, std::uint32_t(cascadeSecondaries.size()), cascadeSecondaries.data() );
+			}
+			else if( aIndirect )
+			{
+				bind_shadow_state( aCmdBuff, aIndirect->shadowOpaquePipe, aShadow.resolution, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aPositions, aTexCoords, aIndices );
+
+				VkPipeline currentPipeline = aIndirect->shadowOpaquePipe;
+				record_indirect_shadow_draws( aCmdBuff, *aIndirect, aGraphicsLayout, c, false, currentPipeline );
+			}
+			else
+			{
+				bind_shadow_state( aCmdBuff, aShadow.opaquePipe, aShadow.resolution, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aPositions, aTexCoords, aIndices );
+
+				VkPipeline currentPipeline = aShadow.opaquePipe;
+				record_shadow_instances( aCmdBuff, aGraphicsLayout, aShadow.opaquePipe, aShadowPipe, currentPipeline, c, aMeshRanges, aMeshInfos, aMaterials, aInstances, aShadow.staticVisible[c], 0, aInstances.size() );
+			}
+
+			vkCmdEndRendering( aCmdBuff );
+
+			// without dynamic casters the cache is the shadow map
+			bool const copied = aShadow.dynamic;
+			lut::image_barrier( aCmdBuff, aShadow.staticImage,
+				VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+				copied ? VK_PIPELINE_STAGE_2_COPY_BIT : VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+				copied ? VK_ACCESS_2_TRANSFER_READ_BIT : VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+				copied ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+				layer
+			);
+		}
+
+		if( dynamic )
+		{
+			// restore the static depth
+			lut::image_barrier( aCmdBuff, aShadow.shadowImage,
+				VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+				VK_ACCESS_2_NONE,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_PIPELINE_STAGE_2_COPY_BIT,
+				VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				layer
+			);
+
+			VkImageCopy copy{};
+			copy.srcSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, c, 1 };
+			copy.dstSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, c, 1 };
+			copy.extent = VkExtent3D{ aShadow.resolution, aShadow.resolution, 1 };
+			vkCmdCopyImage( aCmdBuff,
+				aShadow.staticImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				aShadow.shadowImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &copy
+			);
+
+			lut::image_barrier( aCmdBuff, aShadow.shadowImage,
+				VK_PIPELINE_STAGE_2_COPY_BIT,
+				VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+				layer
+			);
+
+			// dynamic casters are few, always recorded inline
+			begin_shadow_pass( aCmdBuff, aShadow.shadowLayers[c], aShadow.resolution, VK_ATTACHMENT_LOAD_OP_LOAD, false );
+
+			if( aIndirect )
+			{
+				bind_shadow_state( aCmdBuff, aIndirect->shadowOpaquePipe, aShadow.resolution, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aPositions, aTexCoords, aIndices );
+
+				VkPipeline currentPipeline = aIndirect->shadowOpaquePipe;
+				record_indirect_shadow_draws( aCmdBuff, *aIndirect, aGraphicsLayout, c, true, currentPipeline );
+			}
+			else
+			{
+				bind_shadow_state( aCmdBuff, aShadow.opaquePipe, aShadow.resolution, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aPositions, aTexCoords, aIndices );
+
+				VkPipeline currentPipeline = aShadow.opaquePipe;
+				record_shadow_instances( aCmdBuff, aGraphicsLayout, aShadow.opaquePipe, aShadowPipe, currentPipeline, c, aMeshRanges, aMeshInfos, aMaterials, aInstances, aShadow.dynamicVisible[c], 0, aInstances.size() );
+			}
+
+			vkCmdEndRendering( aCmdBuff );
+
+			lut::image_barrier( aCmdBuff, aShadow.shadowImage,
+				VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+				VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+				VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+				VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+				layer
+			);
+		}
+	}
+
+	// point light cube shadow map: one layered render pass instance, every draw
+	// carries the cube faces it covers (see shadows.hpp). Mode 2 renders one
+	// render pass instance per face view with only that face's casters, which
+	// needs no gl_Layer (the GPU-driven path renders the layered pass when it
+	// culls the point draws).
+	VkImageSubresourceRange const cubeFaces{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 6 };
+	if( 0 != aShadow.pointFaces )
+	{
+		lut::GpuProfiler::Scope const scope( aProfiler, aCmdBuff, "point shadow" );
+
+		// re-rendered every frame; the previous frame may still sample it
+		lut::image_barrier( aCmdBuff, aShadow.pointImage,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_2_NONE,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+			cubeFaces
+		);
 
-			vkCmdBindIndexBuffer(aCmdBuff, aMeshIndices[meshIdx].buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(aCmdBuff, aMeshInfos[meshIdx].indices.size(), 1, 0, 0, 0);
+		if( 2 == aShadow.pointFaces && !(aIndirect && aIndirect->pointShadow) )
+		{
+			// the faces are separate layers, no barriers between the passes
+			for( std::uint32_t f = 0; f < 6; ++f )
+			{
+				begin_shadow_pass( aCmdBuff, aShadow.pointFaceTargets[f], aShadow.pointResolution, VK_ATTACHMENT_LOAD_OP_CLEAR, false );
+				bind_shadow_state( aCmdBuff, aShadow.pointFaceOpaquePipe, aShadow.pointResolution, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aPositions, aTexCoords, aIndices );
+
+				VkPipeline currentPipeline = aShadow.pointFaceOpaquePipe;
+				record_point_shadow_instances( aCmdBuff, aGraphicsLayout, aShadow.pointFaceOpaquePipe, aShadow.pointFacePipe, currentPipeline, 1u << f, aMeshRanges, aMeshInfos, aMaterials, aInstances, aShadow.pointFaceMasks );
+
+				vkCmdEndRendering( aCmdBuff );
+			}
+		}
+		else
+		{
+			begin_shadow_pass( aCmdBuff, aShadow.pointTarget, aShadow.pointResolution, VK_ATTACHMENT_LOAD_OP_CLEAR, false, 6 );
+
+			if( aIndirect )
+			{
+				bind_shadow_state( aCmdBuff, aIndirect->pointShadowPipe, aShadow.pointResolution, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aPositions, aTexCoords, aIndices );
+				vkCmdDrawIndexedIndirectCount( aCmdBuff,
+					aIndirect->pointDraws, 0,
+					aIndirect->drawCounts, point_shadow_count_index( aIndirect->buckets.size() ) * sizeof(std::uint32_t),
+					6 * aIndirect->instanceCount, sizeof(VkDrawIndexedIndirectCommand)
+				);
+			}
+			else
+			{
+				bind_shadow_state( aCmdBuff, aShadow.pointOpaquePipe, aShadow.pointResolution, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aPositions, aTexCoords, aIndices );
+
+				VkPipeline currentPipeline = aShadow.pointOpaquePipe;
+				record_point_shadow_instances( aCmdBuff, aGraphicsLayout, aShadow.pointOpaquePipe, aShadow.pointPipe, currentPipeline, 0x3fu, aMeshRanges, aMeshInfos, aMaterials, aInstances, aShadow.pointFaceMasks );
+			}
+
+			vkCmdEndRendering( aCmdBuff );
+		}
+
+		lut::image_barrier( aCmdBuff, aShadow.pointImage,
+			VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+			cubeFaces
+		);
+	}
+	else if( aShadow.pointDiscard )
+	{
+		// not rendered yet, but bound to the main pass in its sampled layout
+		lut::image_barrier( aCmdBuff, aShadow.pointImage,
+			VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
+			VK_ACCESS_2_NONE,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+			cubeFaces
+		);
+	}
+
+	// spot light shadow atlas: the due tiles in one render pass instance over the
+	// whole atlas, which keeps the other tiles (LOAD); each tile is cleared and
+	// drawn through its own viewport and scissor (see shadow_atlas.hpp)
+	VkImageSubresourceRange const atlasRange{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+	if( !aShadow.atlasUpdates.empty() )
+	{
+		lut::GpuProfiler::Scope const scope( aProfiler, aCmdBuff, "shadow atlas" );
+
+		lut::image_barrier( aCmdBuff, aShadow.atlasImage,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_2_NONE,
+			aShadow.atlasDiscard ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+			atlasRange
+		);
+
+		begin_shadow_pass( aCmdBuff, aShadow.atlasView, aShadow.atlasSize,
+			aShadow.atlasDiscard ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD, false );
+
+		bind_shadow_state( aCmdBuff, aShadow.atlasOpaquePipe, aShadow.atlasSize, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aPositions, aTexCoords, aIndices );
+
+		VkPipeline currentPipeline = aShadow.atlasOpaquePipe;
+
+		for( auto const& update : aShadow.atlasUpdates )
+		{
+			auto const& tile = update.tile;
+
+			VkViewport viewport{};
+			viewport.x = float(tile.x);
+			viewport.y = float(tile.y);
+			viewport.width = float(tile.size);
+			viewport.height = float(tile.size);
+			viewport.minDepth = 0.f;
+			viewport.maxDepth = 1.f;
+			vkCmdSetViewport( aCmdBuff, 0, 1, &viewport );
+
+			VkRect2D const rect{ { std::int32_t(tile.x), std::int32_t(tile.y) }, { tile.size, tile.size } };
+			vkCmdSetScissor( aCmdBuff, 0, 1, &rect );
+
+			VkClearAttachment clear{};
+			clear.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+			clear.clearValue.depthStencil = { 1.f, 0 };
+			VkClearRect const clearRect{ rect, 0, 1 };
+			vkCmdClearAttachments( aCmdBuff, 1, &clear, 1, &clearRect );
+
+			// the cascade push constant selects the light in spotshadow.vert
+			record_shadow_instances( aCmdBuff, aGraphicsLayout, aShadow.atlasOpaquePipe, aShadow.atlasPipe, currentPipeline, update.light, aMeshRanges, aMeshInfos, aMaterials, aInstances, aShadow.spotVisible[update.light], 0, aInstances.size() );
 		}
 
 		vkCmdEndRendering( aCmdBuff );
 
-		
-		// transition shadow map to shader read
-		lut::image_barrier( aCmdBuff, aShadowMap.image,
+		lut::image_barrier( aCmdBuff, aShadow.atlasImage,
 			VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
 			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
 			VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
 			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
-			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, 
-			VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL, 
-			VkImageSubresourceRange{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 }
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+			atlasRange
+		);
+	}
+	else if( aShadow.atlasDiscard )
+	{
+		// no tile rendered yet, but bound to the main pass in its sampled layout
+		lut::image_barrier( aCmdBuff, aShadow.atlasImage,
+			VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
+			VK_ACCESS_2_NONE,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_OPTIMAL,
+			atlasRange
 		);
 	}
 
+	if( aProfiler )
+		aProfiler->end( aCmdBuff ); // shadows
 
 	// render scene to offscreen image
+	bool const visbuffer = aVisBuffer && aVisBuffer->enabled;
 
-	// transition offscreen image to color attachment optimal
-	lut::image_barrier( aCmdBuff, aOffscreenColor.image,
-		VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
-		VK_ACCESS_2_NONE,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
-	);
+	bool const computePost = aComputePost && aComputePost->enabled;
 
-	// transition depth buffer to depth attachment optimal
-	lut::image_barrier( aCmdBuff, aDepthAttach.image,
-		VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
-		VK_ACCESS_2_NONE,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
-		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-		VkImageSubresourceRange{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 }
-	);
+	// from here on the attachments go through the frame graph, see
+	// declare_frame_graph(); these record its passes
+	FrameGraphRecorders recorders;
 
-	// begin dynamic rendering for scene pass
-	VkRenderingAttachmentInfo colorAttachment{};
-	colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-	colorAttachment.imageView = aOffscreenColor.view; // target offscreen
-	colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.clearValue.color = aClearColor;
-	// colorAttachment.clearValue.color = { 0.1f, 0.1f, 0.1f, 1.f }; // Clear to black; not balck
-
-	VkRenderingAttachmentInfo depthAttachment{};
-	depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-	depthAttachment.imageView = aDepthAttach.view;
-	depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	depthAttachment.clearValue.depthStencil = { 1.f, 0 };
-
-	VkRenderingInfo renderInfo{};
-	renderInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
-	renderInfo.renderArea.offset = { 0, 0 };
-	renderInfo.renderArea.extent = aImageExtent;
-	renderInfo.layerCount = 1;
-	renderInfo.colorAttachmentCount = 1;
-	renderInfo.pColorAttachments = &colorAttachment;
-	renderInfo.pDepthAttachment = &depthAttachment;
-
-	vkCmdBeginRendering( aCmdBuff, &renderInfo );
-
-
-	// Bind pipeline
-	// Bind opaque pipeline initially
-	vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipe );
-	vkCmdBindDescriptorSets( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsLayout, 0, 1, &aSceneDescriptors, 0, nullptr );
-
-	// Set viewport/scissor
-	VkViewport viewport{};
-	viewport.x = 0.f;
-	viewport.y = 0.f;
-	viewport.width = float(aImageExtent.width);
-	viewport.height = float(aImageExtent.height);
-	viewport.minDepth = 0.f;
-	viewport.maxDepth = 1.f;
-
-	vkCmdSetViewport( aCmdBuff, 0, 1, &viewport );
-
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 };
-	scissor.extent = aImageExtent;
-
-	vkCmdSetScissor( aCmdBuff, 0, 1, &scissor );
-
-	// draw scene geometry
-	VkPipeline currentPipeline = aGraphicsPipe;
-	VkDeviceSize kZeroOffset = 0;
-
-	for (const auto& instance : aInstances)
-	{
-		uint32_t meshIdx = instance.meshIndex;
-		auto const& meshInfo = aMeshInfos[meshIdx];
-
-		vkCmdPushConstants(
-			aCmdBuff,
-			aGraphicsLayout,
-			VK_SHADER_STAGE_VERTEX_BIT,
-			0,
-			sizeof(glm::mat4),
-			&instance.transform
-		);
+	// depth pre-pass, see DepthPrepass
+	if( prepass )
+	{
+		recorders.prepass = [&] {
+			VkRenderingAttachmentInfo prepassDepth{};
+			prepassDepth.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			prepassDepth.imageView = aDepthAttach.view;
+			prepassDepth.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			prepassDepth.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			prepassDepth.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			prepassDepth.clearValue.depthStencil = { 1.f, 0 };
+
+			VkRenderingInfo prepassInfo{};
+			prepassInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+			prepassInfo.renderArea.extent = aRenderExtent;
+			prepassInfo.layerCount = 1;
+			prepassInfo.pDepthAttachment = &prepassDepth;
+
+			if( statistics )
+				vkCmdBeginQuery( aCmdBuff, statistics, aPrepass->firstQuery, 0 );
+
+			vkCmdBeginRendering( aCmdBuff, &prepassInfo );
+
+			if( aIndirect )
+			{
+				IndirectDrawInfo prepassDraws = *aIndirect;
+				prepassDraws.opaquePipe = aPrepass->indirectOpaquePipe;
+				prepassDraws.alphaPipe = aPrepass->indirectAlphaPipe;
+
+				bind_scene_state( aCmdBuff, prepassDraws.opaquePipe, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aRenderExtent, aPositions, aTexCoords, aNormals, aIndices );
+
+				VkPipeline currentPipeline = prepassDraws.opaquePipe;
+				record_indirect_draws( aCmdBuff, prepassDraws, aIndirect->mainDraws, 0, currentPipeline );
+
+				// Hi-Z occlusion culling on the pre-pass depth; the late instances
+				// complete it, the main pass below has nothing left to rebuild
+				if( aIndirect->occlusion )
+				{
+					vkCmdEndRendering( aCmdBuff );
+
+					record_depth_pyramid( aCmdBuff, aDepthAttach.image, aRenderExtent, *aIndirect );
+					record_gpu_cull( aCmdBuff, aSceneDescriptors, *aIndirect, 1 );
+
+					prepassDepth.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+					vkCmdBeginRendering( aCmdBuff, &prepassInfo );
+
+					record_indirect_draws( aCmdBuff, prepassDraws, aIndirect->lateDraws, std::uint32_t(aIndirect->buckets.size()), currentPipeline );
+				}
+			}
+			else
+			{
+				bind_scene_state( aCmdBuff, aPrepass->opaquePipe, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aRenderExtent, aPositions, aTexCoords, aNormals, aIndices );
+
+				VkPipeline currentPipeline = aPrepass->opaquePipe;
+				record_scene_instances( aCmdBuff, aGraphicsLayout, aPrepass->opaquePipe, aPrepass->alphaPipe, currentPipeline, aMeshRanges, aMeshInfos, aMaterials, aInstances, aMainVisible, 0, aInstances.size() );
+			}
+
+			vkCmdEndRendering( aCmdBuff );
+
+			if( statistics )
+				vkCmdEndQuery( aCmdBuff, statistics, aPrepass->firstQuery );
+		};
+	}
 
+	// main pass, into the ids when the visibility buffer is on
+	recorders.main = [&] {
+		// begin dynamic rendering for scene pass
+		VkRenderingAttachmentInfo colorAttachment{};
+		colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		colorAttachment.imageView = aOffscreenColor.view; // target offscreen
+		colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colorAttachment.clearValue.color = aClearColor;
+		// colorAttachment.clearValue.color = { 0.1f, 0.1f, 0.1f, 1.f }; // Clear to black; not balck
+
+		// visibility buffer: ids instead, cleared to "no instance" (NO_INSTANCE in the resolve)
+		if( visbuffer )
+		{
+			colorAttachment.imageView = aVisBuffer->view;
+			colorAttachment.clearValue.color.uint32[0] = 0xffffffffu;
+			colorAttachment.clearValue.color.uint32[1] = 0xffffffffu;
+			colorAttachment.clearValue.color.uint32[2] = 0;
+			colorAttachment.clearValue.color.uint32[3] = 0;
+		}
 
-		// task 1.6: select pipeline based on material
-		VkPipeline targetPipeline = aGraphicsPipe;
-		if (meshInfo.materialIndex < aMaterials.size() && aMaterials[meshInfo.materialIndex].alphaMaskTexture >= 0)
+		VkRenderingAttachmentInfo depthAttachment{};
+		depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		depthAttachment.imageView = aDepthAttach.view;
+		depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthAttachment.loadOp = prepass ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		depthAttachment.clearValue.depthStencil = { 1.f, 0 };
+
+		VkRenderingInfo renderInfo{};
+		renderInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		renderInfo.renderArea.offset = { 0, 0 };
+		renderInfo.renderArea.extent = aRenderExtent;
+		renderInfo.layerCount = 1;
+		renderInfo.colorAttachmentCount = 1;
+		renderInfo.pColorAttachments = &colorAttachment;
+		renderInfo.pDepthAttachment = &depthAttachment;
+
+		if( aSecondary )
+			renderInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+
+		if( statistics )
+			vkCmdBeginQuery( aCmdBuff, statistics, aPrepass->firstQuery + 1, 0 );
+
+		vkCmdBeginRendering( aCmdBuff, &renderInfo );
+
+		// draw scene geometry
+		if( aSecondary )
 		{
-			targetPipeline = aAlphaPipe;
+			// executed in partition order, i.e. the order of the serial loop
+			std::vector<VkCommandBuffer> mainSecondaries;
+			for( std::size_t t = 0; t < aSecondary->main.size(); ++t )
+			{
+				if( executed( t, 1u ) )
+					mainSecondaries.emplace_back( aSecondary->main[t] );
+			}
+
+			if( !mainSecondaries.empty() )
+				vkCmdExecuteCommands( aCmdBuff, std::uint32_t(mainSecondaries.size()), mainSecondaries.data() );
 		}
+		else if( aIndirect )
+		{
+			bind_scene_state( aCmdBuff, aGraphicsPipe, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aRenderExtent, aPositions, aTexCoords, aNormals, aIndices );
+
+			VkPipeline currentPipeline = aGraphicsPipe;
+			std::uint32_t const bucketCount = std::uint32_t(aIndirect->buckets.size());
 
-		if( targetPipeline != currentPipeline )
+			record_indirect_draws( aCmdBuff, *aIndirect, aIndirect->mainDraws, 0, currentPipeline );
+
+			// Hi-Z occlusion culling: build the pyramid from what was drawn so far,
+			// then draw the instances that phase 0 skipped but are not occluded
+			// (after a pre-pass, the late list is already built)
+			if( aIndirect->occlusion && prepass )
+			{
+				record_indirect_draws( aCmdBuff, *aIndirect, aIndirect->lateDraws, bucketCount, currentPipeline );
+			}
+			else if( aIndirect->occlusion )
+			{
+				vkCmdEndRendering( aCmdBuff );
+
+				record_depth_pyramid( aCmdBuff, aDepthAttach.image, aRenderExtent, *aIndirect );
+				record_gpu_cull( aCmdBuff, aSceneDescriptors, *aIndirect, 1 );
+
+				colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+				depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+				vkCmdBeginRendering( aCmdBuff, &renderInfo );
+
+				record_indirect_draws( aCmdBuff, *aIndirect, aIndirect->lateDraws, bucketCount, currentPipeline );
+			}
+		}
+		else
 		{
-			vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, targetPipeline );
-			currentPipeline = targetPipeline;
+			bind_scene_state( aCmdBuff, aGraphicsPipe, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aRenderExtent, aPositions, aTexCoords, aNormals, aIndices );
+
+			VkPipeline currentPipeline = aGraphicsPipe;
+			record_scene_instances( aCmdBuff, aGraphicsLayout, aGraphicsPipe, aAlphaPipe, currentPipeline, aMeshRanges, aMeshInfos, aMaterials, aInstances, aMainVisible, 0, aInstances.size() );
 		}
-		
-		// bind object descriptor set
-		vkCmdBindDescriptorSets( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsLayout, 1, 1, &aMaterialDescriptors[meshInfo.materialIndex], 0, nullptr );
 
-		vkCmdBindVertexBuffers( aCmdBuff, 0, 1, &aMeshPositions[meshIdx].buffer, &kZeroOffset );
-		vkCmdBindVertexBuffers( aCmdBuff, 1, 1, &aMeshTexCoords[meshIdx].buffer, &kZeroOffset );
-		vkCmdBindVertexBuffers( aCmdBuff, 2, 1, &aMeshNormals[meshIdx].buffer, &kZeroOffset );
-		vkCmdBindIndexBuffer( aCmdBuff, aMeshIndices[meshIdx].buffer, 0, VK_INDEX_TYPE_UINT32 );
+		vkCmdEndRendering( aCmdBuff );
 
-		vkCmdDrawIndexed( aCmdBuff, meshInfo.indices.size(), 1, 0, 0, 0 );
-	}
+		if( statistics )
+			vkCmdEndQuery( aCmdBuff, statistics, aPrepass->firstQuery + 1 );
+	};
 
-	vkCmdEndRendering( aCmdBuff );
+	// visibility buffer resolve: one full-screen triangle shades every covered pixel
+	if( visbuffer )
+	{
+		recorders.resolve = [&] {
+			VkRenderingAttachmentInfo resolveColor{};
+			resolveColor.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			resolveColor.imageView = aOffscreenColor.view;
+			resolveColor.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			resolveColor.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			resolveColor.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			resolveColor.clearValue.color = aClearColor;
+
+			VkRenderingInfo resolveInfo{};
+			resolveInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+			resolveInfo.renderArea.extent = aRenderExtent;
+			resolveInfo.layerCount = 1;
+			resolveInfo.colorAttachmentCount = 1;
+			resolveInfo.pColorAttachments = &resolveColor;
+
+			vkCmdBeginRendering( aCmdBuff, &resolveInfo );
+
+			vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aVisBuffer->resolvePipe );
+
+			bind_scene_sets( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aVisBuffer->resolveLayout, aSceneDescriptors, { aMaterialDescriptors, aVisBuffer->resolveDescriptors } );
+
+			VkViewport viewport{};
+			viewport.width = float(aRenderExtent.width);
+			viewport.height = float(aRenderExtent.height);
+			viewport.minDepth = 0.f;
+			viewport.maxDepth = 1.f;
+			vkCmdSetViewport( aCmdBuff, 0, 1, &viewport );
+
+			VkRect2D scissor{};
+			scissor.extent = aRenderExtent;
+			vkCmdSetScissor( aCmdBuff, 0, 1, &scissor );
+
+			vkCmdDraw( aCmdBuff, 3, 1, 0, 0 );
+
+			vkCmdEndRendering( aCmdBuff );
+		};
+	}
 
-	// apply post processing and render to swapchain
+	// apply post processing and render to swapchain: one compute dispatch and a
+	// blit (see ComputePostPass), or the full-screen raster pass
+	if( computePost )
+	{
+		recorders.computePost = [&] {
+			vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aComputePost->pipe );
+			vkCmdBindDescriptorSets( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aComputePost->layout, 0, 1, &aComputePost->descriptors, 0, nullptr );
+			vkCmdPushConstants( aCmdBuff, aComputePost->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(glsl::PostPush), &aComputePost->push );
+
+			vkCmdDispatch( aCmdBuff,
+				(aImageExtent.width + cfg::kPostTileSize - 1) / cfg::kPostTileSize,
+				(aImageExtent.height + cfg::kPostTileSize - 1) / cfg::kPostTileSize,
+				1
+			);
+		};
+
+		// same extent, the blit only converts: linear half floats to the sRGB swapchain
+		recorders.postBlit = [&] {
+			VkImageBlit2 region{};
+			region.sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2;
+			region.srcSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			region.srcOffsets[1] = VkOffset3D{ std::int32_t(aImageExtent.width), std::int32_t(aImageExtent.height), 1 };
+			region.dstSubresource = region.srcSubresource;
+			region.dstOffsets[1] = region.srcOffsets[1];
+
+			VkBlitImageInfo2 blitInfo{};
+			blitInfo.sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2;
+			blitInfo.srcImage = aComputePost->image;
+			blitInfo.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			blitInfo.dstImage = aColorAttach.image;
+			blitInfo.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			blitInfo.regionCount = 1;
+			blitInfo.pRegions = &region;
+			blitInfo.filter = VK_FILTER_NEAREST;
+			vkCmdBlitImage2( aCmdBuff, &blitInfo );
+		};
+	}
+	else
+	{
+		recorders.post = [&] {
+			VkRenderingAttachmentInfo postProcColorAttachment{};
+			postProcColorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			postProcColorAttachment.imageView = aColorAttach.view; // target swapchain
+			postProcColorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			postProcColorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE; // full screen cover so clear is redundant
+			postProcColorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+			VkRenderingInfo postProcRenderInfo{};
+			postProcRenderInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+			postProcRenderInfo.renderArea.offset = { 0, 0 };
+			postProcRenderInfo.renderArea.extent = aImageExtent;
+			postProcRenderInfo.layerCount = 1;
+			postProcRenderInfo.colorAttachmentCount = 1;
+			postProcRenderInfo.pColorAttachments = &postProcColorAttachment;
+			// no depth attachment for post process
+
+			vkCmdBeginRendering( aCmdBuff, &postProcRenderInfo );
+
+			vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPostProcPipe );
+			vkCmdBindDescriptorSets( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPostProcLayout, 0, 1, &aPostProcDescriptors, 1, &aSceneDescriptors.frameOffset );
+
+			// secondaries leave the primary's state undefined, so always set it here
+			VkViewport viewport{};
+			viewport.width = float(aImageExtent.width);
+			viewport.height = float(aImageExtent.height);
+			viewport.minDepth = 0.f;
+			viewport.maxDepth = 1.f;
+			vkCmdSetViewport( aCmdBuff, 0, 1, &viewport );
+
+			VkRect2D scissor{};
+			scissor.extent = aImageExtent;
+			vkCmdSetScissor( aCmdBuff, 0, 1, &scissor );
+
+			// draw full screen triangle
+			vkCmdDraw( aCmdBuff, 3, 1, 0, 0 );
+
+			vkCmdEndRendering( aCmdBuff );
+		};
+	}
 
-	// transition offscreen image to shader read only
-	lut::image_barrier( aCmdBuff, aOffscreenColor.image,
-		VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
-		VK_ACCESS_2_SHADER_READ_BIT,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+	RenderGraph graph;
+	declare_frame_graph( graph,
+		FrameGraphConfig{ prepass, visbuffer, computePost },
+		FrameGraphTargets{
+			aDepthAttach.image, aOffscreenColor.image,
+			visbuffer ? aVisBuffer->image : VK_NULL_HANDLE,
+			computePost ? aComputePost->image : VK_NULL_HANDLE,
+			aColorAttach.image
+		},
+		std::move(recorders)
 	);
 
-	// transition swapchain image to color attachment
-	lut::image_barrier( aCmdBuff, aColorAttach.image,
-		VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
-		VK_ACCESS_2_NONE,
-		VK_IMAGE_LAYOUT_UNDEFINED,
-		VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
-	);
+	RenderGraphStats const graphStats = graph.execute( aCmdBuff, aProfiler );
+	if( aGraphStats )
+		*aGraphStats = graphStats;
 
-	VkRenderingAttachmentInfo postProcColorAttachment{};
-	postProcColorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-	postProcColorAttachment.imageView = aColorAttach.view; // target swapchain
-	postProcColorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	postProcColorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE; // full screen cover so clear is redundant
-	postProcColorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-
-	VkRenderingInfo postProcRenderInfo{};
-	postProcRenderInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
-	postProcRenderInfo.renderArea.offset = { 0, 0 };
-	postProcRenderInfo.renderArea.extent = aImageExtent;
-	postProcRenderInfo.layerCount = 1;
-	postProcRenderInfo.colorAttachmentCount = 1;
-	postProcRenderInfo.pColorAttachments = &postProcColorAttachment;
-	// no depth attachment for post process
-
-	vkCmdBeginRendering( aCmdBuff, &postProcRenderInfo );
-
-	vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPostProcPipe );
-	vkCmdBindDescriptorSets( aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPostProcLayout, 0, 1, &aPostProcDescriptors, 0, nullptr );
-
-	// viewport/scissor already set but reset for safety
-	vkCmdSetViewport( aCmdBuff, 0, 1, &viewport );
-	vkCmdSetScissor( aCmdBuff, 0, 1, &scissor );
-
-	// draw full screen triangle
-	vkCmdDraw( aCmdBuff, 3, 1, 0, 0 );
-
-	vkCmdEndRendering( aCmdBuff );
-
-	// transition swapchain image to present source
-	lut::image_barrier( aCmdBuff, aColorAttach.image,
-		VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
-		VK_ACCESS_2_NONE,
-		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-		VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
-	);
+	if( aProfiler )
+		aProfiler->end( aCmdBuff ); // frame
 
 	if( auto const res = vkEndCommandBuffer( aCmdBuff ); VK_SUCCESS != res )
 	{
@@ -329,7 +1200,77 @@ void record_commands( VkCommandBuffer aCmdBuff, VkPipeline aGraphicsPipe, VkPipe
 	}
 }
 
-void submit_commands( lut::VulkanContext const& aContext, VkCommandBuffer aCmdBuff, VkFence aFence, VkSemaphore aWaitSemaphore, VkSemaphore aSignalSemaphore )
+void record_secondary_draws( SecondaryDrawLists const& aSecondary, VkFormat aColorFormat, VkExtent2D const& aImageExtent, VkPipeline aGraphicsPipe, VkPipeline aAlphaPipe, VkPipeline aShadowPipe, VkPipelineLayout aGraphicsLayout, SceneDescriptors const& aSceneDescriptors, VkBuffer aPositions, VkBuffer aTexCoords, VkBuffer aNormals, VkBuffer aIndices, std::vector<MeshDrawRange> const& aMeshRanges, std::vector<EngineMesh> const& aMeshInfos, std::vector<EngineMaterial> const& aMaterials, VkDescriptorSet aMaterialDescriptors, std::vector<EngineInstance> const& aInstances, std::span<std::uint8_t const> aMainVisible, ShadowPass const& aShadow )
+{
+	assert( 0 == aSecondary.shadowMask || aSecondary.shadow.size() == aSecondary.main.size() * cfg::kMaxShadowCascades );
+	assert( aSecondary.dirty.empty() || aSecondary.dirty.size() == aSecondary.main.size() );
+
+	// must match the attachments of the render pass instances in record_commands()
+	VkCommandBufferInheritanceRenderingInfo shadowRendering{};
+	shadowRendering.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+	shadowRendering.depthAttachmentFormat = cfg::kShadowMapFormat;
+	shadowRendering.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkCommandBufferInheritanceRenderingInfo mainRendering{};
+	mainRendering.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+	mainRendering.colorAttachmentCount = 1;
+	mainRendering.pColorAttachmentFormats = &aColorFormat;
+	mainRendering.depthAttachmentFormat = cfg::kDepthFormat;
+	mainRendering.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	std::size_t const workers = aSecondary.main.size();
+	std::size_t const count = aInstances.size();
+
+	// worker t records instances [t*count/workers, (t+1)*count/workers) of both passes
+	// (every cascade in shadowMask)
+	auto const record = [&] (std::size_t aWorker) {
+		std::size_t const begin = aWorker * count / workers;
+		std::size_t const end = (aWorker + 1) * count / workers;
+
+		for( std::uint32_t c = 0; c < cfg::kMaxShadowCascades; ++c )
+		{
+			if( 0 == (aSecondary.shadowMask & (1u << c)) )
+				continue;
+
+			VkCommandBuffer const shadowCmd = aSecondary.shadow[aWorker * cfg::kMaxShadowCascades + c];
+			begin_secondary( shadowCmd, shadowRendering, aSecondary.reusable );
+			bind_shadow_state( shadowCmd, aShadow.opaquePipe, aShadow.resolution, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aPositions, aTexCoords, aIndices );
+
+			VkPipeline shadowPipeline = aShadow.opaquePipe;
+			record_shadow_instances( shadowCmd, aGraphicsLayout, aShadow.opaquePipe, aShadowPipe, shadowPipeline, c, aMeshRanges, aMeshInfos, aMaterials, aInstances, aShadow.staticVisible[c], begin, end );
+			end_secondary( shadowCmd );
+		}
+
+		VkCommandBuffer const mainCmd = aSecondary.main[aWorker];
+		begin_secondary( mainCmd, mainRendering, aSecondary.reusable, aSecondary.statistics );
+		bind_scene_state( mainCmd, aGraphicsPipe, aGraphicsLayout, aSceneDescriptors, aMaterialDescriptors, aImageExtent, aPositions, aTexCoords, aNormals, aIndices );
+
+		VkPipeline currentPipeline = aGraphicsPipe;
+		record_scene_instances( mainCmd, aGraphicsLayout, aGraphicsPipe, aAlphaPipe, currentPipeline, aMeshRanges, aMeshInfos, aMaterials, aInstances, aMainVisible, begin, end );
+		end_secondary( mainCmd );
+	};
+
+	std::vector<std::size_t> todo;
+	for( std::size_t t = 0; t < workers; ++t )
+	{
+		if( aSecondary.dirty.empty() || aSecondary.dirty[t] )
+			todo.emplace_back( t );
+	}
+
+	// each partition has its own command pool, see RenderSystem::mRecordPools
+	std::vector<std::future<void>> jobs;
+	for( std::size_t i = 1; i < todo.size(); ++i )
+		jobs.emplace_back( std::async( std::launch::async, record, todo[i] ) );
+
+	// first partition on this thread
+	if( !todo.empty() )
+		record( todo[0] );
+
+	for( auto& job : jobs )
+		job.get();
+}
+
+std::uint64_t submit_commands( lut::Timeline& aTimeline, VkCommandBuffer aCmdBuff, VkSemaphore aWaitSemaphore, VkSemaphore aSignalSemaphore )
 {
 	VkSemaphoreSubmitInfo wait[1]{};
 	wait[0].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
@@ -339,7 +1280,7 @@ void submit_commands( lut::VulkanContext const& aContext, VkCommandBuffer aCmdBu
 	VkSemaphoreSubmitInfo signal[1]{};
 	signal[0].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
 	signal[0].semaphore = aSignalSemaphore;
-	signal[0].stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	signal[0].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT; // the compute post path ends in a blit
 
 	VkCommandBufferSubmitInfo submit[1]{};
 	submit[0].sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
@@ -354,12 +1295,7 @@ void submit_commands( lut::VulkanContext const& aContext, VkCommandBuffer aCmdBu
 	submitInfo.signalSemaphoreInfoCount = 1;
 	submitInfo.pSignalSemaphoreInfos = signal;
 
-	if( auto const res = vkQueueSubmit2( aContext.graphicsQueue, 1, &submitInfo, aFence ); VK_SUCCESS != res )
-	{
-		throw lut::Error( "Unable to submit command buffer to queue\n"
-			"vkQueueSubmit2() returned {}", lut::to_string(res)
-		);
-	}
+	return aTimeline.submit( submitInfo );
 }
 
 void present_results( VkQueue aPresentQueue, VkSwapchainKHR aSwapchain, std::uint32_t aImageIndex, VkSemaphore aRenderFinished, bool& aNeedToRecreateSwapchain )
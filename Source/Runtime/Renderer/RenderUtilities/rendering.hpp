@@ -1,17 +1,227 @@
 #pragma once
 
 #include <volk/volk.h>
+#include <span>
 #include <vector>
 
 #include "setup.hpp"
 #include "camera.hpp"
 #include "engine_model.hpp"
+#include "gpu_driven.hpp"
+#include "materials.hpp"
+#include "shadow_atlas.hpp"
+#include "clustered_lights.hpp"
+#include "render_graph.hpp"
+#include "post_process.hpp"
 #include "../../Rhi/vkobject.hpp"
 #include "../../Rhi/vulkan_window.hpp"
 #include "../../Rhi/vkbuffer.hpp" 
+#include "../../Rhi/synch.hpp"
+#include "../../Rhi/gpu_profiler.hpp"
 
 namespace lut = labut2;
 
+namespace cfg
+{
+	// frames recorded ahead of the GPU, independent of the swapchain image
+	// count: command buffers, queries and FrameRing regions, one per frame slot
+	constexpr std::uint32_t kFramesInFlight = 2;
+
+	// CPU path parallel recording, see record_secondary_draws()
+	constexpr std::size_t kMaxRecordThreads = 8;
+
+	// cached CPU path draws: instance ranges that are recorded once and
+	// executed when their bounds are in the frustum
+	constexpr std::size_t kCachedDrawRegions = 8;
+
+	// > 0 replicates the loaded scene in a grid up to this many instances
+	// (draw recording measurements, e.g. 50000)
+	constexpr std::size_t kStressInstanceCount = 0;
+
+	// > 0 uploads the model's textures again until this many are loaded (load
+	// time measurements, e.g. 500); the copies are not sampled
+	constexpr std::size_t kStressTextureCount = 0;
+
+	// finish every texture upload before the next one, like the per-texture
+	// fence waits before UploadManager (load time comparison)
+	constexpr bool kUploadWaitPerTexture = false;
+
+	// textures written by the host (vkCopyMemoryToImage) where supported, mips
+	// filtered on the CPU; false stages all of them. Off: the model's textures
+	// bring no mips, and building them on one CPU thread is slower than the GPU
+	// blit chain of the staged path (see kCompareTextureUploads)
+	constexpr bool kHostImageCopy = false;
+
+	// after loading, uploads the host-copyable model textures once more through
+	// both paths and reports them side by side: host copy and its CPU mips
+	// timed apart, staging up to the GPU being done (copies are discarded;
+	// measurements only, adds both uploads to the load time)
+	constexpr bool kCompareTextureUploads = false;
+}
+
+// CPU path, parallel recording: one main pass secondary per worker and one shadow
+// pass secondary per worker and cascade, executed in worker order inside the
+// primary's render pass instances
+struct SecondaryDrawLists
+{
+	std::span<VkCommandBuffer const> shadow; // [worker * cfg::kMaxShadowCascades + cascade]
+	std::span<VkCommandBuffer const> main;
+
+	// cascades whose shadow secondaries are recorded (static casters only)
+	std::uint32_t shadowMask = 0;
+
+	// partitions to (re-)record, one byte each; empty records all of them
+	std::span<std::uint8_t const> dirty;
+
+	// partitions to execute, one byte each: bit 0 the main pass, bit 1 + c
+	// cascade c; empty executes all of them (cached draws, culled per region)
+	std::span<std::uint8_t const> executed;
+
+	// kept and executed again in later frames (no ONE_TIME_SUBMIT)
+	bool reusable = false;
+
+	// executed inside a pipeline statistics query with these counters (DepthPrepass::statistics)
+	VkQueryPipelineStatisticFlags statistics = 0;
+};
+
+// optional depth pre-pass of the main pass: the visible instances are drawn depth
+// only (position only, alpha tested ones through the shadow map discard shader) in
+// a render pass instance of their own, recorded inline on both paths; the main
+// pass then loads that depth and is recorded with EQUAL pipelines (no depth
+// writes), so every pixel is shaded once. On the GPU-driven path with occlusion
+// culling the depth pyramid is built from the pre-pass, whose second half draws
+// the late instances, and the main pass draws both lists in one instance.
+struct DepthPrepass
+{
+	bool       enabled = false;
+	VkPipeline opaquePipe = VK_NULL_HANDLE;
+	VkPipeline alphaPipe = VK_NULL_HANDLE;
+	VkPipeline indirectOpaquePipe = VK_NULL_HANDLE;
+	VkPipeline indirectAlphaPipe = VK_NULL_HANDLE;
+
+	// optional fragment shader invocations, with or without the pre-pass: query
+	// firstQuery counts the pre-pass, firstQuery + 1 the main pass; both are reset here
+	VkQueryPool   statistics = VK_NULL_HANDLE;
+	std::uint32_t firstQuery = 0;
+};
+
+// scene descriptors (set 0) and the frame's FrameRing offset, the dynamic offset
+// of all three of its per-frame bindings (scene uniforms, spot lights, clustered
+// lights); cached draws bake it, which holds as they are cached per frame slot
+struct SceneDescriptors
+{
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	std::uint32_t   frameOffset = 0;
+};
+
+// clustered lighting (see clustered_lights.hpp): the lightCount lights of the
+// frame's FrameRing region are binned into clusterCounts/clusterIndices by binPipe
+// before the shadow and main passes; nothing is recorded without lights
+// (SceneUniform::clusterGrid.w = 0)
+struct LightClusters
+{
+	std::uint32_t    lightCount = 0;
+	VkBuffer         clusterCounts = VK_NULL_HANDLE;
+	VkBuffer         clusterIndices = VK_NULL_HANDLE;
+	VkPipeline       binPipe = VK_NULL_HANDLE;
+	VkPipelineLayout binLayout = VK_NULL_HANDLE; // set 0: the scene descriptors
+};
+
+// visibility buffer: the main pass rasterizes instance and triangle ids only
+// (visbuffer*.vert/frag) into image, with depth, then one full-screen resolve
+// (visbuffer_resolve.frag) rebuilds each pixel's triangle from the mesh buffers
+// and shades it once into the offscreen image. aGraphicsPipe/aAlphaPipe (and
+// aIndirect's) must be the visibility buffer pipelines when enabled; the depth
+// pre-pass is not combined with it.
+struct VisBufferPass
+{
+	bool        enabled = false;
+	VkImage     image = VK_NULL_HANDLE;
+	VkImageView view = VK_NULL_HANDLE;
+
+	VkPipeline       resolvePipe = VK_NULL_HANDLE;
+	VkPipelineLayout resolveLayout = VK_NULL_HANDLE;
+	VkDescriptorSet  resolveDescriptors = VK_NULL_HANDLE; // set 2, see create_visbuffer_descriptor_layout()
+};
+
+// compute post-processing (see post_process.hpp): when enabled, post.comp writes
+// image (TransientAttachments::post) from the offscreen image and a blit copies it
+// into the swapchain, in place of the raster post-process pass (aPostProcPipe).
+struct ComputePostPass
+{
+	bool             enabled = false;
+	VkImage          image = VK_NULL_HANDLE;
+	VkPipeline       pipe = VK_NULL_HANDLE;
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	VkDescriptorSet  descriptors = VK_NULL_HANDLE; // offscreen image in, image out
+	glsl::PostPush   push{};
+};
+
+// cascaded shadow maps (see shadows.hpp), one layer of the shadow map per cascade
+// Only the cascades in updateMask are rendered this frame (staggered updates), the
+// others keep their depth and their SceneUniform::cascadeVP from an earlier frame.
+// Per cascade, static shadow caching as before: the static casters are rendered
+// into the layer of staticImage only when the cascade is in refreshMask (cascade
+// matrix, static geometry or shadow resolution changed). Without dynamic casters
+// staticImage is the shadow map itself; with them the cached layer is copied into
+// the shadow map whenever the cascade updates and the dynamic casters are drawn on top.
+struct ShadowPass
+{
+	std::uint32_t cascadeCount = 1;
+	std::uint32_t resolution = 0;
+	std::uint32_t updateMask = 0;
+	std::uint32_t refreshMask = 0; // subset of updateMask
+	bool          dynamic = false;
+	bool          discard = false; // new image: layers >= cascadeCount are still undefined
+
+	VkImage                      shadowImage = VK_NULL_HANDLE;
+	std::span<VkImageView const> shadowLayers;
+	VkImage                      staticImage = VK_NULL_HANDLE;
+	std::span<VkImageView const> staticLayers;
+
+	// CPU path: opaque casters (no alpha mask) are drawn with these position only
+	// pipelines, the alpha tested ones with aShadowPipe, pointPipe and atlasPipe
+	VkPipeline opaquePipe = VK_NULL_HANDLE;
+	VkPipeline pointOpaquePipe = VK_NULL_HANDLE;
+	VkPipeline atlasOpaquePipe = VK_NULL_HANDLE;
+
+	// CPU path culling results per cascade, one byte per instance
+	std::span<std::uint8_t const> staticVisible[cfg::kMaxShadowCascades];
+	std::span<std::uint8_t const> dynamicVisible[cfg::kMaxShadowCascades];
+
+	// point light cube shadow map, all faces re-rendered every frame (see shadows.hpp)
+	// pointFaces: 0 skips it; 1 renders one layered pass, 2 one pass per face
+	// into pointFaceTargets, without gl_Layer (CPU recorded draws; for
+	// comparison, and the fallback without shaderOutputLayer). The GPU-driven
+	// path renders the layered pass whenever IndirectDrawInfo::pointShadow is
+	// set. pointDiscard: new image, never rendered
+	std::uint32_t pointFaces = 0;
+	bool          pointDiscard = false;
+	std::uint32_t pointResolution = 0;
+	VkImage       pointImage = VK_NULL_HANDLE;
+	VkImageView   pointTarget = VK_NULL_HANDLE; // 2D array view of the six faces
+	VkPipeline    pointPipe = VK_NULL_HANDLE;   // CPU path, see IndirectDrawInfo::pointShadowPipe
+
+	std::span<VkImageView const> pointFaceTargets; // 2D view per face
+	VkPipeline    pointFacePipe = VK_NULL_HANDLE;       // one pass per face, alpha tested casters
+	VkPipeline    pointFaceOpaquePipe = VK_NULL_HANDLE; // one pass per face, opaque casters
+
+	// CPU path culling result, bit f set when the instance overlaps cube face f
+	std::span<std::uint8_t const> pointFaceMasks;
+
+	// spot light shadow atlas (see shadow_atlas.hpp): the tiles in atlasUpdates
+	// are re-rendered in one render pass instance over the atlas, one viewport per
+	// tile, the others keep their depth; the lights themselves are in the frame's
+	// FrameRing region. The atlas casters are CPU culled on both paths, per light one
+	// byte per instance. atlasDiscard: new image, never rendered
+	std::span<ShadowTileUpdate const>          atlasUpdates;
+	std::span<std::vector<std::uint8_t> const> spotVisible;
+	bool          atlasDiscard = false;
+	std::uint32_t atlasSize = 0;
+	VkImage       atlasImage = VK_NULL_HANDLE;
+	VkImageView   atlasView = VK_NULL_HANDLE;
+	VkPipeline    atlasPipe = VK_NULL_HANDLE;
+};
 
 
 void record_commands( 
@@ -21,32 +231,78 @@ void record_commands(
 	ImageAndView const& aColorAttach, 
 	ImageAndView const& aDepthAttach, 
 	VkExtent2D const& aImageExtent, 
-	VkBuffer aSceneUBO, 
-	glsl::SceneUniform const& aSceneUniform, 
+	// the scene's part of the attachments, from their origin (dynamic resolution);
+	// aImageExtent is the swapchain extent, the post-processing output
+	VkExtent2D const& aRenderExtent,
 	VkPipelineLayout aGraphicsLayout, 
-	VkDescriptorSet aSceneDescriptors, 
-	std::vector<lut::Buffer> const& aMeshPositions, 
-	std::vector<lut::Buffer> const& aMeshTexCoords, 
-	std::vector<lut::Buffer> const& aMeshNormals,
-	std::vector<lut::Buffer> const& aMeshIndices, 
+	SceneDescriptors const& aSceneDescriptors, 
+	// merged vertex streams + index buffer, see MeshDrawRange
+	VkBuffer aPositions, 
+	VkBuffer aTexCoords, 
+	VkBuffer aNormals,
+	VkBuffer aIndices, 
+	std::vector<MeshDrawRange> const& aMeshRanges,
 	std::vector<EngineMesh> const& aMeshInfos, 
 	std::vector<EngineMaterial> const& aMaterials,
-	std::vector<VkDescriptorSet> const& aMaterialDescriptors,
+	VkDescriptorSet aMaterialDescriptors, // bindless set 1, see materials.hpp
 	std::vector<EngineInstance> const& aInstances,//to render obj
 	VkPipeline aPostProcPipe,
-	VkDescriptorSet aPostProcDescriptors,
+	VkDescriptorSet aPostProcDescriptors, // its mosaic uniform at aSceneDescriptors.frameOffset too
 	VkPipelineLayout aPostProcLayout,
 	ImageAndView const& aOffscreenColor,
 	VkClearColorValue aClearColor,
-	// p2_1.5 shadow mapping
+	// p2_1.5 shadow mapping, alpha tested casters (see ShadowPass::opaquePipe)
 	VkPipeline aShadowPipe,
-	ImageAndView const& aShadowMap
+	// CPU culling result, one byte per instance; empty draws everything
+	std::span<std::uint8_t const> aMainVisible,
+	ShadowPass const& aShadow,
+	// GPU-driven path; nullptr records the per-instance draws on the CPU
+	IndirectDrawInfo const* aIndirect = nullptr,
+	// CPU path: draws already recorded by record_secondary_draws(); nullptr records them inline
+	SecondaryDrawLists const* aSecondary = nullptr,
+	// aGraphicsPipe/aAlphaPipe (and aIndirect's) must be the EQUAL variants when enabled
+	DepthPrepass const* aPrepass = nullptr,
+	LightClusters const* aClusters = nullptr,
+	VisBufferPass const* aVisBuffer = nullptr,
+	ComputePostPass const* aComputePost = nullptr,
+	// per pass GPU times and debug labels: the frame, light binning, culling,
+	// each shadow map and every frame graph pass; begin_frame() comes first.
+	// The "frame" scope drives the resolution scale, see dynamic_resolution.hpp
+	lut::GpuProfiler* aProfiler = nullptr,
+	// filled with the frame graph's pass/barrier counts when not nullptr
+	RenderGraphStats* aGraphStats = nullptr
+);
+
+// records the CPU path draws of both passes into aSecondary, partitioned over
+// aSecondary.main.size() threads (one per dirty partition); the command buffers
+// must come from one pool per partition. Shadow draws are recorded for the
+// cascades in aSecondary.shadowMask (static casters of aShadow.staticVisible).
+void record_secondary_draws(
+	SecondaryDrawLists const& aSecondary,
+	VkFormat aColorFormat,
+	VkExtent2D const& aImageExtent,
+	VkPipeline aGraphicsPipe,
+	VkPipeline aAlphaPipe,
+	VkPipeline aShadowPipe,
+	VkPipelineLayout aGraphicsLayout,
+	SceneDescriptors const& aSceneDescriptors,
+	VkBuffer aPositions,
+	VkBuffer aTexCoords,
+	VkBuffer aNormals,
+	VkBuffer aIndices,
+	std::vector<MeshDrawRange> const& aMeshRanges,
+	std::vector<EngineMesh> const& aMeshInfos,
+	std::vector<EngineMaterial> const& aMaterials,
+	VkDescriptorSet aMaterialDescriptors, // bindless set 1, see materials.hpp
+	std::vector<EngineInstance> const& aInstances,
+	std::span<std::uint8_t const> aMainVisible,
+	ShadowPass const& aShadow
 );
 
-void submit_commands( 
-	lut::VulkanContext const& aContext, 
+// returns the timeline value that signals once the frame is done
+std::uint64_t submit_commands( 
+	lut::Timeline& aTimeline, 
 	VkCommandBuffer aCmdBuff, 
-	VkFence aFence, 
 	VkSemaphore aWaitSemaphore, 
 	VkSemaphore aSignalSemaphore 
 );
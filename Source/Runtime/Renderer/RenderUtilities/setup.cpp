@@ -1,4 +1,9 @@
 #include "setup.hpp"
+#include "gpu_driven.hpp"
+#include "materials.hpp"
+#include "camera.hpp"
+#include "render_graph.hpp"
+#include "post_process.hpp"
 
 #include "../../Rhi/error.hpp"
 #include "../../Rhi/to_string.hpp"
@@ -9,6 +14,40 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <bit>
+#include <algorithm>
+
+namespace
+{
+	lut::Pipeline create_compute_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout, char const* aCompPath, char const* aName )
+	{
+		auto const compSpirV = lut::load_file_u32( aCompPath );
+
+		VkShaderModuleCreateInfo code{};
+		code.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		code.codeSize = compSpirV.size()*sizeof(std::uint32_t);
+		code.pCode = compSpirV.data();
+
+		VkComputePipelineCreateInfo pipeInfo{};
+		pipeInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipeInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipeInfo.stage.pName = "main";
+		pipeInfo.stage.pNext = &code; // maintenance5: no VkShaderModule needed
+		pipeInfo.layout = aPipelineLayout;
+
+		VkPipeline pipe = VK_NULL_HANDLE;
+		if( auto const res = vkCreateComputePipelines( aWindow.device, VK_NULL_HANDLE, 1, &pipeInfo, nullptr, &pipe ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create {} pipeline\n"
+				"vkCreateComputePipelines() returned {}", aName, lut::to_string(res)
+			);
+		}
+
+		return lut::Pipeline( aWindow.device, pipe );
+	}
+}
+
 
 lut::PipelineLayout create_triangle_pipeline_layout( lut::VulkanContext const& aContext, VkDescriptorSetLayout aSceneLayout, VkDescriptorSetLayout aObjectLayout )
 {
@@ -18,11 +57,11 @@ lut::PipelineLayout create_triangle_pipeline_layout( lut::VulkanContext const& a
 		aObjectLayout // set 1
 	};
 
-	//matrix calculate
+	//matrix calculate + material index (bindless)
 	VkPushConstantRange pushConstant{};
 	pushConstant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; 
 	pushConstant.offset = 0;
-	pushConstant.size = sizeof(glm::mat4); 
+	pushConstant.size = sizeof(glsl::DrawPush); 
 
 
 	VkPipelineLayoutCreateInfo layoutInfo{};
@@ -68,10 +107,10 @@ lut::PipelineLayout create_post_proc_pipeline_layout( lut::VulkanContext const&
 }
 
 
-lut::Pipeline create_triangle_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout, VkFormat aColorFormat )
+lut::Pipeline create_triangle_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout, VkFormat aColorFormat, char const* aVertPath, bool aDepthEqual )
 {
 	// Load shader code
-	auto const vertSpirV = lut::load_file_u32( cfg::kVertShaderPath );
+	auto const vertSpirV = lut::load_file_u32( aVertPath );
 	auto const fragSpirV = lut::load_file_u32( cfg::kFragShaderPath );
 
 	VkShaderModuleCreateInfo code[2]{};
@@ -191,8 +230,9 @@ lut::Pipeline create_triangle_pipeline( lut::VulkanWindow const& aWindow, VkPipe
 	VkPipelineDepthStencilStateCreateInfo depthInfo{};
 	depthInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 	depthInfo.depthTestEnable = VK_TRUE;
-	depthInfo.depthWriteEnable = VK_TRUE;
-	depthInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	// depth pre-pass: only the fragments that won the pre-pass are shaded
+	depthInfo.depthWriteEnable = aDepthEqual ? VK_FALSE : VK_TRUE;
+	depthInfo.depthCompareOp = aDepthEqual ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS_OR_EQUAL;
 	depthInfo.minDepthBounds = 0.f;
 	depthInfo.maxDepthBounds = 1.f;
 
@@ -244,10 +284,10 @@ lut::Pipeline create_triangle_pipeline( lut::VulkanWindow const& aWindow, VkPipe
 	return lut::Pipeline( aWindow.device, pipe );
 }
 
-lut::Pipeline create_alpha_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout, VkFormat aColorFormat )
+lut::Pipeline create_alpha_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout, VkFormat aColorFormat, char const* aVertPath, bool aDepthEqual )
 {
 	// Load shader code
-	auto const vertSpirV = lut::load_file_u32( cfg::kAlphaVertShaderPath );
+	auto const vertSpirV = lut::load_file_u32( aVertPath );
 	auto const fragSpirV = lut::load_file_u32( cfg::kAlphaFragShaderPath );
 
 	VkShaderModuleCreateInfo code[2]{};
@@ -368,8 +408,9 @@ lut::Pipeline create_alpha_pipeline( lut::VulkanWindow const& aWindow, VkPipelin
 	VkPipelineDepthStencilStateCreateInfo depthInfo{};
 	depthInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 	depthInfo.depthTestEnable = VK_TRUE;
-	depthInfo.depthWriteEnable = VK_TRUE;
-	depthInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	// depth pre-pass: EQUAL against the alpha tested pre-pass depth
+	depthInfo.depthWriteEnable = aDepthEqual ? VK_FALSE : VK_TRUE;
+	depthInfo.depthCompareOp = aDepthEqual ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS_OR_EQUAL;
 	depthInfo.minDepthBounds = 0.f;
 	depthInfo.maxDepthBounds = 1.f;
 
@@ -423,11 +464,13 @@ lut::Pipeline create_alpha_pipeline( lut::VulkanWindow const& aWindow, VkPipelin
 
 lut::DescriptorSetLayout create_scene_descriptor_layout( lut::VulkanWindow const& aWindow )
 {
-	VkDescriptorSetLayoutBinding bindings[2]{};
+	// the per-frame bindings (0, 4 and 6) are dynamic, in the FrameRing region of
+	// the frame, see SceneDescriptors
+	VkDescriptorSetLayoutBinding bindings[9]{};
 	bindings[0].binding = 0; // number must match the index of the corresponding binding
-	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	bindings[0].descriptorCount = 1;
-	bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
 
 	// p2_1.5 shadow map
 	bindings[1].binding = 1;
@@ -435,6 +478,41 @@ lut::DescriptorSetLayout create_scene_descriptor_layout( lut::VulkanWindow const
 	bindings[1].descriptorCount = 1;
 	bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+	// instance buffer (GPU-driven path), read by the cull pass, the *_indirect.vert
+	// shaders and the visibility buffer resolve
+	bindings[2].binding = 2;
+	bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[2].descriptorCount = 1;
+	bindings[2].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+	// point light cube shadow map
+	bindings[3].binding = 3;
+	bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[3].descriptorCount = 1;
+	bindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	// spot lights (glsl::SpotLightData), read by the lighting and by spotshadow.vert
+	bindings[4].binding = 4;
+	bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	bindings[4].descriptorCount = 1;
+	bindings[4].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	// spot light shadow atlas
+	bindings[5].binding = 5;
+	bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[5].descriptorCount = 1;
+	bindings[5].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	// clustered lighting: 6 lights, 7 light count per cluster, 8 light indices per
+	// cluster; written by light_cluster.comp (7, 8), read by the lighting
+	for( std::uint32_t i = 6; i < 9; ++i )
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = 6 == i ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
 	VkDescriptorSetLayoutCreateInfo layoutInfo{};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	layoutInfo.bindingCount = sizeof(bindings)/sizeof(bindings[0]);
@@ -452,33 +530,41 @@ lut::DescriptorSetLayout create_scene_descriptor_layout( lut::VulkanWindow const
 }
 lut::DescriptorSetLayout create_object_descriptor_layout( lut::VulkanWindow const& aWindow )
 {
-	// bindings for base color, roughness, and metalness
-	VkDescriptorSetLayoutBinding bindings[3]{};
+	// bindless materials (materials.hpp): material parameters and all textures
+	VkDescriptorSetLayoutBinding bindings[2]{};
 	
 	bindings[0].binding = 0; 
-	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 	bindings[0].descriptorCount = 1;
 	bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+	// variable count, must be the last binding
 	bindings[1].binding = 1; 
 	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	bindings[1].descriptorCount = 1;
+	bindings[1].descriptorCount = cfg::kMaxBindlessTextures;
 	bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-	bindings[2].binding = 2; 
-	bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	bindings[2].descriptorCount = 1;
-	bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	VkDescriptorBindingFlags const bindingFlags[2] = {
+		0,
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT
+	};
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+	flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	flagsInfo.bindingCount = sizeof(bindingFlags)/sizeof(bindingFlags[0]);
+	flagsInfo.pBindingFlags = bindingFlags;
 
 	VkDescriptorSetLayoutCreateInfo layoutInfo{};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &flagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
 	layoutInfo.bindingCount = sizeof(bindings)/sizeof(bindings[0]);
 	layoutInfo.pBindings = bindings;
 
 	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
 	if( auto const res = vkCreateDescriptorSetLayout( aWindow.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
 	{
-		throw lut::Error( "Unable to create descriptor set layout\n"
+		throw lut::Error( "Unable to create material descriptor set layout\n"
 			"vkCreateDescriptorSetLayout() returned {}", lut::to_string(res)
 		);
 	}
@@ -495,8 +581,9 @@ lut::DescriptorSetLayout create_post_proc_descriptor_layout( lut::VulkanWindow c
 	bindings[0].descriptorCount = 1;
 	bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+	// mosaic uniform, in the frame's FrameRing region
 	bindings[1].binding = 1;
-	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	bindings[1].descriptorCount = 1;
 	bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
@@ -530,7 +617,7 @@ lut::ImageWithView create_depth_buffer( lut::VulkanWindow const& aWindow, lut::A
 	imageInfo.arrayLayers = 1;
 	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT; // sampled: Hi-Z pyramid
 	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
@@ -570,57 +657,151 @@ lut::ImageWithView create_depth_buffer( lut::VulkanWindow const& aWindow, lut::A
 	return lut::ImageWithView( aAllocator.allocator, image, allocation, view );
 }
 
-lut::ImageWithView create_offscreen_buffer( lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator )
+TransientAttachments create_transient_attachments( lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator, bool aVisbuffer )
 {
-	VkImageCreateInfo imageInfo{};
-	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	imageInfo.imageType = VK_IMAGE_TYPE_2D;
-	imageInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
-	imageInfo.extent.width = aWindow.swapchainExtent.width;
-	imageInfo.extent.height = aWindow.swapchainExtent.height;
-	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
-	imageInfo.arrayLayers = 1;
-	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-	VmaAllocationCreateInfo allocInfo{};
-	allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	struct Attachment
+	{
+		lut::ImageWithView TransientAttachments::* dst;
+		VkFormat          format;
+		VkImageUsageFlags usage;
+	};
+	Attachment const attachments[] = {
+		{ &TransientAttachments::offscreen, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT },
+		{ &TransientAttachments::vis, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT },
+		{ &TransientAttachments::post, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT },
+		// ids, loaded per pixel by the resolve (no filtering)
+		{ &TransientAttachments::visbuffer, cfg::kVisbufferFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT }
+	};
+	std::size_t const count = aVisbuffer ? 4 : 3;
+
+	// lifetimes of the attachments in every frame configuration RenderSystem
+	// can pick: shading renders into offscreen, with either the depth pre-pass
+	// or the visibility buffer (ids) or neither, and either post-process path;
+	// the overdraw/overshading modes (4 and 5) render into vis instead, without
+	// visibility buffer and compute post
+	std::vector<RgLifetime> lifetimes;
+	for( bool const overdraw : { false, true } )
+	{
+		for( bool const visbuffer : { false, true } )
+		{
+			for( bool const prepass : { false, true } )
+			{
+				for( bool const computePost : { false, true } )
+				{
+					if( (visbuffer && (!aVisbuffer || prepass || overdraw)) || (overdraw && computePost) )
+						continue;
+
+					auto const graph = frame_graph_lifetimes( FrameGraphConfig{ prepass, visbuffer, computePost } );
+
+					RgLifetime const config[] = {
+						overdraw ? RgLifetime{} : graph.offscreen,
+						overdraw ? graph.offscreen : RgLifetime{},
+						graph.post,
+						graph.ids
+					};
+					lifetimes.insert( lifetimes.end(), config, config + count );
+				}
+			}
+		}
+	}
 
-	VkImage image = VK_NULL_HANDLE;
-	VmaAllocation allocation = VK_NULL_HANDLE;
+	TransientAttachments ret;
 
-	if( auto const res = vmaCreateImage( aAllocator.allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr ); VK_SUCCESS != res )
+	// images first, memory once the requirements of every alias are known
+	VkMemoryRequirements requirements[4]{};
+	for( std::size_t i = 0; i < count; ++i )
 	{
-		throw lut::Error( "Unable to create offscreen image\n"
-			"vmaCreateImage() returned {}", lut::to_string(res)
-		);
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = attachments[i].format;
+		imageInfo.extent.width = aWindow.swapchainExtent.width;
+		imageInfo.extent.height = aWindow.swapchainExtent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = attachments[i].usage;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VkImage image = VK_NULL_HANDLE;
+		if( auto const res = vkCreateImage( aWindow.device, &imageInfo, nullptr, &image ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create transient attachment\n"
+				"vkCreateImage() returned {}", lut::to_string(res)
+			);
+		}
+
+		// no allocation of its own, see lut::Allocation
+		ret.*attachments[i].dst = lut::ImageWithView( aAllocator.allocator, image );
+
+		vkGetImageMemoryRequirements( aWindow.device, image, &requirements[i] );
+		ret.unaliasedBytes += requirements[i].size;
 	}
 
-	VkImageViewCreateInfo viewInfo{};
-	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-	viewInfo.image = image;
-	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-	viewInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
-	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.levelCount = 1;
-	viewInfo.subresourceRange.baseArrayLayer = 0;
-	viewInfo.subresourceRange.layerCount = 1;
+	auto const slots = plan_transient_aliasing(
+		std::span<VkMemoryRequirements const>( requirements, count ),
+		lifetimes
+	);
+	std::uint32_t const slotCount = 1 + *std::max_element( slots.begin(), slots.end() );
 
-	VkImageView view = VK_NULL_HANDLE;
-	if( auto const res = vkCreateImageView( aWindow.device, &viewInfo, nullptr, &view ); VK_SUCCESS != res )
+	for( std::uint32_t s = 0; s < slotCount; ++s )
 	{
-		vmaDestroyImage( aAllocator.allocator, image, allocation );
-		throw lut::Error( "Unable to create offscreen image view\n"
-			"vkCreateImageView() returned {}", lut::to_string(res)
-		);
+		VkMemoryRequirements merged{ 0, 1, ~0u };
+		for( std::size_t i = 0; i < count; ++i )
+		{
+			if( slots[i] != s )
+				continue;
+
+			merged.size = std::max( merged.size, requirements[i].size );
+			merged.alignment = std::max( merged.alignment, requirements[i].alignment );
+			merged.memoryTypeBits &= requirements[i].memoryTypeBits;
+		}
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+		VmaAllocation allocation = VK_NULL_HANDLE;
+		if( auto const res = vmaAllocateMemory( aAllocator.allocator, &merged, &allocInfo, &allocation, nullptr ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to allocate transient attachment memory\n"
+				"vmaAllocateMemory() returned {}", lut::to_string(res)
+			);
+		}
+
+		ret.memory.emplace_back( lut::Allocation( aAllocator.allocator, allocation ) );
+		ret.allocatedBytes += merged.size;
 	}
 
-	return lut::ImageWithView( aAllocator.allocator, image, allocation, view );
+	for( std::size_t i = 0; i < count; ++i )
+	{
+		auto& target = ret.*attachments[i].dst;
+
+		if( auto const res = vmaBindImageMemory( aAllocator.allocator, ret.memory[slots[i]].allocation, target.image ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to bind transient attachment memory\n"
+				"vmaBindImageMemory() returned {}", lut::to_string(res)
+			);
+		}
+
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = target.image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = attachments[i].format;
+		viewInfo.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		if( auto const res = vkCreateImageView( aWindow.device, &viewInfo, nullptr, &target.view ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create transient attachment view\n"
+				"vkCreateImageView() returned {}", lut::to_string(res)
+			);
+		}
+	}
+
+	return ret;
 }
 
 // creates a generic pipeline for debug visualization
@@ -977,63 +1158,6 @@ lut::Pipeline create_post_proc_pipeline( lut::VulkanWindow const& aWindow, VkPip
 	return lut::Pipeline( aWindow.device, pipe );
 }
 
-lut::ImageWithView create_vis_image( lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator )
-{
-	VkImageCreateInfo imageInfo{};
-	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-	imageInfo.imageType = VK_IMAGE_TYPE_2D;
-	imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
-	imageInfo.extent.width = aWindow.swapchainExtent.width;
-	imageInfo.extent.height = aWindow.swapchainExtent.height;
-	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = 1;
-	imageInfo.arrayLayers = 1;
-	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-
-	// color attachment (for drawing to) + sampled (for resolving from)
-	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-	VmaAllocationCreateInfo allocInfo{};
-	allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-	VkImage image = VK_NULL_HANDLE;
-	VmaAllocation allocation = VK_NULL_HANDLE;
-
-	if( auto const res = vmaCreateImage( aAllocator.allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr ); VK_SUCCESS != res )
-	{
-		throw lut::Error( "Unable to create vis image\n"
-			"vmaCreateImage() returned {}", lut::to_string(res)
-		);
-	}
-
-	VkImageViewCreateInfo viewInfo{};
-	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-	viewInfo.image = image;
-	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-	viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
-	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.levelCount = 1;
-	viewInfo.subresourceRange.baseArrayLayer = 0;
-	viewInfo.subresourceRange.layerCount = 1;
-
-
-	VkImageView view = VK_NULL_HANDLE;
-	if( auto const res = vkCreateImageView( aWindow.device, &viewInfo, nullptr, &view ); VK_SUCCESS != res )
-	{
-
-		vmaDestroyImage( aAllocator.allocator, image, allocation );
-		throw lut::Error( "Unable to create vis image view\n"
-			"vkCreateImageView() returned {}", lut::to_string(res)
-		);
-	}
-
-	return lut::ImageWithView( aAllocator.allocator, image, allocation, view );
-}
-
 lut::Pipeline create_overdraw_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout, VkFormat aColorFormat )
 {
 
@@ -1209,7 +1333,7 @@ lut::Pipeline create_overdraw_pipeline( lut::VulkanWindow const& aWindow, VkPipe
 	return lut::Pipeline( aWindow.device, pipe );
 }
 
-lut::Pipeline create_overshading_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout, VkFormat aColorFormat )
+lut::Pipeline create_overshading_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout, VkFormat aColorFormat, bool aDepthEqual )
 {
 
 	auto const vertSpirV = lut::load_file_u32( cfg::kVertShaderPath );
@@ -1326,11 +1450,12 @@ lut::Pipeline create_overshading_pipeline( lut::VulkanWindow const& aWindow, VkP
 	blendInfo.pAttachments = blendStates;
 
 	// Overshading depth state: test On (LESS), write On
+	// after a depth pre-pass: EQUAL, write Off (what remains is the quad overshading)
 	VkPipelineDepthStencilStateCreateInfo depthInfo{};
 	depthInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 	depthInfo.depthTestEnable = VK_TRUE;
-	depthInfo.depthWriteEnable = VK_TRUE;
-	depthInfo.depthCompareOp = VK_COMPARE_OP_LESS; // Critical for Overshading; all in hehe
+	depthInfo.depthWriteEnable = aDepthEqual ? VK_FALSE : VK_TRUE;
+	depthInfo.depthCompareOp = aDepthEqual ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS; // Critical for Overshading; all in hehe
 	depthInfo.minDepthBounds = 0.f;
 	depthInfo.maxDepthBounds = 1.f;
 
@@ -1540,21 +1665,43 @@ lut::Sampler create_shadow_sampler( lut::VulkanWindow const& aWindow )
 	return lut::Sampler( aWindow.device, sampler );
 }
 
-lut::ImageWithView create_shadow_map( lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator )
+lut::QueryPool create_statistics_pool( lut::VulkanWindow const& aWindow, std::uint32_t aCount, VkQueryPipelineStatisticFlags aStatistics )
+{
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	poolInfo.queryCount = aCount;
+	poolInfo.pipelineStatistics = aStatistics;
+
+	VkQueryPool pool = VK_NULL_HANDLE;
+	if( auto const res = vkCreateQueryPool( aWindow.device, &poolInfo, nullptr, &pool ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create pipeline statistics query pool\n"
+			"vkCreateQueryPool() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::QueryPool( aWindow.device, pool );
+}
+
+ShadowMap create_shadow_map( lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator, std::uint32_t aResolution, VkImageUsageFlags aExtraUsage )
 {
-	// p2_1.5 high resolution shadow map
+	// p2_1.5 shadow map, one layer per cascade
+	ShadowMap ret;
+	ret.resolution = aResolution;
+
 	VkImageCreateInfo imageInfo{};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 	imageInfo.imageType = VK_IMAGE_TYPE_2D;
 	imageInfo.format = cfg::kShadowMapFormat; // D32_SFLOAT
-	imageInfo.extent.width = kShadowMapResolution; // resolution goes brrrr
-	imageInfo.extent.height = kShadowMapResolution;
+	imageInfo.extent.width = aResolution; // resolution goes brrrr
+	imageInfo.extent.height = aResolution;
 	imageInfo.extent.depth = 1;
 	imageInfo.mipLevels = 1;
-	imageInfo.arrayLayers = 1;
+	imageInfo.arrayLayers = cfg::kMaxShadowCascades;
 	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | aExtraUsage;
 	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
@@ -1573,37 +1720,153 @@ lut::ImageWithView create_shadow_map( lut::VulkanWindow const& aWindow, lut::All
 		);
 	}
 
+	lut::Image shadowImage( aAllocator.allocator, image, allocation );
+
+	auto const make_view = [&] (VkImageViewType aType, std::uint32_t aBaseLayer, std::uint32_t aLayerCount) {
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = aType;
+		viewInfo.format = cfg::kShadowMapFormat;
+		viewInfo.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, aBaseLayer, aLayerCount }; // strict depth aspect
+
+		VkImageView view = VK_NULL_HANDLE;
+		if( auto const res = vkCreateImageView( aWindow.device, &viewInfo, nullptr, &view ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create shadow map view\n"
+				"vkCreateImageView() returned {}", lut::to_string(res)
+			);
+		}
+
+		return view;
+	};
+
+	ret.image = lut::ImageWithView( std::move(shadowImage), make_view( VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0, cfg::kMaxShadowCascades ) );
+
+	for( std::uint32_t i = 0; i < cfg::kMaxShadowCascades; ++i )
+		ret.layerViews.emplace_back( aWindow.device, make_view( VK_IMAGE_VIEW_TYPE_2D, i, 1 ) );
+
+	return ret;
+}
+
+PointShadowMap create_point_shadow_map( lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator, std::uint32_t aResolution )
+{
+	PointShadowMap ret;
+	ret.resolution = aResolution;
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.flags = VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = cfg::kShadowMapFormat;
+	imageInfo.extent.width = aResolution;
+	imageInfo.extent.height = aResolution;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 6;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
+
+	if( auto const res = vmaCreateImage( aAllocator.allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create point shadow map image\n"
+			"vmaCreateImage() returned {}", lut::to_string(res)
+		);
+	}
+
+	lut::Image cubeImage( aAllocator.allocator, image, allocation );
+
+	auto const make_view = [&] (VkImageViewType aType, std::uint32_t aFirstLayer, std::uint32_t aLayers) {
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = aType;
+		viewInfo.format = cfg::kShadowMapFormat;
+		viewInfo.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, aFirstLayer, aLayers };
+
+		VkImageView view = VK_NULL_HANDLE;
+		if( auto const res = vkCreateImageView( aWindow.device, &viewInfo, nullptr, &view ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create point shadow map view\n"
+				"vkCreateImageView() returned {}", lut::to_string(res)
+			);
+		}
+
+		return view;
+	};
+
+	ret.image = lut::ImageWithView( std::move(cubeImage), make_view( VK_IMAGE_VIEW_TYPE_CUBE, 0, 6 ) );
+	ret.faces = lut::ImageView( aWindow.device, make_view( VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0, 6 ) );
+	for( std::uint32_t f = 0; f < 6; ++f )
+		ret.face[f] = lut::ImageView( aWindow.device, make_view( VK_IMAGE_VIEW_TYPE_2D, f, 1 ) );
+
+	return ret;
+}
+
+lut::ImageWithView create_shadow_atlas_image( lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator, std::uint32_t aSize )
+{
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = cfg::kShadowMapFormat;
+	imageInfo.extent.width = aSize;
+	imageInfo.extent.height = aSize;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
+
+	if( auto const res = vmaCreateImage( aAllocator.allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create shadow atlas image\n"
+			"vmaCreateImage() returned {}", lut::to_string(res)
+		);
+	}
+
+	lut::Image atlasImage( aAllocator.allocator, image, allocation );
+
 	VkImageViewCreateInfo viewInfo{};
 	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	viewInfo.image = image;
 	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 	viewInfo.format = cfg::kShadowMapFormat;
-	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT; // strict depth aspect
-	viewInfo.subresourceRange.baseMipLevel = 0;
-	viewInfo.subresourceRange.levelCount = 1;
-	viewInfo.subresourceRange.baseArrayLayer = 0;
-	viewInfo.subresourceRange.layerCount = 1;
+	viewInfo.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
 
 	VkImageView view = VK_NULL_HANDLE;
 	if( auto const res = vkCreateImageView( aWindow.device, &viewInfo, nullptr, &view ); VK_SUCCESS != res )
 	{
-
-		vmaDestroyImage( aAllocator.allocator, image, allocation );
-		throw lut::Error( "Unable to create shadow map view\n"
+		throw lut::Error( "Unable to create shadow atlas view\n"
 			"vkCreateImageView() returned {}", lut::to_string(res)
 		);
 	}
 
-	return lut::ImageWithView( aAllocator.allocator, image, allocation, view );
-
-
+	return lut::ImageWithView( std::move(atlasImage), view );
 }
 
-lut::Pipeline create_shadow_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout )
+lut::Pipeline create_shadow_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout, char const* aVertPath, bool aAlphaTested )
 {
-	// Load shader code
-	auto const vertSpirV = lut::load_file_u32( cfg::kShadowVertShaderPath );
-	auto const fragSpirV = lut::load_file_u32( cfg::kShadowFragShaderPath );
+	// Load shader code; opaque casters need no fragment shader
+	auto const vertSpirV = lut::load_file_u32( aVertPath );
+	auto const fragSpirV = aAlphaTested ? lut::load_file_u32( cfg::kShadowFragShaderPath ) : std::vector<std::uint32_t>{};
 
 	VkShaderModuleCreateInfo code[2]{};
 	code[0].sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -1651,11 +1914,12 @@ lut::Pipeline create_shadow_pipeline( lut::VulkanWindow const& aWindow, VkPipeli
 
 	// No location 2
 
+	// opaque: the position stream only
 	VkPipelineVertexInputStateCreateInfo inputInfo{};
 	inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	inputInfo.vertexBindingDescriptionCount = 2; // Reduced
+	inputInfo.vertexBindingDescriptionCount = aAlphaTested ? 2 : 1; // Reduced
 	inputInfo.pVertexBindingDescriptions = vertexInputs;
-	inputInfo.vertexAttributeDescriptionCount = 2; // Reduced
+	inputInfo.vertexAttributeDescriptionCount = aAlphaTested ? 2 : 1; // Reduced
 	inputInfo.pVertexAttributeDescriptions = vertexAttributes;
 
 	VkPipelineInputAssemblyStateCreateInfo assemblyInfo{};
@@ -1721,7 +1985,7 @@ lut::Pipeline create_shadow_pipeline( lut::VulkanWindow const& aWindow, VkPipeli
 	pipeInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 	pipeInfo.pNext = &renderingInfo;
 
-	pipeInfo.stageCount = 2; // vert + frag; alpha discard
+	pipeInfo.stageCount = aAlphaTested ? 2 : 1; // vert + frag; alpha discard
 	pipeInfo.pStages = stages;
 
 	pipeInfo.pVertexInputState = &inputInfo;
@@ -1751,3 +2015,783 @@ lut::Pipeline create_shadow_pipeline( lut::VulkanWindow const& aWindow, VkPipeli
 }
 
 
+
+lut::Pipeline create_prepass_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout, char const* aVertPath, bool aAlphaTested )
+{
+	// opaque: vertex shader only; alpha tested: the shadow map discard shader
+	auto const vertSpirV = lut::load_file_u32( aVertPath );
+	auto const fragSpirV = aAlphaTested ? lut::load_file_u32( cfg::kShadowFragShaderPath ) : std::vector<std::uint32_t>{};
+
+	VkShaderModuleCreateInfo code[2]{};
+	code[0].sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	code[0].codeSize = vertSpirV.size()*sizeof(std::uint32_t);
+	code[0].pCode = vertSpirV.data();
+
+	code[1].sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	code[1].codeSize = fragSpirV.size()*sizeof(std::uint32_t);
+	code[1].pCode = fragSpirV.data();
+
+	VkPipelineShaderStageCreateInfo stages[2]{};
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].pName = "main";
+	stages[0].pNext = &code[0];
+
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].pName = "main";
+	stages[1].pNext = &code[1];
+
+	// positions only; the texture coordinates for the alpha test
+	VkVertexInputBindingDescription vertexInputs[2]{};
+	vertexInputs[0].binding = 0;
+	vertexInputs[0].stride = sizeof(float)*3;
+	vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	vertexInputs[1].binding = 1;
+	vertexInputs[1].stride = sizeof(float)*2;
+	vertexInputs[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	VkVertexInputAttributeDescription vertexAttributes[2]{};
+	vertexAttributes[0].binding = 0;
+	vertexAttributes[0].location = 0;
+	vertexAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+	vertexAttributes[0].offset = 0;
+
+	vertexAttributes[1].binding = 1;
+	vertexAttributes[1].location = 1;
+	vertexAttributes[1].format = VK_FORMAT_R32G32_SFLOAT;
+	vertexAttributes[1].offset = 0;
+
+	VkPipelineVertexInputStateCreateInfo inputInfo{};
+	inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	inputInfo.vertexBindingDescriptionCount = aAlphaTested ? 2 : 1;
+	inputInfo.pVertexBindingDescriptions = vertexInputs;
+	inputInfo.vertexAttributeDescriptionCount = aAlphaTested ? 2 : 1;
+	inputInfo.pVertexAttributeDescriptions = vertexAttributes;
+
+	VkPipelineInputAssemblyStateCreateInfo assemblyInfo{};
+	assemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	assemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	assemblyInfo.primitiveRestartEnable = VK_FALSE;
+
+	// viewport and scissor - will be dynamic
+	VkViewport viewport{};
+	VkRect2D scissor{};
+
+	VkPipelineViewportStateCreateInfo viewportInfo{};
+	viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportInfo.viewportCount = 1;
+	viewportInfo.pViewports = &viewport;
+	viewportInfo.scissorCount = 1;
+	viewportInfo.pScissors = &scissor;
+
+	// same culling as the main pass pipelines, or EQUAL would shade faces the
+	// pre-pass never wrote
+	VkPipelineRasterizationStateCreateInfo rasterInfo{};
+	rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterInfo.depthClampEnable = VK_FALSE;
+	rasterInfo.rasterizerDiscardEnable = VK_FALSE;
+	rasterInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterInfo.cullMode = aAlphaTested ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+	rasterInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterInfo.depthBiasEnable = VK_FALSE;
+	rasterInfo.lineWidth = 1.f;
+
+	VkPipelineMultisampleStateCreateInfo samplingInfo{};
+	samplingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	samplingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	// No color attachment
+	VkPipelineColorBlendStateCreateInfo blendInfo{};
+	blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	blendInfo.logicOpEnable = VK_FALSE;
+	blendInfo.attachmentCount = 0;
+	blendInfo.pAttachments = nullptr;
+
+	VkPipelineDepthStencilStateCreateInfo depthInfo{};
+	depthInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthInfo.depthTestEnable = VK_TRUE;
+	depthInfo.depthWriteEnable = VK_TRUE;
+	depthInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	depthInfo.minDepthBounds = 0.f;
+	depthInfo.maxDepthBounds = 1.f;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicInfo{};
+	dynamicInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicInfo.dynamicStateCount = 2;
+	dynamicInfo.pDynamicStates = dynamicStates;
+
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingInfo.colorAttachmentCount = 0; // No color attachment
+	renderingInfo.pColorAttachmentFormats = nullptr;
+	renderingInfo.depthAttachmentFormat = cfg::kDepthFormat;
+
+	VkGraphicsPipelineCreateInfo pipeInfo{};
+	pipeInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipeInfo.pNext = &renderingInfo;
+
+	pipeInfo.stageCount = aAlphaTested ? 2 : 1;
+	pipeInfo.pStages = stages;
+
+	pipeInfo.pVertexInputState = &inputInfo;
+	pipeInfo.pInputAssemblyState = &assemblyInfo;
+	pipeInfo.pTessellationState = nullptr;
+	pipeInfo.pViewportState = &viewportInfo;
+	pipeInfo.pRasterizationState = &rasterInfo;
+	pipeInfo.pMultisampleState = &samplingInfo;
+	pipeInfo.pDepthStencilState = &depthInfo;
+	pipeInfo.pColorBlendState = &blendInfo;
+	pipeInfo.pDynamicState = &dynamicInfo;
+
+	pipeInfo.layout = aPipelineLayout;
+	pipeInfo.subpass = 0;
+
+	VkPipeline pipe = VK_NULL_HANDLE;
+	if( auto const res = vkCreateGraphicsPipelines( aWindow.device, VK_NULL_HANDLE, 1, &pipeInfo, nullptr, &pipe ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create depth pre-pass pipeline\n"
+			"vkCreateGraphicsPipelines() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::Pipeline( aWindow.device, pipe );
+}
+
+
+// visibility buffer
+lut::DescriptorSetLayout create_visbuffer_descriptor_layout( lut::VulkanWindow const& aWindow )
+{
+	// 0: visibility buffer, 1: meshes, 2: indices, 3: positions, 4: texcoords, 5: normals
+	VkDescriptorSetLayoutBinding bindings[6]{};
+	for( std::uint32_t i = 0; i < 6; ++i )
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = sizeof(bindings)/sizeof(bindings[0]);
+	layoutInfo.pBindings = bindings;
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if( auto const res = vkCreateDescriptorSetLayout( aWindow.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create visibility buffer descriptor set layout\n"
+			"vkCreateDescriptorSetLayout() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::DescriptorSetLayout( aWindow.device, layout );
+}
+
+lut::PipelineLayout create_visbuffer_resolve_pipeline_layout( lut::VulkanContext const& aContext, VkDescriptorSetLayout aSceneLayout, VkDescriptorSetLayout aObjectLayout, VkDescriptorSetLayout aVisbufferLayout )
+{
+	VkDescriptorSetLayout layouts[] = {
+		aSceneLayout,    // set 0: scene UBO, instances, shadow maps, lights
+		aObjectLayout,   // set 1: bindless materials
+		aVisbufferLayout // set 2
+	};
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = sizeof(layouts)/sizeof(layouts[0]);
+	layoutInfo.pSetLayouts = layouts;
+
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	if( auto const res = vkCreatePipelineLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create visibility buffer resolve pipeline layout\n"
+			"vkCreatePipelineLayout() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::PipelineLayout( aContext.device, layout );
+}
+
+lut::Pipeline create_visbuffer_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout, char const* aVertPath, bool aAlphaTested )
+{
+	auto const vertSpirV = lut::load_file_u32( aVertPath );
+	auto const fragSpirV = lut::load_file_u32( aAlphaTested ? cfg::kVisbufferAlphaFragShaderPath : cfg::kVisbufferFragShaderPath );
+
+	VkShaderModuleCreateInfo code[2]{};
+	code[0].sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	code[0].codeSize = vertSpirV.size()*sizeof(std::uint32_t);
+	code[0].pCode = vertSpirV.data();
+
+	code[1].sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	code[1].codeSize = fragSpirV.size()*sizeof(std::uint32_t);
+	code[1].pCode = fragSpirV.data();
+
+	VkPipelineShaderStageCreateInfo stages[2]{};
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].pName = "main";
+	stages[0].pNext = &code[0];
+
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].pName = "main";
+	stages[1].pNext = &code[1];
+
+	// positions only; the texture coordinates for the alpha test
+	VkVertexInputBindingDescription vertexInputs[2]{};
+	vertexInputs[0].binding = 0;
+	vertexInputs[0].stride = sizeof(float)*3;
+	vertexInputs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	vertexInputs[1].binding = 1;
+	vertexInputs[1].stride = sizeof(float)*2;
+	vertexInputs[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	VkVertexInputAttributeDescription vertexAttributes[2]{};
+	vertexAttributes[0].binding = 0;
+	vertexAttributes[0].location = 0;
+	vertexAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+	vertexAttributes[0].offset = 0;
+
+	vertexAttributes[1].binding = 1;
+	vertexAttributes[1].location = 1;
+	vertexAttributes[1].format = VK_FORMAT_R32G32_SFLOAT;
+	vertexAttributes[1].offset = 0;
+
+	VkPipelineVertexInputStateCreateInfo inputInfo{};
+	inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	inputInfo.vertexBindingDescriptionCount = aAlphaTested ? 2 : 1;
+	inputInfo.pVertexBindingDescriptions = vertexInputs;
+	inputInfo.vertexAttributeDescriptionCount = aAlphaTested ? 2 : 1;
+	inputInfo.pVertexAttributeDescriptions = vertexAttributes;
+
+	VkPipelineInputAssemblyStateCreateInfo assemblyInfo{};
+	assemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	assemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	assemblyInfo.primitiveRestartEnable = VK_FALSE;
+
+	// viewport and scissor - will be dynamic
+	VkViewport viewport{};
+	VkRect2D scissor{};
+
+	VkPipelineViewportStateCreateInfo viewportInfo{};
+	viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportInfo.viewportCount = 1;
+	viewportInfo.pViewports = &viewport;
+	viewportInfo.scissorCount = 1;
+	viewportInfo.pScissors = &scissor;
+
+	// same culling as the forward main pass pipelines
+	VkPipelineRasterizationStateCreateInfo rasterInfo{};
+	rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterInfo.depthClampEnable = VK_FALSE;
+	rasterInfo.rasterizerDiscardEnable = VK_FALSE;
+	rasterInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterInfo.cullMode = aAlphaTested ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+	rasterInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterInfo.depthBiasEnable = VK_FALSE;
+	rasterInfo.lineWidth = 1.f;
+
+	VkPipelineMultisampleStateCreateInfo samplingInfo{};
+	samplingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	samplingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	// integer attachment, no blending
+	VkPipelineColorBlendAttachmentState blendStates[1]{};
+	blendStates[0].blendEnable = VK_FALSE;
+	blendStates[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT;
+
+	VkPipelineColorBlendStateCreateInfo blendInfo{};
+	blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	blendInfo.logicOpEnable = VK_FALSE;
+	blendInfo.attachmentCount = 1;
+	blendInfo.pAttachments = blendStates;
+
+	VkPipelineDepthStencilStateCreateInfo depthInfo{};
+	depthInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthInfo.depthTestEnable = VK_TRUE;
+	depthInfo.depthWriteEnable = VK_TRUE;
+	depthInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	depthInfo.minDepthBounds = 0.f;
+	depthInfo.maxDepthBounds = 1.f;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicInfo{};
+	dynamicInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicInfo.dynamicStateCount = 2;
+	dynamicInfo.pDynamicStates = dynamicStates;
+
+	VkFormat const colorFormat = cfg::kVisbufferFormat;
+
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &colorFormat;
+	renderingInfo.depthAttachmentFormat = cfg::kDepthFormat;
+
+	VkGraphicsPipelineCreateInfo pipeInfo{};
+	pipeInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipeInfo.pNext = &renderingInfo;
+
+	pipeInfo.stageCount = 2;
+	pipeInfo.pStages = stages;
+
+	pipeInfo.pVertexInputState = &inputInfo;
+	pipeInfo.pInputAssemblyState = &assemblyInfo;
+	pipeInfo.pTessellationState = nullptr;
+	pipeInfo.pViewportState = &viewportInfo;
+	pipeInfo.pRasterizationState = &rasterInfo;
+	pipeInfo.pMultisampleState = &samplingInfo;
+	pipeInfo.pDepthStencilState = &depthInfo;
+	pipeInfo.pColorBlendState = &blendInfo;
+	pipeInfo.pDynamicState = &dynamicInfo;
+
+	pipeInfo.layout = aPipelineLayout;
+	pipeInfo.subpass = 0;
+
+	VkPipeline pipe = VK_NULL_HANDLE;
+	if( auto const res = vkCreateGraphicsPipelines( aWindow.device, VK_NULL_HANDLE, 1, &pipeInfo, nullptr, &pipe ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create visibility buffer pipeline\n"
+			"vkCreateGraphicsPipelines() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::Pipeline( aWindow.device, pipe );
+}
+
+lut::Pipeline create_visbuffer_resolve_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout, VkFormat aColorFormat )
+{
+	auto const vertSpirV = lut::load_file_u32( cfg::kFullscreenVertShaderPath );
+	auto const fragSpirV = lut::load_file_u32( cfg::kVisbufferResolveFragShaderPath );
+
+	VkShaderModuleCreateInfo code[2]{};
+	code[0].sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	code[0].codeSize = vertSpirV.size()*sizeof(std::uint32_t);
+	code[0].pCode = vertSpirV.data();
+
+	code[1].sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	code[1].codeSize = fragSpirV.size()*sizeof(std::uint32_t);
+	code[1].pCode = fragSpirV.data();
+
+	VkPipelineShaderStageCreateInfo stages[2]{};
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].pName = "main";
+	stages[0].pNext = &code[0];
+
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].pName = "main";
+	stages[1].pNext = &code[1];
+
+	// full-screen triangle from gl_VertexIndex
+	VkPipelineVertexInputStateCreateInfo inputInfo{};
+	inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo assemblyInfo{};
+	assemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	assemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	assemblyInfo.primitiveRestartEnable = VK_FALSE;
+
+	// viewport and scissor - will be dynamic
+	VkViewport viewport{};
+	VkRect2D scissor{};
+
+	VkPipelineViewportStateCreateInfo viewportInfo{};
+	viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportInfo.viewportCount = 1;
+	viewportInfo.pViewports = &viewport;
+	viewportInfo.scissorCount = 1;
+	viewportInfo.pScissors = &scissor;
+
+	VkPipelineRasterizationStateCreateInfo rasterInfo{};
+	rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterInfo.depthClampEnable = VK_FALSE;
+	rasterInfo.rasterizerDiscardEnable = VK_FALSE;
+	rasterInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterInfo.cullMode = VK_CULL_MODE_NONE;
+	rasterInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	rasterInfo.depthBiasEnable = VK_FALSE;
+	rasterInfo.lineWidth = 1.f;
+
+	VkPipelineMultisampleStateCreateInfo samplingInfo{};
+	samplingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	samplingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineColorBlendAttachmentState blendStates[1]{};
+	blendStates[0].blendEnable = VK_FALSE;
+	blendStates[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	VkPipelineColorBlendStateCreateInfo blendInfo{};
+	blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	blendInfo.logicOpEnable = VK_FALSE;
+	blendInfo.attachmentCount = 1;
+	blendInfo.pAttachments = blendStates;
+
+	// no depth attachment, the raster pass resolved visibility already
+	VkPipelineDepthStencilStateCreateInfo depthInfo{};
+	depthInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthInfo.depthTestEnable = VK_FALSE;
+	depthInfo.depthWriteEnable = VK_FALSE;
+	depthInfo.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+	depthInfo.minDepthBounds = 0.f;
+	depthInfo.maxDepthBounds = 1.f;
+
+	VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicInfo{};
+	dynamicInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicInfo.dynamicStateCount = 2;
+	dynamicInfo.pDynamicStates = dynamicStates;
+
+	VkPipelineRenderingCreateInfo renderingInfo{};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &aColorFormat;
+
+	VkGraphicsPipelineCreateInfo pipeInfo{};
+	pipeInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipeInfo.pNext = &renderingInfo;
+	pipeInfo.stageCount = 2;
+	pipeInfo.pStages = stages;
+	pipeInfo.pVertexInputState = &inputInfo;
+	pipeInfo.pInputAssemblyState = &assemblyInfo;
+	pipeInfo.pTessellationState = nullptr;
+	pipeInfo.pViewportState = &viewportInfo;
+	pipeInfo.pRasterizationState = &rasterInfo;
+	pipeInfo.pMultisampleState = &samplingInfo;
+	pipeInfo.pDepthStencilState = &depthInfo;
+	pipeInfo.pColorBlendState = &blendInfo;
+	pipeInfo.pDynamicState = &dynamicInfo;
+	pipeInfo.layout = aPipelineLayout;
+	pipeInfo.subpass = 0;
+
+	VkPipeline pipe = VK_NULL_HANDLE;
+	if( auto const res = vkCreateGraphicsPipelines( aWindow.device, VK_NULL_HANDLE, 1, &pipeInfo, nullptr, &pipe ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create visibility buffer resolve pipeline\n"
+			"vkCreateGraphicsPipelines() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::Pipeline( aWindow.device, pipe );
+}
+
+// GPU-driven culling
+// set 1 of the cull pipeline: meshes, main draws, shadow draws, draw counts
+lut::DescriptorSetLayout create_cull_descriptor_layout( lut::VulkanWindow const& aWindow )
+{
+	// 0: meshes, 1: main draws, 2: shadow draws, 3: draw counts,
+	// 4: late (phase 1) draws, 5: visibility, 6: depth pyramid, 7: point shadow draws
+	VkDescriptorSetLayoutBinding bindings[8]{};
+	for( std::uint32_t i = 0; i < 8; ++i )
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	bindings[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = sizeof(bindings)/sizeof(bindings[0]);
+	layoutInfo.pBindings = bindings;
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if( auto const res = vkCreateDescriptorSetLayout( aWindow.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create cull descriptor set layout\n"
+			"vkCreateDescriptorSetLayout() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::DescriptorSetLayout( aWindow.device, layout );
+}
+
+lut::PipelineLayout create_cull_pipeline_layout( lut::VulkanContext const& aContext, VkDescriptorSetLayout aSceneLayout, VkDescriptorSetLayout aCullLayout )
+{
+	VkDescriptorSetLayout layouts[] = {
+		aSceneLayout, // set 0: scene UBO + instances
+		aCullLayout   // set 1
+	};
+
+	VkPushConstantRange pushConstant{};
+	pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(glsl::CullPush);
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = sizeof(layouts)/sizeof(layouts[0]);
+	layoutInfo.pSetLayouts = layouts;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstant;
+
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	if( auto const res = vkCreatePipelineLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create cull pipeline layout\n"
+			"vkCreatePipelineLayout() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::PipelineLayout( aContext.device, layout );
+}
+
+lut::Pipeline create_cull_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout )
+{
+	return create_compute_pipeline( aWindow, aPipelineLayout, cfg::kCullCompShaderPath, "cull" );
+}
+
+lut::PipelineLayout create_light_cluster_pipeline_layout( lut::VulkanContext const& aContext, VkDescriptorSetLayout aSceneLayout )
+{
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &aSceneLayout;
+
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	if( auto const res = vkCreatePipelineLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create light cluster pipeline layout\n"
+			"vkCreatePipelineLayout() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::PipelineLayout( aContext.device, layout );
+}
+
+lut::Pipeline create_light_cluster_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout )
+{
+	return create_compute_pipeline( aWindow, aPipelineLayout, cfg::kLightClusterCompShaderPath, "light cluster" );
+}
+
+bool compute_post_supported( lut::VulkanWindow const& aWindow )
+{
+	VkSurfaceCapabilitiesKHR caps{};
+	if( auto const res = vkGetPhysicalDeviceSurfaceCapabilitiesKHR( aWindow.physicalDevice, aWindow.surface, &caps ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to get surface capabilities\n"
+			"vkGetPhysicalDeviceSurfaceCapabilitiesKHR() returned {}", lut::to_string(res)
+		);
+	}
+
+	VkFormatProperties props{};
+	vkGetPhysicalDeviceFormatProperties( aWindow.physicalDevice, aWindow.swapchainFormat, &props );
+
+	return (caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+		&& (props.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT);
+}
+
+lut::DescriptorSetLayout create_compute_post_descriptor_layout( lut::VulkanWindow const& aWindow )
+{
+	VkDescriptorSetLayoutBinding bindings[2]{};
+	bindings[0].binding = 0; // offscreen color
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	bindings[1].binding = 1; // post output
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = sizeof(bindings)/sizeof(bindings[0]);
+	layoutInfo.pBindings = bindings;
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if( auto const res = vkCreateDescriptorSetLayout( aWindow.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create compute post descriptor set layout\n"
+			"vkCreateDescriptorSetLayout() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::DescriptorSetLayout( aWindow.device, layout );
+}
+
+lut::PipelineLayout create_compute_post_pipeline_layout( lut::VulkanContext const& aContext, VkDescriptorSetLayout aPostLayout )
+{
+	VkPushConstantRange pushConstant{};
+	pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(glsl::PostPush);
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &aPostLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstant;
+
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	if( auto const res = vkCreatePipelineLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create compute post pipeline layout\n"
+			"vkCreatePipelineLayout() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::PipelineLayout( aContext.device, layout );
+}
+
+lut::Pipeline create_compute_post_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout )
+{
+	return create_compute_pipeline( aWindow, aPipelineLayout, cfg::kPostCompShaderPath, "compute post" );
+}
+
+DepthPyramid create_depth_pyramid( lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator )
+{
+	DepthPyramid ret;
+
+	// round down to a power of two, every level is then exactly half of the previous one
+	ret.width = std::bit_floor( aWindow.swapchainExtent.width );
+	ret.height = std::bit_floor( aWindow.swapchainExtent.height );
+	ret.levels = std::min( std::uint32_t(std::bit_width( std::max( ret.width, ret.height ) )), cfg::kMaxDepthPyramidLevels );
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = cfg::kDepthPyramidFormat;
+	imageInfo.extent.width = ret.width;
+	imageInfo.extent.height = ret.height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = ret.levels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
+
+	if( auto const res = vmaCreateImage( aAllocator.allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create depth pyramid image\n"
+			"vmaCreateImage() returned {}", lut::to_string(res)
+		);
+	}
+
+	lut::Image pyramid( aAllocator.allocator, image, allocation );
+
+	auto const make_view = [&] (std::uint32_t aBaseLevel, std::uint32_t aLevelCount) {
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = cfg::kDepthPyramidFormat;
+		viewInfo.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, aBaseLevel, aLevelCount, 0, 1 };
+
+		VkImageView view = VK_NULL_HANDLE;
+		if( auto const res = vkCreateImageView( aWindow.device, &viewInfo, nullptr, &view ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create depth pyramid view\n"
+				"vkCreateImageView() returned {}", lut::to_string(res)
+			);
+		}
+
+		return view;
+	};
+
+	// all levels, sampled by cull.comp
+	ret.image = lut::ImageWithView( std::move(pyramid), make_view( 0, ret.levels ) );
+
+	for( std::uint32_t i = 0; i < ret.levels; ++i )
+		ret.levelViews.emplace_back( aWindow.device, make_view( i, 1 ) );
+
+	return ret;
+}
+
+lut::Sampler create_depth_pyramid_sampler( lut::VulkanWindow const& aWindow )
+{
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST; // explicit level in cull.comp
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.minLod = 0.f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	VkSampler sampler = VK_NULL_HANDLE;
+	if( auto const res = vkCreateSampler( aWindow.device, &samplerInfo, nullptr, &sampler ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create depth pyramid sampler\n"
+			"vkCreateSampler() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::Sampler( aWindow.device, sampler );
+}
+
+lut::DescriptorSetLayout create_depth_reduce_descriptor_layout( lut::VulkanWindow const& aWindow )
+{
+	VkDescriptorSetLayoutBinding bindings[2]{};
+	bindings[0].binding = 0; // source level (or depth buffer)
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	bindings[1].binding = 1; // target level
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = sizeof(bindings)/sizeof(bindings[0]);
+	layoutInfo.pBindings = bindings;
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if( auto const res = vkCreateDescriptorSetLayout( aWindow.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create depth reduce descriptor set layout\n"
+			"vkCreateDescriptorSetLayout() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::DescriptorSetLayout( aWindow.device, layout );
+}
+
+lut::PipelineLayout create_depth_reduce_pipeline_layout( lut::VulkanContext const& aContext, VkDescriptorSetLayout aReduceLayout )
+{
+	VkPushConstantRange pushConstant{};
+	pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstant.offset = 0;
+	pushConstant.size = sizeof(glsl::DepthReducePush);
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &aReduceLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstant;
+
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	if( auto const res = vkCreatePipelineLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create depth reduce pipeline layout\n"
+			"vkCreatePipelineLayout() returned {}", lut::to_string(res)
+		);
+	}
+
+	return lut::PipelineLayout( aContext.device, layout );
+}
+
+lut::Pipeline create_depth_reduce_pipeline( lut::VulkanWindow const& aWindow, VkPipelineLayout aPipelineLayout )
+{
+	return create_compute_pipeline( aWindow, aPipelineLayout, cfg::kDepthReduceCompShaderPath, "depth reduce" );
+}
@@ -1,12 +1,13 @@
 #pragma once
 
 #include <volk/volk.h>
+#include <vector>
 #include "../../Rhi/vulkan_window.hpp"
 #include "../../Rhi/vkobject.hpp"
 #include "../../Rhi/vkimage.hpp"
+#include "../../Rhi/allocator.hpp"
 
 namespace lut = labut2;
-constexpr std::uint32_t kShadowMapResolution = 200; // 2048 for high quality; also tested with lower values
 namespace cfg
 {
 	// Compiled shader code for the graphics pipeline
@@ -17,6 +18,9 @@ namespace cfg
 	
 	constexpr VkFormat kDepthFormat = VK_FORMAT_D32_SFLOAT;
 
+	constexpr float kStatsInterval = 2.f; // seconds between [stats] lines on stderr
+	constexpr char const* kGpuProfilePath = "gpu_profile.csv"; // per pass GPU times, key 0
+
 	constexpr char const* kAlphaVertShaderPath = SHADERDIR_ "default.vert.spv";
 	constexpr char const* kAlphaFragShaderPath = SHADERDIR_ "alpha.frag.spv";
 	
@@ -33,7 +37,53 @@ namespace cfg
 	// p2_1.5 shadow mapping
 	constexpr char const* kShadowVertShaderPath = SHADERDIR_ "shadowmap.vert.spv";
 	constexpr char const* kShadowFragShaderPath = SHADERDIR_ "shadowmap.frag.spv";
+	constexpr char const* kShadowOpaqueVertShaderPath = SHADERDIR_ "shadowmap_opaque.vert.spv";
 	constexpr VkFormat kShadowMapFormat = VK_FORMAT_D32_SFLOAT;
+
+	// GPU-driven rendering
+	constexpr char const* kCullCompShaderPath = SHADERDIR_ "cull.comp.spv";
+	constexpr char const* kIndirectVertShaderPath = SHADERDIR_ "default_indirect.vert.spv";
+	constexpr char const* kShadowIndirectVertShaderPath = SHADERDIR_ "shadowmap_indirect.vert.spv";
+	constexpr char const* kShadowOpaqueIndirectVertShaderPath = SHADERDIR_ "shadowmap_opaque_indirect.vert.spv";
+
+	// point light cube shadow map (layered, see shadows.hpp)
+	constexpr char const* kPointShadowVertShaderPath = SHADERDIR_ "pointshadow.vert.spv";
+	constexpr char const* kPointShadowOpaqueVertShaderPath = SHADERDIR_ "pointshadow_opaque.vert.spv";
+	constexpr char const* kPointShadowIndirectVertShaderPath = SHADERDIR_ "pointshadow_indirect.vert.spv";
+	// one pass per face (mode 2), without gl_Layer
+	constexpr char const* kPointShadowFaceVertShaderPath = SHADERDIR_ "pointshadow_face.vert.spv";
+	constexpr char const* kPointShadowFaceOpaqueVertShaderPath = SHADERDIR_ "pointshadow_face_opaque.vert.spv";
+
+	// spot light shadow atlas (see shadow_atlas.hpp)
+	constexpr char const* kSpotShadowVertShaderPath = SHADERDIR_ "spotshadow.vert.spv";
+	constexpr char const* kSpotShadowOpaqueVertShaderPath = SHADERDIR_ "spotshadow_opaque.vert.spv";
+
+	// depth pre-pass: position only (opaque), position + uv (alpha tested, shadowmap.frag)
+	constexpr char const* kPrepassVertShaderPath = SHADERDIR_ "prepass.vert.spv";
+	constexpr char const* kPrepassAlphaVertShaderPath = SHADERDIR_ "prepass_alpha.vert.spv";
+	constexpr char const* kPrepassIndirectVertShaderPath = SHADERDIR_ "prepass_indirect.vert.spv";
+	constexpr char const* kPrepassAlphaIndirectVertShaderPath = SHADERDIR_ "prepass_alpha_indirect.vert.spv";
+
+	// visibility buffer: instance and triangle ids per pixel, shaded by a full-screen resolve
+	constexpr char const* kVisbufferVertShaderPath = SHADERDIR_ "visbuffer.vert.spv";
+	constexpr char const* kVisbufferAlphaVertShaderPath = SHADERDIR_ "visbuffer_alpha.vert.spv";
+	constexpr char const* kVisbufferIndirectVertShaderPath = SHADERDIR_ "visbuffer_indirect.vert.spv";
+	constexpr char const* kVisbufferAlphaIndirectVertShaderPath = SHADERDIR_ "visbuffer_alpha_indirect.vert.spv";
+	constexpr char const* kVisbufferFragShaderPath = SHADERDIR_ "visbuffer.frag.spv";
+	constexpr char const* kVisbufferAlphaFragShaderPath = SHADERDIR_ "visbuffer_alpha.frag.spv";
+	constexpr char const* kVisbufferResolveFragShaderPath = SHADERDIR_ "visbuffer_resolve.frag.spv";
+	constexpr VkFormat kVisbufferFormat = VK_FORMAT_R32G32_UINT;
+
+	// clustered lighting, see clustered_lights.hpp
+	constexpr char const* kLightClusterCompShaderPath = SHADERDIR_ "light_cluster.comp.spv";
+
+	// Hi-Z occlusion culling
+	constexpr char const* kDepthReduceCompShaderPath = SHADERDIR_ "depth_reduce.comp.spv";
+	constexpr VkFormat kDepthPyramidFormat = VK_FORMAT_R32_SFLOAT;
+	constexpr std::uint32_t kMaxDepthPyramidLevels = 16;
+
+	// compute post-processing, see ComputePostPass
+	constexpr char const* kPostCompShaderPath = SHADERDIR_ "post.comp.spv";
 	
 #	undef SHADERDIR_
 }
@@ -45,31 +95,123 @@ struct ImageAndView
 };
 
 lut::DescriptorSetLayout create_scene_descriptor_layout( lut::VulkanWindow const& );
+// set 1: material buffer + bindless texture array (update-after-bind), see materials.hpp
 lut::DescriptorSetLayout create_object_descriptor_layout( lut::VulkanWindow const& );
 lut::DescriptorSetLayout create_post_proc_descriptor_layout( lut::VulkanWindow const& );
 
 lut::ImageWithView create_depth_buffer( lut::VulkanWindow const&, lut::Allocator const& );
-lut::ImageWithView create_offscreen_buffer( lut::VulkanWindow const&, lut::Allocator const& );
-lut::ImageWithView create_vis_image( lut::VulkanWindow const&, lut::Allocator const& );
+
+// swapchain sized color targets that only live within a frame (see render_graph.hpp);
+// the ones whose frame graph lifetimes never overlap share memory
+struct TransientAttachments
+{
+	std::vector<lut::Allocation> memory; // one per alias slot, outlives the images
+
+	lut::ImageWithView offscreen; // shading target, R16G16B16A16_SFLOAT
+	lut::ImageWithView vis;       // overdraw/overshading target (p2_1.1), R8G8B8A8_UNORM
+	lut::ImageWithView post;      // compute post-processing output, R16G16B16A16_SFLOAT
+	lut::ImageWithView visbuffer; // visibility buffer ids (cfg::kVisbufferFormat), aVisbuffer only
+
+	VkDeviceSize allocatedBytes = 0;
+	VkDeviceSize unaliasedBytes = 0; // one allocation per image
+};
+
+TransientAttachments create_transient_attachments( lut::VulkanWindow const&, lut::Allocator const&, bool aVisbuffer );
 
 // p2_1.5 shadow mapping
-lut::ImageWithView create_shadow_map( lut::VulkanWindow const&, lut::Allocator const& );
+// one layer per cascade (cfg::kMaxShadowCascades, see shadows.hpp); the resolution
+// is a runtime setting (UserState::shadowResolution), the image is recreated when it changes
+struct ShadowMap
+{
+	lut::ImageWithView image; // 2D array view over all cascades, sampled
+	std::vector<lut::ImageView> layerViews; // one per cascade, render targets
+	std::uint32_t resolution = 0;
+};
+
+// aExtraUsage: TRANSFER_SRC/DST for the static shadow cache copy
+ShadowMap create_shadow_map( lut::VulkanWindow const&, lut::Allocator const&, std::uint32_t aResolution, VkImageUsageFlags aExtraUsage = 0 );
 lut::Sampler create_shadow_sampler( lut::VulkanWindow const& );
 
+// point light cube shadow map (see shadows.hpp): cube view for sampling, 2D array
+// view over the six faces as the layered render target
+struct PointShadowMap
+{
+	lut::ImageWithView image; // cube view, sampled
+	lut::ImageView faces;     // 2D array view, render target
+	lut::ImageView face[6];   // 2D view per face, render targets of one pass per face
+	std::uint32_t resolution = 0;
+};
+
+PointShadowMap create_point_shadow_map( lut::VulkanWindow const&, lut::Allocator const&, std::uint32_t aResolution );
+
+// spot light shadow atlas (see shadow_atlas.hpp), one depth image; the tiles are
+// render areas of the same view
+lut::ImageWithView create_shadow_atlas_image( lut::VulkanWindow const&, lut::Allocator const&, std::uint32_t aSize );
+
+// requires the pipelineStatisticsQuery feature, e.g. the depth pre-pass fragment invocations
+lut::QueryPool create_statistics_pool( lut::VulkanWindow const&, std::uint32_t aCount, VkQueryPipelineStatisticFlags );
+
 lut::PipelineLayout create_triangle_pipeline_layout( lut::VulkanContext const&, VkDescriptorSetLayout, VkDescriptorSetLayout );
 lut::PipelineLayout create_post_proc_pipeline_layout( lut::VulkanContext const&, VkDescriptorSetLayout );
 
-lut::Pipeline create_triangle_pipeline( lut::VulkanWindow const&, VkPipelineLayout, VkFormat = VK_FORMAT_B8G8R8A8_SRGB );
+// aDepthEqual: main pass after a depth pre-pass, depth test EQUAL without writes
+lut::Pipeline create_triangle_pipeline( lut::VulkanWindow const&, VkPipelineLayout, VkFormat = VK_FORMAT_B8G8R8A8_SRGB, char const* aVertPath = cfg::kVertShaderPath, bool aDepthEqual = false );
 lut::Pipeline create_debug_pipeline( lut::VulkanWindow const&, VkPipelineLayout, char const* aVertPath, char const* aFragPath, VkFormat = VK_FORMAT_B8G8R8A8_SRGB );
-lut::Pipeline create_alpha_pipeline( lut::VulkanWindow const&, VkPipelineLayout, VkFormat = VK_FORMAT_B8G8R8A8_SRGB );
+lut::Pipeline create_alpha_pipeline( lut::VulkanWindow const&, VkPipelineLayout, VkFormat = VK_FORMAT_B8G8R8A8_SRGB, char const* aVertPath = cfg::kAlphaVertShaderPath, bool aDepthEqual = false );
 lut::Pipeline create_post_proc_pipeline( lut::VulkanWindow const&, VkPipelineLayout, VkDescriptorSetLayout );
 
 lut::Pipeline create_overdraw_pipeline( lut::VulkanWindow const&, VkPipelineLayout, VkFormat = VK_FORMAT_R8G8B8A8_UNORM );
-lut::Pipeline create_overshading_pipeline( lut::VulkanWindow const&, VkPipelineLayout, VkFormat = VK_FORMAT_R8G8B8A8_UNORM );
+lut::Pipeline create_overshading_pipeline( lut::VulkanWindow const&, VkPipelineLayout, VkFormat = VK_FORMAT_R8G8B8A8_UNORM, bool aDepthEqual = false );
 lut::Pipeline create_vis_resolve_pipeline( lut::VulkanWindow const&, VkPipelineLayout, VkDescriptorSetLayout );
 
 // p2_1.5 shadow mapping
-lut::Pipeline create_shadow_pipeline( lut::VulkanWindow const&, VkPipelineLayout );
+// !aAlphaTested: opaque casters, position stream only and no fragment shader
+// (aVertPath one of the *_opaque shaders)
+lut::Pipeline create_shadow_pipeline( lut::VulkanWindow const&, VkPipelineLayout, char const* aVertPath = cfg::kShadowVertShaderPath, bool aAlphaTested = true );
+
+// depth pre-pass: depth only into the main depth buffer, no color attachment
+lut::Pipeline create_prepass_pipeline( lut::VulkanWindow const&, VkPipelineLayout, char const* aVertPath, bool aAlphaTested );
+
+// visibility buffer: (instance, triangle) per pixel in a cfg::kVisbufferFormat
+// image (TransientAttachments::visbuffer), the main pass color attachment and the
+// resolve's storage image
+// set 2 of the resolve: visibility buffer, meshes, indices, positions, texcoords, normals
+lut::DescriptorSetLayout create_visbuffer_descriptor_layout( lut::VulkanWindow const& );
+lut::PipelineLayout create_visbuffer_resolve_pipeline_layout( lut::VulkanContext const&, VkDescriptorSetLayout aSceneLayout, VkDescriptorSetLayout aObjectLayout, VkDescriptorSetLayout aVisbufferLayout );
+// ids only; !aAlphaTested: position stream only (aVertPath one of the visbuffer*.vert)
+lut::Pipeline create_visbuffer_pipeline( lut::VulkanWindow const&, VkPipelineLayout, char const* aVertPath, bool aAlphaTested );
+// full-screen triangle, shades into the offscreen target
+lut::Pipeline create_visbuffer_resolve_pipeline( lut::VulkanWindow const&, VkPipelineLayout, VkFormat aColorFormat );
 
 lut::Sampler create_debug_sampler( lut::VulkanWindow const& );
 lut::Sampler create_post_proc_sampler( lut::VulkanWindow const& );
+
+// GPU-driven culling
+lut::DescriptorSetLayout create_cull_descriptor_layout( lut::VulkanWindow const& );
+lut::PipelineLayout create_cull_pipeline_layout( lut::VulkanContext const&, VkDescriptorSetLayout aSceneLayout, VkDescriptorSetLayout aCullLayout );
+lut::Pipeline create_cull_pipeline( lut::VulkanWindow const&, VkPipelineLayout );
+
+// clustered lighting: light binning over set 0 only (lights in, cluster lists out)
+lut::PipelineLayout create_light_cluster_pipeline_layout( lut::VulkanContext const&, VkDescriptorSetLayout aSceneLayout );
+lut::Pipeline create_light_cluster_pipeline( lut::VulkanWindow const&, VkPipelineLayout );
+
+// Hi-Z depth pyramid, a power of two sized max-depth mip chain of the depth buffer
+struct DepthPyramid
+{
+	lut::ImageWithView image; // view over all levels
+	std::vector<lut::ImageView> levelViews; // one per level, reduce source/target
+	std::uint32_t width = 0, height = 0, levels = 0;
+};
+
+// compute post-processing (post.comp): the offscreen image in, TransientAttachments::post out
+// the swapchain must be a blit destination (TRANSFER_DST usage, BLIT_DST feature)
+bool compute_post_supported( lut::VulkanWindow const& );
+lut::DescriptorSetLayout create_compute_post_descriptor_layout( lut::VulkanWindow const& );
+lut::PipelineLayout create_compute_post_pipeline_layout( lut::VulkanContext const&, VkDescriptorSetLayout );
+lut::Pipeline create_compute_post_pipeline( lut::VulkanWindow const&, VkPipelineLayout );
+
+DepthPyramid create_depth_pyramid( lut::VulkanWindow const&, lut::Allocator const& );
+lut::Sampler create_depth_pyramid_sampler( lut::VulkanWindow const& );
+lut::DescriptorSetLayout create_depth_reduce_descriptor_layout( lut::VulkanWindow const& );
+lut::PipelineLayout create_depth_reduce_pipeline_layout( lut::VulkanContext const&, VkDescriptorSetLayout );
+lut::Pipeline create_depth_reduce_pipeline( lut::VulkanWindow const&, VkPipelineLayout );
@@ -0,0 +1,285 @@
+#include "shadow_atlas.hpp"
+
+#include <bit>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+	constexpr float kSpotNear = 0.1f;
+
+	std::uint32_t level_of_( ShadowAtlas const& aAtlas, std::uint32_t aSize )
+	{
+		return std::uint32_t(std::countr_zero( aAtlas.size )) - std::uint32_t(std::countr_zero( aSize ));
+	}
+
+	bool take_block_( std::vector<glm::uvec2>& aBlocks, glm::uvec2 const& aOrigin )
+	{
+		auto const it = std::find( aBlocks.begin(), aBlocks.end(), aOrigin );
+		if( aBlocks.end() == it )
+			return false;
+
+		*it = aBlocks.back();
+		aBlocks.pop_back();
+		return true;
+	}
+}
+
+std::vector<SpotLight> build_spot_lights( SceneBounds const& aScene, std::uint32_t aCount )
+{
+	std::vector<SpotLight> ret;
+	ret.reserve( aCount );
+
+	// roughly square grid over the xz extent, hanging below the top of the scene
+	std::uint32_t const cols = std::max( 1u, std::uint32_t(std::ceil( std::sqrt( float(aCount) ) )) );
+	std::uint32_t const rows = (aCount + cols - 1) / cols;
+
+	glm::vec3 const extent = aScene.max - aScene.min;
+	float const height = aScene.min.y + 0.6f * extent.y;
+	float const range = std::max( 0.8f * extent.y, 4.f );
+
+	static glm::vec3 const kColors[4] = {
+		{ 1.f, 0.55f, 0.3f }, { 0.4f, 0.6f, 1.f }, { 0.9f, 0.9f, 0.7f }, { 0.5f, 1.f, 0.5f }
+	};
+
+	for( std::uint32_t i = 0; i < aCount; ++i )
+	{
+		std::uint32_t const col = i % cols, row = i / cols;
+
+		SpotLight light{};
+		light.position = glm::vec3(
+			aScene.min.x + extent.x * (float(col) + 0.5f) / float(cols),
+			height,
+			aScene.min.z + extent.z * (float(row) + 0.5f) / float(rows)
+		);
+		light.direction = glm::normalize( glm::vec3( 0.15f, -1.f, 0.1f ) );
+		light.color = kColors[i % 4] * 6.f;
+		light.range = range;
+		light.outerAngle = glm::radians( 35.f );
+		light.innerAngle = glm::radians( 25.f );
+
+		if( 3 == i % 4 )
+		{
+			light.orbitRadius = 0.25f * extent.x / float(cols);
+			light.orbitSpeed = 0.8f;
+		}
+
+		ret.emplace_back( light );
+	}
+
+	return ret;
+}
+
+SpotLight animate_spot_light( SpotLight const& aLight, float aTime )
+{
+	SpotLight ret = aLight;
+	if( 0.f == aLight.orbitSpeed )
+		return ret;
+
+	float const a = aTime * aLight.orbitSpeed;
+	ret.position += aLight.orbitRadius * glm::vec3( std::cos( a ), 0.f, std::sin( a ) );
+	return ret;
+}
+
+glm::mat4 spot_light_view_proj( SpotLight const& aLight )
+{
+	glm::vec3 const up = std::abs( aLight.direction.y ) > 0.99f ? glm::vec3( 1.f, 0.f, 0.f ) : glm::vec3( 0.f, 1.f, 0.f );
+	glm::mat4 const view = glm::lookAt( aLight.position, aLight.position + aLight.direction, up );
+	glm::mat4 const proj = glm::perspectiveRH_ZO( 2.f * aLight.outerAngle, 1.f, kSpotNear, aLight.range );
+	return proj * view;
+}
+
+std::uint32_t spot_shadow_tile_size( SpotLight const& aLight, Frustum const& aCameraFrustum, glm::vec3 const& aCameraPos, float aTanHalfFov )
+{
+	// sphere around the cone: half way down the axis, reaching the rim of the base
+	float const halfRange = 0.5f * aLight.range;
+	float const baseRadius = aLight.range * std::tan( aLight.outerAngle );
+	glm::vec3 const center = aLight.position + aLight.direction * halfRange;
+	float const radius = std::sqrt( halfRange * halfRange + baseRadius * baseRadius );
+
+	for( auto const& plane : aCameraFrustum.planes )
+	{
+		if( glm::dot( glm::vec3( plane ), center ) + plane.w < -radius * glm::length( glm::vec3( plane ) ) )
+			return 0;
+	}
+
+	// projected radius relative to half the screen height
+	float const distance = glm::length( center - aCameraPos );
+	float const coverage = distance <= radius ? 1.f : std::min( 1.f, radius / (distance * aTanHalfFov) );
+
+	std::uint32_t const texels = std::uint32_t(coverage * float(cfg::kMaxShadowTile));
+	return std::clamp( std::bit_floor( texels ), cfg::kMinShadowTile, cfg::kMaxShadowTile );
+}
+
+ShadowAtlas create_shadow_atlas( std::uint32_t aSize, std::uint32_t aMinTile )
+{
+	ShadowAtlas ret;
+	ret.size = aSize;
+	ret.freeBlocks.resize( std::size_t(std::countr_zero( aSize ) - std::countr_zero( aMinTile )) + 1 );
+	ret.freeBlocks[0].emplace_back( 0u, 0u );
+	return ret;
+}
+
+AtlasTile atlas_allocate( ShadowAtlas& aAtlas, std::uint32_t aSize )
+{
+	std::uint32_t const level = level_of_( aAtlas, aSize );
+
+	// smallest free block that fits
+	std::uint32_t from = level + 1;
+	while( from > 0 && aAtlas.freeBlocks[from - 1].empty() )
+		--from;
+	if( 0 == from )
+		return {};
+	--from;
+
+	glm::uvec2 const origin = aAtlas.freeBlocks[from].back();
+	aAtlas.freeBlocks[from].pop_back();
+
+	// split down to the requested level; the first quarter is kept
+	for( std::uint32_t l = from + 1; l <= level; ++l )
+	{
+		std::uint32_t const half = aAtlas.size >> l;
+		aAtlas.freeBlocks[l].emplace_back( origin.x + half, origin.y );
+		aAtlas.freeBlocks[l].emplace_back( origin.x, origin.y + half );
+		aAtlas.freeBlocks[l].emplace_back( origin.x + half, origin.y + half );
+	}
+
+	aAtlas.allocatedTexels += std::uint64_t(aSize) * aSize;
+	++aAtlas.tileCount;
+	return { origin.x, origin.y, aSize };
+}
+
+void atlas_release( ShadowAtlas& aAtlas, AtlasTile const& aTile )
+{
+	if( 0 == aTile.size )
+		return;
+
+	aAtlas.allocatedTexels -= std::uint64_t(aTile.size) * aTile.size;
+	--aAtlas.tileCount;
+
+	// merge with the buddies while all four quarters of the parent are free
+	std::uint32_t level = level_of_( aAtlas, aTile.size );
+	glm::uvec2 origin( aTile.x, aTile.y );
+	while( level > 0 )
+	{
+		std::uint32_t const size = aAtlas.size >> level;
+		glm::uvec2 const parent( origin.x & ~(2 * size - 1), origin.y & ~(2 * size - 1) );
+
+		glm::uvec2 buddies[3];
+		std::uint32_t n = 0;
+		for( std::uint32_t q = 0; q < 4; ++q )
+		{
+			glm::uvec2 const b( parent.x + (q & 1) * size, parent.y + (q >> 1) * size );
+			if( b != origin )
+				buddies[n++] = b;
+		}
+
+		auto& blocks = aAtlas.freeBlocks[level];
+		auto const isFree = [&] (glm::uvec2 const& b) {
+			return blocks.end() != std::find( blocks.begin(), blocks.end(), b );
+		};
+		if( !isFree( buddies[0] ) || !isFree( buddies[1] ) || !isFree( buddies[2] ) )
+			break;
+
+		for( auto const& b : buddies )
+			take_block_( blocks, b );
+
+		origin = parent;
+		--level;
+	}
+
+	aAtlas.freeBlocks[level].emplace_back( origin );
+}
+
+ShadowSchedule schedule_shadow_atlas( ShadowAtlas& aAtlas, std::span<SpotShadowSlot> aSlots, std::span<std::uint32_t const> aDesiredSize, std::span<SpotLight const> aLights, std::uint64_t aFrame, std::uint64_t aBudget )
+{
+	ShadowSchedule ret;
+
+	// releases first, so the (re)allocations below can use the space
+	std::vector<std::uint32_t> pending;
+	for( std::uint32_t i = 0; i < aSlots.size(); ++i )
+	{
+		auto& slot = aSlots[i];
+		std::uint32_t const desired = aDesiredSize[i];
+
+		bool const keep = slot.tile.size && desired && desired <= slot.tile.size && desired > slot.tile.size / 4;
+		if( keep )
+			continue;
+
+		if( slot.tile.size )
+		{
+			atlas_release( aAtlas, slot.tile );
+			slot = {};
+		}
+
+		if( desired )
+			pending.emplace_back( i );
+	}
+
+	// largest first, which keeps the quadtree from fragmenting; a light that does
+	// not fit gets the largest smaller tile that does
+	std::ranges::sort( pending, [&] (std::uint32_t aA, std::uint32_t aB) {
+		return aDesiredSize[aA] > aDesiredSize[aB];
+	} );
+
+	for( auto const i : pending )
+	{
+		for( std::uint32_t size = aDesiredSize[i]; size >= cfg::kMinShadowTile && 0 == aSlots[i].tile.size; size /= 2 )
+			aSlots[i].tile = atlas_allocate( aAtlas, size );
+	}
+
+	// due tiles: never rendered, then moving lights, then the oldest static ones
+	struct Due
+	{
+		std::uint32_t light;
+		std::uint32_t priority;
+		std::uint64_t lastRender;
+	};
+
+	std::vector<Due> due;
+	for( std::uint32_t i = 0; i < aSlots.size(); ++i )
+	{
+		auto const& slot = aSlots[i];
+		if( 0 == slot.tile.size )
+		{
+			if( aDesiredSize[i] )
+				++ret.unshadowed;
+			continue;
+		}
+
+		if( !slot.rendered )
+			due.emplace_back( Due{ i, 0, 0 } );
+		else if( 0.f != aLights[i].orbitSpeed )
+			due.emplace_back( Due{ i, 1, slot.lastRender } );
+		else if( aFrame - slot.lastRender >= cfg::kStaticSpotRefreshFrames )
+			due.emplace_back( Due{ i, 2, slot.lastRender } );
+	}
+
+	std::ranges::sort( due, [] (Due const& aA, Due const& aB) {
+		return aA.priority != aB.priority ? aA.priority < aB.priority : aA.lastRender < aB.lastRender;
+	} );
+
+	for( auto const& d : due )
+	{
+		auto& slot = aSlots[d.light];
+		std::uint64_t const texels = std::uint64_t(slot.tile.size) * slot.tile.size;
+		if( !ret.updates.empty() && ret.texels + texels > aBudget )
+		{
+			// over budget: moving and static lights keep their previous depth
+			if( !slot.rendered )
+				++ret.unshadowed;
+			continue;
+		}
+
+		slot.rendered = true;
+		slot.lastRender = aFrame;
+		slot.viewProj = spot_light_view_proj( aLights[d.light] );
+
+		ret.updates.emplace_back( ShadowTileUpdate{ d.light, slot.tile } );
+		ret.texels += texels;
+	}
+
+	return ret;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "culling.hpp"
+
+// Shadow atlas for many shadowed spot lights
+// one depth image is split into power-of-two tiles by a quadtree buddy allocator.
+// Each light gets a tile sized by the screen coverage of its light volume; a
+// scheduler spends a per-frame budget of shadow texels on the tiles that need
+// rendering: new tiles first, then moving lights (every frame), then static
+// lights whose depth is older than cfg::kStaticSpotRefreshFrames. All tiles of a
+// frame are rendered in one render pass instance, one viewport per tile.
+
+namespace cfg
+{
+	constexpr std::uint32_t kShadowAtlasSize = 4096;
+	constexpr std::uint32_t kMinShadowTile = 128;
+	constexpr std::uint32_t kMaxShadowTile = 1024;
+
+	constexpr std::uint64_t kShadowAtlasBudget = 2 * 1024 * 1024; // texels rendered per frame
+	constexpr std::uint64_t kStaticSpotRefreshFrames = 120;
+
+	// sizes the spot light buffer read by the shaders
+	constexpr std::uint32_t kMaxSpotLights = 32;
+	constexpr std::uint32_t kSpotLightCount = 24;
+}
+
+namespace glsl
+{
+	// must match SpotLight in default.frag, alpha.frag and spotshadow.vert
+	struct SpotLightData
+	{
+		glm::mat4 viewProj;
+		glm::vec4 position;  // w: range
+		glm::vec4 direction; // w: cos of the outer cone angle
+		glm::vec4 color;     // w: cos of the inner cone angle
+		glm::vec4 atlasRect; // xy: tile offset, zw: tile size (atlas uv); zw = 0: unshadowed
+	};
+}
+
+struct SpotLight
+{
+	glm::vec3 position;
+	glm::vec3 direction;
+	glm::vec3 color;
+	float     range;
+	float     outerAngle; // radians, half angle
+	float     innerAngle;
+
+	// moving lights circle around position
+	float orbitRadius = 0.f;
+	float orbitSpeed = 0.f; // radians per second
+};
+
+// a grid of lights over the scene, every fourth one moving
+std::vector<SpotLight> build_spot_lights( SceneBounds const&, std::uint32_t aCount );
+
+// light state at aTime (seconds)
+SpotLight animate_spot_light( SpotLight const&, float aTime );
+
+glm::mat4 spot_light_view_proj( SpotLight const& );
+
+// tile edge length for the light: the projected size of its light volume on the
+// screen, 0 if the volume is outside the view frustum
+std::uint32_t spot_shadow_tile_size(
+	SpotLight const&,
+	Frustum const& aCameraFrustum,
+	glm::vec3 const& aCameraPos,
+	float aTanHalfFov
+);
+
+struct AtlasTile
+{
+	std::uint32_t x = 0, y = 0; // texels
+	std::uint32_t size = 0;     // 0: no tile
+};
+
+// quadtree buddy allocator: free blocks per level, level 0 is the whole atlas
+struct ShadowAtlas
+{
+	std::uint32_t size = cfg::kShadowAtlasSize;
+	std::vector<std::vector<glm::uvec2>> freeBlocks;
+	std::uint64_t allocatedTexels = 0;
+	std::uint32_t tileCount = 0;
+};
+
+ShadowAtlas create_shadow_atlas( std::uint32_t aSize, std::uint32_t aMinTile );
+
+// aSize is a power of two in [cfg::kMinShadowTile, atlas size]; the result has
+// size 0 if there is no free block
+AtlasTile atlas_allocate( ShadowAtlas&, std::uint32_t aSize );
+void atlas_release( ShadowAtlas&, AtlasTile const& );
+
+// per light scheduling state
+struct SpotShadowSlot
+{
+	AtlasTile     tile;
+	bool          rendered = false; // the tile holds this light's depth
+	std::uint64_t lastRender = 0;   // frame
+	glm::mat4     viewProj{ 1.f };  // of the light when the tile was rendered
+};
+
+struct ShadowTileUpdate
+{
+	std::uint32_t light;
+	AtlasTile     tile;
+};
+
+struct ShadowSchedule
+{
+	std::vector<ShadowTileUpdate> updates;
+	std::uint64_t texels = 0;      // rendered this frame
+	std::uint32_t unshadowed = 0;  // visible lights without a rendered tile
+};
+
+// (re)allocates the tiles for aDesiredSize (0 releases the tile; tiles grow at
+// once but shrink only to a quarter, so lights near a size boundary do not
+// flip every frame) and picks the tiles to render within aBudget texels; at
+// least one tile is rendered when any is due
+ShadowSchedule schedule_shadow_atlas(
+	ShadowAtlas&,
+	std::span<SpotShadowSlot> aSlots,
+	std::span<std::uint32_t const> aDesiredSize,
+	std::span<SpotLight const> aLights,
+	std::uint64_t aFrame,
+	std::uint64_t aBudget
+);
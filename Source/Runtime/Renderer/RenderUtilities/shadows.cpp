@@ -0,0 +1,218 @@
+#include "shadows.hpp"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace
+{
+	// receiver-aware fit of one cascade (see shadows.hpp); the window [aLeft,
+	// aLeft + aExtent] x [aBottom, aBottom + aExtent] comes in as the stable one
+	// and only shrinks. Returns false, with the window left as is, if no receiver
+	// overlaps it.
+	bool fit_cascade_( InstanceBounds const& aBounds, ShadowFitScratch& aScratch, glm::mat4 const& aLightView, glm::mat4 const& aWorld2Camera, glm::vec3 const& aEye, glm::vec3 const& aForward, glm::vec3 const& aRight, glm::vec3 const& aUp, float aTanX, float aTanY, float aAspect, float aSliceNear, float aSliceFar, std::uint32_t aResolution, float& aLeft, float& aBottom, float& aExtent, float& aNear, float& aFar )
+	{
+		constexpr float kMax = std::numeric_limits<float>::max();
+
+		// receivers: instances in the slice of the camera frustum
+		glm::mat4 const sliceProj = glm::perspectiveRH_ZO( 2.f * std::atan( aTanY ), aAspect, aSliceNear, aSliceFar );
+		if( 0 == cull_instances( extract_frustum( sliceProj * aWorld2Camera ), aBounds, aScratch.receivers ).visible )
+			return false;
+
+		glm::vec3 recvMin( kMax ), recvMax( -kMax );
+		for( std::size_t i = 0; i < aBounds.count; ++i )
+		{
+			if( !aScratch.receivers[i] )
+				continue;
+			recvMin = glm::min( recvMin, aScratch.lightMin[i] );
+			recvMax = glm::max( recvMax, aScratch.lightMax[i] );
+		}
+
+		// receiver boxes reach beyond the slice, clip them to its corners
+		glm::vec3 sliceMin( kMax ), sliceMax( -kMax );
+		for( std::uint32_t k = 0; k < 8; ++k )
+		{
+			float const z = (k & 4) ? aSliceFar : aSliceNear;
+			glm::vec3 const corner = aEye + aForward * z
+				+ aRight * (((k & 1) ? z : -z) * aTanX)
+				+ aUp * (((k & 2) ? z : -z) * aTanY);
+			glm::vec3 const p = glm::vec3( aLightView * glm::vec4( corner, 1.f ) );
+			sliceMin = glm::min( sliceMin, p );
+			sliceMax = glm::max( sliceMax, p );
+		}
+
+		glm::vec2 const lo = glm::max( glm::vec2( recvMin ), glm::max( glm::vec2( sliceMin ), glm::vec2( aLeft, aBottom ) ) );
+		glm::vec2 const hi = glm::min( glm::vec2( recvMax ), glm::min( glm::vec2( sliceMax ), glm::vec2( aLeft, aBottom ) + aExtent ) );
+		if( lo.x >= hi.x || lo.y >= hi.y )
+			return false;
+
+		// quantized size, texel snapped position
+		float const step = aExtent / float(cfg::kShadowFitSteps);
+		float const extent = std::min( std::ceil( std::max( hi.x - lo.x, hi.y - lo.y ) / step ) * step, aExtent );
+		float const texel = extent / float(aResolution);
+		glm::vec2 const mid = 0.5f * (lo + hi);
+		aLeft = std::floor( (mid.x - 0.5f * extent) / texel ) * texel;
+		aBottom = std::floor( (mid.y - 0.5f * extent) / texel ) * texel;
+		aExtent = extent;
+
+		// depth (view space looks down -Z): up to the farthest receiver in the
+		// slice, from the nearest caster that overlaps the window in front of it
+		float const recvFar = std::min( -recvMin.z, -sliceMin.z );
+		float casterNear = recvFar;
+		for( std::size_t i = 0; i < aBounds.count; ++i )
+		{
+			auto const& bmin = aScratch.lightMin[i];
+			auto const& bmax = aScratch.lightMax[i];
+			if( bmax.x <= aLeft || bmin.x >= aLeft + extent || bmax.y <= aBottom || bmin.y >= aBottom + extent )
+				continue;
+			casterNear = std::min( casterNear, -bmax.z );
+		}
+
+		aNear = std::floor( casterNear / step ) * step;
+		aFar = std::max( std::ceil( recvFar / step ) * step, aNear + step );
+		return true;
+	}
+}
+
+ShadowCascades compute_shadow_cascades( glm::mat4 const& aCamera2World, float aAspect, glm::vec3 const& aToLight, glm::vec3 const& aSceneMin, glm::vec3 const& aSceneMax, std::uint32_t aCascadeCount, std::uint32_t aResolution, InstanceBounds const* aFitBounds, ShadowFitScratch* aFitScratch )
+{
+	ShadowCascades ret;
+	ret.count = std::clamp( aCascadeCount, 1u, cfg::kMaxShadowCascades );
+
+	float const zNear = cfg::kCameraNear;
+	float const zFar = std::min( cfg::kShadowDistance, cfg::kCameraFar );
+
+	// squared slope of the frustum corner rays; the distance of a corner at view
+	// depth z from the view axis is z * sqrt(k)
+	float const tanY = std::tan( 0.5f * lut::Radians( cfg::kCameraFov ).value() );
+	float const tanX = tanY * aAspect;
+	float const k = tanX * tanX + tanY * tanY;
+
+	glm::vec3 const eye = glm::vec3( aCamera2World[3] );
+	glm::vec3 const forward = -glm::normalize( glm::vec3( aCamera2World[2] ) ); // camera looks down -Z
+
+	// light space with a fixed orientation; only the window of each cascade moves
+	glm::vec3 const dir = -glm::normalize( aToLight );
+	glm::vec3 const up = std::abs( dir.y ) > 0.99f ? glm::vec3( 1.f, 0.f, 0.f ) : glm::vec3( 0.f, 1.f, 0.f );
+	glm::mat4 const lightView = glm::lookAt( glm::vec3( 0.f ), dir, up );
+
+	// nearest scene depth along the light direction (view space looks down -Z)
+	float sceneNear = std::numeric_limits<float>::max();
+	for( std::uint32_t i = 0; i < 8; ++i )
+	{
+		glm::vec3 const corner( (i & 1) ? aSceneMax.x : aSceneMin.x, (i & 2) ? aSceneMax.y : aSceneMin.y, (i & 4) ? aSceneMax.z : aSceneMin.z );
+		sceneNear = std::min( sceneNear, -(lightView * glm::vec4( corner, 1.f )).z );
+	}
+
+	// receiver-aware fitting: light space boxes of all instances, once per call
+	glm::mat4 world2camera{ 1.f };
+	glm::vec3 cameraRight{ 0.f }, cameraUp{ 0.f };
+	if( aFitBounds )
+	{
+		auto& scratch = *aFitScratch;
+		scratch.lightMin.resize( aFitBounds->count );
+		scratch.lightMax.resize( aFitBounds->count );
+
+		glm::mat3 const rot( lightView );
+		glm::mat3 const absRot( glm::abs( rot[0] ), glm::abs( rot[1] ), glm::abs( rot[2] ) );
+		for( std::size_t i = 0; i < aFitBounds->count; ++i )
+		{
+			glm::vec3 const c = glm::vec3( lightView * glm::vec4( aFitBounds->cx[i], aFitBounds->cy[i], aFitBounds->cz[i], 1.f ) );
+			glm::vec3 const e = absRot * glm::vec3( aFitBounds->ex[i], aFitBounds->ey[i], aFitBounds->ez[i] );
+			scratch.lightMin[i] = c - e;
+			scratch.lightMax[i] = c + e;
+		}
+
+		world2camera = glm::inverse( aCamera2World );
+		cameraRight = glm::normalize( glm::vec3( aCamera2World[0] ) );
+		cameraUp = glm::normalize( glm::vec3( aCamera2World[1] ) );
+	}
+
+	float sliceNear = zNear;
+	for( std::uint32_t i = 0; i < ret.count; ++i )
+	{
+		float const t = float(i + 1) / float(ret.count);
+		float const logSplit = zNear * std::pow( zFar / zNear, t );
+		float const uniformSplit = zNear + (zFar - zNear) * t;
+		float const sliceFar = cfg::kCascadeSplitLambda * logSplit + (1.f - cfg::kCascadeSplitLambda) * uniformSplit;
+
+		// bounding sphere of the slice, centered on the view axis where the near and
+		// far corners are equally distant (or at the far plane for wide slices)
+		float const center = std::min( 0.5f * (sliceNear + sliceFar) * (1.f + k), sliceFar );
+		float radius = std::sqrt( (sliceFar - center) * (sliceFar - center) + sliceFar * sliceFar * k );
+		radius = std::ceil( radius * 16.f ) / 16.f; // keep the texel size exact across frames
+
+		// snap the window to whole texels
+		float const texel = 2.f * radius / float(aResolution);
+		glm::vec3 c = glm::vec3( lightView * glm::vec4( eye + forward * center, 1.f ) );
+		c.x = std::floor( c.x / texel ) * texel;
+		c.y = std::floor( c.y / texel ) * texel;
+
+		// depth range: the sphere plus every caster between it and the light;
+		// snapped as well, so the matrix only changes with the window
+		float depthNear = std::floor( std::min( -c.z - radius, sceneNear ) / texel ) * texel;
+		float depthFar = std::ceil( (-c.z + radius) / texel ) * texel;
+
+		float left = c.x - radius, bottom = c.y - radius;
+		float extent = 2.f * radius;
+		float fitNear = depthNear, fitFar = depthFar;
+		if( aFitBounds && fit_cascade_( *aFitBounds, *aFitScratch, lightView, world2camera, eye, forward, cameraRight, cameraUp, tanX, tanY, aAspect, sliceNear, sliceFar, aResolution, left, bottom, extent, fitNear, fitFar ) )
+		{
+			depthNear = fitNear;
+			depthFar = fitFar;
+		}
+
+		glm::mat4 const proj = glm::orthoRH_ZO( left, left + extent, bottom, bottom + extent, depthNear, depthFar );
+
+		ret.viewProj[i] = proj * lightView;
+		ret.fitScale[i] = extent / (2.f * radius);
+		ret.splitFar[i] = sliceFar;
+		sliceNear = sliceFar;
+	}
+
+	return ret;
+}
+
+bool is_cascade_due( std::uint32_t aCascade, std::uint64_t aFrame )
+{
+	return aCascade < cfg::kNearCascades || 0 == (aFrame + aCascade) % cfg::kFarCascadeInterval;
+}
+
+void compute_point_shadow_faces( glm::vec3 const& aLightPos, float aRange, glm::mat4 (&aFaceViewProj)[6] )
+{
+	// the usual cube map camera setup; Vulkan flips both the clip space Y and the
+	// image row order relative to OpenGL, so the face images come out the same
+	static glm::vec3 const kForward[6] = {
+		{ 1.f, 0.f, 0.f }, { -1.f, 0.f, 0.f },
+		{ 0.f, 1.f, 0.f }, { 0.f, -1.f, 0.f },
+		{ 0.f, 0.f, 1.f }, { 0.f, 0.f, -1.f }
+	};
+	static glm::vec3 const kUp[6] = {
+		{ 0.f, -1.f, 0.f }, { 0.f, -1.f, 0.f },
+		{ 0.f, 0.f, 1.f }, { 0.f, 0.f, -1.f },
+		{ 0.f, -1.f, 0.f }, { 0.f, -1.f, 0.f }
+	};
+
+	glm::mat4 const proj = glm::perspectiveRH_ZO( glm::radians( 90.f ), 1.f, cfg::kPointShadowNear, aRange );
+
+	for( std::uint32_t f = 0; f < 6; ++f )
+		aFaceViewProj[f] = proj * glm::lookAt( aLightPos, aLightPos + kForward[f], kUp[f] );
+}
+
+std::uint32_t compute_point_face_masks( glm::mat4 const (&aFaceViewProj)[6], InstanceBounds const& aBounds, std::vector<std::uint8_t>& aFaceMasks, std::vector<std::uint8_t>& aScratch )
+{
+	aFaceMasks.assign( aBounds.count, 0 );
+
+	std::uint32_t pairs = 0;
+	for( std::uint32_t f = 0; f < 6; ++f )
+	{
+		pairs += cull_instances( extract_frustum( aFaceViewProj[f] ), aBounds, aScratch ).visible;
+
+		for( std::size_t i = 0; i < aBounds.count; ++i )
+			aFaceMasks[i] |= std::uint8_t(aScratch[i] << f);
+	}
+
+	return pairs;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "camera.hpp"
+#include "culling.hpp"
+
+// Cascaded shadow maps (directional light)
+// the shadowed part of the camera frustum is split with the practical split scheme
+// (blend of logarithmic and uniform split distances). Each cascade is fitted with a
+// bounding sphere of its slice, so its size does not change when the camera turns,
+// and its window is snapped to whole shadow map texels in a light space of fixed
+// orientation, so shadow edges do not shimmer when the camera moves. Every cascade
+// is a layer of one depth image and has its own caster culling.
+//
+// Receiver-aware fitting (optional): the window of a cascade is shrunk to the
+// light space bounds of the receivers, the instances inside its slice of the
+// camera frustum, and its depth range to the casters that overlap that window,
+// extended towards the light. The caster culling against the cascade frustum then
+// only keeps casters that can shadow a visible receiver. The window size is
+// quantized to steps of the stable window, so it changes in discrete steps only.
+
+namespace cfg
+{
+	constexpr float kCascadeSplitLambda = 0.8f; // 1 = logarithmic, 0 = uniform splits
+	constexpr float kShadowDistance = 60.f;     // camera depth covered by the cascades
+
+	// cascades [0, kNearCascades) are re-rendered every frame, the others every
+	// kFarCascadeInterval frames, staggered so they do not all update in one frame
+	constexpr std::uint32_t kNearCascades = 2;
+	constexpr std::uint32_t kFarCascadeInterval = 4;
+
+	// receiver-aware fitting: window sizes are multiples of the stable window / kShadowFitSteps
+	constexpr std::uint32_t kShadowFitSteps = 16;
+
+	// point light cube shadow map, per face (see compute_point_shadow_faces())
+	constexpr std::uint32_t kPointShadowResolution = 1024;
+}
+
+struct ShadowCascades
+{
+	std::uint32_t count = 0;
+	glm::mat4     viewProj[cfg::kMaxShadowCascades];
+	float         splitFar[cfg::kMaxShadowCascades]; // view depth
+	float         fitScale[cfg::kMaxShadowCascades]; // window edge relative to the stable window (1 = not fitted)
+};
+
+// receiver-aware fitting, kept across frames to avoid reallocations
+struct ShadowFitScratch
+{
+	std::vector<glm::vec3>    lightMin, lightMax; // light space instance boxes
+	std::vector<std::uint8_t> receivers;
+};
+
+// aToLight: direction towards the light (SceneUniform::lightPos with w = 0); the
+// scene bounds extend each cascade towards the light so that every caster is kept.
+// aFitBounds enables receiver-aware fitting (aFitScratch required then).
+ShadowCascades compute_shadow_cascades(
+	glm::mat4 const& aCamera2World,
+	float aAspect,
+	glm::vec3 const& aToLight,
+	glm::vec3 const& aSceneMin,
+	glm::vec3 const& aSceneMax,
+	std::uint32_t aCascadeCount,
+	std::uint32_t aResolution,
+	InstanceBounds const* aFitBounds = nullptr,
+	ShadowFitScratch* aFitScratch = nullptr
+);
+
+// staggered updates: is cascade aCascade re-rendered in frame aFrame?
+bool is_cascade_due( std::uint32_t aCascade, std::uint64_t aFrame );
+
+// Omnidirectional point light shadows
+// the six faces of a cube depth map are rendered in one layered pass: every
+// caster is culled against the six face frusta and drawn with one instance per
+// face it overlaps; the vertex shader picks the face (gl_Layer) from the
+// instance index, so a caster is never rasterized into faces it cannot touch.
+// Layered rendering instead of multiview, which would broadcast every draw to
+// all six faces. gl_Layer from the vertex shader needs shaderOutputLayer;
+// without it, mode 2 renders one pass per face into that face's 2D view.
+
+// 90 degree view-projection per face in cube map layer order (+X, -X, +Y, -Y,
+// +Z, -Z); the orientation matches the cube map lookup, so no Y flip
+void compute_point_shadow_faces(
+	glm::vec3 const& aLightPos,
+	float aRange,
+	glm::mat4 (&aFaceViewProj)[6]
+);
+
+// bit f of aFaceMasks[i] is set if instance i overlaps face f; aScratch holds
+// the per face culling result. Returns the number of (instance, face) pairs.
+std::uint32_t compute_point_face_masks(
+	glm::mat4 const (&aFaceViewProj)[6],
+	InstanceBounds const&,
+	std::vector<std::uint8_t>& aFaceMasks,
+	std::vector<std::uint8_t>& aScratch
+);
@@ -0,0 +1,400 @@
+#include "software_occlusion.hpp"
+
+#include <cmath>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include "stb_image_write.h"
+
+// MSVC implies FMA with /arch:AVX2 but does not define __FMA__
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#	define OCCLUSION_AVX2_ 1
+#	include <immintrin.h>
+#endif
+
+namespace
+{
+	static_assert( 0 == cfg::kOcclusionWidth % cfg::kOcclusionTileWidth );
+	static_assert( 0 == cfg::kOcclusionHeight % cfg::kOcclusionTileHeight );
+	static_assert( 0 == cfg::kOcclusionTileWidth % 8 );
+
+	constexpr std::uint32_t kTilesX = cfg::kOcclusionWidth / cfg::kOcclusionTileWidth;
+	constexpr std::uint32_t kTilesY = cfg::kOcclusionHeight / cfg::kOcclusionTileHeight;
+
+	constexpr float kNearW = 1e-5f;
+	constexpr float kDepthBias = 1e-6f; // keeps boxes from being occluded by their own surface
+
+	// edge functions e = A*x + B*y + C (>= 0 inside) and the depth plane
+	struct ScreenTriangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3];
+		float zA, zB, zC;
+		int minX, maxX, minY, maxY;
+	};
+
+	glm::vec3 to_screen( glm::vec4 const& aClip, OcclusionBuffer const& aBuffer )
+	{
+		glm::vec3 const ndc = glm::vec3( aClip ) / aClip.w;
+		return glm::vec3(
+			(ndc.x * 0.5f + 0.5f) * float(aBuffer.width),
+			(ndc.y * 0.5f + 0.5f) * float(aBuffer.height),
+			ndc.z
+		);
+	}
+
+	bool setup_triangle( glm::vec3 aV0, glm::vec3 aV1, glm::vec3 aV2, OcclusionBuffer const& aBuffer, ScreenTriangle& aOut )
+	{
+		float area = (aV1.x - aV0.x) * (aV2.y - aV0.y) - (aV1.y - aV0.y) * (aV2.x - aV0.x);
+		if( std::abs( area ) < 1e-8f )
+			return false;
+
+		// occluders are two sided, flip to a positive orientation
+		if( area < 0.f )
+		{
+			std::swap( aV1, aV2 );
+			area = -area;
+		}
+
+		glm::vec3 const v[3] = { aV0, aV1, aV2 };
+		for( int i = 0; i < 3; ++i )
+		{
+			// edge opposite to vertex i
+			glm::vec3 const& a = v[(i + 1) % 3];
+			glm::vec3 const& b = v[(i + 2) % 3];
+			aOut.edgeA[i] = a.y - b.y;
+			aOut.edgeB[i] = b.x - a.x;
+			aOut.edgeC[i] = -(aOut.edgeA[i] * a.x + aOut.edgeB[i] * a.y);
+		}
+
+		// z = z0 + (z1-z0)*b1 + (z2-z0)*b2 with b_i = e_i / area
+		float const dz1 = (aV1.z - aV0.z) / area;
+		float const dz2 = (aV2.z - aV0.z) / area;
+		aOut.zA = dz1 * aOut.edgeA[1] + dz2 * aOut.edgeA[2];
+		aOut.zB = dz1 * aOut.edgeB[1] + dz2 * aOut.edgeB[2];
+		aOut.zC = aV0.z + dz1 * aOut.edgeC[1] + dz2 * aOut.edgeC[2];
+
+		float const minX = std::min( { aV0.x, aV1.x, aV2.x } ), maxX = std::max( { aV0.x, aV1.x, aV2.x } );
+		float const minY = std::min( { aV0.y, aV1.y, aV2.y } ), maxY = std::max( { aV0.y, aV1.y, aV2.y } );
+
+		// clamp before converting, vertices close to the eye project very far out
+		float const w = float(aBuffer.width), h = float(aBuffer.height);
+		aOut.minX = int(std::floor( std::clamp( minX, 0.f, w ) ));
+		aOut.maxX = std::min( int(std::ceil( std::clamp( maxX, -1.f, w ) )), int(aBuffer.width) - 1 );
+		aOut.minY = int(std::floor( std::clamp( minY, 0.f, h ) ));
+		aOut.maxY = std::min( int(std::ceil( std::clamp( maxY, -1.f, h ) )), int(aBuffer.height) - 1 );
+
+		return aOut.minX <= aOut.maxX && aOut.minY <= aOut.maxY;
+	}
+
+	void rasterize_tile( std::uint32_t aTile, std::vector<ScreenTriangle> const& aTriangles, std::vector<std::uint32_t> const& aBin, OcclusionBuffer& aBuffer )
+	{
+		int const tileX0 = int(aTile % kTilesX * cfg::kOcclusionTileWidth);
+		int const tileY0 = int(aTile / kTilesX * cfg::kOcclusionTileHeight);
+		int const tileX1 = tileX0 + int(cfg::kOcclusionTileWidth) - 1;
+		int const tileY1 = tileY0 + int(cfg::kOcclusionTileHeight) - 1;
+
+		for( std::uint32_t const index : aBin )
+		{
+			auto const& tri = aTriangles[index];
+
+			// x range starts on a multiple of 8 so full 8-wide rows stay inside the tile
+			int const x0 = std::max( tileX0, tri.minX ) & ~7;
+			int const x1 = std::min( tileX1, tri.maxX );
+			int const y0 = std::max( tileY0, tri.minY );
+			int const y1 = std::min( tileY1, tri.maxY );
+
+			for( int y = y0; y <= y1; ++y )
+			{
+				float const py = float(y) + 0.5f;
+				float* row = aBuffer.depth.data() + std::size_t(y) * aBuffer.width;
+
+#				if defined(OCCLUSION_AVX2_)
+				__m256 const lane = _mm256_setr_ps( 0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f );
+				__m256 const zero = _mm256_setzero_ps();
+
+				__m256 const a0 = _mm256_set1_ps( tri.edgeA[0] ), r0 = _mm256_set1_ps( tri.edgeB[0] * py + tri.edgeC[0] );
+				__m256 const a1 = _mm256_set1_ps( tri.edgeA[1] ), r1 = _mm256_set1_ps( tri.edgeB[1] * py + tri.edgeC[1] );
+				__m256 const a2 = _mm256_set1_ps( tri.edgeA[2] ), r2 = _mm256_set1_ps( tri.edgeB[2] * py + tri.edgeC[2] );
+				__m256 const za = _mm256_set1_ps( tri.zA ), zr = _mm256_set1_ps( tri.zB * py + tri.zC );
+
+				for( int x = x0; x <= x1; x += 8 )
+				{
+					__m256 const px = _mm256_add_ps( _mm256_set1_ps( float(x) ), lane );
+
+					__m256 const e0 = _mm256_fmadd_ps( a0, px, r0 );
+					__m256 const e1 = _mm256_fmadd_ps( a1, px, r1 );
+					__m256 const e2 = _mm256_fmadd_ps( a2, px, r2 );
+
+					__m256 const inside = _mm256_and_ps(
+						_mm256_cmp_ps( e0, zero, _CMP_GE_OQ ),
+						_mm256_and_ps( _mm256_cmp_ps( e1, zero, _CMP_GE_OQ ), _mm256_cmp_ps( e2, zero, _CMP_GE_OQ ) )
+					);
+
+					if( 0 == _mm256_movemask_ps( inside ) )
+						continue;
+
+					__m256 const z = _mm256_fmadd_ps( za, px, zr );
+					__m256 const old = _mm256_loadu_ps( row + x );
+					_mm256_storeu_ps( row + x, _mm256_blendv_ps( old, _mm256_min_ps( old, z ), inside ) );
+				}
+#				else
+				for( int x = x0; x <= x1; ++x )
+				{
+					float const px = float(x) + 0.5f;
+
+					bool inside = true;
+					for( int e = 0; e < 3; ++e )
+						inside = inside && tri.edgeA[e] * px + tri.edgeB[e] * py + tri.edgeC[e] >= 0.f;
+
+					if( inside )
+						row[x] = std::min( row[x], tri.zA * px + tri.zB * py + tri.zC );
+				}
+#				endif
+			}
+		}
+	}
+
+	std::uint32_t test_range( OcclusionBuffer const& aBuffer, glm::mat4 const& aViewProj, InstanceBounds const& aBounds, std::uint8_t* aVisible, std::size_t aBegin, std::size_t aEnd )
+	{
+		std::uint32_t occluded = 0;
+
+		for( std::size_t i = aBegin; i < aEnd; ++i )
+		{
+			if( !aVisible[i] )
+				continue;
+
+			glm::vec3 const c( aBounds.cx[i], aBounds.cy[i], aBounds.cz[i] );
+			glm::vec3 const e( aBounds.ex[i], aBounds.ey[i], aBounds.ez[i] );
+
+			glm::vec2 lo( std::numeric_limits<float>::max() ), hi( std::numeric_limits<float>::lowest() );
+			float nearest = 1.f;
+			bool crossesNear = false;
+
+			for( int k = 0; k < 8 && !crossesNear; ++k )
+			{
+				glm::vec3 const corner = c + e * glm::vec3( (k & 1) ? 1.f : -1.f, (k & 2) ? 1.f : -1.f, (k & 4) ? 1.f : -1.f );
+				glm::vec4 const clip = aViewProj * glm::vec4( corner, 1.f );
+
+				if( clip.w <= kNearW || clip.z < 0.f )
+				{
+					crossesNear = true;
+					break;
+				}
+
+				glm::vec3 const s = to_screen( clip, aBuffer );
+				lo = glm::min( lo, glm::vec2( s ) );
+				hi = glm::max( hi, glm::vec2( s ) );
+				nearest = std::min( nearest, s.z );
+			}
+
+			if( crossesNear )
+				continue;
+
+			float const w = float(aBuffer.width), h = float(aBuffer.height);
+			int const x0 = int(std::floor( std::clamp( lo.x, 0.f, w ) ));
+			int const x1 = std::min( int(std::floor( std::clamp( hi.x, -1.f, w ) )), int(aBuffer.width) - 1 );
+			int const y0 = int(std::floor( std::clamp( lo.y, 0.f, h ) ));
+			int const y1 = std::min( int(std::floor( std::clamp( hi.y, -1.f, h ) )), int(aBuffer.height) - 1 );
+
+			if( x0 > x1 || y0 > y1 )
+				continue; // off screen, left to the frustum test
+
+			// occluded only if the buffer is nearer everywhere in the rectangle
+			float const ref = nearest - kDepthBias;
+			bool hidden = true;
+			for( int y = y0; y <= y1 && hidden; ++y )
+			{
+				float const* row = aBuffer.depth.data() + std::size_t(y) * aBuffer.width;
+				int x = x0;
+
+#				if defined(OCCLUSION_AVX2_)
+				__m256 const vref = _mm256_set1_ps( ref );
+				for( ; x + 8 <= x1 + 1; x += 8 )
+				{
+					if( 0 != _mm256_movemask_ps( _mm256_cmp_ps( _mm256_loadu_ps( row + x ), vref, _CMP_GE_OQ ) ) )
+					{
+						hidden = false;
+						break;
+					}
+				}
+#				endif
+
+				for( ; x <= x1 && hidden; ++x )
+					hidden = row[x] < ref;
+			}
+
+			if( hidden )
+			{
+				aVisible[i] = 0;
+				++occluded;
+			}
+		}
+
+		return occluded;
+	}
+}
+
+Occluders build_occluders( EngineModel const& aModel )
+{
+	Occluders ret;
+
+	// biggest instances first
+	std::vector<std::size_t> order( aModel.scenes.size() );
+	std::iota( order.begin(), order.end(), std::size_t(0) );
+
+	std::vector<float> sizes( aModel.scenes.size() );
+	for( std::size_t i = 0; i < aModel.scenes.size(); ++i )
+	{
+		auto const& inst = aModel.scenes[i];
+		auto const& mesh = aModel.meshes[inst.meshIndex];
+
+		glm::vec3 const ext = mesh.boundsMax - mesh.boundsMin;
+		glm::mat3 const m = glm::mat3( inst.transform );
+		sizes[i] = glm::length( glm::abs( m[0] ) * ext.x + glm::abs( m[1] ) * ext.y + glm::abs( m[2] ) * ext.z );
+	}
+
+	std::sort( order.begin(), order.end(), [&] (std::size_t a, std::size_t b) { return sizes[a] > sizes[b]; } );
+
+	std::size_t triangles = 0;
+	for( std::size_t const i : order )
+	{
+		if( sizes[i] < cfg::kMinOccluderSize )
+			break;
+
+		auto const& inst = aModel.scenes[i];
+		auto const& mesh = aModel.meshes[inst.meshIndex];
+
+		std::size_t const meshTriangles = mesh.indices.size() / 3;
+		if( 0 == meshTriangles || meshTriangles > cfg::kMaxOccluderMeshTriangles )
+			continue;
+		if( triangles + meshTriangles > cfg::kMaxOccluderTriangles )
+			continue;
+
+		// alpha masked geometry has holes
+		if( mesh.materialIndex < aModel.materials.size() && aModel.materials[mesh.materialIndex].alphaMaskTexture >= 0 )
+			continue;
+
+		auto const base = std::uint32_t(ret.positions.size());
+		for( auto const& p : mesh.positions )
+			ret.positions.emplace_back( glm::vec3( inst.transform * glm::vec4( p, 1.f ) ) );
+		for( auto const idx : mesh.indices )
+			ret.indices.emplace_back( base + idx );
+
+		triangles += meshTriangles;
+		++ret.instanceCount;
+	}
+
+	return ret;
+}
+
+std::size_t rasterize_occluders( Occluders const& aOccluders, glm::mat4 const& aViewProj, OcclusionBuffer& aBuffer )
+{
+	aBuffer.depth.assign( std::size_t(aBuffer.width) * aBuffer.height, 1.f );
+
+	std::vector<glm::vec4> clip( aOccluders.positions.size() );
+	for( std::size_t i = 0; i < clip.size(); ++i )
+		clip[i] = aViewProj * glm::vec4( aOccluders.positions[i], 1.f );
+
+	// setup + binning
+	std::vector<ScreenTriangle> triangles;
+	triangles.reserve( aOccluders.indices.size() / 3 );
+
+	std::vector<std::uint32_t> bins[kTilesX * kTilesY];
+
+	for( std::size_t t = 0; t + 2 < aOccluders.indices.size(); t += 3 )
+	{
+		glm::vec4 const& c0 = clip[aOccluders.indices[t + 0]];
+		glm::vec4 const& c1 = clip[aOccluders.indices[t + 1]];
+		glm::vec4 const& c2 = clip[aOccluders.indices[t + 2]];
+
+		// no clipping; dropping an occluder only loses occlusion, never correctness
+		if( c0.w <= kNearW || c1.w <= kNearW || c2.w <= kNearW || c0.z < 0.f || c1.z < 0.f || c2.z < 0.f )
+			continue;
+
+		ScreenTriangle tri;
+		if( !setup_triangle( to_screen( c0, aBuffer ), to_screen( c1, aBuffer ), to_screen( c2, aBuffer ), aBuffer, tri ) )
+			continue;
+
+		auto const index = std::uint32_t(triangles.size());
+		triangles.emplace_back( tri );
+
+		for( int ty = tri.minY / int(cfg::kOcclusionTileHeight); ty <= tri.maxY / int(cfg::kOcclusionTileHeight); ++ty )
+		{
+			for( int tx = tri.minX / int(cfg::kOcclusionTileWidth); tx <= tri.maxX / int(cfg::kOcclusionTileWidth); ++tx )
+				bins[ty * kTilesX + tx].emplace_back( index );
+		}
+	}
+
+	// tiles are independent, workers pull them from a shared counter
+	std::atomic<std::uint32_t> next{ 0 };
+	auto const worker = [&] {
+		for( std::uint32_t tile = next++; tile < kTilesX * kTilesY; tile = next++ )
+			rasterize_tile( tile, triangles, bins[tile], aBuffer );
+	};
+
+	std::size_t const workers = std::min<std::size_t>( std::max( 1u, std::thread::hardware_concurrency() ), kTilesX * kTilesY );
+
+	std::vector<std::future<void>> jobs;
+	for( std::size_t i = 1; i < workers; ++i )
+		jobs.emplace_back( std::async( std::launch::async, worker ) );
+
+	worker();
+	for( auto& job : jobs )
+		job.get();
+
+	return triangles.size();
+}
+
+std::uint32_t test_occlusion( OcclusionBuffer const& aBuffer, glm::mat4 const& aViewProj, InstanceBounds const& aBounds, std::vector<std::uint8_t>& aVisible )
+{
+	aVisible.resize( aBounds.count, 1 );
+
+	if( aBounds.count < cfg::kCullParallelThreshold )
+		return test_range( aBuffer, aViewProj, aBounds, aVisible.data(), 0, aBounds.count );
+
+	std::size_t const workers = std::max( 1u, std::thread::hardware_concurrency() );
+	std::size_t const chunk = (aBounds.count + workers - 1) / workers;
+
+	std::vector<std::future<std::uint32_t>> jobs;
+	for( std::size_t begin = chunk; begin < aBounds.count; begin += chunk )
+	{
+		std::size_t const end = std::min( begin + chunk, aBounds.count );
+		jobs.emplace_back( std::async( std::launch::async, test_range,
+			std::cref( aBuffer ), std::cref( aViewProj ), std::cref( aBounds ), aVisible.data(), begin, end ) );
+	}
+
+	std::uint32_t occluded = test_range( aBuffer, aViewProj, aBounds, aVisible.data(), 0, std::min( chunk, aBounds.count ) );
+	for( auto& job : jobs )
+		occluded += job.get();
+
+	return occluded;
+}
+
+bool write_occlusion_buffer( OcclusionBuffer const& aBuffer, char const* aPath )
+{
+	// stretch the written depth range, empty pixels stay black
+	float lo = 1.f, hi = 0.f;
+	for( float const d : aBuffer.depth )
+	{
+		if( d < 1.f )
+		{
+			lo = std::min( lo, d );
+			hi = std::max( hi, d );
+		}
+	}
+
+	float const scale = hi > lo ? 1.f / (hi - lo) : 1.f;
+
+	std::vector<std::uint8_t> pixels( aBuffer.depth.size(), 0 );
+	for( std::size_t i = 0; i < pixels.size(); ++i )
+	{
+		if( aBuffer.depth[i] < 1.f )
+			pixels[i] = std::uint8_t( 64.f + 191.f * (1.f - (aBuffer.depth[i] - lo) * scale) );
+	}
+
+	return 0 != stbi_write_png( aPath, int(aBuffer.width), int(aBuffer.height), 1, pixels.data(), int(aBuffer.width) );
+}
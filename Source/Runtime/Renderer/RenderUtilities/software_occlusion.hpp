@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "engine_model.hpp"
+#include "culling.hpp"
+
+// Software occlusion culling (CPU path, for GPUs where a Hi-Z pass is too expensive)
+// large, low polygon meshes are selected as occluders at load time and rasterized
+// into a small depth buffer each frame; instances whose projected bounds lie behind
+// that depth everywhere are removed from the main pass before record_commands().
+// Rasterization runs per screen tile on worker threads, 8 pixels at a time with AVX2.
+
+namespace cfg
+{
+	// occlusion buffer size, multiples of the tile size
+	constexpr std::uint32_t kOcclusionWidth = 256;
+	constexpr std::uint32_t kOcclusionHeight = 128;
+	constexpr std::uint32_t kOcclusionTileWidth = 64; // multiple of 8 (SIMD width)
+	constexpr std::uint32_t kOcclusionTileHeight = 32;
+
+	// occluder selection
+	constexpr float kMinOccluderSize = 2.f;                  // world space bounds diagonal
+	constexpr std::size_t kMaxOccluderMeshTriangles = 2048;  // skip detailed meshes
+	constexpr std::size_t kMaxOccluderTriangles = 32768;     // total budget
+
+	constexpr char const* kOcclusionDumpPath = "occlusion_buffer.png";
+}
+
+// world space occluder triangles, baked from the static scene
+struct Occluders
+{
+	std::vector<glm::vec3>     positions;
+	std::vector<std::uint32_t> indices;
+	std::size_t                instanceCount = 0;
+};
+
+// nearest [0,1] depth per pixel, row 0 at the top of the screen
+struct OcclusionBuffer
+{
+	std::uint32_t      width = cfg::kOcclusionWidth;
+	std::uint32_t      height = cfg::kOcclusionHeight;
+	std::vector<float> depth;
+};
+
+Occluders build_occluders( EngineModel const& );
+
+// returns the number of triangles that survived setup (in front of the near plane)
+std::size_t rasterize_occluders( Occluders const&, glm::mat4 const& aViewProj, OcclusionBuffer& );
+
+// clears aVisible for visible instances hidden behind the occlusion buffer,
+// returns the number of instances it removed
+std::uint32_t test_occlusion(
+	OcclusionBuffer const&,
+	glm::mat4 const& aViewProj,
+	InstanceBounds const&,
+	std::vector<std::uint8_t>& aVisible
+);
+
+// debug view: writes the buffer as a grey scale PNG (near = white)
+bool write_occlusion_buffer( OcclusionBuffer const&, char const* aPath );
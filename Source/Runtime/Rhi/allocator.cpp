@@ -33,6 +33,34 @@ namespace labut2
 		std::swap( allocator, aOther.allocator );
 		return *this;
 	}
+
+
+	Allocation::Allocation() noexcept = default;
+
+	Allocation::~Allocation()
+	{
+		if( VK_NULL_HANDLE != allocation )
+		{
+			assert( VK_NULL_HANDLE != mAllocator );
+			vmaFreeMemory( mAllocator, allocation );
+		}
+	}
+
+	Allocation::Allocation( VmaAllocator aAllocator, VmaAllocation aAllocation ) noexcept
+		: allocation( aAllocation )
+		, mAllocator( aAllocator )
+	{}
+
+	Allocation::Allocation( Allocation&& aOther ) noexcept
+		: allocation( std::exchange( aOther.allocation, VK_NULL_HANDLE ) )
+		, mAllocator( std::exchange( aOther.mAllocator, VK_NULL_HANDLE ) )
+	{}
+	Allocation& Allocation::operator=( Allocation&& aOther ) noexcept
+	{
+		std::swap( allocation, aOther.allocation );
+		std::swap( mAllocator, aOther.mAllocator );
+		return *this;
+	}
 }
 
 namespace labut2
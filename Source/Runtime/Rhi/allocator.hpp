@@ -26,6 +26,28 @@ namespace labut2
 			VmaAllocator allocator = VK_NULL_HANDLE;
 	};
 
+	// a block of device memory without a resource of its own, e.g. shared by
+	// several images that are bound to it with vmaBindImageMemory()
+	class Allocation
+	{
+		public:
+			Allocation() noexcept, ~Allocation();
+
+			explicit Allocation( VmaAllocator, VmaAllocation = VK_NULL_HANDLE ) noexcept;
+
+			Allocation( Allocation const& ) = delete;
+			Allocation& operator= (Allocation const&) = delete;
+
+			Allocation( Allocation&& ) noexcept;
+			Allocation& operator = (Allocation&&) noexcept;
+
+		public:
+			VmaAllocation allocation = VK_NULL_HANDLE;
+
+		private:
+			VmaAllocator mAllocator = VK_NULL_HANDLE;
+	};
+
 	Allocator create_allocator( VulkanContext const& );
 }
 
@@ -7,12 +7,12 @@
 
 namespace labut2
 {
-	CommandPool create_command_pool( VulkanContext const& aContext, VkCommandPoolCreateFlags aFlags )
+	CommandPool create_command_pool( VulkanContext const& aContext, VkCommandPoolCreateFlags aFlags, std::uint32_t aQueueFamilyIndex )
 	{   // create command pool
 
 		VkCommandPoolCreateInfo poolInfo{};
 		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-       		poolInfo.queueFamilyIndex = aContext.graphicsFamilyIndex;
+       		poolInfo.queueFamilyIndex = VK_QUEUE_FAMILY_IGNORED == aQueueFamilyIndex ? aContext.graphicsFamilyIndex : aQueueFamilyIndex;
 		poolInfo.flags = aFlags;
 
 		VkCommandPool cpool = VK_NULL_HANDLE;
@@ -27,13 +27,13 @@ namespace labut2
 		return CommandPool( aContext.device, cpool );
 	}
 
-	VkCommandBuffer alloc_command_buffer( VulkanContext const& aContext, VkCommandPool aCmdPool )
+	VkCommandBuffer alloc_command_buffer( VulkanContext const& aContext, VkCommandPool aCmdPool, VkCommandBufferLevel aLevel )
 	{   // allocate command buffer
 		
 		VkCommandBufferAllocateInfo cbufInfo{};
 		cbufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		cbufInfo.commandPool = aCmdPool;
-		cbufInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cbufInfo.level = aLevel;
 		cbufInfo.commandBufferCount = 1;
 
 		VkCommandBuffer cbuff = VK_NULL_HANDLE;
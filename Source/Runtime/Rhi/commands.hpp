@@ -9,8 +9,9 @@
 
 namespace labut2
 {
-	CommandPool create_command_pool( VulkanContext const&, VkCommandPoolCreateFlags = 0 );
-	VkCommandBuffer alloc_command_buffer( VulkanContext const&, VkCommandPool );
+	// aQueueFamilyIndex: VK_QUEUE_FAMILY_IGNORED for the graphics family
+	CommandPool create_command_pool( VulkanContext const&, VkCommandPoolCreateFlags = 0, std::uint32_t aQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED );
+	VkCommandBuffer alloc_command_buffer( VulkanContext const&, VkCommandPool, VkCommandBufferLevel = VK_COMMAND_BUFFER_LEVEL_PRIMARY );
 }
 
 #endif // COMMANDS_HPP_DBB0D0EE_AC4E_44A8_800B_DE17E07E1536
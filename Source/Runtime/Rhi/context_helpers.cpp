@@ -174,8 +174,12 @@ namespace labut2::detail
 
 	std::vector<char const*> check_required_device_features( VkPhysicalDevice aPhysicalDev )
 	{
+		VkPhysicalDeviceVulkan12Features vk12{};
+		vk12.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
 		VkPhysicalDeviceVulkan13Features vk13{};
 		vk13.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+		vk13.pNext  = &vk12;
 		
 		VkPhysicalDeviceVulkan14Features vk14{};
 		vk14.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES;
@@ -188,6 +192,34 @@ namespace labut2::detail
 		vkGetPhysicalDeviceFeatures2( aPhysicalDev, &feat );
 
 		std::vector<char const*> missingFeat;
+		if( !vk12.scalarBlockLayout )
+		{
+			missingFeat.emplace_back( "scalarBlockLayout" );
+		}
+		if( !vk12.runtimeDescriptorArray )
+		{
+			missingFeat.emplace_back( "runtimeDescriptorArray" );
+		}
+		if( !vk12.descriptorBindingPartiallyBound )
+		{
+			missingFeat.emplace_back( "descriptorBindingPartiallyBound" );
+		}
+		if( !vk12.descriptorBindingVariableDescriptorCount )
+		{
+			missingFeat.emplace_back( "descriptorBindingVariableDescriptorCount" );
+		}
+		if( !vk12.descriptorBindingSampledImageUpdateAfterBind )
+		{
+			missingFeat.emplace_back( "descriptorBindingSampledImageUpdateAfterBind" );
+		}
+		if( !vk12.shaderSampledImageArrayNonUniformIndexing )
+		{
+			missingFeat.emplace_back( "shaderSampledImageArrayNonUniformIndexing" );
+		}
+		if( !vk12.timelineSemaphore )
+		{
+			missingFeat.emplace_back( "timelineSemaphore" );
+		}
 		if( !vk13.synchronization2 )
 		{
 			missingFeat.emplace_back( "synchronization2" );
@@ -203,4 +235,66 @@ namespace labut2::detail
 
 		return missingFeat;
 	}
+
+	void fill_device_features( VkPhysicalDevice aPhysicalDev, DeviceFeatures& aFeatures )
+	{
+		VkPhysicalDeviceFeatures supported{};
+		vkGetPhysicalDeviceFeatures( aPhysicalDev, &supported );
+
+		VkPhysicalDeviceVulkan12Features supported12{};
+		supported12.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		VkPhysicalDeviceVulkan14Features supported14{};
+		supported14.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES;
+		supported14.pNext  = &supported12;
+
+		VkPhysicalDeviceFeatures2 supported2{};
+		supported2.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supported2.pNext  = &supported14;
+		vkGetPhysicalDeviceFeatures2( aPhysicalDev, &supported2 );
+
+		auto& core = aFeatures.core;
+		core = VkPhysicalDeviceFeatures{};
+		// optional: GPU-driven path, vkCmdDrawIndexedIndirectCount with maxDrawCount > 1;
+		// cull.comp addresses instances through firstInstance
+		core.multiDrawIndirect = supported.multiDrawIndirect;
+		core.drawIndirectFirstInstance = supported.drawIndirectFirstInstance;
+
+		// optional: fragment shader invocations of the depth pre-pass statistics
+		core.pipelineStatisticsQuery = supported.pipelineStatisticsQuery;
+
+		// optional: gl_PrimitiveID in fragment shaders (visibility buffer ids)
+		core.geometryShader = supported.geometryShader;
+
+		auto& vk12 = aFeatures.vk12;
+		vk12 = VkPhysicalDeviceVulkan12Features{};
+		vk12.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		vk12.drawIndirectCount  = supported12.drawIndirectCount; // optional: GPU-driven path
+		vk12.scalarBlockLayout  = VK_TRUE; // shaders use layout(scalar)
+		// bindless materials: one partially bound, update-after-bind sampler2D[] (set 1)
+		vk12.runtimeDescriptorArray  = VK_TRUE;
+		vk12.descriptorBindingPartiallyBound  = VK_TRUE;
+		vk12.descriptorBindingVariableDescriptorCount  = VK_TRUE;
+		vk12.descriptorBindingSampledImageUpdateAfterBind  = VK_TRUE;
+		vk12.shaderSampledImageArrayNonUniformIndexing  = VK_TRUE;
+		vk12.timelineSemaphore  = VK_TRUE; // per-queue submission values, see Timeline
+		// optional: layered point light shadows, cube face (gl_Layer) from the vertex shader
+		vk12.shaderOutputLayer  = supported12.shaderOutputLayer;
+
+		auto& vk13 = aFeatures.vk13;
+		vk13 = VkPhysicalDeviceVulkan13Features{};
+		vk13.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+		vk13.pNext  = &vk12;
+		vk13.synchronization2  = VK_TRUE;
+		vk13.dynamicRendering  = VK_TRUE;
+
+		auto& vk14 = aFeatures.vk14;
+		vk14 = VkPhysicalDeviceVulkan14Features{};
+		vk14.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES;
+		vk14.pNext  = &vk13;
+		vk14.maintenance5  = VK_TRUE; // Required in Vulkan 1.4, but we need to say that we want it.
+
+		// optional: texture uploads written by the host (see load_image_texture2d_host())
+		vk14.hostImageCopy  = supported14.hostImageCopy;
+	}
 }
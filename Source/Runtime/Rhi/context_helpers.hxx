@@ -34,6 +34,27 @@ namespace labut2
 		std::unordered_set<std::string> get_device_extensions( VkPhysicalDevice );
 
 		std::vector<char const*> check_required_device_features( VkPhysicalDevice );
+
+		// Features enabled at device creation; shared by both create_device()
+		// paths so that they enable the same set. The members are chained
+		// through pNext (vk14 -> vk13 -> vk12), so the struct must not be
+		// copied or moved once filled.
+		struct DeviceFeatures
+		{
+			VkPhysicalDeviceFeatures core{};
+			VkPhysicalDeviceVulkan12Features vk12{};
+			VkPhysicalDeviceVulkan13Features vk13{};
+			VkPhysicalDeviceVulkan14Features vk14{};
+
+			DeviceFeatures() = default;
+			DeviceFeatures( DeviceFeatures const& ) = delete;
+			DeviceFeatures& operator= (DeviceFeatures const&) = delete;
+		};
+
+		// Required features (see check_required_device_features()) plus the
+		// optional ones that aPhysicalDev supports. Use as
+		// VkDeviceCreateInfo::pEnabledFeatures = &core, pNext = &vk14.
+		void fill_device_features( VkPhysicalDevice, DeviceFeatures& );
 	}
 }
 
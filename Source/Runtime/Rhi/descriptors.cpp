@@ -8,16 +8,21 @@
 namespace labut2
 {
 
-    DescriptorPool create_descriptor_pool( VulkanContext const& aContext, std::uint32_t aMaxDescriptors, std::uint32_t aMaxSets)
+    DescriptorPool create_descriptor_pool( VulkanContext const& aContext, std::uint32_t aMaxDescriptors, std::uint32_t aMaxSets, VkDescriptorPoolCreateFlags aFlags )
     {   // create descriptor pool
         
 		VkDescriptorPoolSize const pools[] = {
 			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, aMaxDescriptors },
-			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, aMaxDescriptors }
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, aMaxDescriptors },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, aMaxDescriptors },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, aMaxDescriptors },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, aMaxDescriptors },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, aMaxDescriptors }
 		};
 
 		VkDescriptorPoolCreateInfo poolInfo{};
 		poolInfo.sType          = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.flags          = aFlags;
 		poolInfo.maxSets        = aMaxSets;
 		poolInfo.poolSizeCount  = sizeof(pools)/sizeof(pools[0]);
 		poolInfo.pPoolSizes     = pools;
@@ -35,14 +40,20 @@ namespace labut2
 		return DescriptorPool( aContext.device, pool );
 	}
 
-    VkDescriptorSet alloc_desc_set( VulkanContext const& aContext, VkDescriptorPool aPool, VkDescriptorSetLayout aSetLayout )
+    VkDescriptorSet alloc_desc_set( VulkanContext const& aContext, VkDescriptorPool aPool, VkDescriptorSetLayout aSetLayout, std::uint32_t aVariableCount )
     {   // allocate descriptor set
 
+		VkDescriptorSetVariableDescriptorCountAllocateInfo variableInfo{};
+		variableInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+		variableInfo.descriptorSetCount = 1;
+		variableInfo.pDescriptorCounts  = &aVariableCount;
+
 		VkDescriptorSetAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 		allocInfo.descriptorPool      = aPool;
 		allocInfo.descriptorSetCount  = 1;
 		allocInfo.pSetLayouts         = &aSetLayout;
+		allocInfo.pNext               = aVariableCount ? &variableInfo : nullptr;
 
 		VkDescriptorSet dset = VK_NULL_HANDLE;
 		// allocate set
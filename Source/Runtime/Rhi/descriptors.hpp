@@ -10,9 +10,10 @@
 
 namespace labut2
 {
-	DescriptorPool create_descriptor_pool( VulkanContext const& aContext, std::uint32_t aMaxDescriptors = 2048, std::uint32_t aMaxSets = 1024 );
+	DescriptorPool create_descriptor_pool( VulkanContext const& aContext, std::uint32_t aMaxDescriptors = 2048, std::uint32_t aMaxSets = 1024, VkDescriptorPoolCreateFlags = 0 );
 
-	VkDescriptorSet alloc_desc_set( VulkanContext const& aContext, VkDescriptorPool aPool, VkDescriptorSetLayout aSetLayout );
+	// aVariableCount sizes the variable count binding of the layout (descriptor indexing), if any
+	VkDescriptorSet alloc_desc_set( VulkanContext const& aContext, VkDescriptorPool aPool, VkDescriptorSetLayout aSetLayout, std::uint32_t aVariableCount = 0 );
 }
 
 #endif // DESCRIPTORS_HPP_FAB9C33C_AB8E_4D20_A9F0_73648EADD693
@@ -0,0 +1,261 @@
+#include "gpu_profiler.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+
+#include "error.hpp"
+#include "to_string.hpp"
+
+// SOLUTION_TAGS: vulkan-(ex-[^1]|cw-.)
+
+namespace labut2
+{
+	namespace
+	{
+		// nearest rank of a sorted copy
+		float percentile( std::vector<float> aValues, float aFraction )
+		{
+			std::size_t const rank = std::size_t(std::ceil( aFraction * float(aValues.size()) ));
+			std::size_t const index = std::clamp<std::size_t>( rank, 1, aValues.size() ) - 1;
+			std::nth_element( aValues.begin(), aValues.begin() + std::ptrdiff_t(index), aValues.end() );
+			return aValues[index];
+		}
+	}
+
+	GpuProfiler::GpuProfiler( VulkanContext const& aContext, std::uint32_t aFrameSlots, std::uint32_t aMaxScopes )
+		: mDevice( aContext.device )
+		, mMaxScopes( aMaxScopes )
+		, mLabels( VK_NULL_HANDLE != aContext.debugMessenger && vkCmdBeginDebugUtilsLabelEXT && vkCmdEndDebugUtilsLabelEXT )
+	{
+		VkPhysicalDeviceProperties props{};
+		vkGetPhysicalDeviceProperties( aContext.physicalDevice, &props );
+		mPeriod = props.limits.timestampPeriod;
+
+		std::uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties( aContext.physicalDevice, &familyCount, nullptr );
+		std::vector<VkQueueFamilyProperties> families( familyCount );
+		vkGetPhysicalDeviceQueueFamilyProperties( aContext.physicalDevice, &familyCount, families.data() );
+
+		std::uint32_t const validBits = families[aContext.graphicsFamilyIndex].timestampValidBits;
+		if( 0 == validBits )
+			throw Error( "Graphics queue does not support timestamps" );
+		if( validBits < 64 )
+			mMask = (std::uint64_t(1) << validBits) - 1;
+
+		mSlots.resize( aFrameSlots );
+		for( auto& slot : mSlots )
+		{
+			VkQueryPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			poolInfo.queryCount = 2 * aMaxScopes;
+
+			VkQueryPool pool = VK_NULL_HANDLE;
+			if( auto const res = vkCreateQueryPool( mDevice, &poolInfo, nullptr, &pool ); VK_SUCCESS != res )
+			{
+				throw Error( "Unable to create profiler query pool\n"
+					"vkCreateQueryPool() returned {}", to_string(res)
+				);
+			}
+
+			slot.pool = QueryPool( mDevice, pool );
+			slot.records.reserve( aMaxScopes );
+		}
+	}
+
+	void GpuProfiler::begin_frame( std::uint32_t aFrameSlot )
+	{
+		assert( aFrameSlot < mSlots.size() );
+		assert( mOpen.empty() );
+
+		auto& slot = mSlots[aFrameSlot];
+		mReadBack = ~std::uint64_t(0);
+		if( slot.pending )
+			read_back( slot );
+
+		slot.records.clear();
+		slot.frame = mRecorded++;
+		mCurrent = &slot;
+	}
+
+	void GpuProfiler::reset( VkCommandBuffer aCmdBuff )
+	{
+		assert( mCurrent );
+
+		vkCmdResetQueryPool( aCmdBuff, mCurrent->pool.handle, 0, 2 * mMaxScopes );
+		mCurrent->pending = true;
+	}
+
+	void GpuProfiler::begin( VkCommandBuffer aCmdBuff, char const* aName )
+	{
+		assert( mCurrent && mCurrent->pending );
+
+		if( mLabels )
+		{
+			VkDebugUtilsLabelEXT label{};
+			label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+			label.pLabelName = aName;
+			vkCmdBeginDebugUtilsLabelEXT( aCmdBuff, &label );
+		}
+
+		if( mCurrent->records.size() >= mMaxScopes )
+		{
+			++mDropped;
+			mOpen.emplace_back( ~0u );
+			return;
+		}
+
+		std::uint32_t const query = 2 * std::uint32_t(mCurrent->records.size());
+		mOpen.emplace_back( std::uint32_t(mCurrent->records.size()) );
+		mCurrent->records.emplace_back( Record{ series( aName ), std::uint32_t(mOpen.size() - 1), query } );
+
+		vkCmdWriteTimestamp2( aCmdBuff, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, mCurrent->pool.handle, query );
+	}
+
+	void GpuProfiler::end( VkCommandBuffer aCmdBuff )
+	{
+		assert( mCurrent && !mOpen.empty() );
+
+		std::uint32_t const record = mOpen.back();
+		mOpen.pop_back();
+
+		if( ~0u != record )
+			vkCmdWriteTimestamp2( aCmdBuff, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, mCurrent->pool.handle, mCurrent->records[record].query + 1 );
+
+		if( mLabels )
+			vkCmdEndDebugUtilsLabelEXT( aCmdBuff );
+	}
+
+	std::vector<GpuScopeTiming> GpuProfiler::timings() const
+	{
+		std::vector<GpuScopeTiming> ret;
+		ret.reserve( mSeries.size() );
+
+		std::vector<float> values;
+		for( auto const& series : mSeries )
+		{
+			GpuScopeTiming timing{ series.name, series.depth, series.history.size(), 0.f, 0.f, 0.f, 0.f, 0.f };
+			if( !series.history.empty() )
+			{
+				values.clear();
+				for( auto const& sample : series.history )
+					values.emplace_back( sample.ms );
+
+				std::size_t const last = (series.head + series.history.size() - 1) % series.history.size();
+				timing.lastMs = series.history[last].ms;
+
+				float sum = 0.f;
+				for( float const ms : values )
+					sum += ms;
+				timing.averageMs = sum / float(values.size());
+				timing.maxMs = *std::max_element( values.begin(), values.end() );
+				timing.p95Ms = percentile( values, 0.95f );
+				timing.p99Ms = percentile( values, 0.99f );
+			}
+
+			ret.emplace_back( timing );
+		}
+
+		return ret;
+	}
+
+	std::optional<float> GpuProfiler::read_back_ms( char const* aName ) const
+	{
+		for( auto const& series : mSeries )
+		{
+			if( series.name != aName && 0 != std::strcmp( series.name, aName ) )
+				continue;
+			if( series.history.empty() )
+				return {};
+
+			std::size_t const last = (series.head + series.history.size() - 1) % series.history.size();
+			if( series.history[last].frame != mReadBack )
+				return {};
+
+			return series.history[last].ms;
+		}
+
+		return {};
+	}
+
+	bool GpuProfiler::write_csv( char const* aPath ) const
+	{
+		std::FILE* file = std::fopen( aPath, "w" );
+		if( !file )
+			return false;
+
+		std::fprintf( file, "frame,scope,depth,gpu_ms\n" );
+
+		for( auto const& series : mSeries )
+		{
+			for( std::size_t i = 0; i < series.history.size(); ++i )
+			{
+				auto const& sample = series.history[(series.head + i) % series.history.size()];
+				std::fprintf( file, "%llu,%s,%u,%.4f\n", static_cast<unsigned long long>(sample.frame), series.name, series.depth, sample.ms );
+			}
+		}
+
+		return 0 == std::fclose( file );
+	}
+
+	void GpuProfiler::read_back( Slot& aSlot )
+	{
+		aSlot.pending = false;
+		if( aSlot.records.empty() )
+			return;
+
+		std::uint32_t const count = 2 * std::uint32_t(aSlot.records.size());
+		std::vector<std::uint64_t> results( 2 * count ); // value, availability
+		auto const res = vkGetQueryPoolResults( mDevice, aSlot.pool.handle, 0, count,
+			results.size() * sizeof(std::uint64_t), results.data(), 2 * sizeof(std::uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT );
+		if( VK_SUCCESS != res && VK_NOT_READY != res )
+		{
+			throw Error( "Unable to read profiler timestamps\n"
+				"vkGetQueryPoolResults() returned {}", to_string(res)
+			);
+		}
+
+		for( auto const& record : aSlot.records )
+		{
+			std::uint64_t const* begin = &results[2 * record.query];
+			std::uint64_t const* end = &results[2 * (record.query + 1)];
+			if( !begin[1] || !end[1] )
+			{
+				++mDropped;
+				continue;
+			}
+
+			float const ms = float(double((end[0] - begin[0]) & mMask) * mPeriod * 1e-6);
+
+			auto& series = mSeries[record.series];
+			series.depth = record.depth;
+			if( series.history.size() < kHistory )
+				series.history.emplace_back( Sample{ aSlot.frame, ms } );
+			else
+			{
+				series.history[series.head] = Sample{ aSlot.frame, ms };
+				series.head = (series.head + 1) % series.history.size();
+			}
+		}
+
+		mReadBack = aSlot.frame;
+		++mFrames;
+	}
+
+	std::uint32_t GpuProfiler::series( char const* aName )
+	{
+		for( std::size_t i = 0; i < mSeries.size(); ++i )
+		{
+			if( mSeries[i].name == aName || 0 == std::strcmp( mSeries[i].name, aName ) )
+				return std::uint32_t(i);
+		}
+
+		mSeries.emplace_back( Series{ aName } );
+		mSeries.back().history.reserve( kHistory );
+		return std::uint32_t(mSeries.size() - 1);
+	}
+}
@@ -0,0 +1,148 @@
+#ifndef GPU_PROFILER_HPP_1BDE45D3_4814_4CF1_BB0F_02B2BBE42C50
+#define GPU_PROFILER_HPP_1BDE45D3_4814_4CF1_BB0F_02B2BBE42C50
+// SOLUTION_TAGS: vulkan-(ex-[^1]|cw-.)
+
+#include <volk/volk.h>
+
+#include <vector>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+
+#include "vkobject.hpp"
+#include "vulkan_context.hpp"
+
+namespace labut2
+{
+	struct GpuScopeTiming
+	{
+		char const*   name;
+		std::uint32_t depth;   // nesting depth when last recorded, 0: outermost
+		std::size_t   samples; // in the window
+		float         lastMs;
+		float         averageMs;
+		float         p95Ms;
+		float         p99Ms;
+		float         maxMs;
+	};
+
+	// GPU timestamp profiler
+	// Every scope (begin()/end(), or Scope) writes a timestamp pair into the
+	// query pool of the current frame slot and, where VK_EXT_debug_utils is
+	// enabled, opens a debug label of the same name for capture tools. Scopes
+	// nest. A slot is read back at its next begin_frame(): by then the caller
+	// has waited for the slot's previous submission, so results are never
+	// waited for; queries that are still unavailable are dropped. Per scope
+	// name the last kHistory samples give the rolling average and percentiles.
+	class GpuProfiler final
+	{
+		public:
+			static constexpr std::uint32_t kDefaultMaxScopes = 64; // per frame
+			static constexpr std::size_t   kHistory = 240;         // samples per scope
+
+			class Scope final
+			{
+				public:
+					Scope( GpuProfiler* aProfiler, VkCommandBuffer aCmdBuff, char const* aName )
+						: mProfiler( aProfiler ), mCmdBuff( aCmdBuff )
+					{
+						if( mProfiler )
+							mProfiler->begin( mCmdBuff, aName );
+					}
+					~Scope()
+					{
+						if( mProfiler )
+							mProfiler->end( mCmdBuff );
+					}
+
+					Scope( Scope const& ) = delete;
+					Scope& operator= (Scope const&) = delete;
+
+				private:
+					GpuProfiler*    mProfiler;
+					VkCommandBuffer mCmdBuff;
+			};
+
+		public:
+			GpuProfiler() noexcept = default;
+
+			// one query pool of 2 * aMaxScopes timestamps per frame slot
+			GpuProfiler( VulkanContext const&, std::uint32_t aFrameSlots, std::uint32_t aMaxScopes = kDefaultMaxScopes );
+
+			// reads back the slot's previous frame, once the slot's resources
+			// are free again; the following scopes go into this slot
+			void begin_frame( std::uint32_t aFrameSlot );
+
+			// resets the slot's queries; in its command buffer, before any scope
+			void reset( VkCommandBuffer );
+
+			// aName must outlive the profiler (a string literal); scopes with
+			// the same name share their statistics
+			void begin( VkCommandBuffer, char const* aName );
+			void end( VkCommandBuffer );
+
+			// in order of first appearance
+			std::vector<GpuScopeTiming> timings() const;
+
+			// aName's time in the frame that the last begin_frame() read back (the
+			// last scope of that name there); empty if that frame did not record
+			// it or its queries were unavailable. For per frame consumers, e.g.
+			// the dynamic resolution controller.
+			std::optional<float> read_back_ms( char const* aName ) const;
+
+			// every sample in the window as CSV (frame, scope, depth, gpu ms); false on failure
+			bool write_csv( char const* aPath ) const;
+
+			std::uint64_t frames() const noexcept { return mFrames; }   // read back
+			std::uint64_t dropped() const noexcept { return mDropped; } // scopes past aMaxScopes or unavailable
+
+		private:
+			struct Record
+			{
+				std::uint32_t series;
+				std::uint32_t depth;
+				std::uint32_t query; // begin; end at query + 1
+			};
+
+			struct Slot
+			{
+				QueryPool           pool;
+				std::vector<Record> records;
+				std::uint64_t       frame = 0; // number of the recorded frame
+				bool                pending = false;
+			};
+
+			struct Sample
+			{
+				std::uint64_t frame;
+				float         ms;
+			};
+
+			struct Series
+			{
+				char const*         name;
+				std::uint32_t       depth = 0;
+				std::vector<Sample> history; // ring, oldest at head once full
+				std::size_t         head = 0;
+			};
+
+			void read_back( Slot& );
+			std::uint32_t series( char const* aName );
+
+			VkDevice      mDevice = VK_NULL_HANDLE;
+			float         mPeriod = 0.f;  // ns per tick
+			std::uint64_t mMask = ~std::uint64_t(0); // timestampValidBits
+			std::uint32_t mMaxScopes = 0;
+			bool          mLabels = false;
+
+			std::vector<Slot>          mSlots;
+			Slot*                      mCurrent = nullptr;
+			std::vector<std::uint32_t> mOpen; // records of the open scopes, ~0u if dropped
+
+			std::vector<Series> mSeries;
+			std::uint64_t       mFrames = 0, mRecorded = 0, mDropped = 0;
+			std::uint64_t       mReadBack = ~std::uint64_t(0); // frame read by the last begin_frame()
+	};
+}
+
+#endif // GPU_PROFILER_HPP_1BDE45D3_4814_4CF1_BB0F_02B2BBE42C50
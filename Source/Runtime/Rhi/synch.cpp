@@ -1,5 +1,8 @@
 #include "synch.hpp"
 
+#include <limits>
+#include <vector>
+#include <utility>
 #include <cassert>
 
 #include "error.hpp"
@@ -48,6 +51,109 @@ namespace labut2
 		return Semaphore( aDevice, semaphore );
 	}
 
+	Timeline create_timeline( VkDevice aDevice, VkQueue aQueue )
+	{
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+
+		VkSemaphore semaphore = VK_NULL_HANDLE;
+		if( auto const res = vkCreateSemaphore( aDevice, &semaphoreInfo, nullptr, &semaphore ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to create timeline semaphore\n"
+				"vkCreateSemaphore() returned {}", to_string(res)
+			);
+		}
+
+		return Timeline( aDevice, Semaphore( aDevice, semaphore ), aQueue );
+	}
+
+	Timeline::Timeline( VkDevice aDevice, Semaphore aSemaphore, VkQueue aQueue ) noexcept
+		: semaphore( std::move(aSemaphore) )
+		, queue( aQueue )
+		, mDevice( aDevice )
+	{}
+
+	std::uint64_t Timeline::submit( VkSubmitInfo2 const& aSubmit, VkPipelineStageFlags2 aSignalStages, VkFence aFence )
+	{
+		assert( VK_NULL_HANDLE != semaphore.handle );
+
+		std::uint64_t const value = mSubmitted + 1;
+
+		// the caller's signals, then the timeline's
+		std::vector<VkSemaphoreSubmitInfo> signals( aSubmit.pSignalSemaphoreInfos, aSubmit.pSignalSemaphoreInfos + aSubmit.signalSemaphoreInfoCount );
+
+		auto& signal = signals.emplace_back();
+		signal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		signal.semaphore = semaphore.handle;
+		signal.value = value;
+		signal.stageMask = aSignalStages;
+
+		VkSubmitInfo2 submitInfo = aSubmit;
+		submitInfo.signalSemaphoreInfoCount = std::uint32_t(signals.size());
+		submitInfo.pSignalSemaphoreInfos = signals.data();
+
+		if( auto const res = vkQueueSubmit2( queue, 1, &submitInfo, aFence ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to submit command buffer to queue\n"
+				"vkQueueSubmit2() returned {}", to_string(res)
+			);
+		}
+
+		mSubmitted = value;
+		return value;
+	}
+
+	std::uint64_t Timeline::completed()
+	{
+		std::uint64_t value = 0;
+		if( auto const res = vkGetSemaphoreCounterValue( mDevice, semaphore.handle, &value ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to query timeline semaphore\n"
+				"vkGetSemaphoreCounterValue() returned {}", to_string(res)
+			);
+		}
+
+		mCompleted = value;
+		return value;
+	}
+
+	void Timeline::wait( std::uint64_t aValue )
+	{
+		if( aValue <= mCompleted )
+			return;
+
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &semaphore.handle;
+		waitInfo.pValues = &aValue;
+
+		if( auto const res = vkWaitSemaphores( mDevice, &waitInfo, std::numeric_limits<std::uint64_t>::max() ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to wait for timeline semaphore\n"
+				"vkWaitSemaphores() returned {}", to_string(res)
+			);
+		}
+
+		mCompleted = aValue;
+	}
+
+	VkSemaphoreSubmitInfo Timeline::wait_info( std::uint64_t aValue, VkPipelineStageFlags2 aStages ) const noexcept
+	{
+		VkSemaphoreSubmitInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		info.semaphore = semaphore.handle;
+		info.value = aValue;
+		info.stageMask = aStages;
+		return info;
+	}
+
 	void image_barrier( VkCommandBuffer aCmdBuff, VkImage aImage, VkPipelineStageFlags2 aSrcStageMask, VkAccessFlags2 aSrcAccessMask, VkImageLayout aSrcLayout, VkPipelineStageFlags2 aDstStageMask, VkAccessFlags2 aDstAccessMask, VkImageLayout aDstLayout, VkImageSubresourceRange aRange, std::uint32_t aSrcQueueFamilyIndex, std::uint32_t aDstQueueFamilyIndex )
 	{	// create image barrier
 		assert( VK_NULL_HANDLE != aCmdBuff );
@@ -14,6 +14,44 @@ namespace labut2
 	Fence create_fence( VkDevice, VkFenceCreateFlags = 0 );
 	Semaphore create_semaphore( VkDevice );
 
+	// Timeline semaphore of one queue
+	// every submit() signals the next value of the queue's counter. CPU waits
+	// (wait()) and resource retirement (reached()) key off these values instead
+	// of fences or vkQueueWaitIdle(); other queues wait on them via wait_info().
+	class Timeline final
+	{
+		public:
+			Timeline() noexcept = default;
+			Timeline( VkDevice, Semaphore, VkQueue ) noexcept;
+
+			// aSubmit, plus a signal of the next value at aSignalStages; returns
+			// that value
+			std::uint64_t submit( VkSubmitInfo2 const& aSubmit, VkPipelineStageFlags2 aSignalStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VkFence = VK_NULL_HANDLE );
+
+			// value of the latest submit()
+			std::uint64_t submitted() const noexcept { return mSubmitted; }
+
+			// highest value the queue has reached, without waiting
+			std::uint64_t completed();
+			bool reached( std::uint64_t aValue ) { return aValue <= mCompleted || aValue <= completed(); }
+
+			void wait( std::uint64_t aValue );
+
+			// wait of another queue's submission on aValue
+			VkSemaphoreSubmitInfo wait_info( std::uint64_t aValue, VkPipelineStageFlags2 aStages ) const noexcept;
+
+		public:
+			Semaphore semaphore;
+			VkQueue queue = VK_NULL_HANDLE;
+
+		private:
+			VkDevice      mDevice = VK_NULL_HANDLE;
+			std::uint64_t mSubmitted = 0;
+			std::uint64_t mCompleted = 0;
+	};
+
+	Timeline create_timeline( VkDevice, VkQueue );
+
 	void image_barrier(
 		VkCommandBuffer,
 		VkImage,
@@ -0,0 +1,192 @@
+#include "transfer.hpp"
+
+#include <utility>
+#include <cassert>
+
+#include "error.hpp"
+#include "commands.hpp"
+#include "to_string.hpp"
+
+// SOLUTION_TAGS: vulkan-(ex-[^1]|cw-.)
+
+namespace
+{
+	constexpr VkPipelineStageFlags2 kTransferStages = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+
+	void begin_commands( VkCommandBuffer aCmdBuff )
+	{
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if( auto const res = vkBeginCommandBuffer( aCmdBuff, &beginInfo ); VK_SUCCESS != res )
+		{
+			throw labut2::Error( "Beginning command buffer recording\n"
+				"vkBeginCommandBuffer() returned {}", labut2::to_string(res)
+			);
+		}
+	}
+
+	void end_commands( VkCommandBuffer aCmdBuff )
+	{
+		if( auto const res = vkEndCommandBuffer( aCmdBuff ); VK_SUCCESS != res )
+		{
+			throw labut2::Error( "Ending command buffer recording\n"
+				"vkEndCommandBuffer() returned {}", labut2::to_string(res)
+			);
+		}
+	}
+}
+
+namespace labut2
+{
+	TransferQueue::TransferQueue( VulkanContext const& aContext, Timeline& aGraphics )
+		: mDevice( aContext.device )
+		, mGraphics( &aGraphics )
+		, mTransferFamily( aContext.transferFamilyIndex )
+		, mGraphicsFamily( aContext.graphicsFamilyIndex )
+	{
+		mGraphicsPool = create_command_pool( aContext, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT );
+
+		if( dedicated() )
+		{
+			mTransfer = create_timeline( aContext.device, aContext.transferQueue );
+			mTransferPool = create_command_pool( aContext, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, mTransferFamily );
+		}
+	}
+
+	TransferQueue::Batch TransferQueue::begin()
+	{
+		assert( mGraphics );
+
+		Batch ret;
+		VkCommandBufferAllocateInfo cbufInfo{};
+		cbufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cbufInfo.commandPool = mGraphicsPool.handle;
+		cbufInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cbufInfo.commandBufferCount = 1;
+
+		if( auto const res = vkAllocateCommandBuffers( mDevice, &cbufInfo, &ret.graphics ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to allocate command buffer\n"
+				"vkAllocateCommandBuffers() returned {}", to_string(res)
+			);
+		}
+		begin_commands( ret.graphics );
+
+		if( !dedicated() )
+		{
+			ret.transfer = ret.graphics;
+			return ret;
+		}
+
+		cbufInfo.commandPool = mTransferPool.handle;
+		if( auto const res = vkAllocateCommandBuffers( mDevice, &cbufInfo, &ret.transfer ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to allocate command buffer\n"
+				"vkAllocateCommandBuffers() returned {}", to_string(res)
+			);
+		}
+		begin_commands( ret.transfer );
+
+		return ret;
+	}
+
+	std::uint64_t TransferQueue::submit( Batch&& aBatch )
+	{
+		VkCommandBufferSubmitInfo graphicsCmd{};
+		graphicsCmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+		graphicsCmd.commandBuffer = aBatch.graphics;
+
+		VkSubmitInfo2 graphicsInfo{};
+		graphicsInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+		graphicsInfo.commandBufferInfoCount = 1;
+		graphicsInfo.pCommandBufferInfos = &graphicsCmd;
+
+		VkSemaphoreSubmitInfo transferDone{};
+		if( dedicated() )
+		{
+			end_commands( aBatch.transfer );
+
+			VkCommandBufferSubmitInfo transferCmd{};
+			transferCmd.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+			transferCmd.commandBuffer = aBatch.transfer;
+
+			VkSubmitInfo2 transferInfo{};
+			transferInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+			transferInfo.commandBufferInfoCount = 1;
+			transferInfo.pCommandBufferInfos = &transferCmd;
+
+			std::uint64_t const value = mTransfer.submit( transferInfo, kTransferStages );
+
+			// the acquires are in the first scope of this wait
+			transferDone = mTransfer.wait_info( value, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT );
+			graphicsInfo.waitSemaphoreInfoCount = 1;
+			graphicsInfo.pWaitSemaphoreInfos = &transferDone;
+		}
+
+		end_commands( aBatch.graphics );
+		std::uint64_t const value = mGraphics->submit( graphicsInfo );
+
+		mInFlight.emplace_back( InFlight{ value, aBatch.transfer, aBatch.graphics, std::move(aBatch.staging) } );
+		return value;
+	}
+
+	void TransferQueue::collect()
+	{
+		std::size_t done = 0;
+		for( ; done < mInFlight.size() && mGraphics->reached( mInFlight[done].value ); ++done )
+		{
+			auto const& batch = mInFlight[done];
+			vkFreeCommandBuffers( mDevice, mGraphicsPool.handle, 1, &batch.graphics );
+			if( dedicated() )
+				vkFreeCommandBuffers( mDevice, mTransferPool.handle, 1, &batch.transfer );
+		}
+
+		mInFlight.erase( mInFlight.begin(), mInFlight.begin() + std::ptrdiff_t(done) );
+	}
+
+	void TransferQueue::handoff( Batch const& aBatch, VkBuffer aBuffer, VkPipelineStageFlags2 aDstStages, VkAccessFlags2 aDstAccess ) const
+	{
+		if( !dedicated() )
+		{
+			buffer_barrier( aBatch.graphics, aBuffer, kTransferStages, VK_ACCESS_2_TRANSFER_WRITE_BIT, aDstStages, aDstAccess );
+			return;
+		}
+
+		// release: the destination half is ignored
+		buffer_barrier( aBatch.transfer, aBuffer,
+			kTransferStages, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+			VK_WHOLE_SIZE, 0, mTransferFamily, mGraphicsFamily
+		);
+
+		// acquire: the source half is ignored, the semaphore wait orders it
+		buffer_barrier( aBatch.graphics, aBuffer,
+			VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+			aDstStages, aDstAccess,
+			VK_WHOLE_SIZE, 0, mTransferFamily, mGraphicsFamily
+		);
+	}
+
+	void TransferQueue::handoff( Batch const& aBatch, VkImage aImage, VkImageLayout aLayout, VkImageSubresourceRange aRange, VkPipelineStageFlags2 aDstStages, VkAccessFlags2 aDstAccess ) const
+	{
+		if( !dedicated() )
+		{
+			image_barrier( aBatch.graphics, aImage, kTransferStages, VK_ACCESS_2_TRANSFER_WRITE_BIT, aLayout, aDstStages, aDstAccess, aLayout, aRange );
+			return;
+		}
+
+		image_barrier( aBatch.transfer, aImage,
+			kTransferStages, VK_ACCESS_2_TRANSFER_WRITE_BIT, aLayout,
+			VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, aLayout,
+			aRange, mTransferFamily, mGraphicsFamily
+		);
+
+		image_barrier( aBatch.graphics, aImage,
+			VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, aLayout,
+			aDstStages, aDstAccess, aLayout,
+			aRange, mTransferFamily, mGraphicsFamily
+		);
+	}
+}
@@ -0,0 +1,79 @@
+#ifndef TRANSFER_HPP_5C3E1B7A_0D42_4F6E_9A8B_2E7C61D4F0A3
+#define TRANSFER_HPP_5C3E1B7A_0D42_4F6E_9A8B_2E7C61D4F0A3
+// SOLUTION_TAGS: vulkan-(ex-[^1]|cw-.)
+
+#include <volk/volk.h>
+
+#include <vector>
+#include <cstdint>
+
+#include "synch.hpp"
+#include "vkbuffer.hpp"
+#include "vkobject.hpp"
+#include "vulkan_context.hpp"
+
+namespace labut2
+{
+	// Uploads on the transfer queue
+	// A batch has a command buffer of the transfer family for the copies and one
+	// of the graphics family for the queue family ownership acquires and for
+	// what only a graphics queue can do (mip blits). submit() submits the
+	// transfer part on the transfer queue's own timeline and the graphics part
+	// on the graphics timeline, waiting for the former, and returns the graphics
+	// value from which the uploaded resources may be used; nothing waits on the
+	// host. The staging buffers and command buffers of a batch are released by
+	// collect() once that value is reached.
+	//
+	// Without a transfer-only family (lavapipe, some integrated GPUs) both parts
+	// are the same graphics command buffer and a handoff is a plain barrier.
+	class TransferQueue final
+	{
+		public:
+			struct Batch
+			{
+				VkCommandBuffer transfer = VK_NULL_HANDLE;
+				VkCommandBuffer graphics = VK_NULL_HANDLE;
+
+				// released with the batch, see collect()
+				std::vector<Buffer> staging;
+			};
+
+		public:
+			TransferQueue() noexcept = default;
+
+			// aGraphics: the timeline of the graphics queue; must outlive this
+			TransferQueue( VulkanContext const&, Timeline& aGraphics );
+
+			// the transfer queue is not the graphics queue
+			bool dedicated() const noexcept { return mTransferFamily != mGraphicsFamily; }
+
+			Batch begin();
+			std::uint64_t submit( Batch&& );
+
+			void collect();
+
+			// transfer writes to the resource, made visible to aDstStages/aDstAccess
+			// on the graphics queue (ownership release in the transfer part, acquire
+			// in the graphics part); images keep aLayout
+			void handoff( Batch const&, VkBuffer, VkPipelineStageFlags2 aDstStages, VkAccessFlags2 aDstAccess ) const;
+			void handoff( Batch const&, VkImage, VkImageLayout aLayout, VkImageSubresourceRange, VkPipelineStageFlags2 aDstStages, VkAccessFlags2 aDstAccess ) const;
+
+		private:
+			struct InFlight
+			{
+				std::uint64_t       value; // graphics timeline
+				VkCommandBuffer     transfer, graphics;
+				std::vector<Buffer> staging;
+			};
+
+			VkDevice      mDevice = VK_NULL_HANDLE;
+			Timeline*     mGraphics = nullptr;
+			Timeline      mTransfer;
+			CommandPool   mTransferPool, mGraphicsPool;
+			std::uint32_t mTransferFamily = 0, mGraphicsFamily = 0;
+
+			std::vector<InFlight> mInFlight; // in submission order
+	};
+}
+
+#endif // TRANSFER_HPP_5C3E1B7A_0D42_4F6E_9A8B_2E7C61D4F0A3
@@ -0,0 +1,214 @@
+#include "upload.hpp"
+
+#include <cstring>
+#include <utility>
+#include <cassert>
+#include <algorithm>
+
+#include "error.hpp"
+#include "to_string.hpp"
+
+// SOLUTION_TAGS: vulkan-(ex-[^1]|cw-.)
+
+namespace labut2
+{
+	UploadManager::UploadManager( VulkanContext const& aContext, Allocator const& aAllocator, Timeline& aGraphics, VkDeviceSize aRingSize, std::chrono::milliseconds aFlushInterval )
+		: mQueue( aContext, aGraphics )
+		, mGraphics( &aGraphics )
+		, mAllocator( &aAllocator )
+		, mSize( aRingSize )
+		, mFlushInterval( aFlushInterval )
+	{
+		VkPhysicalDeviceProperties props{};
+		vkGetPhysicalDeviceProperties( aContext.physicalDevice, &props );
+
+		// texel aligned for any format used here; a power of two
+		mAlignment = std::max<VkDeviceSize>( 16, props.limits.optimalBufferCopyOffsetAlignment );
+
+		mRing = create_buffer( aAllocator, mSize,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+			VMA_MEMORY_USAGE_AUTO_PREFER_HOST
+		);
+
+		VmaAllocationInfo info{};
+		vmaGetAllocationInfo( aAllocator.allocator, mRing.allocation, &info );
+		if( !info.pMappedData )
+			throw Error( "Unable to map the staging ring" );
+
+		mMapped = static_cast<std::byte*>( info.pMappedData );
+	}
+
+	UploadManager::Staging UploadManager::stage( void const* aData, VkDeviceSize aSize )
+	{
+		assert( mGraphics );
+
+		// the size threshold; the copies out of earlier stage()s are recorded
+		if( mBatchBytes > mSize / 4 )
+			flush();
+
+		++mStats.uploads;
+		mStats.bytes += aSize;
+
+		Staging ret{};
+		if( aSize > mSize / 4 )
+		{
+			// would take the ring over for itself
+			Buffer staging = create_buffer( *mAllocator, aSize,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT
+			);
+
+			VmaAllocationInfo info{};
+			vmaGetAllocationInfo( mAllocator->allocator, staging.allocation, &info );
+			if( !info.pMappedData )
+				throw Error( "Unable to map staging buffer" );
+
+			std::memcpy( info.pMappedData, aData, std::size_t(aSize) );
+			if( auto const res = vmaFlushAllocation( mAllocator->allocator, staging.allocation, 0, VK_WHOLE_SIZE ); VK_SUCCESS != res )
+			{
+				throw Error( "Unable to flush staging buffer\n"
+					"vmaFlushAllocation() returned {}", to_string(res)
+				);
+			}
+
+			++mStats.oversized;
+			ret = Staging{ staging.buffer, 0 };
+
+			if( !mOpen )
+			{
+				mBatch = mQueue.begin();
+				mOpen = true;
+				mOpened = std::chrono::steady_clock::now();
+			}
+			mBatch.staging.emplace_back( std::move(staging) );
+		}
+		else
+		{
+			// may flush the open batch, so before begin()
+			VkDeviceSize const offset = allocate( aSize );
+
+			std::memcpy( mMapped + offset, aData, std::size_t(aSize) );
+			if( auto const res = vmaFlushAllocation( mAllocator->allocator, mRing.allocation, offset, aSize ); VK_SUCCESS != res )
+			{
+				throw Error( "Unable to flush the staging ring\n"
+					"vmaFlushAllocation() returned {}", to_string(res)
+				);
+			}
+
+			ret = Staging{ mRing.buffer, offset };
+
+			if( !mOpen )
+			{
+				mBatch = mQueue.begin();
+				mOpen = true;
+				mOpened = std::chrono::steady_clock::now();
+			}
+		}
+
+		mBatchBytes += aSize;
+		return ret;
+	}
+
+	void UploadManager::upload( VkBuffer aDst, void const* aData, VkDeviceSize aSize, VkPipelineStageFlags2 aDstStages, VkAccessFlags2 aDstAccess )
+	{
+		auto const src = stage( aData, aSize );
+
+		VkBufferCopy copy{ src.offset, 0, aSize };
+		vkCmdCopyBuffer( mBatch.transfer, src.buffer, aDst, 1, &copy );
+
+		handoff( aDst, aDstStages, aDstAccess );
+	}
+
+	std::uint64_t UploadManager::flush()
+	{
+		if( !mOpen )
+			return mLastValue;
+
+		mLastValue = mQueue.submit( std::move(mBatch) );
+		mRegions.emplace_back( Region{ mLastValue, mHead } );
+
+		mBatch = {};
+		mOpen = false;
+		mBatchBytes = 0;
+		++mStats.batches;
+
+		return mLastValue;
+	}
+
+	void UploadManager::finish()
+	{
+		std::uint64_t const value = flush();
+		if( !mGraphics->reached( value ) )
+		{
+			++mStats.stalls;
+			mGraphics->wait( value );
+		}
+		recycle();
+	}
+
+	void UploadManager::update()
+	{
+		if( mOpen && std::chrono::steady_clock::now() - mOpened >= mFlushInterval )
+			flush();
+
+		recycle();
+	}
+
+	VkDeviceSize UploadManager::allocate( VkDeviceSize aSize )
+	{
+		VkDeviceSize const size = (aSize + mAlignment - 1) & ~(mAlignment - 1);
+		assert( size <= mSize / 4 );
+
+		// free: [head, end) and [0, tail) when head >= tail, else [head, tail);
+		// head never catches up with tail, so head == tail means empty
+		for( ;; )
+		{
+			if( mHead >= mTail )
+			{
+				if( mSize - mHead >= size )
+				{
+					VkDeviceSize const offset = mHead;
+					mHead += size;
+					return offset;
+				}
+
+				if( mTail > size )
+				{
+					mHead = size;
+					return 0;
+				}
+			}
+			else if( mTail - mHead > size )
+			{
+				VkDeviceSize const offset = mHead;
+				mHead += size;
+				return offset;
+			}
+
+			// full: the open batch may hold the only space that is still to come
+			// back, then wait for the oldest batch
+			flush();
+
+			assert( !mRegions.empty() );
+			++mStats.stalls;
+			mGraphics->wait( mRegions.front().value );
+			recycle();
+		}
+	}
+
+	void UploadManager::recycle()
+	{
+		while( !mRegions.empty() && mGraphics->reached( mRegions.front().value ) )
+		{
+			mTail = mRegions.front().end;
+			mRegions.pop_front();
+		}
+
+		// nothing in flight or recorded: start over at the front
+		if( mRegions.empty() && !mOpen )
+			mHead = mTail = 0;
+
+		mQueue.collect();
+	}
+}
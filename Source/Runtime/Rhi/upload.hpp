@@ -0,0 +1,119 @@
+#ifndef UPLOAD_HPP_9E2B6C40_7A1D_4C85_B3F2_1D8A5E7C3B69
+#define UPLOAD_HPP_9E2B6C40_7A1D_4C85_B3F2_1D8A5E7C3B69
+// SOLUTION_TAGS: vulkan-(ex-[^1]|cw-.)
+
+#include <volk/volk.h>
+#include <vk_mem_alloc.h>
+
+#include <deque>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "synch.hpp"
+#include "transfer.hpp"
+#include "vkbuffer.hpp"
+#include "allocator.hpp"
+#include "vulkan_context.hpp"
+
+namespace labut2
+{
+	struct UploadStats
+	{
+		std::uint64_t bytes = 0;     // staged
+		std::uint32_t uploads = 0;   // stage() calls
+		std::uint32_t batches = 0;   // TransferQueue submits
+		std::uint32_t stalls = 0;    // host waits for ring space or finish()
+		std::uint32_t oversized = 0; // staged in a buffer of their own
+	};
+
+	// Batched uploads through a persistent staging ring
+	// stage() copies the data into one persistently mapped ring buffer and
+	// returns where; the caller records the copies out of it into batch() and
+	// hands the results over with handoff(). All uploads go into the open
+	// TransferQueue batch, which is submitted by flush(): explicitly, when it
+	// holds more than a quarter of the ring or, from update(), when it has been
+	// open for longer than the flush interval. Ring space is recycled once the
+	// graphics timeline passes the batch that used it; the host only waits when
+	// the ring is full. Uploads larger than a quarter of the ring get a staging
+	// buffer of their own, released with their batch. Work that uses an upload
+	// must be submitted to the graphics queue after the flush() of its batch.
+	class UploadManager final
+	{
+		public:
+			struct Staging
+			{
+				VkBuffer     buffer;
+				VkDeviceSize offset;
+			};
+
+			static constexpr VkDeviceSize kDefaultRingSize = VkDeviceSize(64) << 20;
+			static constexpr std::chrono::milliseconds kDefaultFlushInterval{ 4 };
+
+		public:
+			UploadManager() noexcept = default;
+
+			// aGraphics: the timeline of the graphics queue; must outlive this
+			UploadManager( VulkanContext const&, Allocator const&, Timeline& aGraphics, VkDeviceSize aRingSize = kDefaultRingSize, std::chrono::milliseconds aFlushInterval = kDefaultFlushInterval );
+
+			// valid until the next stage(), flush() or update(); opens a batch
+			Staging stage( void const* aData, VkDeviceSize aSize );
+
+			// the open batch, to record the copies out of the last stage() into
+			TransferQueue::Batch const& batch() const noexcept { return mBatch; }
+
+			void handoff( VkBuffer aBuffer, VkPipelineStageFlags2 aDstStages, VkAccessFlags2 aDstAccess ) const
+			{
+				mQueue.handoff( mBatch, aBuffer, aDstStages, aDstAccess );
+			}
+			void handoff( VkImage aImage, VkImageLayout aLayout, VkImageSubresourceRange aRange, VkPipelineStageFlags2 aDstStages, VkAccessFlags2 aDstAccess ) const
+			{
+				mQueue.handoff( mBatch, aImage, aLayout, aRange, aDstStages, aDstAccess );
+			}
+
+			// a whole buffer: stage, copy and handoff
+			void upload( VkBuffer aDst, void const* aData, VkDeviceSize aSize, VkPipelineStageFlags2 aDstStages, VkAccessFlags2 aDstAccess );
+
+			// submits the open batch, if any; returns the graphics timeline value
+			// after which everything uploaded so far may be used
+			std::uint64_t flush();
+
+			// flush() and wait for it on the host
+			void finish();
+
+			// time threshold and recycling; once per frame
+			void update();
+
+			UploadStats const& stats() const noexcept { return mStats; }
+
+		private:
+			struct Region
+			{
+				std::uint64_t value; // graphics timeline
+				VkDeviceSize  end;   // ring head after the batch
+			};
+
+			VkDeviceSize allocate( VkDeviceSize aSize );
+			void recycle();
+
+			TransferQueue        mQueue;
+			Timeline*            mGraphics = nullptr;
+			Buffer               mRing;
+			Allocator const*     mAllocator = nullptr;
+			std::byte*           mMapped = nullptr;
+			VkDeviceSize         mSize = 0, mAlignment = 16;
+			VkDeviceSize         mHead = 0, mTail = 0;
+			std::deque<Region>   mRegions;
+
+			TransferQueue::Batch mBatch;
+			bool                 mOpen = false;
+			VkDeviceSize         mBatchBytes = 0;
+			std::chrono::milliseconds mFlushInterval = kDefaultFlushInterval;
+			std::chrono::steady_clock::time_point mOpened;
+			std::uint64_t        mLastValue = 0;
+
+			UploadStats          mStats;
+	};
+}
+
+#endif // UPLOAD_HPP_9E2B6C40_7A1D_4C85_B3F2_1D8A5E7C3B69
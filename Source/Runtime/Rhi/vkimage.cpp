@@ -2,6 +2,8 @@
 
 #include <limits>
 #include <bit>
+#include <array>
+#include <cmath>
 #include <print>
 #include <vector>
 #include <utility>
@@ -20,6 +22,62 @@
 
 // SOLUTION_TAGS: vulkan-(ex-[^123]|cw-.)
 
+namespace
+{
+	// RGBA8 level below aSrc, 2x2 box filter (edge texels repeat for odd sizes);
+	// sRGB colour is averaged in linear space, like the blits do
+	void downsample_rgba8( std::uint8_t const* aSrc, std::uint32_t aWidth, std::uint32_t aHeight, std::uint8_t* aDst, bool aSrgb )
+	{
+		static auto const toLinear = [] {
+			std::array<float, 256> ret{};
+			for( std::size_t i = 0; i < ret.size(); ++i )
+			{
+				float const c = float(i) / 255.f;
+				ret[i] = c <= 0.04045f ? c / 12.92f : std::pow( (c + 0.055f) / 1.055f, 2.4f );
+			}
+			return ret;
+		}();
+		static auto const toSrgb = [] {
+			std::array<std::uint8_t, 4096> ret{};
+			for( std::size_t i = 0; i < ret.size(); ++i )
+			{
+				float const l = float(i) / float(ret.size() - 1);
+				float const c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow( l, 1.f / 2.4f ) - 0.055f;
+				ret[i] = std::uint8_t(c * 255.f + 0.5f);
+			}
+			return ret;
+		}();
+
+		std::uint32_t const w = std::max( 1u, aWidth / 2 ), h = std::max( 1u, aHeight / 2 );
+		for( std::uint32_t y = 0; y < h; ++y )
+		{
+			std::uint32_t const y0 = std::min( 2 * y, aHeight - 1 ), y1 = std::min( 2 * y + 1, aHeight - 1 );
+			for( std::uint32_t x = 0; x < w; ++x )
+			{
+				std::uint32_t const x0 = std::min( 2 * x, aWidth - 1 ), x1 = std::min( 2 * x + 1, aWidth - 1 );
+				std::uint8_t const* texels[4] = {
+					aSrc + 4 * (y0 * aWidth + x0), aSrc + 4 * (y0 * aWidth + x1),
+					aSrc + 4 * (y1 * aWidth + x0), aSrc + 4 * (y1 * aWidth + x1)
+				};
+
+				std::uint8_t* out = aDst + 4 * (y * w + x);
+				for( std::size_t c = 0; c < 4; ++c )
+				{
+					if( aSrgb && c < 3 )
+					{
+						float const l = 0.25f * (toLinear[texels[0][c]] + toLinear[texels[1][c]] + toLinear[texels[2][c]] + toLinear[texels[3][c]]);
+						out[c] = toSrgb[std::size_t(l * float(toSrgb.size() - 1) + 0.5f)];
+					}
+					else
+					{
+						out[c] = std::uint8_t((texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+					}
+				}
+			}
+		}
+	}
+}
+
 
 namespace labut2
 {
@@ -29,8 +87,8 @@ namespace labut2
 	{
 		if( VK_NULL_HANDLE != image )
 		{
+			// no allocation: bound to memory owned elsewhere (see Allocation)
 			assert( VK_NULL_HANDLE != mAllocator );
-			assert( VK_NULL_HANDLE != allocation );
 			vmaDestroyImage( mAllocator, image, allocation );
 		}
 	}
@@ -97,7 +155,7 @@ namespace labut2
 
 namespace labut2
 {
-	Image load_image_texture2d( char const* aPath, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator, VkFormat format )
+	Image load_image_texture2d( char const* aPath, UploadManager& aUploads, Allocator const& aAllocator, VkFormat format )
 	{
 		// load base image
 		int width = 0, height = 0, channels = 0;
@@ -111,218 +169,18 @@ namespace labut2
 			);
 		}
 
-        // create staging buffer
-		std::size_t const size = std::size_t(width) * std::size_t(height) * 4;
-		Buffer staging = create_buffer(
-			aAllocator,
-			size,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
-		);
-
-        // copy data to staging buffer
-		void* ptr = nullptr;
-		if( auto const res = vmaMapMemory( aAllocator.allocator, staging.allocation, &ptr ); VK_SUCCESS != res )
+		// the pixels are in the staging buffer once this returns
+		try
 		{
+			Image image = load_image_texture2d_from_memory( data, std::uint32_t(width), std::uint32_t(height), aUploads, aAllocator, format );
 			stbi_image_free( data );
-			throw Error( "Mapping memory for writing\n"
-				"vmaMapMemory() returned {}", to_string(res)
-			);
-		}
-
-		std::memcpy( ptr, data, size );
-		vmaUnmapMemory( aAllocator.allocator, staging.allocation );
-		stbi_image_free( data );
-
-        // create gpu image
-		Image image = create_image_texture2d(
-			aAllocator,
-			std::uint32_t(width),
-			std::uint32_t(height),
-			format,
-			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
-		);
-
-        // begin command buffer
-		VkCommandBuffer cmdBuff = alloc_command_buffer( aContext, aCmdPool );
-
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		
-		if( auto const res = vkBeginCommandBuffer( cmdBuff, &beginInfo ); VK_SUCCESS != res )
-		{
-			throw Error( "Beginning command buffer recording\n"
-				"vkBeginCommandBuffer() returned {}", to_string(res)
-			);
-		}
-
-
-        // transition entire image to transfer destination
-		// to TRANSFER_DST_OPTIMAL
-		image_barrier(
-			cmdBuff,
-			image.image,
-			VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
-			0,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_PIPELINE_STAGE_2_COPY_BIT,
-			VK_ACCESS_2_TRANSFER_WRITE_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, VK_REMAINING_MIP_LEVELS,
-				0, 1
-			}
-		);
-
-        // copy staging buffer to image level 0
-		VkBufferImageCopy copy{};
-		copy.bufferOffset = 0;
-		copy.bufferRowLength = 0;
-		copy.bufferImageHeight = 0;
-		copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		copy.imageSubresource.mipLevel = 0;
-		copy.imageSubresource.baseArrayLayer = 0;
-		copy.imageSubresource.layerCount = 1;
-		copy.imageOffset = { 0, 0, 0 };
-       	copy.imageExtent = { std::uint32_t(width), std::uint32_t(height), 1 };
-
-		vkCmdCopyBufferToImage( cmdBuff, staging.buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy );
-
-        // compute mip count
-		std::uint32_t const mipLevels = compute_mip_level_count( width, height );
-		
-        // barrier before blits
-
-
-        // transition base level for reading
-		// to TRANSFER_SRC_OPTIMAL
-		image_barrier(
-			cmdBuff,
-			image.image,
-			VK_PIPELINE_STAGE_2_COPY_BIT,
-			VK_ACCESS_2_TRANSFER_WRITE_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_PIPELINE_STAGE_2_BLIT_BIT,
-			VK_ACCESS_2_TRANSFER_READ_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, 1,
-				0, 1
-			}
-		);
-
-        
-		// generate mip levels
-		for( std::uint32_t i = 1; i < mipLevels; ++i )
-		{
-			VkImageBlit blit{};
-			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.srcSubresource.layerCount = 1;
-			blit.srcSubresource.mipLevel = i-1;
-			blit.srcOffsets[0] = { 0, 0, 0 };
-			blit.srcOffsets[1] = {
-				std::int32_t(width >> (i-1)) > 0 ? std::int32_t(width >> (i-1)) : 1,
-				std::int32_t(height >> (i-1)) > 0 ? std::int32_t(height >> (i-1)) : 1,
-				1
-			};
-
-			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.dstSubresource.layerCount = 1;
-			blit.dstSubresource.mipLevel = i;
-			blit.dstOffsets[0] = { 0, 0, 0 };
-			blit.dstOffsets[1] = {
-				std::int32_t(width >> i) > 0 ? std::int32_t(width >> i) : 1,
-				std::int32_t(height >> i) > 0 ? std::int32_t(height >> i) : 1,
-				1
-			};
-			
-            // blit previous mip to next
-			vkCmdBlitImage(
-				cmdBuff,
-				image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1, &blit,
-				VK_FILTER_LINEAR
-			);
-
-            
-			// transition level for next read
-			// to TRANSFER_SRC_OPTIMAL
-			image_barrier(
-				cmdBuff,
-				image.image,
-				VK_PIPELINE_STAGE_2_BLIT_BIT,
-				VK_ACCESS_2_TRANSFER_WRITE_BIT,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				VK_PIPELINE_STAGE_2_BLIT_BIT,
-				VK_ACCESS_2_TRANSFER_READ_BIT,
-				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				VkImageSubresourceRange{
-					VK_IMAGE_ASPECT_COLOR_BIT,
-					i, 1,
-					0, 1
-				}
-			);
-		}
-
-        // final transition for shader reads
-		// to SHADER_READ_ONLY_OPTIMAL
-		image_barrier(
-			cmdBuff,
-			image.image,
-			VK_PIPELINE_STAGE_2_BLIT_BIT,
-			VK_ACCESS_2_TRANSFER_READ_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
-			VK_ACCESS_2_SHADER_READ_BIT,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, mipLevels,
-				0, 1
-			}
-		);
-
-
-        // end command buffer
-		if( auto const res = vkEndCommandBuffer( cmdBuff ); VK_SUCCESS != res )
-		{
-			throw Error( "Ending command buffer recording\n"
-				"vkEndCommandBuffer() returned {}", to_string(res)
-			);
-		}
-
-        // submit and wait
-		Fence uploadComplete = create_fence( aContext.device );
-		
-		VkCommandBufferSubmitInfo submit[1]{};
-		submit[0].sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
-		submit[0].commandBuffer = cmdBuff;
-
-		VkSubmitInfo2 submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
-		submitInfo.commandBufferInfoCount = 1;
-		submitInfo.pCommandBufferInfos = submit;
-
-		if( auto const res = vkQueueSubmit2( aContext.graphicsQueue, 1, &submitInfo, uploadComplete.handle ); VK_SUCCESS != res )
-		{
-			throw Error( "Unable to submit command buffer to queue\n"
-				"vkQueueSubmit2() returned {}", to_string(res)
-			);
+			return image;
 		}
-
-		if( auto const res = vkWaitForFences( aContext.device, 1, &uploadComplete.handle, VK_TRUE, std::numeric_limits<std::uint64_t>::max() ); VK_SUCCESS != res )
+		catch( ... )
 		{
-
-			throw Error( "Waiting for upload to complete\n"
-				"vkWaitForFences() returned {}", to_string(res)
-			);
+			stbi_image_free( data );
+			throw;
 		}
-
-		return image;
 	}
 
 	Image create_image_texture2d( Allocator const& aAllocator, std::uint32_t aWidth, std::uint32_t aHeight, VkFormat aFormat, VkImageUsageFlags aUsage )
@@ -366,55 +224,43 @@ namespace labut2
 
 	Image load_image_texture2d_from_memory(
 		void const* aPixels, std::uint32_t aWidth, std::uint32_t aHeight,
-		VulkanContext const& aContext, VkCommandPool aCmdPool,
-		Allocator const& aAllocator, VkFormat format)
+		UploadManager& aUploads, Allocator const& aAllocator, VkFormat format)
 	{
 		//pixels size
 		std::size_t const size = std::size_t(aWidth) * std::size_t(aHeight) * 4;
 
-		// staging buffer
-		Buffer staging = create_buffer(
-			aAllocator, size,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
-		);
-
-		void* ptr = nullptr;
-		if (auto const res = vmaMapMemory(aAllocator.allocator, staging.allocation, &ptr); VK_SUCCESS != res)
-			throw Error("Mapping staging memory\nvmaMapMemory() returned {}", to_string(res));
-
-		std::memcpy(ptr, aPixels, size);
-
-		vmaUnmapMemory(aAllocator.allocator, staging.allocation);
-
-		// following is the same as load_image_texture2d 
 		Image image = create_image_texture2d(
 			aAllocator, aWidth, aHeight, format,
 			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
 		);
 
-		VkCommandBuffer cmdBuff = alloc_command_buffer(aContext, aCmdPool);
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		vkBeginCommandBuffer(cmdBuff, &beginInfo);
+		std::uint32_t const mipLevels = compute_mip_level_count(aWidth, aHeight);
+		VkImageSubresourceRange const allLevels{ VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+
+		auto const staging = aUploads.stage(aPixels, size);
+		auto const& batch = aUploads.batch();
 
-		image_barrier(cmdBuff, image.image,
-			VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED,
+		// transfer queue: level 0
+		image_barrier(batch.transfer, image.image,
+			VK_PIPELINE_STAGE_2_NONE, 0, VK_IMAGE_LAYOUT_UNDEFINED,
 			VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, 1 }
+			allLevels
 		);
 
 		VkBufferImageCopy copy{};
+		copy.bufferOffset = staging.offset;
 		copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
 		copy.imageExtent = { aWidth, aHeight, 1 };
-		vkCmdCopyBufferToImage(cmdBuff, staging.buffer, image.image,
+		vkCmdCopyBufferToImage(batch.transfer, staging.buffer, image.image,
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
 
-		std::uint32_t const mipLevels = compute_mip_level_count(aWidth, aHeight);
+		// graphics queue: the mip chain (blits need a graphics queue)
+		aUploads.handoff(image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, allLevels,
+			VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT
+		);
 
-		image_barrier(cmdBuff, image.image,
+		image_barrier(batch.graphics, image.image,
 			VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
 			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 			VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
@@ -435,12 +281,12 @@ namespace labut2
 				std::max(1, std::int32_t(aWidth >> i)),
 				std::max(1, std::int32_t(aHeight >> i)), 1
 			};
-			vkCmdBlitImage(cmdBuff,
+			vkCmdBlitImage(batch.graphics,
 				image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 				image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 				1, &blit, VK_FILTER_LINEAR);
 
-			image_barrier(cmdBuff, image.image,
+			image_barrier(batch.graphics, image.image,
 				VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
 				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 				VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
@@ -449,30 +295,149 @@ namespace labut2
 			);
 		}
 
-		image_barrier(cmdBuff, image.image,
+		image_barrier(batch.graphics, image.image,
 			VK_PIPELINE_STAGE_2_BLIT_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
 			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
 			VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
 			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 }
+			allLevels
 		);
 
-		vkEndCommandBuffer(cmdBuff);
+		// submitted with the batch, ahead of the frames that sample it
+		return image;
+	}
+
+	bool host_image_copy_supported( VkPhysicalDevice aPhysicalDev, VkFormat aFormat )
+	{
+		VkPhysicalDeviceVulkan14Features vk14{};
+		vk14.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES;
+
+		VkPhysicalDeviceFeatures2 feat{};
+		feat.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		feat.pNext = &vk14;
+		vkGetPhysicalDeviceFeatures2( aPhysicalDev, &feat );
+
+		// enabled by fill_device_features() whenever it is supported
+		if( !vk14.hostImageCopy )
+			return false;
+
+		VkFormatProperties3 props3{};
+		props3.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3;
+
+		VkFormatProperties2 props{};
+		props.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2;
+		props.pNext = &props3;
+		vkGetPhysicalDeviceFormatProperties2( aPhysicalDev, aFormat, &props );
 
-		Fence uploadComplete = create_fence(aContext.device);
-		VkCommandBufferSubmitInfo submit[1]{};
-		submit[0].sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
-		submit[0].commandBuffer = cmdBuff;
-		VkSubmitInfo2 submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
-		submitInfo.commandBufferInfoCount = 1;
-		submitInfo.pCommandBufferInfos = submit;
-		vkQueueSubmit2(aContext.graphicsQueue, 1, &submitInfo, uploadComplete.handle);
-		vkWaitForFences(aContext.device, 1, &uploadComplete.handle, VK_TRUE,
-			std::numeric_limits<std::uint64_t>::max());
+		return 0 != (props3.optimalTilingFeatures & VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT);
+	}
+
+	VkImageLayout host_image_copy_layout( VkPhysicalDevice aPhysicalDev )
+	{
+		VkPhysicalDeviceHostImageCopyProperties hostCopy{};
+		hostCopy.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES;
+
+		VkPhysicalDeviceProperties2 props{};
+		props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		props.pNext = &hostCopy;
+		vkGetPhysicalDeviceProperties2( aPhysicalDev, &props );
+
+		std::vector<VkImageLayout> dstLayouts( hostCopy.copyDstLayoutCount );
+		hostCopy.pCopyDstLayouts = dstLayouts.data();
+		vkGetPhysicalDeviceProperties2( aPhysicalDev, &props );
+
+		if( dstLayouts.end() != std::find( dstLayouts.begin(), dstLayouts.end(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ) )
+			return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		return VK_IMAGE_LAYOUT_GENERAL;
+	}
+
+	std::vector<std::uint8_t> build_mips_rgba8( void const* aPixels, std::uint32_t aWidth, std::uint32_t aHeight, bool aSrgb )
+	{
+		std::uint32_t const mipLevels = compute_mip_level_count( aWidth, aHeight );
+
+		std::size_t mipBytes = 0;
+		for( std::uint32_t i = 1; i < mipLevels; ++i )
+			mipBytes += std::size_t(std::max( 1u, aWidth >> i )) * std::max( 1u, aHeight >> i ) * 4;
+
+		std::vector<std::uint8_t> mips( mipBytes );
+		auto const* src = static_cast<std::uint8_t const*>(aPixels);
+		std::size_t offset = 0;
+		for( std::uint32_t i = 1; i < mipLevels; ++i )
+		{
+			std::uint32_t const w = std::max( 1u, aWidth >> (i-1) ), h = std::max( 1u, aHeight >> (i-1) );
+			downsample_rgba8( src, w, h, mips.data() + offset, aSrgb );
+
+			src = mips.data() + offset;
+			offset += std::size_t(std::max( 1u, w / 2 )) * std::max( 1u, h / 2 ) * 4;
+		}
+
+		return mips;
+	}
+
+	Image load_image_texture2d_host(
+		void const* aPixels, std::uint32_t aWidth, std::uint32_t aHeight,
+		std::span<std::uint8_t const> aMips,
+		VulkanContext const& aContext, Allocator const& aAllocator, VkFormat format, VkImageLayout aCopyLayout )
+	{
+		std::uint32_t const mipLevels = compute_mip_level_count( aWidth, aHeight );
+
+		Image image = create_image_texture2d( aAllocator, aWidth, aHeight, format,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_HOST_TRANSFER_BIT
+		);
+
+		VkImageSubresourceRange const allLevels{ VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+
+		// the only transition: the image is sampled in aCopyLayout
+		VkHostImageLayoutTransitionInfo transition{};
+		transition.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO;
+		transition.image = image.image;
+		transition.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		transition.newLayout = aCopyLayout;
+		transition.subresourceRange = allLevels;
+
+		if( auto const res = vkTransitionImageLayout( aContext.device, 1, &transition ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to transition image layout on the host\n"
+				"vkTransitionImageLayout() returned {}", to_string(res)
+			);
+		}
+
+		// level 0 from aPixels, the others packed in aMips
+		std::vector<VkMemoryToImageCopy> regions( mipLevels );
+		std::size_t offset = 0;
+		for( std::uint32_t i = 0; i < mipLevels; ++i )
+		{
+			std::uint32_t const w = std::max( 1u, aWidth >> i ), h = std::max( 1u, aHeight >> i );
+
+			auto& region = regions[i];
+			region.sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY;
+			region.pHostPointer = 0 == i ? aPixels : aMips.data() + offset;
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1 };
+			region.imageExtent = { w, h, 1 };
+
+			if( i > 0 )
+				offset += std::size_t(w) * h * 4;
+		}
+		assert( offset == aMips.size() );
+
+		VkCopyMemoryToImageInfo copyInfo{};
+		copyInfo.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO;
+		copyInfo.dstImage = image.image;
+		copyInfo.dstImageLayout = aCopyLayout;
+		copyInfo.regionCount = mipLevels;
+		copyInfo.pRegions = regions.data();
+
+		if( auto const res = vkCopyMemoryToImage( aContext.device, &copyInfo ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to copy memory to image\n"
+				"vkCopyMemoryToImage() returned {}", to_string(res)
+			);
+		}
 
 		return image;
 	}
+
 	std::uint32_t compute_mip_level_count( std::uint32_t aWidth, std::uint32_t aHeight )
 	{
 		std::uint32_t const bits = aWidth | aHeight;
@@ -5,7 +5,12 @@
 #include <volk/volk.h>
 #include <vk_mem_alloc.h>
 
+#include <span>
+#include <vector>
+#include <cstdint>
+
 #include "allocator.hpp"
+#include "upload.hpp"
 
 namespace labut2
 {
@@ -48,13 +53,37 @@ namespace labut2
 	};
 
 
-	Image load_image_texture2d( char const* aPath, VulkanContext const&, VkCommandPool, Allocator const&, VkFormat format );
+	// recorded into aUploads' open batch: copied on the transfer queue, mips
+	// generated on the graphics queue; usable once the batch is flushed
+	Image load_image_texture2d( char const* aPath, UploadManager& aUploads, Allocator const&, VkFormat format );
 
 	Image create_image_texture2d( Allocator const&, std::uint32_t aWidth, std::uint32_t aHeight, VkFormat, VkImageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT );
 
 	Image load_image_texture2d_from_memory(
 		void const* aPixels, std::uint32_t aWidth, std::uint32_t aHeight,
-		VulkanContext const&, VkCommandPool, Allocator const&, VkFormat format);
+		UploadManager&, Allocator const&, VkFormat format);
+
+	// Host image copy (Vulkan 1.4 hostImageCopy): the host fills the image with
+	// vkCopyMemoryToImage(), the mips built on the CPU by build_mips_rgba8(); no
+	// staging buffer, command buffer or queue work. The image stays in
+	// aCopyLayout, which its descriptors must name, and is usable by any later
+	// submission when this returns. aCopyLayout comes from
+	// host_image_copy_layout(), queried once.
+	bool host_image_copy_supported( VkPhysicalDevice, VkFormat );
+
+	// SHADER_READ_ONLY_OPTIMAL if the device lists it as a host copy destination
+	// layout, else GENERAL (a host transition may only go to such a layout, so
+	// the image is sampled in GENERAL then)
+	VkImageLayout host_image_copy_layout( VkPhysicalDevice );
+
+	// RGBA8 levels 1.. of an aWidth x aHeight image, 2x2 box filtered and packed
+	// level after level; sRGB colour is averaged in linear space
+	std::vector<std::uint8_t> build_mips_rgba8( void const* aPixels, std::uint32_t aWidth, std::uint32_t aHeight, bool aSrgb );
+
+	Image load_image_texture2d_host(
+		void const* aPixels, std::uint32_t aWidth, std::uint32_t aHeight,
+		std::span<std::uint8_t const> aMips,
+		VulkanContext const&, Allocator const&, VkFormat format, VkImageLayout aCopyLayout );
 
 	std::uint32_t compute_mip_level_count( std::uint32_t aWidth, std::uint32_t aHeight );
 
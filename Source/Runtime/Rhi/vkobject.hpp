@@ -97,6 +97,8 @@ namespace labut2
 	using Fence = UniqueHandle< VkFence, VkDevice, vkDestroyFence >;
 	using Semaphore = UniqueHandle< VkSemaphore, VkDevice, vkDestroySemaphore >;
 
+	using QueryPool = UniqueHandle< VkQueryPool, VkDevice, vkDestroyQueryPool >;
+
 	using ImageView = UniqueHandle< VkImageView, VkDevice, vkDestroyImageView >;
 	using Sampler = UniqueHandle< VkSampler, VkDevice, vkDestroySampler >;
 }
@@ -52,6 +52,8 @@ namespace labut2
 		, device( std::exchange( aOther.device, VK_NULL_HANDLE ) )
 		, graphicsFamilyIndex( aOther.graphicsFamilyIndex )
 		, graphicsQueue( std::exchange( aOther.graphicsQueue, VK_NULL_HANDLE ) )
+		, transferFamilyIndex( aOther.transferFamilyIndex )
+		, transferQueue( std::exchange( aOther.transferQueue, VK_NULL_HANDLE ) )
 		, debugMessenger( std::exchange( aOther.debugMessenger, VK_NULL_HANDLE ) )
 	{}
 
@@ -73,6 +75,8 @@ namespace labut2
 		std::swap( device, aOther.device );
 		std::swap( graphicsFamilyIndex, aOther.graphicsFamilyIndex );
 		std::swap( graphicsQueue, aOther.graphicsQueue );
+		std::swap( transferFamilyIndex, aOther.transferFamilyIndex );
+		std::swap( transferQueue, aOther.transferQueue );
 		std::swap( debugMessenger, aOther.debugMessenger );
 		return *this;
 	}
@@ -157,6 +161,10 @@ namespace labut2
 
 		assert( VK_NULL_HANDLE != ret.graphicsQueue );
 
+		// single queue: transfers go through the graphics queue
+		ret.transferFamilyIndex = ret.graphicsFamilyIndex;
+		ret.transferQueue = ret.graphicsQueue;
+
 		// Done
 		return ret;
 	}
@@ -193,28 +201,18 @@ namespace
 		queueInfo.queueCount        = 1;
 		queueInfo.pQueuePriorities  = queuePriorities;
 
-		VkPhysicalDeviceFeatures deviceFeatures{};
-		// No extra Vulkan 1.0 features for now.
-
-		VkPhysicalDeviceVulkan13Features vk13{};
-		vk13.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
-		vk13.synchronization2  = VK_TRUE;
-		vk13.dynamicRendering  = VK_TRUE;
+		labut2::detail::DeviceFeatures features;
+		labut2::detail::fill_device_features( aPhysicalDev, features );
 
-		VkPhysicalDeviceVulkan14Features vk14{};
-		vk14.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES;
-		vk14.pNext  = &vk13;
-		vk14.maintenance5  = VK_TRUE; // Required in Vulkan 1.4, but we need to say that we want it.
-		
 		VkDeviceCreateInfo deviceInfo{};
 		deviceInfo.sType  = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
 		deviceInfo.queueCreateInfoCount  = 1;
 		deviceInfo.pQueueCreateInfos     = &queueInfo;
 
-		deviceInfo.pEnabledFeatures      = &deviceFeatures;
+		deviceInfo.pEnabledFeatures      = &features.core;
 
-		deviceInfo.pNext                 = &vk14;
+		deviceInfo.pNext                 = &features.vk14;
 
 		VkDevice device = VK_NULL_HANDLE;
 		if( auto const res = vkCreateDevice( aPhysicalDev, &deviceInfo, nullptr, &device ); VK_SUCCESS != res )
@@ -30,6 +30,11 @@ namespace labut2
 			std::uint32_t graphicsFamilyIndex = 0;
 			VkQueue graphicsQueue = VK_NULL_HANDLE;
 
+			// a transfer-only family's queue where there is one, otherwise the
+			// graphics queue again (see TransferQueue)
+			std::uint32_t transferFamilyIndex = 0;
+			VkQueue transferQueue = VK_NULL_HANDLE;
+
 			
 			VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
 	};
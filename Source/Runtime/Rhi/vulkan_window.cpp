@@ -30,6 +30,7 @@ namespace
 	float score_device( VkPhysicalDevice, VkSurfaceKHR );
 
 	std::optional<std::uint32_t> find_queue_family( VkPhysicalDevice, VkQueueFlags, VkSurfaceKHR = VK_NULL_HANDLE );
+	std::optional<std::uint32_t> find_transfer_queue_family( VkPhysicalDevice );
 
 	VkDevice create_device( 
 		VkPhysicalDevice,
@@ -278,7 +279,14 @@ namespace labut2
         }
 
 
-		ret.device = create_device( ret.physicalDevice, queueFamilyIndices, enabledDevExensions );
+		// uploads: a transfer-only family (DMA engine) if the device has one,
+		// requested in addition to the above; the swapchain is not shared with it
+		std::vector<std::uint32_t> deviceQueueFamilies = queueFamilyIndices;
+		auto const transfer = find_transfer_queue_family( ret.physicalDevice );
+		if( transfer && deviceQueueFamilies.end() == std::find( deviceQueueFamilies.begin(), deviceQueueFamilies.end(), *transfer ) )
+			deviceQueueFamilies.emplace_back( *transfer );
+
+		ret.device = create_device( ret.physicalDevice, deviceQueueFamilies, enabledDevExensions );
 
 		// Retrieve VkQueues
 		vkGetDeviceQueue( ret.device, ret.graphicsFamilyIndex, 0, &ret.graphicsQueue );
@@ -293,6 +301,18 @@ namespace labut2
 			ret.presentQueue = ret.graphicsQueue;
 		}
 
+		if( deviceQueueFamilies.size() > queueFamilyIndices.size() )
+		{
+			ret.transferFamilyIndex = *transfer;
+			vkGetDeviceQueue( ret.device, ret.transferFamilyIndex, 0, &ret.transferQueue );
+			std::print( stderr, "Using transfer queue family {}\n", ret.transferFamilyIndex );
+		}
+		else
+		{
+			ret.transferFamilyIndex = ret.graphicsFamilyIndex;
+			ret.transferQueue = ret.graphicsQueue;
+		}
+
 		// Create swap chain
 		std::tie(ret.swapchain, ret.swapchainFormat, ret.swapchainExtent) = create_swapchain( ret.physicalDevice, ret.surface, ret.device, ret.window, queueFamilyIndices );
 		
@@ -468,6 +488,11 @@ namespace
 		chainInfo.imageExtent = extent;
 		chainInfo.imageArrayLayers = 1;
 		chainInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+		// blit target of the compute post-processing path, where supported
+		if( caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT )
+			chainInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
 		chainInfo.preTransform = caps.currentTransform;
 		chainInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 		chainInfo.presentMode = presentMode;
@@ -613,6 +638,32 @@ namespace
 		return {};
 	}
 
+	std::optional<std::uint32_t> find_transfer_queue_family( VkPhysicalDevice aPhysicalDev )
+	{
+		std::uint32_t numQueues = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties( aPhysicalDev, &numQueues, nullptr );
+
+		std::vector<VkQueueFamilyProperties> families( numQueues );
+		vkGetPhysicalDeviceQueueFamilyProperties( aPhysicalDev, &numQueues, families.data() );
+
+		// prefer TRANSFER alone (the copy engine), then any family without GRAPHICS
+		std::optional<std::uint32_t> ret;
+		for( std::uint32_t i = 0; i < numQueues; ++i )
+		{
+			auto const flags = families[i].queueFlags;
+			if( !(VK_QUEUE_TRANSFER_BIT & flags) || (VK_QUEUE_GRAPHICS_BIT & flags) )
+				continue;
+
+			if( !(VK_QUEUE_COMPUTE_BIT & flags) )
+				return i;
+
+			if( !ret )
+				ret = i;
+		}
+
+		return ret;
+	}
+
 	VkDevice create_device( VkPhysicalDevice aPhysicalDev, std::vector<std::uint32_t> const& aQueues, std::vector<char const*> const& aEnabledExtensions )
 	{
 		if( aQueues.empty() )
@@ -630,18 +681,8 @@ namespace
 			queueInfo.pQueuePriorities  = queuePriorities;
 		}
 
-		VkPhysicalDeviceFeatures deviceFeatures{};
-		// No extra Vulkan 1.0 features for now.
-
-		VkPhysicalDeviceVulkan13Features vk13{};
-		vk13.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
-		vk13.synchronization2  = VK_TRUE;
-		vk13.dynamicRendering  = VK_TRUE;
-
-		VkPhysicalDeviceVulkan14Features vk14{};
-		vk14.sType  = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_4_FEATURES;
-		vk14.pNext  = &vk13;
-		vk14.maintenance5  = VK_TRUE; // Required in Vulkan 1.4, but we need to say that we want it.
+		lut::detail::DeviceFeatures features;
+		lut::detail::fill_device_features( aPhysicalDev, features );
 
 		VkDeviceCreateInfo deviceInfo{};
 		deviceInfo.sType  = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -652,9 +693,9 @@ namespace
 		deviceInfo.enabledExtensionCount    = std::uint32_t(aEnabledExtensions.size());
 		deviceInfo.ppEnabledExtensionNames  = aEnabledExtensions.data();
 
-		deviceInfo.pEnabledFeatures         = &deviceFeatures;
+		deviceInfo.pEnabledFeatures         = &features.core;
 
-		deviceInfo.pNext                    = &vk14;
+		deviceInfo.pNext                    = &features.vk14;
 
 		VkDevice device = VK_NULL_HANDLE;
 		if( auto const res = vkCreateDevice( aPhysicalDev, &deviceInfo, nullptr, &device ); VK_SUCCESS != res )